@@ -1,8 +1,10 @@
 #include "Application.h"
+#include "Shaders/Shader.h"
 #include <map>
 #include <set>
 #include <cstdint>
 #include <algorithm>
+#include <filesystem>
 
 // extension function, proxy to load vkCreateDebugUtilsMessengerEXT function
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
@@ -206,11 +208,13 @@ int Application::getDeviceScore(VkPhysicalDevice device)
     score += deviceProperties.limits.maxImageDimension2D;
 
     // Application can't function without geometry shaders or complete queue or required extensions
-    if (!deviceFeatures.geometryShader || !indices.isComplete() || !checkDeviceExtensionSupport(device)) {
+    // GPU driven draws pass the instance id through firstInstance
+    if (!deviceFeatures.geometryShader || !deviceFeatures.drawIndirectFirstInstance || !indices.isComplete() || !checkDeviceExtensionSupport(device)) {
         return 0;
     }
 
     // Check for swap chain support, if no support in either format or present return 0
+    ScratchScope scratch;
     SwapChainDetails chainSupport = querySwapChainSupport(device);
     if (chainSupport.formats.empty() || chainSupport.presentModes.empty()) {
         return 0;
@@ -220,20 +224,33 @@ int Application::getDeviceScore(VkPhysicalDevice device)
 }
 
 bool Application::checkDeviceExtensionSupport(VkPhysicalDevice device)
+{
+    for (const char* required : deviceExtensions) {
+        if (!checkOptionalExtensionSupport(device, required)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Application::checkOptionalExtensionSupport(VkPhysicalDevice device, const char* extension)
 {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, &availableExtensions[0]);
+    // temporaries come from the thread's scratch arena, gone when the scope ends
+    ScratchScope scratch;
+    ArenaVector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-    for (const auto& extension : availableExtensions) {
-        requiredExtensions.erase(extension.extensionName);
+    for (const auto& available : availableExtensions) {
+        if (strcmp(extension, available.extensionName) == 0) {
+            return true;
+        }
     }
 
-    return requiredExtensions.empty();
+    return false;
 }
 
 QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device)
@@ -243,8 +260,9 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device)
     uint32_t queueFamilyCount = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, &queueFamilies[0]);
+    ScratchScope scratch;
+    ArenaVector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
@@ -270,6 +288,7 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device)
 
 void Application::createSwapChain()
 {
+    ScratchScope scratch;
     SwapChainDetails swapChainSupport = querySwapChainSupport(physicalDevice);
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
@@ -331,6 +350,7 @@ void Application::createSwapChain()
     swapChainExtent = extent;
 }
 
+// allocates in the caller's scratch scope
 SwapChainDetails Application::querySwapChainSupport(VkPhysicalDevice device)
 {
     SwapChainDetails details;
@@ -356,7 +376,7 @@ SwapChainDetails Application::querySwapChainSupport(VkPhysicalDevice device)
     return details;
 }
 
-VkSurfaceFormatKHR Application::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
+VkSurfaceFormatKHR Application::chooseSwapSurfaceFormat(const ArenaVector<VkSurfaceFormatKHR>& availableFormats)
 {
     for (const auto& availableFormat : availableFormats) {
         if (availableFormat.format == DesiredSurfaceFormat && availableFormat.colorSpace == DesiredColourSpace) {
@@ -367,7 +387,7 @@ VkSurfaceFormatKHR Application::chooseSwapSurfaceFormat(const std::vector<VkSurf
     return availableFormats[0];
 }
 
-VkPresentModeKHR Application::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+VkPresentModeKHR Application::chooseSwapPresentMode(const ArenaVector<VkPresentModeKHR>& availablePresentModes)
 {
     for (const auto& availablePresentMode : availablePresentModes) {
         if (availablePresentMode == DesiredPresentationMode) {
@@ -431,9 +451,119 @@ void Application::createImageViews()
     }
 }
 
+void Application::createResourceManager()
+{
+    resources = std::make_unique<ResourceManager>(physicalDevice, device);
+}
+
+void Application::createDeletionQueue()
+{
+    deletionQueue = std::make_unique<DeletionQueue>(*resources);
+}
+
 void Application::createGraphicsPipeline()
 {
-    pipeline = new GraphicsPipeline(instance, device, swapChainExtent, swapChainImageFormat, "./src/Shaders/testTriangle.vert.spv","./src/Shaders/testTriangle.frag.spv");
+    pipeline = std::make_unique<GraphicsPipeline>(*resources, *deletionQueue, device, swapChainExtent, swapChainImageFormat, "./src/Shaders/testTriangle.vert.spv","./src/Shaders/testTriangle.frag.spv");
+}
+
+void Application::createFileSystem()
+{
+    fileSystem = std::make_unique<VirtualFileSystem>();
+    fileSystem->mountDirectory(".");
+
+    std::error_code error;
+    if (std::filesystem::is_regular_file(PACK_ARCHIVE_PATH, error)) {
+        fileSystem->mountArchive(PACK_ARCHIVE_PATH);
+    }
+    Shader::setFileSystem(fileSystem.get());
+}
+
+void Application::createJobSystem()
+{
+    jobSystem = std::make_unique<JobSystem>();
+}
+
+void Application::createFrameArena()
+{
+    frameArena = std::make_unique<FrameArena>(FRAME_ARENA_SIZE, FRAMES_IN_FLIGHT);
+}
+
+void Application::createWorld()
+{
+    world = std::make_unique<World>();
+}
+
+void Application::createTransformSystem()
+{
+    transforms = std::make_unique<TransformSystem>();
+}
+
+void Application::createGpuCulling()
+{
+    if (!GpuCulling::shadersAvailable()) {
+        std::cout << "GPU Culling unavailable, culling shaders aren't compiled\n";
+        return;
+    }
+
+    gpuCulling = std::make_unique<GpuCulling>(physicalDevice, device, MAX_GPU_INSTANCES, MAX_GPU_MESHES, drawIndirectCountSupported, multiDrawIndirectSupported);
+}
+
+void Application::createDepthPyramid()
+{
+    if (!gpuCulling || !HiZPyramid::shadersAvailable()) {
+        std::cout << "Depth Pyramid unavailable, occlusion culling is off\n";
+        return;
+    }
+
+    depthPyramid = std::make_unique<HiZPyramid>(physicalDevice, device, swapChainExtent);
+    gpuCulling->setDepthPyramid(depthPyramid.get());
+}
+
+void Application::createClusterCulling()
+{
+    if (!gpuCulling || !ClusterCulling::shadersAvailable()) {
+        std::cout << "Cluster Culling unavailable, culling shaders aren't compiled\n";
+        return;
+    }
+    if (!meshShaderSupported && !drawIndirectCountSupported && !multiDrawIndirectSupported) {
+        std::cout << "Cluster Culling unavailable, meshes are culled whole\n";
+        return;
+    }
+
+    clusterCulling = std::make_unique<ClusterCulling>(physicalDevice, device, *gpuCulling, MAX_GPU_MESHLETS, MAX_GPU_CLUSTERS,
+        drawIndirectCountSupported, multiDrawIndirectSupported, meshShaderSupported);
+    clusterCulling->setDepthPyramid(depthPyramid.get());
+}
+
+void Application::createAssetStreamer()
+{
+    assetStreamer = std::make_unique<AssetStreamer>(physicalDevice, device, *jobSystem, *fileSystem, STREAMING_STAGING_SIZE, STREAMING_FRAME_BUDGET);
+}
+
+void Application::createTextureStreamer()
+{
+    memoryBudget = std::make_unique<MemoryBudget>(instance, physicalDevice, memoryBudgetSupported);
+
+    TextureStreamer::Settings settings;
+    settings.maxTextures = MAX_STREAMED_TEXTURES;
+    settings.framesInFlight = FRAMES_IN_FLIGHT;
+    textureStreamer = std::make_unique<TextureStreamer>(physicalDevice, device, *assetStreamer, *deletionQueue, *fileSystem, *memoryBudget, settings);
+}
+
+void Application::createWorldPartition()
+{
+    if (!fileSystem->exists(WORLD_PARTITION_PATH)) {
+        std::cout << "World Partition unavailable, no " << WORLD_PARTITION_PATH << "\n";
+        return;
+    }
+
+    WorldPartition::MeshResolver resolveMesh = [this](const std::string& path) {
+        auto found = std::find(worldMeshes.begin(), worldMeshes.end(), path);
+        if (found != worldMeshes.end()) return (uint32_t)(found - worldMeshes.begin());
+        worldMeshes.push_back(path);
+        return (uint32_t)worldMeshes.size() - 1;
+    };
+    worldPartition = std::make_unique<WorldPartition>(*assetStreamer, *fileSystem, *world, WORLD_PARTITION_PATH, resolveMesh, WorldPartition::Settings());
 }
 
 void Application::createLogicalDevice()
@@ -456,17 +586,42 @@ void Application::createLogicalDevice()
         queueCreateInfoVec.push_back(queueCreateInfo);
     }
 
-    // will use later, enables specific features on device
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+    // enables specific features on device
     VkPhysicalDeviceFeatures deviceFeatures{};
+    // one indirect call for many draws, otherwise the GPU driven path loops per draw
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE;
+    // cooked textures are BC compressed, TextureLoader refuses them when this isn't there
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+    drawIndirectCountSupported = checkOptionalExtensionSupport(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    // both depend on the properties 2 instance extension
+    meshShaderSupported = physicalDeviceProperties2Supported && checkOptionalExtensionSupport(physicalDevice, VK_NV_MESH_SHADER_EXTENSION_NAME);
+    memoryBudgetSupported = physicalDeviceProperties2Supported && checkOptionalExtensionSupport(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    if (drawIndirectCountSupported) enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (meshShaderSupported) enabledExtensions.push_back(VK_NV_MESH_SHADER_EXTENSION_NAME);
+    if (memoryBudgetSupported) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // the extension alone doesn't enable mesh shaders, the feature is chained on the create info
+    VkPhysicalDeviceMeshShaderFeaturesNV meshShaderFeatures{};
+    meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV;
+    meshShaderFeatures.meshShader = VK_TRUE;
 
     // main create structure
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = meshShaderSupported ? &meshShaderFeatures : nullptr;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfoVec.size());
     createInfo.pQueueCreateInfos = &queueCreateInfoVec[0];
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = &deviceExtensions[0];
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = &enabledExtensions[0];
 
     if (enableValidationLayers) {
         // ignored by up-to-date vulkan, but good backwards compatibility
@@ -525,6 +680,12 @@ std::vector<const char*> Application::getRequiredExtensions()
     glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
     std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // instance side dependency of VK_NV_mesh_shader and VK_EXT_memory_budget on 1.0, optional
+    // so instance creation doesn't fail where the loader doesn't have it
+    physicalDeviceProperties2Supported = checkInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    if (physicalDeviceProperties2Supported) {
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
     // if validation layers are enabled, add debug extension
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -533,28 +694,84 @@ std::vector<const char*> Application::getRequiredExtensions()
     return extensions;
 }
 
+bool Application::checkInstanceExtensionSupport(const char* extension)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    ScratchScope scratch;
+    ArenaVector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& available : availableExtensions) {
+        if (strcmp(extension, available.extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void Application::initVulkan()
 {
+    createFileSystem();
+    createJobSystem();
+    createFrameArena();
+    createWorld();
+    createTransformSystem();
     createInstance();
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    createResourceManager();
+    createDeletionQueue();
     createSwapChain();
     createImageViews();
     createGraphicsPipeline();
+    createGpuCulling();
+    createDepthPyramid();
+    createClusterCulling();
+    createAssetStreamer();
+    createTextureStreamer();
+    createWorldPartition();
 }
 
 void Application::mainLoop()
 {
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
+        // what the frame before last allocated is gone
+        frameArena->beginFrame();
+        frame++;
+        deletionQueue->beginFrame(frame);
+        // nothing is submitted yet, so like the frame arena this takes the frame before last as
+        // done. Once frames are fenced it gets the last frame whose fence has signalled
+        if (frame > FRAMES_IN_FLIGHT) deletionQueue->retire(frame - FRAMES_IN_FLIGHT);
+
+        transforms->update(*jobSystem, gpuCulling ? gpuCulling->getInstances() : nullptr);
     }
 }
 
 void Application::cleanup()
 {
-    delete(pipeline);
+    // the only wait on the device, everything below can go right away
+    vkDeviceWaitIdle(device);
+
+    // releases their loads, the streamer still has to be there
+    worldPartition.reset();
+    textureStreamer.reset();
+    memoryBudget.reset();
+    // joins the I/O threads and waits for running decodes before anything they use goes away
+    assetStreamer.reset();
+    clusterCulling.reset();
+    gpuCulling.reset();
+    depthPyramid.reset();
+    pipeline.reset();
+    // what was handed over goes now, some of it through the resource manager
+    deletionQueue.reset();
+    // whatever is still registered goes with it, before the device
+    resources.reset();
 
     for (auto imageView : swapChainImageViews) {
         vkDestroyImageView(device, imageView, nullptr);
@@ -574,4 +791,12 @@ void Application::cleanup()
     glfwDestroyWindow(window);
 
     glfwTerminate();
+
+    transforms.reset();
+    world.reset();
+    jobSystem.reset();
+    frameArena.reset();
+
+    Shader::setFileSystem(nullptr);
+    fileSystem.reset();
 }
@@ -8,9 +8,24 @@
 #include <stdexcept>
 #include <cstdlib>
 #include <vector>
+#include <memory>
 #include <optional>
 
 #include "GraphicsPipeline.h"
+#include "Culling/GpuCulling.h"
+#include "Culling/ClusterCulling.h"
+#include "Jobs/JobSystem.h"
+#include "Memory/Containers.h"
+#include "Memory/FrameArena.h"
+#include "Resources/DeletionQueue.h"
+#include "Resources/ResourceManager.h"
+#include "Assets/AssetStreamer.h"
+#include "Assets/TextureStreamer.h"
+#include "Assets/VirtualFileSystem.h"
+#include "Buffers/MemoryBudget.h"
+#include "Ecs/World.h"
+#include "Scene/TransformSystem.h"
+#include "Scene/WorldPartition.h"
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
@@ -22,10 +37,11 @@ struct QueueFamilyIndices {
     }
 };
 
+// lists live in the caller's scratch scope
 struct SwapChainDetails {
     VkSurfaceCapabilitiesKHR capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR> presentModes;
+    ArenaVector<VkSurfaceFormatKHR> formats;
+    ArenaVector<VkPresentModeKHR> presentModes;
 };
 
 class Application {
@@ -83,6 +99,10 @@ private:
     bool checkValidationLayerSupport();
 
     std::vector<const char*> getRequiredExtensions();
+    bool checkInstanceExtensionSupport(const char* extension);
+    // instance side dependency of the mesh shader and memory budget device extensions on 1.0,
+    // both count as unavailable without it
+    bool physicalDeviceProperties2Supported = false;
 
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
@@ -101,6 +121,7 @@ private:
     void pickPhysicalDevice();
     int getDeviceScore(VkPhysicalDevice device);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkOptionalExtensionSupport(VkPhysicalDevice device, const char* extension);
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     
     VkDevice device;
@@ -108,22 +129,101 @@ private:
     VkQueue graphicsQueue;
     void createLogicalDevice();
 
+    // buffers, images, pipelines and samplers behind generational handles
+    std::unique_ptr<ResourceManager> resources;
+    void createResourceManager();
+
+    // resources are handed over here instead of destroyed, they go once the frames that used
+    // them have finished. Frames count up from 1, 0 is before the first
+    std::unique_ptr<DeletionQueue> deletionQueue;
+    uint64_t frame = 0;
+    void createDeletionQueue();
+
+    // optional device extensions, enabled when present, features fall back when they aren't
+    bool drawIndirectCountSupported = false;
+    bool multiDrawIndirectSupported = false;
+    bool meshShaderSupported = false;
+    bool memoryBudgetSupported = false;
+
     VkSwapchainKHR swapChain;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     void createSwapChain();
     SwapChainDetails querySwapChainSupport(VkPhysicalDevice device);
-    VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+    VkSurfaceFormatKHR chooseSwapSurfaceFormat(const ArenaVector<VkSurfaceFormatKHR>& availableFormats);
+    VkPresentModeKHR chooseSwapPresentMode(const ArenaVector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
     std::vector<VkImageView> swapChainImageViews;
     void createImageViews();
 
-    GraphicsPipeline* pipeline;
+    std::unique_ptr<GraphicsPipeline> pipeline;
     void createGraphicsPipeline();
 
+    // every shader, mesh and texture is loaded through this, the pack archive (if there is one)
+    // is mounted over the working directory
+    const char* PACK_ARCHIVE_PATH = "data.pak";
+    std::unique_ptr<VirtualFileSystem> fileSystem;
+    void createFileSystem();
+
+    // shared scheduler for culling, decoding and recording, the main thread is worker 0
+    std::unique_ptr<JobSystem> jobSystem;
+    void createJobSystem();
+
+    // per frame temporaries, one arena per frame in flight
+    const size_t FRAME_ARENA_SIZE = 1 << 20;
+    std::unique_ptr<FrameArena> frameArena;
+    void createFrameArena();
+
+    // every entity in the scene
+    std::unique_ptr<World> world;
+    void createWorld();
+
+    // scene hierarchy, world matrices go straight into the GPU instance buffer
+    std::unique_ptr<TransformSystem> transforms;
+    void createTransformSystem();
+
+    // instance capacity of the GPU driven path, buffers are sized up front. Empty when the
+    // culling shaders aren't compiled, nothing that depends on it is created then
+    const uint32_t MAX_GPU_INSTANCES = 1 << 18;
+    const uint32_t MAX_GPU_MESHES = 4096;
+    std::unique_ptr<GpuCulling> gpuCulling;
+    void createGpuCulling();
+
+    // two phase occlusion culling, sized from the swap chain's depth. Empty when there is no
+    // GPU culling or depthReduce.comp isn't compiled, culling is frustum only then
+    std::unique_ptr<HiZPyramid> depthPyramid;
+    void createDepthPyramid();
+
+    // per meshlet culling for meshes cooked with meshlets, empty when the device can't draw
+    // an unknown number of clusters. 65535 fits every device's maxDrawMeshTasksCount
+    const uint32_t MAX_GPU_MESHLETS = 1 << 15;
+    const uint32_t MAX_GPU_CLUSTERS = 65535;
+    std::unique_ptr<ClusterCulling> clusterCulling;
+    void createClusterCulling();
+
+    // background loading, uploads are spread over frames through the staging ring
+    const VkDeviceSize STREAMING_STAGING_SIZE = 64 << 20;
+    const VkDeviceSize STREAMING_FRAME_BUDGET = 16 << 20;
+    std::unique_ptr<AssetStreamer> assetStreamer;
+    void createAssetStreamer();
+
+    // device local memory left to the process, the texture streamer plans its mips against it
+    std::unique_ptr<MemoryBudget> memoryBudget;
+    // mip residency of cooked textures, one bindless array element and feedback slot each
+    const uint32_t MAX_STREAMED_TEXTURES = 4096;
+    const uint32_t FRAMES_IN_FLIGHT = 2;
+    std::unique_ptr<TextureStreamer> textureStreamer;
+    void createTextureStreamer();
+
+    // cells of the cooked world around the camera, empty when there is no world to stream.
+    // Mesh ids are handed out in the order cells first reference the meshes
+    const char* WORLD_PARTITION_PATH = "cooked/world.world";
+    std::unique_ptr<WorldPartition> worldPartition;
+    std::vector<std::string> worldMeshes;
+    void createWorldPartition();
+
     void initVulkan();
 
     void mainLoop();
@@ -0,0 +1,179 @@
+#include "AssetCooker.h"
+#include "../Jobs/JobSystem.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+// formats the mesh path is expected to see, anything else in a content directory is ignored
+static const char* MESH_EXTENSIONS[] = { ".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".ply", ".stl", ".blend" };
+static const char* TEXTURE_EXTENSIONS[] = { ".png", ".jpg", ".jpeg", ".tga" };
+
+// regular files below directory with one of the extensions (compared lower case), sorted
+template<size_t N>
+static std::vector<std::filesystem::path> findSources(const std::string& directory, const char* (&extensions)[N])
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+	if (!fs::is_directory(directory, error)) {
+		throw std::runtime_error("ERROR: " + directory + " is not a directory!");
+	}
+
+	std::vector<fs::path> sources;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(directory)) {
+		if (!entry.is_regular_file()) continue;
+
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+		if (std::find(std::begin(extensions), std::end(extensions), extension) != std::end(extensions)) {
+			sources.push_back(entry.path());
+		}
+	}
+	// directory iteration order is unspecified, keep the cook order stable
+	std::sort(sources.begin(), sources.end());
+	return sources;
+}
+
+AssetCooker::AssetCooker(JobSystem& j, const std::string& path)
+	: jobs(j), manifestPath(path)
+{
+	manifest.load(manifestPath);
+}
+
+void AssetCooker::add(const std::string& source, const std::string& output, uint64_t settings, CookFunction cook)
+{
+	assets.push_back({ source, output, settings, cook });
+}
+
+void AssetCooker::addMesh(const std::string& source, const std::string& output, const MeshCooker::Settings& settings)
+{
+	add(source, output, MeshCooker::hashSettings(settings), [settings](const std::string& source, const std::string& output) {
+		MeshCooker::CookedMesh mesh = MeshCooker::import(source, settings);
+		MeshCooker::write(mesh, output);
+		return mesh.dependencies;
+	});
+}
+
+void AssetCooker::addMeshDirectory(const std::string& sourceDirectory, const std::string& outputDirectory, const MeshCooker::Settings& settings)
+{
+	namespace fs = std::filesystem;
+
+	for (const fs::path& source : findSources(sourceDirectory, MESH_EXTENSIONS)) {
+		fs::path output = fs::path(outputDirectory) / fs::relative(source, sourceDirectory);
+		output.replace_extension(".mesh");
+		addMesh(source.generic_string(), output.generic_string(), settings);
+	}
+}
+
+void AssetCooker::addScene(const std::string& source, const std::string& output, const MeshCooker::Settings& settings)
+{
+	add(source, output, SceneCooker::hashSettings(settings), [settings](const std::string& source, const std::string& output) {
+		MeshCooker::CookedMesh mesh = MeshCooker::import(source, SceneCooker::meshSettings(settings));
+		SceneCooker::write(mesh, output);
+		return mesh.dependencies;
+	});
+}
+
+void AssetCooker::addWorld(const std::string& source, const std::string& output, const WorldCooker::Settings& settings)
+{
+	add(source, output, WorldCooker::hashSettings(settings), [settings](const std::string& source, const std::string& output) {
+		MeshCooker::CookedMesh mesh = MeshCooker::import(source, SceneCooker::meshSettings(settings.mesh));
+		WorldCooker::write(mesh, output, settings);
+		return mesh.dependencies;
+	});
+}
+
+void AssetCooker::addTexture(const std::string& source, const std::string& output, const TextureCooker::Settings& settings)
+{
+	JobSystem& workers = jobs;
+	add(source, output, TextureCooker::hashSettings(settings), [&workers, settings](const std::string& source, const std::string& output) {
+		TextureCooker::cook(source, output, workers, settings);
+		return std::vector<std::string>();
+	});
+}
+
+void AssetCooker::addTextureDirectory(const std::string& sourceDirectory, const std::string& outputDirectory, const TextureCooker::Settings& settings)
+{
+	namespace fs = std::filesystem;
+
+	for (const fs::path& source : findSources(sourceDirectory, TEXTURE_EXTENSIONS)) {
+		fs::path output = fs::path(outputDirectory) / fs::relative(source, sourceDirectory);
+		output.replace_extension(".ktx2");
+
+		TextureCooker::Settings textureSettings = settings;
+		textureSettings.usage = TextureCooker::usageFromName(source.string());
+		addTexture(source.generic_string(), output.generic_string(), textureSettings);
+	}
+}
+
+AssetCooker::Stats AssetCooker::run()
+{
+	uint32_t count = (uint32_t)assets.size();
+
+	// the up to date check hashes files too, so it is spread across the workers as well
+	std::vector<uint8_t> stale(count);
+	jobs.parallelFor(count, 1, [&](uint32_t i) {
+		stale[i] = manifest.isStale(assets[i].source, assets[i].settings);
+	});
+
+	std::vector<uint32_t> pending;
+	for (uint32_t i = 0; i < count; i++) {
+		if (stale[i]) pending.push_back(i);
+	}
+
+	// independent assets, one job each. Results go to their own slot and are merged afterwards
+	std::vector<CookRecord> records(pending.size());
+	std::vector<std::string> errors(pending.size());
+	jobs.parallelFor((uint32_t)pending.size(), 1, [&](uint32_t p) {
+		const Asset& asset = assets[pending[p]];
+		try {
+			std::filesystem::path directory = std::filesystem::path(asset.output).parent_path();
+			if (!directory.empty()) std::filesystem::create_directories(directory);
+
+			std::vector<std::string> dependencies = asset.cook(asset.source, asset.output);
+
+			CookRecord& record = records[p];
+			record.source = asset.source;
+			record.output = asset.output;
+			record.settings = asset.settings;
+			record.inputs.push_back(CookManifest::snapshot(asset.source));
+			for (const std::string& dependency : dependencies) {
+				record.inputs.push_back(CookManifest::snapshot(dependency));
+			}
+		}
+		catch (const std::exception& e) {
+			errors[p] = e.what();
+			if (errors[p].empty()) errors[p] = "ERROR: Failed to cook " + asset.source;
+		}
+	});
+
+	Stats stats;
+	stats.skipped = count - (uint32_t)pending.size();
+	for (size_t p = 0; p < pending.size(); p++) {
+		const Asset& asset = assets[pending[p]];
+		if (errors[p].empty()) {
+			manifest.set(records[p]);
+			stats.cooked++;
+			std::cout << "Cooked " << asset.source << " -> " << asset.output << "\n";
+		}
+		else {
+			manifest.erase(asset.source);
+			stats.failed++;
+			std::cerr << errors[p] << std::endl;
+		}
+	}
+
+	std::filesystem::path manifestDirectory = std::filesystem::path(manifestPath).parent_path();
+	if (!manifestDirectory.empty()) std::filesystem::create_directories(manifestDirectory);
+	manifest.save(manifestPath);
+
+	std::cout << "Cook finished: " << stats.cooked << " cooked, " << stats.skipped << " up to date, " << stats.failed << " failed\n";
+	return stats;
+}
+
+const CookManifest& AssetCooker::getManifest() const
+{
+	return manifest;
+}
@@ -0,0 +1,73 @@
+#ifndef ASSET_COOKER_H
+#define ASSET_COOKER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "CookManifest.h"
+#include "MeshCooker.h"
+#include "SceneCooker.h"
+#include "TextureCooker.h"
+#include "WorldCooker.h"
+
+class JobSystem;
+
+// incremental cooking of a set of source assets. Every asset is keyed by its settings hash and
+// the content of its source and dependencies, anything that matches the manifest is skipped and
+// the rest is cooked in parallel on the job system.
+//
+//    AssetCooker cooker(jobs, "cooked/manifest.txt");
+//    cooker.addMeshDirectory("content", "cooked", MeshCooker::Settings());
+//    cooker.addTextureDirectory("content", "cooked", TextureCooker::Settings());
+//    cooker.run();
+class AssetCooker {
+public:
+	// cooks source into output and returns every other file it read, throws on failure.
+	// Runs on any worker, so it must not touch shared state
+	typedef std::function<std::vector<std::string>(const std::string& source, const std::string& output)> CookFunction;
+
+	struct Stats {
+		uint32_t cooked = 0;
+		uint32_t skipped = 0;
+		uint32_t failed = 0;
+	};
+
+	// loads the manifest at manifestPath if there is one
+	AssetCooker(JobSystem& j, const std::string& manifestPath);
+
+	void add(const std::string& source, const std::string& output, uint64_t settings, CookFunction cook);
+	void addMesh(const std::string& source, const std::string& output, const MeshCooker::Settings& settings);
+	// every mesh source below sourceDirectory, mirrored into outputDirectory as .mesh files
+	void addMeshDirectory(const std::string& sourceDirectory, const std::string& outputDirectory, const MeshCooker::Settings& settings);
+	// scene plus the .mesh it places, written next to output
+	void addScene(const std::string& source, const std::string& output, const MeshCooker::Settings& settings);
+	// world index plus the mesh, the cell scenes and their HLOD proxies, all written next to output
+	void addWorld(const std::string& source, const std::string& output, const WorldCooker::Settings& settings);
+	void addTexture(const std::string& source, const std::string& output, const TextureCooker::Settings& settings);
+	// every image below sourceDirectory as .ktx2 files, the usage in settings is replaced by
+	// TextureCooker::usageFromName for each file
+	void addTextureDirectory(const std::string& sourceDirectory, const std::string& outputDirectory, const TextureCooker::Settings& settings);
+
+	// cooks whatever is stale and saves the manifest. Failures are reported and left out of
+	// the manifest so they are retried next time, they don't stop the other assets
+	Stats run();
+
+	const CookManifest& getManifest() const;
+
+private:
+	struct Asset {
+		std::string source;
+		std::string output;
+		uint64_t settings;
+		CookFunction cook;
+	};
+
+	JobSystem& jobs;
+	std::string manifestPath;
+	CookManifest manifest;
+	std::vector<Asset> assets;
+};
+
+#endif
@@ -0,0 +1,445 @@
+#include "AssetStreamer.h"
+#include "../Buffers/Buffer.h"
+#include "../Jobs/JobSystem.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static const uint32_t INVALID = 0xFFFFFFFF;
+// two blocking readers keep a request in the drive's queue while the other one is being set up
+static const uint32_t IO_THREAD_COUNT = 2;
+static const VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+StreamedBuffer::~StreamedBuffer()
+{
+	if (buffer != VK_NULL_HANDLE) Buffer::destroy(device, buffer, memory);
+}
+
+bool AssetStreamer::QueueEntry::operator<(const QueueEntry& other) const
+{
+	if (priority != other.priority) return priority > other.priority;
+	return sequence > other.sequence;
+}
+
+AssetStreamer::AssetStreamer(VkPhysicalDevice& p, VkDevice& d, JobSystem& j, const VirtualFileSystem& v, VkDeviceSize stagingSize, VkDeviceSize frameBudget)
+	: device(d), jobs(j), fileSystem(v), staging(p, d, stagingSize), frameBudget(frameBudget)
+{
+	for (uint32_t i = 0; i < IO_THREAD_COUNT; i++) {
+		ioThreads.emplace_back(&AssetStreamer::ioLoop, this);
+	}
+
+	std::cout << "Asset Streamer created (" << (staging.getSize() >> 20) << " MB staging, "
+		<< (frameBudget >> 10) << " KB per frame)\n";
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : ioThreads) {
+		thread.join();
+	}
+
+	// decode jobs still hold their request, the device is expected to be idle by now
+	for (std::unique_ptr<Request>& request : requests) {
+		if (request->decodeJob) jobs.wait(*request->decodeJob);
+	}
+}
+
+StreamHandle AssetStreamer::load(const std::string& path, StreamPriority priority, DecodeFunction decode)
+{
+	return loadRange(path, 0, VirtualFileSystem::WHOLE_FILE, priority, decode);
+}
+
+StreamHandle AssetStreamer::loadRange(const std::string& path, uint64_t offset, uint64_t size, StreamPriority priority, DecodeFunction decode)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	// a slot whose decode job hasn't wound down yet can't hand out its TaskGroup again
+	uint32_t index = INVALID;
+	for (size_t i = 0; i < freeSlots.size(); i++) {
+		Request* candidate = requests[freeSlots[i]].get();
+		if (!candidate->decodeJob || candidate->decodeJob->isFinished()) {
+			index = freeSlots[i];
+			freeSlots[i] = freeSlots.back();
+			freeSlots.pop_back();
+			break;
+		}
+	}
+	if (index == INVALID) {
+		index = (uint32_t)requests.size();
+		requests.push_back(std::make_unique<Request>());
+	}
+
+	Request& request = *requests[index];
+	request.decodeJob.reset();
+	request.state = STREAM_QUEUED;
+	request.priority = priority;
+	request.sequence = nextSequence++;
+	request.path = path;
+	request.offset = offset;
+	request.size = size;
+	request.decode = decode;
+
+	readQueue.push({ priority, request.sequence, index, request.generation });
+	wake.notify_one();
+
+	StreamHandle handle;
+	handle.index = index;
+	handle.generation = request.generation;
+	return handle;
+}
+
+void AssetStreamer::setPriority(StreamHandle handle, StreamPriority priority)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Request* request = find(handle);
+	if (!request || request->priority == priority) return;
+
+	request->priority = priority;
+	// the old entry no longer matches and is skipped
+	if (request->state == STREAM_QUEUED) {
+		readQueue.push({ priority, request->sequence, handle.index, request->generation });
+	}
+}
+
+void AssetStreamer::release(StreamHandle handle)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Request* request = find(handle);
+	if (!request) return;
+
+	switch (request->state) {
+	case STREAM_READING:
+	case STREAM_DECODING:
+		request->cancelled = true;
+		break;
+	case STREAM_UPLOADING:
+		// copies already recorded still read the staging ring and write the destination
+		if (request->uploadFrame != 0) {
+			request->cancelled = true;
+			break;
+		}
+		uploadQueue.erase(std::find(uploadQueue.begin(), uploadQueue.end(), handle.index));
+		freeSlot(handle.index);
+		break;
+	default:
+		freeSlot(handle.index);
+		break;
+	}
+}
+
+StreamState AssetStreamer::getState(StreamHandle handle) const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Request* request = find(handle);
+	return request ? request->state : STREAM_INVALID;
+}
+
+bool AssetStreamer::isReady(StreamHandle handle) const
+{
+	return getState(handle) == STREAM_READY;
+}
+
+void AssetStreamer::recordUploads(VkCommandBuffer cmd, uint64_t frame)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (uploadQueue.empty()) return;
+
+	std::sort(uploadQueue.begin(), uploadQueue.end(), [this](uint32_t a, uint32_t b) {
+		const Request& ra = *requests[a];
+		const Request& rb = *requests[b];
+		if (ra.priority != rb.priority) return ra.priority < rb.priority;
+		return ra.sequence < rb.sequence;
+	});
+
+	VkDeviceSize budget = frameBudget;
+	bool ringFull = false;
+	bool copied = false;
+	size_t kept = 0;
+
+	for (size_t q = 0; q < uploadQueue.size(); q++) {
+		uint32_t index = uploadQueue[q];
+		Request& request = *requests[index];
+
+		while (!request.cancelled && !ringFull && budget > 0 && request.uploadIndex < request.asset.uploads.size()) {
+			const StreamUpload& upload = request.asset.uploads[request.uploadIndex];
+
+			VkDeviceSize remaining = upload.size - request.uploadOffset;
+			VkDeviceSize available = staging.available(UPLOAD_ALIGNMENT);
+			VkDeviceSize bytes = std::min(std::min(remaining, budget), available);
+			if (upload.image != VK_NULL_HANDLE && bytes < remaining) {
+				// whole rows only. A row bigger than the budget still goes through on its own
+				// once the frame has nothing else to copy
+				VkDeviceSize rows = bytes / upload.rowPitch;
+				if (rows == 0 && budget == frameBudget && available >= upload.rowPitch) rows = 1;
+				bytes = rows * upload.rowPitch;
+			}
+			// out of ring space, or of budget for a whole row: the rest waits for the next frame
+			if (remaining > 0 && bytes == 0) {
+				ringFull = true;
+				break;
+			}
+
+			if (bytes > 0) {
+				if (request.uploadFrame == 0 && request.asset.prepare) request.asset.prepare(cmd);
+
+				VkDeviceSize offset;
+				uint8_t* destination = staging.allocate(bytes, UPLOAD_ALIGNMENT, offset);
+				memcpy(destination, upload.data + request.uploadOffset, (size_t)bytes);
+
+				if (upload.image != VK_NULL_HANDLE) {
+					uint32_t y = (uint32_t)(request.uploadOffset / upload.rowPitch) * upload.rowHeight;
+					uint32_t rows = (uint32_t)(bytes / upload.rowPitch) * upload.rowHeight;
+
+					VkBufferImageCopy region{};
+					region.bufferOffset = offset;
+					region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, upload.mipLevel, 0, 1 };
+					region.imageOffset = { 0, (int32_t)y, 0 };
+					// the last row of blocks may reach past the level's edge
+					region.imageExtent = { upload.width, std::min(rows, upload.height - y), 1 };
+					vkCmdCopyBufferToImage(cmd, staging.getBuffer(), upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				}
+				else {
+					VkBufferCopy region{ offset, upload.offset + request.uploadOffset, bytes };
+					vkCmdCopyBuffer(cmd, staging.getBuffer(), upload.destination, 1, &region);
+				}
+
+				budget -= std::min(bytes, budget);
+				request.uploadOffset += bytes;
+				request.uploadFrame = frame;
+				stats.bytesUploaded += bytes;
+				copied = true;
+			}
+
+			if (request.uploadOffset == upload.size) {
+				request.uploadIndex++;
+				request.uploadOffset = 0;
+			}
+		}
+
+		if (request.uploadIndex == request.asset.uploads.size() && !request.cancelled && request.asset.finalize) {
+			request.asset.finalize(cmd);
+		}
+
+		// done, or cancelled after part of it was copied: wait for the copies to retire
+		if (request.uploadIndex == request.asset.uploads.size() || request.cancelled) {
+			inFlight.push_back(index);
+		}
+		else {
+			uploadQueue[kept++] = index;
+		}
+	}
+	uploadQueue.resize(kept);
+
+	if (!copied) return;
+	staging.endFrame(frame);
+
+	// one barrier for every destination, they can be read by anything after this
+	VkMemoryBarrier uploadToRead{};
+	uploadToRead.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	uploadToRead.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	uploadToRead.dstAccessMask = VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &uploadToRead, 0, nullptr, 0, nullptr);
+}
+
+void AssetStreamer::retire(uint64_t completedFrame)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	staging.retire(completedFrame);
+
+	size_t kept = 0;
+	for (uint32_t index : inFlight) {
+		Request& request = *requests[index];
+		if (request.uploadFrame > completedFrame) {
+			inFlight[kept++] = index;
+			continue;
+		}
+
+		if (request.cancelled) {
+			freeSlot(index);
+			continue;
+		}
+
+		// the GPU has its copy, the file's bytes and the copy list are no longer needed
+		request.state = STREAM_READY;
+		std::vector<uint8_t>().swap(request.bytes);
+		request.asset.uploads.clear();
+	}
+	inFlight.resize(kept);
+}
+
+AssetStreamer::Stats AssetStreamer::getStats() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	Stats result = stats;
+	for (const std::unique_ptr<Request>& request : requests) {
+		if (request->state == STREAM_QUEUED) result.queued++;
+		else if (request->state == STREAM_READING) result.reading++;
+		else if (request->state == STREAM_DECODING) result.decoding++;
+		else if (request->state == STREAM_UPLOADING) result.uploading++;
+	}
+	return result;
+}
+
+AssetStreamer::DecodeFunction AssetStreamer::decodeBuffer(VkPhysicalDevice& p, VkDevice& d, VkBufferUsageFlags usage)
+{
+	VkPhysicalDevice physicalDevice = p;
+	VkDevice device = d;
+
+	return [physicalDevice, device, usage](std::vector<uint8_t>& bytes, StreamedAsset& asset) {
+		if (bytes.empty()) return false;
+
+		std::shared_ptr<StreamedBuffer> buffer = std::make_shared<StreamedBuffer>();
+		buffer->device = device;
+		buffer->size = bytes.size();
+		Buffer::create(physicalDevice, device, bytes.size(), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer->buffer, buffer->memory);
+
+		// straight out of the file's bytes, the streamer keeps them until the copy is done
+		asset.uploads.push_back({ buffer->buffer, 0, bytes.data(), bytes.size() });
+		asset.object = buffer;
+		return true;
+	};
+}
+
+AssetStreamer::Request* AssetStreamer::find(StreamHandle handle) const
+{
+	if (handle.index >= requests.size()) return nullptr;
+
+	Request* request = requests[handle.index].get();
+	if (request->generation != handle.generation || request->state == STREAM_INVALID) return nullptr;
+	return request;
+}
+
+void AssetStreamer::freeSlot(uint32_t index)
+{
+	Request& request = *requests[index];
+	// the decode job may still be unwinding, load() only reuses the slot once it has finished
+	request.generation++;
+	request.state = STREAM_INVALID;
+	request.cancelled = false;
+	request.path.clear();
+	request.decode = nullptr;
+	std::vector<uint8_t>().swap(request.bytes);
+	request.asset = StreamedAsset();
+	request.uploadIndex = 0;
+	request.uploadOffset = 0;
+	request.uploadFrame = 0;
+
+	freeSlots.push_back(index);
+}
+
+void AssetStreamer::ioLoop()
+{
+	while (true) {
+		uint32_t index;
+		std::string path;
+		uint64_t offset, size;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this]() { return stopping || !readQueue.empty(); });
+			if (stopping) return;
+
+			QueueEntry entry = readQueue.top();
+			readQueue.pop();
+
+			// released, reprioritised or picked up through a newer entry
+			Request& request = *requests[entry.index];
+			if (request.generation != entry.generation || request.state != STREAM_QUEUED || request.priority != entry.priority) continue;
+
+			request.state = STREAM_READING;
+			index = entry.index;
+			path = request.path;
+			offset = request.offset;
+			size = request.size;
+		}
+
+		std::vector<uint8_t> bytes;
+		bool ok = fileSystem.read(path, offset, size, bytes, [this, index]() {
+			std::lock_guard<std::mutex> guard(lock);
+			return requests[index]->cancelled || stopping;
+		});
+
+		std::lock_guard<std::mutex> guard(lock);
+		Request& request = *requests[index];
+		if (request.cancelled) {
+			freeSlot(index);
+			continue;
+		}
+		if (!ok) {
+			if (!stopping) std::cerr << "ERROR: Failed to read " + path + "!\n";
+			request.state = STREAM_FAILED;
+			continue;
+		}
+
+		stats.bytesRead += bytes.size();
+		request.bytes.swap(bytes);
+		request.state = STREAM_DECODING;
+
+		// the job only takes the lock once this thread lets go of it
+		request.decodeJob = std::make_unique<TaskGroup>();
+		jobs.run(*request.decodeJob, [this, index]() { decode(index); });
+		jobs.submit(*request.decodeJob);
+	}
+}
+
+void AssetStreamer::decode(uint32_t index)
+{
+	std::vector<uint8_t> bytes;
+	DecodeFunction function;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		Request& request = *requests[index];
+		if (request.cancelled) {
+			freeSlot(index);
+			return;
+		}
+		bytes.swap(request.bytes);
+		function = request.decode;
+	}
+
+	// whatever the decoder built is destroyed at the end of this scope if it isn't handed on,
+	// declared first so that happens after the lock is released
+	StreamedAsset asset;
+	std::string error;
+	bool ok = false;
+	try {
+		ok = function(bytes, asset);
+	}
+	catch (const std::exception& e) {
+		error = e.what();
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	Request& request = *requests[index];
+	if (request.cancelled) {
+		freeSlot(index);
+		return;
+	}
+	if (!ok) {
+		std::cerr << "ERROR: Failed to decode " + request.path + (error.empty() ? "!" : ": " + error) + "\n";
+		request.state = STREAM_FAILED;
+		return;
+	}
+
+	// uploads may point into the bytes, they stay with the request until it is ready
+	request.bytes.swap(bytes);
+	request.asset = std::move(asset);
+	if (request.asset.uploads.empty()) {
+		request.state = STREAM_READY;
+		std::vector<uint8_t>().swap(request.bytes);
+	}
+	else {
+		request.state = STREAM_UPLOADING;
+		uploadQueue.push_back(index);
+	}
+}
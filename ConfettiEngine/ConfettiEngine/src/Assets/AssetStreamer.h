@@ -0,0 +1,233 @@
+#ifndef ASSET_STREAMER_H
+#define ASSET_STREAMER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "../Buffers/StagingRing.h"
+
+class JobSystem;
+class TaskGroup;
+class VirtualFileSystem;
+
+enum StreamPriority {
+	// needed this frame, e.g. what the camera is about to see
+	STREAM_PRIORITY_CRITICAL = 0,
+	STREAM_PRIORITY_HIGH = 1,
+	STREAM_PRIORITY_NORMAL = 2,
+	// prefetching, only runs when nothing else is waiting
+	STREAM_PRIORITY_LOW = 3
+};
+
+enum StreamState {
+	STREAM_INVALID = 0,
+	STREAM_QUEUED,
+	STREAM_READING,
+	STREAM_DECODING,
+	STREAM_UPLOADING,
+	STREAM_READY,
+	STREAM_FAILED
+};
+
+// index and generation of a request slot, a released slot bumps its generation so stale
+// handles are recognised instead of aliasing whatever reuses the slot
+struct StreamHandle {
+	uint32_t index = 0xFFFFFFFF;
+	uint32_t generation = 0;
+
+	bool isValid() const { return index != 0xFFFFFFFF; }
+};
+
+// a copy from CPU memory into a buffer the decoder created, or into one level of an image if
+// image is set. Image data is tightly packed rows of rowPitch bytes, each covering rowHeight
+// texel rows (4 for block compressed formats), and is copied a whole row at a time
+struct StreamUpload {
+	VkBuffer destination = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	// has to stay valid until the asset is ready, into the file's bytes or the decoded object
+	const uint8_t* data = nullptr;
+	VkDeviceSize size = 0;
+
+	// in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL by the time the copy runs, see StreamedAsset::prepare
+	VkImage image = VK_NULL_HANDLE;
+	uint32_t mipLevel = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	VkDeviceSize rowPitch = 0;
+	uint32_t rowHeight = 1;
+};
+
+// what the decode stage hands on
+struct StreamedAsset {
+	// whatever the decoder built, destroyed when the handle is released
+	std::shared_ptr<void> object;
+	std::vector<StreamUpload> uploads;
+
+	// optional, recorded right before the asset's first copy and right after its last one,
+	// e.g. image layout transitions and mip generation
+	std::function<void(VkCommandBuffer)> prepare;
+	std::function<void(VkCommandBuffer)> finalize;
+};
+
+// buffer created by AssetStreamer::decodeBuffer, freed with the handle
+struct StreamedBuffer {
+	VkDevice device = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+
+	~StreamedBuffer();
+};
+
+// loads files in the background in three overlapping stages, so level streaming never blocks
+// the frame:
+// - read: dedicated I/O threads pull the most important queued request and read the whole file
+//   through the VirtualFileSystem, in chunks so cancellation is quick
+// - decode: a job on the JobSystem runs the request's DecodeFunction (decompression,
+//   transcoding, creating the GPU resources) and lists the copies it needs
+// - upload: recordUploads copies through a StagingRing on the main thread, highest priority
+//   first and within a per frame byte budget, big assets are split across frames (images
+//   between rows)
+// An asset is ready once the frame that recorded its last copy has retired.
+//
+//    StreamHandle mesh = streamer.load("cooked/rock.mesh", STREAM_PRIORITY_HIGH, decodeMesh);
+//    every frame: streamer.recordUploads(cmd, frame); ... streamer.retire(completedFrame);
+//    if (streamer.isReady(mesh)) draw(streamer.get<Mesh>(mesh));
+class AssetStreamer {
+public:
+	// runs on a job worker. Fills asset from the file's bytes and returns false if the file is
+	// unusable. Bytes left in the vector are kept until the asset is ready, uploads may point into them
+	typedef std::function<bool(std::vector<uint8_t>& bytes, StreamedAsset& asset)> DecodeFunction;
+
+	struct Stats {
+		uint32_t queued = 0;
+		uint32_t reading = 0;
+		uint32_t decoding = 0;
+		uint32_t uploading = 0;
+		uint64_t bytesRead = 0;
+		uint64_t bytesUploaded = 0;
+	};
+
+	// paths are looked up in v. stagingSize is the ring's capacity, frameBudget caps the bytes
+	// copied per recordUploads
+	AssetStreamer(VkPhysicalDevice& p, VkDevice& d, JobSystem& j, const VirtualFileSystem& v, VkDeviceSize stagingSize, VkDeviceSize frameBudget);
+	~AssetStreamer();
+
+	AssetStreamer(const AssetStreamer&) = delete;
+	AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+	StreamHandle load(const std::string& path, StreamPriority priority, DecodeFunction decode);
+	// only size bytes from offset reach the decoder, e.g. a few mip levels of a texture
+	StreamHandle loadRange(const std::string& path, uint64_t offset, uint64_t size, StreamPriority priority, DecodeFunction decode);
+	// takes effect for the stages the request hasn't reached yet
+	void setPriority(StreamHandle handle, StreamPriority priority);
+	// cancels a request wherever it is or frees a loaded asset, the handle is invalid afterwards.
+	// Ready assets are destroyed right away, the caller must be done with them on the GPU
+	void release(StreamHandle handle);
+
+	StreamState getState(StreamHandle handle) const;
+	bool isReady(StreamHandle handle) const;
+	// the decoded object once ready, nullptr before
+	template<typename T>
+	T* get(StreamHandle handle) const;
+
+	// main thread, outside a render pass. frame identifies the submission cmd belongs to,
+	// it has to increase every call
+	void recordUploads(VkCommandBuffer cmd, uint64_t frame);
+	// every frame up to and including completedFrame has finished on the GPU
+	void retire(uint64_t completedFrame);
+
+	Stats getStats() const;
+
+	// the whole file into a new device local buffer with usage (plus transfer dst)
+	static DecodeFunction decodeBuffer(VkPhysicalDevice& p, VkDevice& d, VkBufferUsageFlags usage);
+
+private:
+	struct Request {
+		uint32_t generation = 0;
+		StreamState state = STREAM_INVALID;
+		StreamPriority priority = STREAM_PRIORITY_NORMAL;
+		// order of arrival within a priority
+		uint64_t sequence = 0;
+		// set by release while a stage owns the request, that stage frees it
+		bool cancelled = false;
+
+		std::string path;
+		// byte range of the file, the whole file by default
+		uint64_t offset = 0;
+		uint64_t size = ~0ull;
+		DecodeFunction decode;
+		std::vector<uint8_t> bytes;
+		std::unique_ptr<TaskGroup> decodeJob;
+		StreamedAsset asset;
+
+		// copy progress
+		uint32_t uploadIndex = 0;
+		VkDeviceSize uploadOffset = 0;
+		// last frame that copied part of the asset, 0 before the first copy
+		uint64_t uploadFrame = 0;
+	};
+
+	struct QueueEntry {
+		StreamPriority priority;
+		uint64_t sequence;
+		uint32_t index;
+		uint32_t generation;
+
+		// priority_queue pops the largest, make that the most urgent and oldest
+		bool operator<(const QueueEntry& other) const;
+	};
+
+	Request* find(StreamHandle handle) const;
+	void freeSlot(uint32_t index);
+
+	void ioLoop();
+	void decode(uint32_t index);
+
+	VkDevice& device;
+	JobSystem& jobs;
+	const VirtualFileSystem& fileSystem;
+
+	StagingRing staging;
+	VkDeviceSize frameBudget;
+
+	// guards every request's state and the queues, stages work on a request without it
+	mutable std::mutex lock;
+	std::vector<std::unique_ptr<Request>> requests;
+	std::vector<uint32_t> freeSlots;
+	uint64_t nextSequence = 0;
+
+	// stale entries (released or reprioritised requests) are skipped when popped
+	std::priority_queue<QueueEntry> readQueue;
+	// decoded, waiting for or in the middle of their copies
+	std::vector<uint32_t> uploadQueue;
+	// every copy recorded, waiting for the last frame to retire
+	std::vector<uint32_t> inFlight;
+
+	Stats stats;
+
+	std::condition_variable wake;
+	std::atomic<bool> stopping{ false };
+	std::vector<std::thread> ioThreads;
+};
+
+template<typename T>
+T* AssetStreamer::get(StreamHandle handle) const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Request* request = find(handle);
+	if (!request || request->state != STREAM_READY) return nullptr;
+	return static_cast<T*>(request->asset.object.get());
+}
+
+#endif
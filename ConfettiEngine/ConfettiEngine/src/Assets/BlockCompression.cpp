@@ -0,0 +1,390 @@
+#include "BlockCompression.h"
+#include "../Jobs/JobSystem.h"
+#include "../Math/Simd.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+static const uint32_t BLOCK_TEXELS = 16;
+// least squares passes after the principal axis fit, the first one does nearly all the work
+static const uint32_t REFINE_ITERATIONS = 2;
+static const uint32_t POWER_ITERATIONS = 8;
+
+// one block as structure of arrays, 16 texels per channel divide evenly into any SIMD width
+struct Block {
+	float channels[4][BLOCK_TEXELS];
+};
+
+// in 0..255 texel units, e0 is what step 0 reconstructs to
+struct Endpoints {
+	float e0[4];
+	float e1[4];
+};
+
+static void loadBlock(const uint8_t* texels, const uint32_t* sources, uint32_t channels, Block& block)
+{
+	for (uint32_t c = 0; c < channels; c++) {
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) block.channels[c][i] = texels[i * 4 + sources[c]];
+	}
+}
+
+// texels projected onto the segment e0 -> e1 and snapped to one of levels evenly spaced steps.
+// Writes every texel's step and returns the squared error of the snapped values
+static float fitIndices(const Block& block, uint32_t channels, const Endpoints& e, uint32_t levels, uint8_t* steps)
+{
+	float direction[4];
+	float lengthSquared = 0.0f;
+	for (uint32_t c = 0; c < channels; c++) {
+		direction[c] = e.e1[c] - e.e0[c];
+		lengthSquared += direction[c] * direction[c];
+	}
+	float last = (float)(levels - 1);
+	float toStep = lengthSquared > 0.0f ? last / lengthSquared : 0.0f;
+
+	Simd::Float start[4], delta[4];
+	for (uint32_t c = 0; c < channels; c++) {
+		start[c] = Simd::set1(e.e0[c]);
+		delta[c] = Simd::set1(direction[c]);
+	}
+	const Simd::Float zero = Simd::zero();
+	const Simd::Float maxStep = Simd::set1(last);
+	const Simd::Float scale = Simd::set1(toStep);
+	const Simd::Float toWeight = Simd::set1(1.0f / last);
+
+	float stepValues[BLOCK_TEXELS];
+	Simd::Float error = zero;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i += Simd::WIDTH) {
+		Simd::Float t = zero;
+		for (uint32_t c = 0; c < channels; c++) {
+			t = Simd::madd(Simd::sub(Simd::load(&block.channels[c][i]), start[c]), delta[c], t);
+		}
+		t = Simd::round(Simd::min(Simd::max(Simd::mul(t, scale), zero), maxStep));
+		Simd::store(stepValues + i, t);
+
+		Simd::Float weight = Simd::mul(t, toWeight);
+		for (uint32_t c = 0; c < channels; c++) {
+			Simd::Float d = Simd::sub(Simd::load(&block.channels[c][i]), Simd::madd(weight, delta[c], start[c]));
+			error = Simd::madd(d, d, error);
+		}
+	}
+
+	float lanes[Simd::WIDTH];
+	Simd::store(lanes, error);
+	float total = 0.0f;
+	for (uint32_t lane = 0; lane < Simd::WIDTH; lane++) total += lanes[lane];
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) steps[i] = (uint8_t)stepValues[i];
+	return total;
+}
+
+// endpoints at the extremes of the texels' projections onto their principal axis
+static void principalEndpoints(const Block& block, uint32_t channels, Endpoints& e)
+{
+	float mean[4] = {};
+	for (uint32_t c = 0; c < channels; c++) {
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) mean[c] += block.channels[c][i];
+		mean[c] /= BLOCK_TEXELS;
+	}
+
+	float covariance[4][4] = {};
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		for (uint32_t a = 0; a < channels; a++) {
+			for (uint32_t b = a; b < channels; b++) {
+				covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+			}
+		}
+	}
+	for (uint32_t a = 0; a < channels; a++) {
+		for (uint32_t b = 0; b < a; b++) covariance[a][b] = covariance[b][a];
+	}
+
+	// power iteration, starting from the channel that varies most
+	float axis[4] = {};
+	uint32_t widest = 0;
+	for (uint32_t c = 1; c < channels; c++) {
+		if (covariance[c][c] > covariance[widest][widest]) widest = c;
+	}
+	axis[widest] = 1.0f;
+	if (covariance[widest][widest] <= 0.0f) {
+		// flat block
+		memcpy(e.e0, mean, sizeof(mean));
+		memcpy(e.e1, mean, sizeof(mean));
+		return;
+	}
+
+	for (uint32_t iteration = 0; iteration < POWER_ITERATIONS; iteration++) {
+		float next[4] = {};
+		float length = 0.0f;
+		for (uint32_t a = 0; a < channels; a++) {
+			for (uint32_t b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+			length += next[a] * next[a];
+		}
+		if (length <= FLT_MIN) break;
+		length = 1.0f / std::sqrt(length);
+		for (uint32_t c = 0; c < channels; c++) axis[c] = next[c] * length;
+	}
+
+	float lowest = FLT_MAX, highest = -FLT_MAX;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		float t = 0.0f;
+		for (uint32_t c = 0; c < channels; c++) t += (block.channels[c][i] - mean[c]) * axis[c];
+		lowest = std::min(lowest, t);
+		highest = std::max(highest, t);
+	}
+
+	for (uint32_t c = 0; c < channels; c++) {
+		e.e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * lowest));
+		e.e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * highest));
+	}
+}
+
+// the endpoints with the least squared error for the given steps, false if the steps
+// don't determine them (every texel on the same step)
+static bool refineEndpoints(const Block& block, uint32_t channels, const uint8_t* steps, uint32_t levels, Endpoints& e)
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		float b = steps[i] / (float)(levels - 1);
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (uint32_t c = 0; c < channels; c++) {
+			ax[c] += a * block.channels[c][i];
+			bx[c] += b * block.channels[c][i];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f) return false;
+
+	float inverse = 1.0f / determinant;
+	for (uint32_t c = 0; c < channels; c++) {
+		e.e0[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) * inverse));
+		e.e1[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) * inverse));
+	}
+	return true;
+}
+
+// fit, snap to what the format stores, refine from the chosen steps and keep the best
+template<typename Quantize>
+static void fitBlock(const Block& block, uint32_t channels, uint32_t levels, Quantize quantize, Endpoints& best, uint8_t* bestSteps)
+{
+	Endpoints fit;
+	principalEndpoints(block, channels, fit);
+
+	float bestError = FLT_MAX;
+	for (uint32_t iteration = 0; iteration <= REFINE_ITERATIONS; iteration++) {
+		Endpoints snapped = fit;
+		quantize(snapped);
+
+		uint8_t steps[BLOCK_TEXELS];
+		float error = fitIndices(block, channels, snapped, levels, steps);
+		if (error < bestError) {
+			bestError = error;
+			best = snapped;
+			memcpy(bestSteps, steps, BLOCK_TEXELS);
+		}
+		if (error == 0.0f || !refineEndpoints(block, channels, steps, levels, fit)) break;
+	}
+}
+
+static float snap(float value, float maximum)
+{
+	return std::floor(std::min(255.0f, std::max(0.0f, value)) * maximum / 255.0f + 0.5f);
+}
+
+static void quantize565(Endpoints& e)
+{
+	for (float* endpoint : { e.e0, e.e1 }) {
+		uint32_t r = (uint32_t)snap(endpoint[0], 31.0f), g = (uint32_t)snap(endpoint[1], 63.0f), b = (uint32_t)snap(endpoint[2], 31.0f);
+		endpoint[0] = (float)(r << 3 | r >> 2);
+		endpoint[1] = (float)(g << 2 | g >> 4);
+		endpoint[2] = (float)(b << 3 | b >> 2);
+	}
+}
+
+static void quantize8(Endpoints& e)
+{
+	e.e0[0] = snap(e.e0[0], 255.0f);
+	e.e1[0] = snap(e.e1[0], 255.0f);
+}
+
+// 7 bits per channel plus one p bit per endpoint shared by its channels, whichever p is closer
+static void quantize7p(Endpoints& e)
+{
+	for (float* endpoint : { e.e0, e.e1 }) {
+		float bestError = FLT_MAX;
+		float best[4];
+		for (uint32_t p = 0; p < 2; p++) {
+			float candidate[4];
+			float error = 0.0f;
+			for (uint32_t c = 0; c < 4; c++) {
+				float code = std::min(127.0f, std::max(0.0f, std::floor((endpoint[c] - p) * 0.5f + 0.5f)));
+				candidate[c] = code * 2.0f + p;
+				error += (candidate[c] - endpoint[c]) * (candidate[c] - endpoint[c]);
+			}
+			if (error < bestError) {
+				bestError = error;
+				memcpy(best, candidate, sizeof(best));
+			}
+		}
+		memcpy(endpoint, best, sizeof(best));
+	}
+}
+
+static void encodeBc1(const uint8_t* texels, uint8_t* out)
+{
+	static const uint32_t RGB[3] = { 0, 1, 2 };
+	// steps run from color0 to color1, the palette stores them as 0, 2, 3, 1
+	static const uint32_t ORDER[4] = { 0, 2, 3, 1 };
+
+	Block block;
+	loadBlock(texels, RGB, 3, block);
+	Endpoints e;
+	uint8_t steps[BLOCK_TEXELS];
+	fitBlock(block, 3, 4, quantize565, e, steps);
+
+	uint16_t color0 = (uint16_t)((uint32_t)e.e0[0] >> 3 << 11 | (uint32_t)e.e0[1] >> 2 << 5 | (uint32_t)e.e0[2] >> 3);
+	uint16_t color1 = (uint16_t)((uint32_t)e.e1[0] >> 3 << 11 | (uint32_t)e.e1[1] >> 2 << 5 | (uint32_t)e.e1[2] >> 3);
+	// color0 > color1 selects the four colour palette
+	bool swap = color0 < color1;
+	if (swap) std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t step = swap ? 3 - steps[i] : steps[i];
+		if (color0 == color1) step = 0;
+		indices |= ORDER[step] << (i * 2);
+	}
+
+	memcpy(out, &color0, 2);
+	memcpy(out + 2, &color1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+static void encodeBc4(const uint8_t* texels, uint32_t channel, uint8_t* out)
+{
+	Block block;
+	loadBlock(texels, &channel, 1, block);
+	Endpoints e;
+	uint8_t steps[BLOCK_TEXELS];
+	fitBlock(block, 1, 8, quantize8, e, steps);
+
+	uint8_t red0 = (uint8_t)e.e0[0], red1 = (uint8_t)e.e1[0];
+	// red0 > red1 selects eight interpolated values
+	bool swap = red0 < red1;
+	if (swap) std::swap(red0, red1);
+
+	uint64_t indices = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t step = swap ? 7 - steps[i] : steps[i];
+		if (red0 == red1) step = 0;
+		// red0, red1, then the six values between them
+		uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+		indices |= index << (i * 3);
+	}
+
+	out[0] = red0;
+	out[1] = red1;
+	for (uint32_t i = 0; i < 6; i++) out[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+// little endian bit stream over one 128 bit block
+struct BlockWriter {
+	uint8_t* out;
+	uint32_t position = 0;
+
+	explicit BlockWriter(uint8_t* o) : out(o) {
+		memset(out, 0, 16);
+	}
+
+	void write(uint32_t value, uint32_t bits) {
+		for (uint32_t b = 0; b < bits; b++, position++) {
+			out[position / 8] |= (uint8_t)(((value >> b) & 1) << (position % 8));
+		}
+	}
+};
+
+static void encodeBc7(const uint8_t* texels, uint8_t* out)
+{
+	static const uint32_t RGBA[4] = { 0, 1, 2, 3 };
+
+	Block block;
+	loadBlock(texels, RGBA, 4, block);
+	Endpoints e;
+	uint8_t steps[BLOCK_TEXELS];
+	fitBlock(block, 4, 16, quantize7p, e, steps);
+
+	// the first texel's index drops its top bit, so it has to be in the lower half
+	if (steps[0] >= 8) {
+		std::swap(e.e0, e.e1);
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) steps[i] = (uint8_t)(15 - steps[i]);
+	}
+
+	BlockWriter writer(out);
+	// mode 6
+	writer.write(1 << 6, 7);
+	for (uint32_t c = 0; c < 4; c++) {
+		writer.write((uint32_t)e.e0[c] >> 1, 7);
+		writer.write((uint32_t)e.e1[c] >> 1, 7);
+	}
+	writer.write((uint32_t)e.e0[0] & 1, 1);
+	writer.write((uint32_t)e.e1[0] & 1, 1);
+	writer.write(steps[0], 3);
+	for (uint32_t i = 1; i < BLOCK_TEXELS; i++) writer.write(steps[i], 4);
+}
+
+uint32_t BlockCompression::blockBytes(BlockFormat format)
+{
+	return format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC4 ? 8 : 16;
+}
+
+void BlockCompression::encodeBlock(BlockFormat format, const uint8_t* texels, uint8_t* out)
+{
+	switch (format) {
+	case BLOCK_FORMAT_BC1:
+		encodeBc1(texels, out);
+		break;
+	case BLOCK_FORMAT_BC3:
+		// alpha block first
+		encodeBc4(texels, 3, out);
+		encodeBc1(texels, out + 8);
+		break;
+	case BLOCK_FORMAT_BC4:
+		encodeBc4(texels, 0, out);
+		break;
+	case BLOCK_FORMAT_BC5:
+		encodeBc4(texels, 0, out);
+		encodeBc4(texels, 1, out + 8);
+		break;
+	case BLOCK_FORMAT_BC7:
+		encodeBc7(texels, out);
+		break;
+	}
+}
+
+std::vector<uint8_t> BlockCompression::compress(const Bitmap& image, BlockFormat format, JobSystem& jobs)
+{
+	uint32_t blocksX = (image.width + 3) / 4;
+	uint32_t blocksY = (image.height + 3) / 4;
+	uint32_t bytes = blockBytes(format);
+	std::vector<uint8_t> out((size_t)blocksX * blocksY * bytes);
+
+	jobs.parallelFor(blocksY, 1, [&](uint32_t by) {
+		uint8_t texels[BLOCK_TEXELS * 4];
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			for (uint32_t y = 0; y < 4; y++) {
+				uint32_t sy = std::min(by * 4 + y, image.height - 1);
+				for (uint32_t x = 0; x < 4; x++) {
+					uint32_t sx = std::min(bx * 4 + x, image.width - 1);
+					memcpy(texels + (y * 4 + x) * 4, &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+				}
+			}
+			encodeBlock(format, texels, out.data() + ((size_t)by * blocksX + bx) * bytes);
+		}
+	});
+	return out;
+}
@@ -0,0 +1,41 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageDecoder.h"
+
+class JobSystem;
+
+enum BlockFormat {
+	// RGB at 4 bits per texel, alpha ignored
+	BLOCK_FORMAT_BC1 = 0,
+	// BC1 colour plus a BC4 alpha block, 8 bits per texel
+	BLOCK_FORMAT_BC3,
+	// red only at 4 bits per texel, for masks
+	BLOCK_FORMAT_BC4,
+	// red and green as two BC4 blocks, for tangent space normals (z is rebuilt in the shader)
+	BLOCK_FORMAT_BC5,
+	// RGBA at 8 bits per texel
+	BLOCK_FORMAT_BC7
+};
+
+// cook time encoders for the BC formats every desktop GPU samples natively.
+// Every block is fitted along the principal axis of its texels and refined with a least
+// squares pass over the chosen indices, the index search and error evaluation are SIMD over
+// the block's 16 texels. BC7 only uses mode 6 (one subset, 7 bit RGBA endpoints with p bits,
+// 16 interpolation steps), which suits smooth colour and alpha well and keeps the encoder fast
+namespace BlockCompression {
+	// 8 or 16
+	uint32_t blockBytes(BlockFormat format);
+
+	// texels is a 4x4 RGBA8 block, row major
+	void encodeBlock(BlockFormat format, const uint8_t* texels, uint8_t* out);
+
+	// the whole image as rows of blocks, tightly packed. Partial blocks at the right and
+	// bottom edge repeat the last column/row. Rows of blocks are spread across jobs
+	std::vector<uint8_t> compress(const Bitmap& image, BlockFormat format, JobSystem& jobs);
+};
+
+#endif
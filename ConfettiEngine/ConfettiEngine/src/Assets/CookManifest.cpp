@@ -0,0 +1,180 @@
+#include "CookManifest.h"
+#include "Hash.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+const uint32_t CookManifest::VERSION;
+
+static const char* MANIFEST_HEADER = "confetti-cook-manifest";
+
+void CookManifest::load(const std::string& path)
+{
+	records.clear();
+
+	std::ifstream file(path);
+	if (!file.is_open()) return;
+
+	std::string line;
+	std::getline(file, line);
+	std::istringstream header(line);
+	std::string name;
+	uint32_t version = 0;
+	header >> name >> version;
+	if (name != MANIFEST_HEADER) {
+		throw std::runtime_error("ERROR: " + path + " is not a cook manifest!");
+	}
+	// older manifests are simply dropped, everything gets recooked
+	if (version != VERSION) return;
+
+	while (std::getline(file, line)) {
+		if (line.empty()) continue;
+
+		// the paths come after the first tab, everything before is whitespace separated
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos || line.compare(0, 6, "asset ") != 0) {
+			throw std::runtime_error("ERROR: Malformed asset entry in " + path + "!");
+		}
+
+		CookRecord record;
+		std::istringstream fields(line.substr(6, tab - 6));
+		std::string settings;
+		uint32_t inputCount = 0;
+		fields >> settings >> inputCount;
+		record.settings = Hash::fromHex(settings);
+
+		size_t split = line.find('\t', tab + 1);
+		if (split == std::string::npos) {
+			throw std::runtime_error("ERROR: Malformed asset entry in " + path + "!");
+		}
+		record.source = line.substr(tab + 1, split - tab - 1);
+		record.output = line.substr(split + 1);
+
+		record.inputs.resize(inputCount);
+		for (CookInput& input : record.inputs) {
+			if (!std::getline(file, line) || line.compare(0, 6, "input ") != 0 || (tab = line.find('\t')) == std::string::npos) {
+				throw std::runtime_error("ERROR: Malformed input entry in " + path + "!");
+			}
+
+			std::istringstream values(line.substr(6, tab - 6));
+			std::string hash;
+			values >> input.size >> input.modified >> hash;
+			input.hash = Hash::fromHex(hash);
+			input.path = line.substr(tab + 1);
+		}
+
+		records[record.source] = std::move(record);
+	}
+}
+
+void CookManifest::save(const std::string& path) const
+{
+	// sorted so the file doesn't reshuffle between runs
+	std::vector<const CookRecord*> sorted;
+	sorted.reserve(records.size());
+	for (const auto& entry : records) sorted.push_back(&entry.second);
+	std::sort(sorted.begin(), sorted.end(), [](const CookRecord* a, const CookRecord* b) { return a->source < b->source; });
+
+	// write to a temporary and swap it in, an interrupted cook leaves the old manifest intact
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("ERROR: Failed to open " + temporary + " for writing!");
+		}
+
+		file << MANIFEST_HEADER << " " << VERSION << "\n";
+		for (const CookRecord* record : sorted) {
+			file << "asset " << Hash::toHex(record->settings) << " " << record->inputs.size() << "\t" << record->source << "\t" << record->output << "\n";
+			for (const CookInput& input : record->inputs) {
+				file << "input " << input.size << " " << input.modified << " " << Hash::toHex(input.hash) << "\t" << input.path << "\n";
+			}
+		}
+
+		if (!file.good()) {
+			throw std::runtime_error("ERROR: Failed to write " + temporary + "!");
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		throw std::runtime_error("ERROR: Failed to replace " + path + ": " + error.message());
+	}
+}
+
+const CookRecord* CookManifest::find(const std::string& source) const
+{
+	auto it = records.find(source);
+	return it != records.end() ? &it->second : nullptr;
+}
+
+void CookManifest::set(const CookRecord& record)
+{
+	records[record.source] = record;
+}
+
+void CookManifest::erase(const std::string& source)
+{
+	records.erase(source);
+}
+
+bool CookManifest::isStale(const std::string& source, uint64_t settings) const
+{
+	const CookRecord* record = find(source);
+	if (!record || record->settings != settings) return true;
+	return inputsChanged(*record);
+}
+
+bool CookManifest::isStale(const std::string& source) const
+{
+	const CookRecord* record = find(source);
+	if (!record) return true;
+	return inputsChanged(*record);
+}
+
+CookInput CookManifest::snapshot(const std::string& path)
+{
+	CookInput input;
+	input.path = path;
+
+	std::error_code error;
+	uintmax_t size = std::filesystem::file_size(path, error);
+	if (error) return input;
+
+	input.size = size;
+	input.modified = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+	input.hash = Hash::file(path);
+	return input;
+}
+
+const std::unordered_map<std::string, CookRecord>& CookManifest::getRecords() const
+{
+	return records;
+}
+
+bool CookManifest::inputsChanged(const CookRecord& record) const
+{
+	std::error_code error;
+	if (!std::filesystem::exists(record.output, error)) return true;
+
+	for (const CookInput& input : record.inputs) {
+		uintmax_t size = std::filesystem::file_size(input.path, error);
+		// a dependency that disappeared (or showed up) changes the result
+		if (error) {
+			if (input.hash != 0) return true;
+			continue;
+		}
+		if (size != input.size) return true;
+
+		int64_t modified = (int64_t)std::filesystem::last_write_time(input.path, error).time_since_epoch().count();
+		if (!error && modified == input.modified) continue;
+
+		// touched but possibly identical, only the contents decide
+		if (Hash::file(input.path) != input.hash) return true;
+	}
+
+	return false;
+}
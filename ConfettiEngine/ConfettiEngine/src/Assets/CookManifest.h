@@ -0,0 +1,61 @@
+#ifndef COOK_MANIFEST_H
+#define COOK_MANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// a file that went into a cooked asset. Size and modification time are a cheap first check,
+// the content hash decides when they differ, so touching a file doesn't force a recook
+struct CookInput {
+	std::string path;
+	uint64_t size = 0;
+	int64_t modified = 0;
+	uint64_t hash = 0;
+};
+
+struct CookRecord {
+	std::string source;
+	std::string output;
+	// hash of the import settings and cooker version, see MeshCooker::hashSettings
+	uint64_t settings = 0;
+	// the source itself first, then its dependencies
+	std::vector<CookInput> inputs;
+};
+
+// what was cooked from what, kept next to the cooked data. The cooker uses it to skip
+// up to date assets and the runtime can ask whether what it is about to load is stale.
+// Plain text so it diffs and merges sensibly:
+//   asset <settings> <input count>\t<source>\t<output>
+//   input <size> <modified> <hash>\t<path>
+class CookManifest {
+public:
+	// a missing manifest loads as empty, a malformed one throws
+	void load(const std::string& path);
+	void save(const std::string& path) const;
+
+	const CookRecord* find(const std::string& source) const;
+	void set(const CookRecord& record);
+	void erase(const std::string& source);
+
+	// true if source has no record, was cooked with other settings, its output is gone or any
+	// of its inputs changed since. Hashes files, safe to call from several threads at once
+	bool isStale(const std::string& source, uint64_t settings) const;
+	// same but ignoring settings, for the runtime which doesn't know them
+	bool isStale(const std::string& source) const;
+
+	// stats and hashes path as it is now, size 0 and hash 0 if it doesn't exist
+	static CookInput snapshot(const std::string& path);
+
+	const std::unordered_map<std::string, CookRecord>& getRecords() const;
+
+	static const uint32_t VERSION = 1;
+
+private:
+	bool inputsChanged(const CookRecord& record) const;
+
+	std::unordered_map<std::string, CookRecord> records;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "Hash.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <stdexcept>
+
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+static uint64_t rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read64(const uint8_t* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint64_t accumulate(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME2;
+	acc = rotl(acc, 31);
+	return acc * PRIME1;
+}
+
+static uint64_t mergeRound(uint64_t acc, uint64_t value)
+{
+	acc ^= accumulate(0, value);
+	return acc * PRIME1 + PRIME4;
+}
+
+uint64_t Hash::compute(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	const uint8_t* end = p + size;
+	uint64_t h;
+
+	if (size >= 32) {
+		// four independent lanes over 32 byte stripes
+		uint64_t v1 = seed + PRIME1 + PRIME2;
+		uint64_t v2 = seed + PRIME2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME1;
+
+		const uint8_t* limit = end - 32;
+		do {
+			v1 = accumulate(v1, read64(p));
+			v2 = accumulate(v2, read64(p + 8));
+			v3 = accumulate(v3, read64(p + 16));
+			v4 = accumulate(v4, read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		h = mergeRound(h, v1);
+		h = mergeRound(h, v2);
+		h = mergeRound(h, v3);
+		h = mergeRound(h, v4);
+	}
+	else {
+		h = seed + PRIME5;
+	}
+
+	h += (uint64_t)size;
+
+	for (; p + 8 <= end; p += 8) {
+		h ^= accumulate(0, read64(p));
+		h = rotl(h, 27) * PRIME1 + PRIME4;
+	}
+	if (p + 4 <= end) {
+		h ^= (uint64_t)read32(p) * PRIME1;
+		h = rotl(h, 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= (*p) * PRIME5;
+		h = rotl(h, 11) * PRIME1;
+	}
+
+	// avalanche
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+uint64_t Hash::combine(uint64_t a, uint64_t b)
+{
+	uint64_t values[2] = { a, b };
+	return compute(values, sizeof(values));
+}
+
+uint64_t Hash::file(const std::string& path)
+{
+	try {
+		MappedFile mapped(path);
+		return compute(mapped.getData(), mapped.getSize());
+	}
+	catch (const std::runtime_error&) {
+		return 0;
+	}
+}
+
+std::string Hash::toHex(uint64_t hash)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string hex(16, '0');
+	for (int i = 15; i >= 0; i--) {
+		hex[i] = digits[hash & 0xF];
+		hash >>= 4;
+	}
+	return hex;
+}
+
+uint64_t Hash::fromHex(const std::string& hex)
+{
+	return std::stoull(hex, nullptr, 16);
+}
@@ -0,0 +1,19 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit content hashing (XXH64) for cook keys, fast enough to hash whole source files
+namespace Hash {
+	uint64_t compute(const void* data, size_t size, uint64_t seed = 0);
+	uint64_t combine(uint64_t a, uint64_t b);
+	// hash of the file's contents, 0 if it can't be opened
+	uint64_t file(const std::string& path);
+
+	std::string toHex(uint64_t hash);
+	uint64_t fromHex(const std::string& hex);
+};
+
+#endif
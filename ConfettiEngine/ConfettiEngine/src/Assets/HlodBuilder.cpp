@@ -0,0 +1,282 @@
+#include "HlodBuilder.h"
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <glm/gtc/type_ptr.hpp>
+
+// pixels around every tile repeating its edge, keeps filtering and small mips from bleeding
+// the neighbouring material in
+static const uint32_t GUTTER = 2;
+// uvs this far outside [0, 1] count as repeating
+static const float UV_SLACK = 0.01f;
+
+static float srgbToLinear(uint8_t value)
+{
+	float c = value / 255.0f;
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t linearToSrgb(float value)
+{
+	float c = std::min(std::max(value, 0.0f), 1.0f);
+	c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	return (uint8_t)(c * 255.0f + 0.5f);
+}
+
+// the material's base colour texture, an empty bitmap if it has none or it can't be read
+static Bitmap loadBaseColor(const MeshCooker::CookedMesh& source, const MeshMaterial& material)
+{
+	if (material.baseColorTexture == MESH_NO_STRING) return Bitmap();
+	const char* path = &source.strings[material.baseColorTexture];
+
+	try {
+		if (path[0] == '*') {
+			uint32_t index = (uint32_t)std::strtoul(path + 1, nullptr, 10);
+			if (index >= source.embeddedTextures.size()) return Bitmap();
+			const MeshCooker::EmbeddedTexture& texture = source.embeddedTextures[index];
+			return ImageDecoder::decode(texture.data.data(), texture.data.size(), "embedded." + texture.extension);
+		}
+
+		std::string full = source.directory + path;
+		MappedFile file(full);
+		return ImageDecoder::decode(file.getData(), file.getSize(), full);
+	}
+	catch (const std::exception& e) {
+		// a proxy with a flat colour beats no proxy
+		std::cerr << e.what() << "\n";
+		return Bitmap();
+	}
+}
+
+// fills tile (inner size x size, linear rgba) with bitmap box filtered in linear light, or
+// with its average when average is set
+static void resampleTile(const Bitmap& bitmap, uint32_t size, bool average, const float factor[4], std::vector<float>& tile)
+{
+	tile.assign((size_t)size * size * 4, 0.0f);
+	if (bitmap.width == 0 || bitmap.height == 0) {
+		for (size_t i = 0; i < tile.size(); i++) tile[i] = factor[i % 4];
+		return;
+	}
+
+	float linear[256];
+	for (uint32_t i = 0; i < 256; i++) linear[i] = srgbToLinear((uint8_t)i);
+
+	auto boxAverage = [&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, float* result) {
+		double sum[4] = {};
+		for (uint32_t y = y0; y < y1; y++) {
+			const uint8_t* row = &bitmap.pixels[((size_t)y * bitmap.width + x0) * 4];
+			for (uint32_t x = x0; x < x1; x++, row += 4) {
+				sum[0] += linear[row[0]];
+				sum[1] += linear[row[1]];
+				sum[2] += linear[row[2]];
+				sum[3] += row[3] / 255.0f;
+			}
+		}
+		double count = (double)(x1 - x0) * (y1 - y0);
+		for (int c = 0; c < 4; c++) result[c] = (float)(sum[c] / count) * factor[c];
+	};
+
+	if (average) {
+		float color[4];
+		boxAverage(0, 0, bitmap.width, bitmap.height, color);
+		for (size_t i = 0; i < tile.size(); i++) tile[i] = color[i % 4];
+		return;
+	}
+
+	// every tile texel averages the source texels it covers, at least one
+	for (uint32_t y = 0; y < size; y++) {
+		uint32_t y0 = (uint32_t)((uint64_t)y * bitmap.height / size);
+		uint32_t y1 = std::max(y0 + 1, (uint32_t)((uint64_t)(y + 1) * bitmap.height / size));
+		for (uint32_t x = 0; x < size; x++) {
+			uint32_t x0 = (uint32_t)((uint64_t)x * bitmap.width / size);
+			uint32_t x1 = std::max(x0 + 1, (uint32_t)((uint64_t)(x + 1) * bitmap.width / size));
+			boxAverage(x0, y0, x1, y1, &tile[((size_t)y * size + x) * 4]);
+		}
+	}
+}
+
+uint32_t HlodBuilder::build(const MeshCooker::CookedMesh& source, const std::vector<Instance>& instances, const std::string& atlasName,
+	const Settings& settings, MeshCooker::CookedMesh& proxy, Bitmap& atlas)
+{
+	if (instances.empty()) {
+		throw std::runtime_error("ERROR: HLOD cluster without instances!");
+	}
+	if (settings.tileSize <= 2 * GUTTER) {
+		throw std::runtime_error("ERROR: HLOD atlas tiles must be larger than their gutter!");
+	}
+
+	// a tile per material the cluster uses, in order of first use
+	std::vector<uint32_t> materials;
+	std::vector<uint32_t> tileOfInstance(instances.size());
+	std::vector<uint8_t> repeating;
+	for (size_t i = 0; i < instances.size(); i++) {
+		const MeshSubmesh& submesh = source.submeshes[instances[i].submesh];
+		size_t tile = std::find(materials.begin(), materials.end(), submesh.materialIndex) - materials.begin();
+		if (tile == materials.size()) {
+			materials.push_back(submesh.materialIndex);
+			repeating.push_back(0);
+		}
+		tileOfInstance[i] = (uint32_t)tile;
+
+		for (uint32_t v = submesh.vertexOffset; v < submesh.vertexOffset + submesh.vertexCount; v++) {
+			const float* uv = source.vertices[v].uv;
+			if (uv[0] < -UV_SLACK || uv[0] > 1.0f + UV_SLACK || uv[1] < -UV_SLACK || uv[1] > 1.0f + UV_SLACK) {
+				repeating[tile] = 1;
+				break;
+			}
+		}
+	}
+
+	uint32_t columns = (uint32_t)std::ceil(std::sqrt((double)materials.size()));
+	uint32_t rows = ((uint32_t)materials.size() + columns - 1) / columns;
+	uint32_t tileSize = settings.tileSize;
+	uint32_t inner = tileSize - 2 * GUTTER;
+	atlas.width = columns * tileSize;
+	atlas.height = rows * tileSize;
+	atlas.pixels.assign((size_t)atlas.width * atlas.height * 4, 0);
+
+	static const float WHITE[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float roughness = 0.0f;
+	std::vector<float> tile;
+	for (uint32_t t = 0; t < materials.size(); t++) {
+		const MeshMaterial* material = materials[t] < source.materials.size() ? &source.materials[materials[t]] : nullptr;
+		resampleTile(material ? loadBaseColor(source, *material) : Bitmap(), inner, repeating[t] != 0, material ? material->baseColorFactor : WHITE, tile);
+		roughness += material ? material->roughnessFactor : 1.0f;
+
+		// the gutter repeats the tile's edge
+		uint32_t originX = (t % columns) * tileSize;
+		uint32_t originY = (t / columns) * tileSize;
+		for (uint32_t y = 0; y < tileSize; y++) {
+			uint32_t sy = (uint32_t)std::min(std::max((int32_t)y - (int32_t)GUTTER, 0), (int32_t)inner - 1);
+			for (uint32_t x = 0; x < tileSize; x++) {
+				uint32_t sx = (uint32_t)std::min(std::max((int32_t)x - (int32_t)GUTTER, 0), (int32_t)inner - 1);
+				const float* texel = &tile[((size_t)sy * inner + sx) * 4];
+				uint8_t* pixel = &atlas.pixels[((size_t)(originY + y) * atlas.width + originX + x) * 4];
+				pixel[0] = linearToSrgb(texel[0]);
+				pixel[1] = linearToSrgb(texel[1]);
+				pixel[2] = linearToSrgb(texel[2]);
+				pixel[3] = (uint8_t)(std::min(std::max(texel[3], 0.0f), 1.0f) * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	// every instance's lod 0 in world space, uvs moved into their tile
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < instances.size(); i++) {
+		const MeshSubmesh& submesh = source.submeshes[instances[i].submesh];
+		const glm::mat4& world = instances[i].world;
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+		// mirrored transforms flip the winding
+		bool mirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+
+		uint32_t t = tileOfInstance[i];
+		glm::vec2 tileMin(((t % columns) * tileSize + GUTTER) / (float)atlas.width, ((t / columns) * tileSize + GUTTER) / (float)atlas.height);
+		glm::vec2 tileExtent(inner / (float)atlas.width, inner / (float)atlas.height);
+
+		uint32_t base = (uint32_t)vertices.size();
+		for (uint32_t v = submesh.vertexOffset; v < submesh.vertexOffset + submesh.vertexCount; v++) {
+			MeshVertex vertex = source.vertices[v];
+
+			glm::vec3 position = glm::vec3(world * glm::vec4(glm::make_vec3(vertex.position), 1.0f));
+			glm::vec3 normal = glm::normalize(normalMatrix * glm::make_vec3(vertex.normal));
+			glm::vec3 tangent = glm::mat3(world) * glm::make_vec3(vertex.tangent);
+			if (glm::dot(tangent, tangent) > 0.0f) tangent = glm::normalize(tangent);
+			glm::vec2 uv = tileMin + glm::clamp(glm::make_vec2(vertex.uv), 0.0f, 1.0f) * tileExtent;
+
+			memcpy(vertex.position, glm::value_ptr(position), sizeof(vertex.position));
+			if (source.attributes & MESH_ATTRIBUTE_NORMAL) memcpy(vertex.normal, glm::value_ptr(normal), sizeof(vertex.normal));
+			memcpy(vertex.tangent, glm::value_ptr(tangent), sizeof(float) * 3);
+			if (mirrored) vertex.tangent[3] = -vertex.tangent[3];
+			memcpy(vertex.uv, glm::value_ptr(uv), sizeof(vertex.uv));
+			vertices.push_back(vertex);
+
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+		for (uint32_t index = submesh.firstIndex; index < submesh.firstIndex + submesh.indexCount; index += 3) {
+			indices.push_back(base + source.indices[index]);
+			indices.push_back(base + source.indices[index + (mirrored ? 2 : 1)]);
+			indices.push_back(base + source.indices[index + (mirrored ? 1 : 2)]);
+		}
+	}
+
+	if (indices.empty()) {
+		throw std::runtime_error("ERROR: HLOD cluster without triangles!");
+	}
+
+	size_t target = std::max<size_t>(3, (size_t)(indices.size() * settings.reduction) / 3 * 3);
+	float targetError = settings.maxError * glm::length(boundsMax - boundsMin);
+	float error = 0.0f;
+	std::vector<uint32_t> simplified(indices.size());
+	simplified.resize(MeshSimplifier::simplify(simplified.data(), indices.data(), indices.size(), vertices[0].position, sizeof(MeshVertex), vertices.size(),
+		target, targetError, &error));
+
+	// only the vertices the simplified triangles still use, in order of first use
+	MeshSubmesh submesh{};
+	submesh.firstIndex = (uint32_t)proxy.indices.size();
+	submesh.vertexOffset = (int32_t)proxy.vertices.size();
+	submesh.materialIndex = (uint32_t)proxy.materials.size();
+	std::vector<uint32_t> remap(vertices.size(), 0xFFFFFFFF);
+	glm::vec3 usedMin(std::numeric_limits<float>::max());
+	glm::vec3 usedMax(-std::numeric_limits<float>::max());
+	for (uint32_t index : simplified) {
+		if (remap[index] == 0xFFFFFFFF) {
+			remap[index] = (uint32_t)(proxy.vertices.size() - submesh.vertexOffset);
+			proxy.vertices.push_back(vertices[index]);
+			usedMin = glm::min(usedMin, glm::make_vec3(vertices[index].position));
+			usedMax = glm::max(usedMax, glm::make_vec3(vertices[index].position));
+		}
+		proxy.indices.push_back(remap[index]);
+	}
+	submesh.vertexCount = (uint32_t)(proxy.vertices.size() - submesh.vertexOffset);
+	submesh.indexCount = (uint32_t)(proxy.indices.size() - submesh.firstIndex);
+	if (submesh.vertexCount == 0) usedMin = usedMax = glm::vec3(0.0f);
+	memcpy(submesh.aabbMin, glm::value_ptr(usedMin), sizeof(submesh.aabbMin));
+	memcpy(submesh.aabbMax, glm::value_ptr(usedMax), sizeof(submesh.aabbMax));
+
+	// the atlas' texel density, for the texture streamer
+	double surfaceArea = 0.0, uvArea = 0.0;
+	for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i += 3) {
+		const MeshVertex* corners[3];
+		for (uint32_t c = 0; c < 3; c++) corners[c] = &proxy.vertices[submesh.vertexOffset + proxy.indices[i + c]];
+
+		glm::vec3 p0 = glm::make_vec3(corners[0]->position);
+		surfaceArea += 0.5 * glm::length(glm::cross(glm::make_vec3(corners[1]->position) - p0, glm::make_vec3(corners[2]->position) - p0));
+		glm::vec2 t0 = glm::make_vec2(corners[0]->uv);
+		glm::vec2 e1 = glm::make_vec2(corners[1]->uv) - t0, e2 = glm::make_vec2(corners[2]->uv) - t0;
+		uvArea += 0.5 * std::fabs(e1.x * e2.y - e1.y * e2.x);
+	}
+	submesh.uvDensity = surfaceArea > 0.0 ? (float)std::sqrt(uvArea / surfaceArea) : 0.0f;
+
+	// the proxy is its own and only lod, it has no meshlets
+	submesh.firstLod = (uint32_t)proxy.lods.size();
+	submesh.lodCount = 1;
+	proxy.lods.push_back({ submesh.firstIndex, submesh.indexCount, error });
+	submesh.firstMeshlet = (uint32_t)proxy.meshlets.size();
+	submesh.meshletCount = 0;
+
+	MeshMaterial material{};
+	material.name = MESH_NO_STRING;
+	material.baseColorTexture = (uint32_t)proxy.strings.size();
+	proxy.strings.insert(proxy.strings.end(), atlasName.c_str(), atlasName.c_str() + atlasName.size() + 1);
+	material.normalTexture = MESH_NO_STRING;
+	material.metallicRoughnessTexture = MESH_NO_STRING;
+	material.emissiveTexture = MESH_NO_STRING;
+	for (int c = 0; c < 4; c++) material.baseColorFactor[c] = 1.0f;
+	material.metallicFactor = 0.0f;
+	material.roughnessFactor = roughness / materials.size();
+	proxy.materials.push_back(material);
+
+	proxy.attributes |= source.attributes | MESH_ATTRIBUTE_UV;
+	proxy.submeshes.push_back(submesh);
+	return (uint32_t)proxy.submeshes.size() - 1;
+}
@@ -0,0 +1,42 @@
+#ifndef HLOD_BUILDER_H
+#define HLOD_BUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ImageDecoder.h"
+#include "MeshCooker.h"
+
+// cook time hierarchical lods: everything in a cluster of placed submeshes is merged into one
+// world space submesh, simplified far below what the per object lod chains reach, and drawn
+// with a single material whose base colour is an atlas of the cluster's materials. At a
+// distance the whole cluster is that one draw.
+// Every material gets a tile of the atlas holding its base colour texture (times its factor)
+// scaled down, uvs are squeezed into the tile. Materials whose uvs repeat would smear across
+// the tile edge, their tile is the texture's average colour instead
+namespace HlodBuilder {
+	struct Settings {
+		// the proxy aims for this fraction of its cluster's triangles
+		float reduction = 0.1f;
+		// largest simplification error, relative to the cluster's bounding box diagonal
+		float maxError = 0.02f;
+		// edge of a material's atlas tile in pixels
+		uint32_t tileSize = 64;
+	};
+
+	// a submesh of the source mesh placed by a node
+	struct Instance {
+		uint32_t submesh;
+		glm::mat4 world;
+	};
+
+	// appends the cluster's proxy to proxy as one submesh with its own material pointing at
+	// atlasName (relative to the proxy mesh) and returns the submesh's index. atlas receives the
+	// texture. Source textures are read relative to source.directory
+	uint32_t build(const MeshCooker::CookedMesh& source, const std::vector<Instance>& instances, const std::string& atlasName,
+		const Settings& settings, MeshCooker::CookedMesh& proxy, Bitmap& atlas);
+};
+
+#endif
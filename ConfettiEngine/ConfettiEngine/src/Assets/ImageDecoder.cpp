@@ -0,0 +1,194 @@
+#include "ImageDecoder.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+// anything larger is treated as corrupt rather than allocated, same as PNG and JPEG
+static const uint64_t MAX_PIXELS = 1ull << 28;
+
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static uint16_t readLe16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+Bitmap ImageDecoder::decode(const uint8_t* data, size_t size, const std::string& name)
+{
+	if (size >= sizeof(PNG_SIGNATURE) && memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0) {
+		return decodePng(data, size, name);
+	}
+	if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+		return decodeJpeg(data, size, name);
+	}
+
+	std::string extension = name.size() >= 4 ? name.substr(name.size() - 4) : std::string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+	if (extension == ".tga") {
+		return decodeTga(data, size, name);
+	}
+
+	throw std::runtime_error("ERROR: " + name + " is not a PNG, JPEG or TGA image!");
+}
+
+// 5 bits per channel, the top bit is alpha if the file says it has any
+static void unpack16(const uint8_t* p, bool alpha, uint8_t* rgba)
+{
+	uint16_t v = readLe16(p);
+	rgba[0] = (uint8_t)(((v >> 10) & 31) * 255 / 31);
+	rgba[1] = (uint8_t)(((v >> 5) & 31) * 255 / 31);
+	rgba[2] = (uint8_t)((v & 31) * 255 / 31);
+	rgba[3] = alpha && !(v & 0x8000) ? 0 : 255;
+}
+
+Bitmap ImageDecoder::decodeTga(const uint8_t* data, size_t size, const std::string& name)
+{
+	if (size < 18) {
+		throw std::runtime_error("ERROR: " + name + " is not a TGA image!");
+	}
+
+	uint8_t idLength = data[0];
+	uint8_t colorMapType = data[1];
+	uint8_t imageType = data[2];
+	uint16_t mapFirst = readLe16(data + 3);
+	uint16_t mapLength = readLe16(data + 5);
+	uint8_t mapEntryBits = data[7];
+	uint16_t width = readLe16(data + 12);
+	uint16_t height = readLe16(data + 14);
+	uint8_t depth = data[16];
+	uint8_t descriptor = data[17];
+
+	bool rle = (imageType & 8) != 0;
+	uint8_t type = imageType & 7;
+	bool alphaBits = (descriptor & 15) != 0;
+	uint32_t pixelBytes = (depth + 7) / 8;
+
+	bool supported = (type == 1 && colorMapType == 1 && (depth == 8 || depth == 16))
+		|| (type == 2 && (depth == 15 || depth == 16 || depth == 24 || depth == 32))
+		|| (type == 3 && (depth == 8 || depth == 16));
+	if (!supported || width == 0 || height == 0 || (uint64_t)width * height > MAX_PIXELS || (imageType & ~11u) != 0) {
+		throw std::runtime_error("ERROR: " + name + " is an unsupported TGA variant!");
+	}
+
+	size_t position = 18 + (size_t)idLength;
+
+	// colour map entries are stored like true colour pixels
+	std::vector<uint8_t> palette;
+	if (colorMapType == 1) {
+		uint32_t entryBytes = (mapEntryBits + 7) / 8;
+		// colour mapped pixels index into the map, so it can't be empty
+		if (entryBytes < 2 || entryBytes > 4 || (type == 1 && mapLength == 0) || position + (size_t)mapLength * entryBytes > size) {
+			throw std::runtime_error("ERROR: " + name + " is truncated or corrupt!");
+		}
+		palette.resize((size_t)mapLength * 4);
+		for (uint32_t i = 0; i < mapLength; i++) {
+			const uint8_t* p = data + position + (size_t)i * entryBytes;
+			uint8_t* rgba = &palette[(size_t)i * 4];
+			if (entryBytes == 2) {
+				unpack16(p, mapEntryBits == 16 && alphaBits, rgba);
+			}
+			else {
+				rgba[0] = p[2];
+				rgba[1] = p[1];
+				rgba[2] = p[0];
+				rgba[3] = entryBytes == 4 ? p[3] : 255;
+			}
+		}
+		position += (size_t)mapLength * entryBytes;
+	}
+
+	auto toRgba = [&](const uint8_t* p, uint8_t* rgba) {
+		if (type == 1) {
+			uint32_t index = (pixelBytes == 2 ? readLe16(p) : p[0]) - mapFirst;
+			if (index >= mapLength) index = 0;
+			memcpy(rgba, &palette[(size_t)index * 4], 4);
+		}
+		else if (type == 3) {
+			rgba[0] = rgba[1] = rgba[2] = p[0];
+			rgba[3] = pixelBytes == 2 ? p[1] : 255;
+		}
+		else if (pixelBytes == 2) {
+			unpack16(p, depth == 16 && alphaBits, rgba);
+		}
+		else {
+			rgba[0] = p[2];
+			rgba[1] = p[1];
+			rgba[2] = p[0];
+			rgba[3] = pixelBytes == 4 ? p[3] : 255;
+		}
+	};
+
+	// the file has to hold every pixel before the image is allocated, a run length packet
+	// covers at most 128
+	size_t pixelCount = (size_t)width * height;
+	size_t remaining = position < size ? size - position : 0;
+	if (rle ? pixelCount > remaining * 128 : pixelCount * pixelBytes > remaining) {
+		throw std::runtime_error("ERROR: " + name + " is truncated or corrupt!");
+	}
+
+	Bitmap bitmap;
+	bitmap.width = width;
+	bitmap.height = height;
+	bitmap.pixels.resize(pixelCount * 4);
+
+	uint8_t* out = bitmap.pixels.data();
+	for (size_t written = 0; written < pixelCount; ) {
+		uint32_t run = 1;
+		bool repeat = false;
+		if (rle) {
+			if (position >= size) {
+				throw std::runtime_error("ERROR: " + name + " is truncated or corrupt!");
+			}
+			uint8_t packet = data[position++];
+			run = (packet & 127) + 1;
+			repeat = (packet & 128) != 0;
+		}
+		run = (uint32_t)std::min<size_t>(run, pixelCount - written);
+
+		size_t needed = (size_t)(repeat ? 1 : run) * pixelBytes;
+		if (position + needed > size) {
+			throw std::runtime_error("ERROR: " + name + " is truncated or corrupt!");
+		}
+		for (uint32_t i = 0; i < run; i++) {
+			toRgba(data + position + (repeat ? 0 : (size_t)i * pixelBytes), out + (written + i) * 4);
+		}
+		position += needed;
+		written += run;
+	}
+
+	// bottom up unless bit 5 says otherwise, right to left if bit 4 is set
+	size_t rowBytes = (size_t)width * 4;
+	if (!(descriptor & 0x20)) {
+		for (uint32_t y = 0; y < height / 2; y++) {
+			std::swap_ranges(out + y * rowBytes, out + (y + 1) * rowBytes, out + (height - 1 - y) * rowBytes);
+		}
+	}
+	if (descriptor & 0x10) {
+		uint32_t* pixels = (uint32_t*)out;
+		for (uint32_t y = 0; y < height; y++) std::reverse(pixels + (size_t)y * width, pixels + (size_t)(y + 1) * width);
+	}
+
+	return bitmap;
+}
+
+std::vector<uint8_t> ImageDecoder::encodeTga(const Bitmap& bitmap)
+{
+	std::vector<uint8_t> file(18 + bitmap.pixels.size(), 0);
+	file[2] = 2;
+	file[12] = (uint8_t)(bitmap.width & 0xFF);
+	file[13] = (uint8_t)(bitmap.width >> 8);
+	file[14] = (uint8_t)(bitmap.height & 0xFF);
+	file[15] = (uint8_t)(bitmap.height >> 8);
+	file[16] = 32;
+	// top down, 8 alpha bits
+	file[17] = 0x28;
+
+	for (size_t i = 0; i < bitmap.pixels.size(); i += 4) {
+		file[18 + i + 0] = bitmap.pixels[i + 2];
+		file[18 + i + 1] = bitmap.pixels[i + 1];
+		file[18 + i + 2] = bitmap.pixels[i + 0];
+		file[18 + i + 3] = bitmap.pixels[i + 3];
+	}
+	return file;
+}
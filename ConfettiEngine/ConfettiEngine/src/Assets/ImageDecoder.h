@@ -0,0 +1,34 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// decoded image, always 8 bit RGBA, rows top to bottom without padding
+struct Bitmap {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels;
+};
+
+// PNG, baseline JPEG and TGA into RGBA8. Pure functions of their input, so any number of jobs
+// can decode at once. Everything throws on malformed or unsupported files
+namespace ImageDecoder {
+	// picks the decoder by signature, TGA (which has none) by name's extension
+	Bitmap decode(const uint8_t* data, size_t size, const std::string& name);
+
+	// every colour type and bit depth, interlaced or not
+	Bitmap decodePng(const uint8_t* data, size_t size, const std::string& name);
+	// baseline and extended huffman, grey or YCbCr with any sampling factors. No progressive or
+	// arithmetic coded files
+	Bitmap decodeJpeg(const uint8_t* data, size_t size, const std::string& name);
+	// colour mapped, true colour and grey, raw or run length encoded
+	Bitmap decodeTga(const uint8_t* data, size_t size, const std::string& name);
+
+	// uncompressed 32 bit TGA, for textures that arrive as raw pixels
+	std::vector<uint8_t> encodeTga(const Bitmap& bitmap);
+};
+
+#endif
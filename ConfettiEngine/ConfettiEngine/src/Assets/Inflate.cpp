@@ -0,0 +1,265 @@
+#include "Inflate.h"
+#include <cstring>
+
+// codes up to this long decode with one table lookup, longer ones walk the canonical code
+static const uint32_t FAST_BITS = 10;
+
+static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// least significant bit first, reads past the end as zeros and remembers it
+struct BitReader {
+	const uint8_t* data;
+	size_t size;
+	size_t position = 0;
+	uint64_t bits = 0;
+	uint32_t count = 0;
+
+	BitReader(const uint8_t* d, size_t s) : data(d), size(s) {}
+
+	void refill() {
+		while (count <= 56) {
+			uint64_t byte = position < size ? data[position] : 0;
+			position++;
+			bits |= byte << count;
+			count += 8;
+		}
+	}
+
+	uint32_t peek(uint32_t n) {
+		if (count < n) refill();
+		return (uint32_t)(bits & ((1ull << n) - 1));
+	}
+
+	void consume(uint32_t n) {
+		bits >>= n;
+		count -= n;
+	}
+
+	uint32_t read(uint32_t n) {
+		uint32_t value = peek(n);
+		consume(n);
+		return value;
+	}
+
+	void alignToByte() {
+		consume(count % 8);
+	}
+
+	// consumed more than the data holds
+	bool overran() const {
+		return position * 8 - count > size * 8;
+	}
+};
+
+struct Huffman {
+	// symbol | length << 9, 0 for codes longer than FAST_BITS
+	uint16_t fast[1 << FAST_BITS];
+	uint16_t counts[16];
+	uint16_t symbols[288];
+
+	bool build(const uint8_t* lengths, uint32_t n) {
+		memset(counts, 0, sizeof(counts));
+		for (uint32_t i = 0; i < n; i++) counts[lengths[i]]++;
+		counts[0] = 0;
+
+		// over subscribed sets can't be decoded, incomplete ones are allowed (a single distance code)
+		int32_t left = 1;
+		for (uint32_t length = 1; length < 16; length++) {
+			left = (left << 1) - counts[length];
+			if (left < 0) return false;
+		}
+
+		uint16_t offsets[16];
+		offsets[1] = 0;
+		for (uint32_t length = 1; length < 15; length++) offsets[length + 1] = offsets[length] + counts[length];
+		for (uint32_t symbol = 0; symbol < n; symbol++) {
+			if (lengths[symbol]) symbols[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+		}
+
+		// codes are stored most significant bit first, the table is indexed by the bits as read
+		memset(fast, 0, sizeof(fast));
+		uint32_t code = 0;
+		uint32_t index = 0;
+		for (uint32_t length = 1; length < 16; length++) {
+			for (uint32_t i = 0; i < counts[length]; i++, code++) {
+				uint16_t symbol = symbols[index++];
+				if (length > FAST_BITS) continue;
+
+				uint32_t reversed = 0;
+				for (uint32_t b = 0; b < length; b++) reversed |= ((code >> b) & 1) << (length - 1 - b);
+				for (uint32_t fill = reversed; fill < (1u << FAST_BITS); fill += 1u << length) {
+					fast[fill] = (uint16_t)(symbol | length << 9);
+				}
+			}
+			code <<= 1;
+		}
+		return true;
+	}
+
+	int32_t decode(BitReader& in) const {
+		uint16_t entry = fast[in.peek(FAST_BITS)];
+		if (entry) {
+			in.consume(entry >> 9);
+			return entry & 511;
+		}
+
+		int32_t code = 0;
+		int32_t first = 0;
+		int32_t index = 0;
+		for (uint32_t length = 1; length < 16; length++) {
+			code |= (int32_t)in.read(1);
+			int32_t count = counts[length];
+			if (code - first < count) return symbols[index + code - first];
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+};
+
+struct FixedCodes {
+	Huffman literals;
+	Huffman distances;
+
+	FixedCodes() {
+		uint8_t lengths[288];
+		memset(lengths, 8, 144);
+		memset(lengths + 144, 9, 112);
+		memset(lengths + 256, 7, 24);
+		memset(lengths + 280, 8, 8);
+		literals.build(lengths, 288);
+
+		memset(lengths, 5, 30);
+		distances.build(lengths, 30);
+	}
+};
+
+static bool inflateBlock(BitReader& in, const Huffman& literals, const Huffman& distances, std::vector<uint8_t>& output, size_t start, size_t limit)
+{
+	while (true) {
+		int32_t symbol = literals.decode(in);
+		if (symbol < 0 || in.overran()) return false;
+
+		if (symbol < 256) {
+			if (output.size() - start >= limit) return false;
+			output.push_back((uint8_t)symbol);
+			continue;
+		}
+		if (symbol == 256) return true;
+
+		symbol -= 257;
+		if (symbol >= 29) return false;
+		size_t length = LENGTH_BASE[symbol] + in.read(LENGTH_EXTRA[symbol]);
+
+		int32_t code = distances.decode(in);
+		if (code < 0 || code >= 30) return false;
+		size_t distance = DISTANCE_BASE[code] + in.read(DISTANCE_EXTRA[code]);
+		if (distance > output.size() - start || length > limit - (output.size() - start)) return false;
+
+		// byte by byte, a match may overlap what it writes
+		size_t from = output.size() - distance;
+		size_t to = output.size();
+		output.resize(to + length);
+		uint8_t* data = output.data();
+		for (size_t i = 0; i < length; i++) data[to + i] = data[from + i];
+	}
+}
+
+static bool readDynamicCodes(BitReader& in, Huffman& literals, Huffman& distances)
+{
+	uint32_t literalCount = in.read(5) + 257;
+	uint32_t distanceCount = in.read(5) + 1;
+	uint32_t codeLengthCount = in.read(4) + 4;
+	if (literalCount > 286 || distanceCount > 30) return false;
+
+	uint8_t codeLengthLengths[19] = {};
+	for (uint32_t i = 0; i < codeLengthCount; i++) codeLengthLengths[CODE_LENGTH_ORDER[i]] = (uint8_t)in.read(3);
+	Huffman codeLengths;
+	if (!codeLengths.build(codeLengthLengths, 19)) return false;
+
+	uint8_t lengths[286 + 30];
+	uint32_t total = literalCount + distanceCount;
+	for (uint32_t n = 0; n < total; ) {
+		int32_t symbol = codeLengths.decode(in);
+		if (symbol < 0 || in.overran()) return false;
+
+		if (symbol < 16) {
+			lengths[n++] = (uint8_t)symbol;
+			continue;
+		}
+
+		uint8_t value = 0;
+		uint32_t repeat;
+		if (symbol == 16) {
+			if (n == 0) return false;
+			value = lengths[n - 1];
+			repeat = 3 + in.read(2);
+		}
+		else if (symbol == 17) {
+			repeat = 3 + in.read(3);
+		}
+		else {
+			repeat = 11 + in.read(7);
+		}
+		if (n + repeat > total) return false;
+		memset(lengths + n, value, repeat);
+		n += repeat;
+	}
+
+	// a block without an end of block code can't terminate
+	if (lengths[256] == 0) return false;
+	return literals.build(lengths, literalCount) && distances.build(lengths + literalCount, distanceCount);
+}
+
+bool Inflate::deflate(const uint8_t* source, size_t size, std::vector<uint8_t>& output, size_t limit)
+{
+	static const FixedCodes fixed;
+
+	BitReader in(source, size);
+	size_t start = output.size();
+
+	bool last;
+	do {
+		last = in.read(1) != 0;
+		uint32_t type = in.read(2);
+
+		if (type == 0) {
+			in.alignToByte();
+			uint32_t length = in.read(16);
+			if ((length ^ 0xFFFF) != in.read(16)) return false;
+			if (length > limit - (output.size() - start)) return false;
+			for (uint32_t i = 0; i < length; i++) output.push_back((uint8_t)in.read(8));
+			if (in.overran()) return false;
+		}
+		else if (type == 1) {
+			if (!inflateBlock(in, fixed.literals, fixed.distances, output, start, limit)) return false;
+		}
+		else if (type == 2) {
+			Huffman literals, distances;
+			if (!readDynamicCodes(in, literals, distances)) return false;
+			if (!inflateBlock(in, literals, distances, output, start, limit)) return false;
+		}
+		else {
+			return false;
+		}
+	} while (!last);
+
+	return !in.overran();
+}
+
+bool Inflate::zlib(const uint8_t* source, size_t size, std::vector<uint8_t>& output, size_t limit)
+{
+	if (size < 2) return false;
+
+	// deflate only, no preset dictionary. The adler32 trailer isn't checked, PNG has its own CRCs
+	uint8_t method = source[0];
+	uint8_t flags = source[1];
+	if ((method & 15) != 8 || (method * 256 + flags) % 31 != 0 || (flags & 0x20)) return false;
+
+	return deflate(source + 2, size - 2, output, limit);
+}
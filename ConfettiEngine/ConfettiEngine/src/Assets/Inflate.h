@@ -0,0 +1,18 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// deflate decompression (RFC 1951) for the image decoders, table driven so a symbol usually
+// costs one lookup
+namespace Inflate {
+	// a zlib stream (RFC 1950) as PNG stores it, appended to output. False if it is malformed
+	// or would decompress to more than limit bytes, so a tiny stream can't claim gigabytes
+	bool zlib(const uint8_t* source, size_t size, std::vector<uint8_t>& output, size_t limit);
+	// raw deflate data without the zlib header and checksum
+	bool deflate(const uint8_t* source, size_t size, std::vector<uint8_t>& output, size_t limit);
+};
+
+#endif
@@ -0,0 +1,435 @@
+#include "ImageDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+static const uint64_t MAX_PIXELS = 1ull << 28;
+static const uint32_t FAST_BITS = 9;
+
+// zigzag position k -> natural (row major) position in the 8x8 block
+static const uint8_t ZIGZAG[64] = {
+	0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static uint16_t readBe16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+// most significant bit first. Undoes the 0xFF 0x00 stuffing and stops in front of a marker,
+// reading zeros from there on
+struct JpegBitReader {
+	const uint8_t* data;
+	size_t size;
+	size_t position;
+	uint32_t bits = 0;
+	uint32_t count = 0;
+	bool atMarker = false;
+
+	JpegBitReader(const uint8_t* d, size_t s, size_t p) : data(d), size(s), position(p) {}
+
+	void fill() {
+		while (count <= 24) {
+			uint32_t byte = 0;
+			if (!atMarker && position < size) {
+				byte = data[position];
+				if (byte == 0xFF) {
+					uint8_t next = position + 1 < size ? data[position + 1] : 0xD9;
+					if (next == 0x00) {
+						position += 2;
+					}
+					else {
+						atMarker = true;
+						byte = 0;
+					}
+				}
+				else {
+					position++;
+				}
+			}
+			bits |= byte << (24 - count);
+			count += 8;
+		}
+	}
+
+	uint32_t peek(uint32_t n) {
+		if (count < n) fill();
+		return bits >> (32 - n);
+	}
+
+	void consume(uint32_t n) {
+		bits <<= n;
+		count -= n;
+	}
+
+	uint32_t read(uint32_t n) {
+		if (n == 0) return 0;
+		uint32_t value = peek(n);
+		consume(n);
+		return value;
+	}
+
+	// n bit magnitude category to its signed value
+	int32_t receiveExtend(uint32_t n) {
+		if (n == 0) return 0;
+		int32_t value = (int32_t)read(n);
+		return value < (1 << (n - 1)) ? value - (1 << n) + 1 : value;
+	}
+
+	// skips the RSTn marker the reader stopped at, false if there isn't one
+	bool restart() {
+		bits = 0;
+		count = 0;
+		atMarker = false;
+		if (position + 1 >= size || data[position] != 0xFF || data[position + 1] < 0xD0 || data[position + 1] > 0xD7) return false;
+		position += 2;
+		return true;
+	}
+};
+
+struct JpegHuffman {
+	// value | length << 8, 0 for codes longer than FAST_BITS
+	uint16_t fast[1 << FAST_BITS];
+	// per length: one past the largest code and the index of the first code's value
+	int32_t maxCode[18];
+	int32_t valueOffset[17];
+	uint8_t values[256];
+	bool defined = false;
+
+	bool build(const uint8_t* counts, const uint8_t* symbols, uint32_t total) {
+		memcpy(values, symbols, total);
+		memset(fast, 0, sizeof(fast));
+
+		int32_t code = 0;
+		uint32_t index = 0;
+		for (uint32_t length = 1; length <= 16; length++) {
+			valueOffset[length] = (int32_t)index - code;
+			// more codes than the length has room for, checked before any of them land in fast
+			if ((uint32_t)code + counts[length - 1] > (1u << length)) return false;
+			for (uint32_t i = 0; i < counts[length - 1]; i++, code++, index++) {
+				if (length <= FAST_BITS) {
+					uint32_t first = (uint32_t)code << (FAST_BITS - length);
+					for (uint32_t fill = 0; fill < (1u << (FAST_BITS - length)); fill++) {
+						fast[first + fill] = (uint16_t)(values[index] | length << 8);
+					}
+				}
+			}
+			maxCode[length] = code;
+			code <<= 1;
+		}
+		maxCode[17] = 0x7FFFFFFF;
+		defined = true;
+		return true;
+	}
+
+	int32_t decode(JpegBitReader& in) const {
+		uint16_t entry = fast[in.peek(FAST_BITS)];
+		if (entry) {
+			in.consume(entry >> 8);
+			return entry & 0xFF;
+		}
+
+		for (uint32_t length = FAST_BITS + 1; length <= 16; length++) {
+			int32_t code = (int32_t)in.peek(length);
+			if (code < maxCode[length]) {
+				in.consume(length);
+				return values[valueOffset[length] + code];
+			}
+		}
+		return -1;
+	}
+};
+
+struct JpegComponent {
+	uint32_t id;
+	uint32_t h;
+	uint32_t v;
+	uint32_t quantTable;
+	uint32_t dcTable = 0;
+	uint32_t acTable = 0;
+	int32_t dcPrediction = 0;
+	// blocks the plane is wide and tall, covering whole MCUs
+	uint32_t blocksX = 0;
+	uint32_t blocksY = 0;
+	std::vector<uint8_t> plane;
+};
+
+// 8x8 inverse DCT as two separable passes, all zero rows (most of them) are skipped
+struct InverseDct {
+	float table[8][8];
+
+	InverseDct() {
+		for (uint32_t x = 0; x < 8; x++) {
+			for (uint32_t u = 0; u < 8; u++) {
+				float scale = u == 0 ? std::sqrt(0.125f) : 0.5f;
+				table[x][u] = scale * std::cos((2.0f * x + 1.0f) * u * 3.14159265f / 16.0f);
+			}
+		}
+	}
+
+	void transform(const int32_t* coefficients, uint8_t* out, size_t stride) const {
+		float rows[64];
+		for (uint32_t v = 0; v < 8; v++) {
+			const int32_t* row = coefficients + v * 8;
+			float* result = rows + v * 8;
+			bool zero = true;
+			for (uint32_t u = 1; u < 8; u++) zero &= row[u] == 0;
+			if (zero) {
+				float dc = row[0] * table[0][0];
+				for (uint32_t x = 0; x < 8; x++) result[x] = dc;
+				continue;
+			}
+			for (uint32_t x = 0; x < 8; x++) {
+				float sum = 0.0f;
+				for (uint32_t u = 0; u < 8; u++) sum += table[x][u] * row[u];
+				result[x] = sum;
+			}
+		}
+
+		for (uint32_t y = 0; y < 8; y++) {
+			for (uint32_t x = 0; x < 8; x++) {
+				float sum = 128.0f;
+				for (uint32_t v = 0; v < 8; v++) sum += table[y][v] * rows[v * 8 + x];
+				out[y * stride + x] = (uint8_t)std::min(255.0f, std::max(0.0f, sum + 0.5f));
+			}
+		}
+	}
+};
+
+static bool decodeBlock(JpegBitReader& in, JpegComponent& component, const JpegHuffman& dc, const JpegHuffman& ac, const uint16_t* quant, uint8_t* out, size_t stride)
+{
+	static const InverseDct idct;
+
+	int32_t coefficients[64] = {};
+	int32_t category = dc.decode(in);
+	if (category < 0 || category > 16) return false;
+	component.dcPrediction += in.receiveExtend((uint32_t)category);
+	coefficients[0] = component.dcPrediction * quant[0];
+
+	for (uint32_t k = 1; k < 64; ) {
+		int32_t symbol = ac.decode(in);
+		if (symbol < 0) return false;
+
+		uint32_t run = (uint32_t)symbol >> 4;
+		uint32_t magnitude = (uint32_t)symbol & 15;
+		if (magnitude == 0) {
+			// 0xF0 skips 16 zeros, anything else ends the block
+			if (run != 15) break;
+			k += 16;
+			continue;
+		}
+		k += run;
+		if (k > 63) return false;
+		coefficients[ZIGZAG[k]] = in.receiveExtend(magnitude) * quant[k];
+		k++;
+	}
+
+	idct.transform(coefficients, out, stride);
+	return true;
+}
+
+Bitmap ImageDecoder::decodeJpeg(const uint8_t* data, size_t size, const std::string& name)
+{
+	auto corrupt = [&name]() { return std::runtime_error("ERROR: " + name + " is truncated or corrupt!"); };
+
+	uint16_t quant[4][64] = {};
+	JpegHuffman dcTables[4], acTables[4];
+	std::vector<JpegComponent> components;
+	uint32_t width = 0, height = 0;
+	uint32_t maxH = 1, maxV = 1;
+	uint32_t mcusX = 0, mcusY = 0;
+	uint32_t restartInterval = 0;
+	bool frameFound = false;
+
+	size_t position = 2;
+	while (position + 4 <= size) {
+		if (data[position] != 0xFF) {
+			position++;
+			continue;
+		}
+		uint8_t marker = data[position + 1];
+		if (marker == 0xFF || marker == 0x00 || (marker >= 0xD0 && marker <= 0xD8)) {
+			position++;
+			continue;
+		}
+		if (marker == 0xD9) break;
+
+		position += 2;
+		uint32_t length = readBe16(data + position);
+		if (length < 2 || position + length > size) throw corrupt();
+		const uint8_t* segment = data + position + 2;
+		const uint8_t* segmentEnd = data + position + length;
+		position += length;
+
+		if (marker == 0xDB) {
+			for (const uint8_t* p = segment; p < segmentEnd; ) {
+				uint32_t precision = *p >> 4;
+				uint32_t table = *p & 3;
+				p++;
+				if (p + 64 * (precision ? 2 : 1) > segmentEnd) throw corrupt();
+				for (uint32_t k = 0; k < 64; k++) {
+					quant[table][k] = precision ? readBe16(p + k * 2) : p[k];
+				}
+				p += 64 * (precision ? 2 : 1);
+			}
+		}
+		else if (marker == 0xC4) {
+			for (const uint8_t* p = segment; p < segmentEnd; ) {
+				if (p + 17 > segmentEnd) throw corrupt();
+				uint32_t tableClass = *p >> 4;
+				uint32_t table = *p & 3;
+				const uint8_t* counts = p + 1;
+				uint32_t total = 0;
+				for (uint32_t i = 0; i < 16; i++) total += counts[i];
+				if (total > 256 || p + 17 + total > segmentEnd) throw corrupt();
+				JpegHuffman& huffman = tableClass == 0 ? dcTables[table] : acTables[table];
+				if (!huffman.build(counts, p + 17, total)) throw corrupt();
+				p += 17 + total;
+			}
+		}
+		else if (marker == 0xC0 || marker == 0xC1) {
+			if (segmentEnd - segment < 6) throw corrupt();
+			uint32_t precision = segment[0];
+			height = readBe16(segment + 1);
+			width = readBe16(segment + 3);
+			uint32_t count = segment[5];
+			if (precision != 8 || (count != 1 && count != 3) || width == 0 || height == 0 || (uint64_t)width * height > MAX_PIXELS) {
+				throw std::runtime_error("ERROR: " + name + " is an unsupported JPEG variant!");
+			}
+			if (segmentEnd - segment < 6 + 3 * (ptrdiff_t)count) throw corrupt();
+
+			components.resize(count);
+			for (uint32_t c = 0; c < count; c++) {
+				const uint8_t* p = segment + 6 + c * 3;
+				components[c].id = p[0];
+				components[c].h = p[1] >> 4;
+				components[c].v = p[1] & 15;
+				components[c].quantTable = p[2] & 3;
+				if (components[c].h < 1 || components[c].h > 4 || components[c].v < 1 || components[c].v > 4) throw corrupt();
+				maxH = std::max(maxH, components[c].h);
+				maxV = std::max(maxV, components[c].v);
+			}
+
+			mcusX = (width + 8 * maxH - 1) / (8 * maxH);
+			mcusY = (height + 8 * maxV - 1) / (8 * maxV);
+			for (JpegComponent& component : components) {
+				component.blocksX = mcusX * component.h;
+				component.blocksY = mcusY * component.v;
+				component.plane.assign((size_t)component.blocksX * component.blocksY * 64, 0);
+			}
+			frameFound = true;
+		}
+		else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			throw std::runtime_error("ERROR: " + name + " is a progressive, lossless or arithmetic coded JPEG, which is unsupported!");
+		}
+		else if (marker == 0xDD) {
+			if (segmentEnd - segment < 2) throw corrupt();
+			restartInterval = readBe16(segment);
+		}
+		else if (marker == 0xDA) {
+			if (!frameFound || segmentEnd - segment < 1) throw corrupt();
+			uint32_t count = segment[0];
+			if (count < 1 || count > components.size() || segmentEnd - segment < 1 + 2 * (ptrdiff_t)count) throw corrupt();
+
+			std::vector<JpegComponent*> scan;
+			for (uint32_t s = 0; s < count; s++) {
+				const uint8_t* p = segment + 1 + s * 2;
+				auto found = std::find_if(components.begin(), components.end(), [p](const JpegComponent& c) { return c.id == p[0]; });
+				if (found == components.end()) throw corrupt();
+				found->dcTable = p[1] >> 4 & 3;
+				found->acTable = p[1] & 3;
+				found->dcPrediction = 0;
+				if (!dcTables[found->dcTable].defined || !acTables[found->acTable].defined) throw corrupt();
+				scan.push_back(&*found);
+			}
+
+			// a single component scan isn't interleaved, its MCU is one block over the component's own size
+			bool interleaved = count > 1;
+			uint32_t scanX = mcusX, scanY = mcusY;
+			if (!interleaved) {
+				uint32_t componentWidth = (width * scan[0]->h + maxH - 1) / maxH;
+				uint32_t componentHeight = (height * scan[0]->v + maxV - 1) / maxV;
+				scanX = (componentWidth + 7) / 8;
+				scanY = (componentHeight + 7) / 8;
+			}
+
+			JpegBitReader in(data, size, position);
+			uint32_t mcuCount = scanX * scanY;
+			for (uint32_t mcu = 0; mcu < mcuCount; mcu++) {
+				if (restartInterval && mcu > 0 && mcu % restartInterval == 0) {
+					if (!in.restart()) throw corrupt();
+					for (JpegComponent* component : scan) component->dcPrediction = 0;
+				}
+
+				uint32_t mx = mcu % scanX, my = mcu / scanX;
+				for (JpegComponent* component : scan) {
+					uint32_t blocksH = interleaved ? component->h : 1;
+					uint32_t blocksV = interleaved ? component->v : 1;
+					size_t stride = (size_t)component->blocksX * 8;
+					for (uint32_t by = 0; by < blocksV; by++) {
+						for (uint32_t bx = 0; bx < blocksH; bx++) {
+							size_t blockX = (size_t)mx * blocksH + bx;
+							size_t blockY = (size_t)my * blocksV + by;
+							uint8_t* out = component->plane.data() + blockY * 8 * stride + blockX * 8;
+							if (!decodeBlock(in, *component, dcTables[component->dcTable], acTables[component->acTable], quant[component->quantTable], out, stride)) {
+								throw corrupt();
+							}
+						}
+					}
+				}
+			}
+			// carry on from wherever the entropy coded data ended, the next marker is found by the scan for 0xFF
+			position = in.position;
+		}
+	}
+
+	if (!frameFound) throw corrupt();
+
+	Bitmap bitmap;
+	bitmap.width = width;
+	bitmap.height = height;
+	bitmap.pixels.resize((size_t)width * height * 4);
+
+	// chroma is upsampled by picking the nearest sample
+	std::vector<uint32_t> columns[3];
+	for (size_t c = 0; c < components.size(); c++) {
+		columns[c].resize(width);
+		for (uint32_t x = 0; x < width; x++) columns[c][x] = x * components[c].h / maxH;
+	}
+
+	uint8_t* out = bitmap.pixels.data();
+	for (uint32_t y = 0; y < height; y++) {
+		if (components.size() == 1) {
+			const uint8_t* grey = components[0].plane.data() + (size_t)(y * components[0].v / maxV) * components[0].blocksX * 8;
+			for (uint32_t x = 0; x < width; x++, out += 4) {
+				out[0] = out[1] = out[2] = grey[columns[0][x]];
+				out[3] = 255;
+			}
+			continue;
+		}
+
+		const uint8_t* rows[3];
+		for (uint32_t c = 0; c < 3; c++) {
+			rows[c] = components[c].plane.data() + (size_t)(y * components[c].v / maxV) * components[c].blocksX * 8;
+		}
+		// JFIF YCbCr, 16.16 fixed point
+		for (uint32_t x = 0; x < width; x++, out += 4) {
+			int32_t luma = rows[0][columns[0][x]] << 16;
+			int32_t cb = rows[1][columns[1][x]] - 128;
+			int32_t cr = rows[2][columns[2][x]] - 128;
+			int32_t r = (luma + 91881 * cr + 32768) >> 16;
+			int32_t g = (luma - 22554 * cb - 46802 * cr + 32768) >> 16;
+			int32_t b = (luma + 116130 * cb + 32768) >> 16;
+			out[0] = (uint8_t)std::min(255, std::max(0, r));
+			out[1] = (uint8_t)std::min(255, std::max(0, g));
+			out[2] = (uint8_t)std::min(255, std::max(0, b));
+			out[3] = 255;
+		}
+	}
+
+	return bitmap;
+}
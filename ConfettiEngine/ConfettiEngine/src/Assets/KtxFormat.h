@@ -0,0 +1,54 @@
+#ifndef KTX_FORMAT_H
+#define KTX_FORMAT_H
+
+#include <cstdint>
+
+// the subset of KTX 2.0 written by TextureCooker and read by TextureLoader: one 2D image with
+// its whole mip chain, no supercompression. Level data is already in the layout Vulkan copies
+// from, so loading is the level index plus a buffer to image copy per level.
+//
+// [Ktx2Header][Ktx2Level * levelCount][data format descriptor][key/value data][level data]
+//
+// The level index is ordered from level 0 down, the data itself is stored smallest level first
+// (as the spec asks) with every level on a multiple of the block size, 8 or 16 bytes
+
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+enum Ktx2Supercompression : uint32_t {
+	KTX2_SUPERCOMPRESSION_NONE = 0
+};
+
+struct Ktx2Header {
+	uint8_t identifier[12];
+	// VkFormat
+	uint32_t vkFormat;
+	// 1 for block compressed and 8 bit formats
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	// 0 for 2D
+	uint32_t pixelDepth;
+	// 0 when not an array
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+
+struct Ktx2Level {
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	// equal to byteLength without supercompression
+	uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the KTX 2.0 header");
+static_assert(sizeof(Ktx2Level) == 24, "Ktx2Level must match the KTX 2.0 level index");
+
+#endif
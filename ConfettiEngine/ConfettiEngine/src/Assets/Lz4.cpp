@@ -0,0 +1,170 @@
+#include "Lz4.h"
+#include <cstring>
+
+static const size_t MIN_MATCH = 4;
+// the format requires the last 5 bytes to be literals and the last match to start 12 bytes
+// before the end
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_FIND_LIMIT = 12;
+static const size_t MAX_OFFSET = 65535;
+static const uint32_t HASH_BITS = 12;
+static const uint32_t EMPTY = 0xFFFFFFFF;
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t hashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// lengths past the token's 15 continue in bytes of 255
+static uint8_t* writeLength(uint8_t* out, size_t length)
+{
+	while (length >= 255) {
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = (uint8_t)length;
+	return out;
+}
+
+static bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+{
+	uint8_t b;
+	do {
+		if (in >= end) return false;
+		b = *in++;
+		length += b;
+	} while (b == 255);
+	return true;
+}
+
+static uint8_t* writeLiterals(uint8_t* out, uint8_t*& token, const uint8_t* literals, size_t count)
+{
+	token = out++;
+	if (count >= 15) {
+		*token = 15 << 4;
+		out = writeLength(out, count - 15);
+	}
+	else {
+		*token = (uint8_t)(count << 4);
+	}
+	if (count > 0) memcpy(out, literals, count);
+	return out + count;
+}
+
+size_t Lz4::compressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t Lz4::compress(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity)
+{
+	if (capacity < compressBound(size)) return 0;
+
+	const uint8_t* end = source + size;
+	const uint8_t* anchor = source;
+	uint8_t* out = destination;
+	uint8_t* token;
+
+	if (size > MATCH_FIND_LIMIT) {
+		// positions relative to source, 16KB so it stays in L1 next to the data
+		uint32_t table[1 << HASH_BITS];
+		memset(table, 0xFF, sizeof(table));
+
+		const uint8_t* matchLimit = end - MATCH_FIND_LIMIT;
+		const uint8_t* ip = source;
+		while (ip <= matchLimit) {
+			uint32_t sequence = read32(ip);
+			uint32_t hash = hashSequence(sequence);
+			uint32_t candidate = table[hash];
+			table[hash] = (uint32_t)(ip - source);
+
+			if (candidate == EMPTY || (size_t)(ip - source) - candidate > MAX_OFFSET || read32(source + candidate) != sequence) {
+				// skip ahead faster the longer nothing matches, incompressible data stays cheap
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			const uint8_t* match = source + candidate;
+			size_t length = MIN_MATCH;
+			while (ip + length < end - LAST_LITERALS && match[length] == ip[length]) length++;
+
+			// extend backwards into the pending literals
+			while (ip > anchor && match > source && ip[-1] == match[-1]) {
+				ip--;
+				match--;
+				length++;
+			}
+
+			out = writeLiterals(out, token, anchor, ip - anchor);
+			uint16_t offset = (uint16_t)(ip - match);
+			*out++ = (uint8_t)(offset & 0xFF);
+			*out++ = (uint8_t)(offset >> 8);
+
+			size_t extra = length - MIN_MATCH;
+			if (extra >= 15) {
+				*token |= 15;
+				out = writeLength(out, extra - 15);
+			}
+			else {
+				*token |= (uint8_t)extra;
+			}
+
+			ip += length;
+			anchor = ip;
+		}
+	}
+
+	out = writeLiterals(out, token, anchor, end - anchor);
+	return out - destination;
+}
+
+bool Lz4::decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t size)
+{
+	const uint8_t* in = source;
+	const uint8_t* inEnd = source + sourceSize;
+	uint8_t* out = destination;
+	uint8_t* outEnd = destination + size;
+
+	while (in < inEnd) {
+		uint8_t token = *in++;
+
+		size_t literals = token >> 4;
+		if (literals == 15 && !readLength(in, inEnd, literals)) return false;
+		if (literals > (size_t)(inEnd - in) || literals > (size_t)(outEnd - out)) return false;
+		memcpy(out, in, literals);
+		in += literals;
+		out += literals;
+
+		// the last sequence has no match
+		if (in == inEnd) break;
+
+		if (inEnd - in < 2) return false;
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > (size_t)(out - destination)) return false;
+
+		size_t length = token & 15;
+		if (length == 15 && !readLength(in, inEnd, length)) return false;
+		length += MIN_MATCH;
+		if (length > (size_t)(outEnd - out)) return false;
+
+		const uint8_t* match = out - offset;
+		if (offset >= length) {
+			memcpy(out, match, length);
+		}
+		else {
+			// overlapping, repeats the last offset bytes
+			for (size_t i = 0; i < length; i++) out[i] = match[i];
+		}
+		out += length;
+	}
+
+	return out == outEnd;
+}
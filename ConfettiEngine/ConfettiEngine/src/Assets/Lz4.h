@@ -0,0 +1,20 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format (no frame), compatible with the reference decoder. Greedy single probe
+// compressor, decompression runs at memory speed, which is what pack archives need
+namespace Lz4 {
+	// worst case compressed size of size bytes
+	size_t compressBound(size_t size);
+
+	// returns the compressed size, 0 if capacity is below compressBound(size)
+	size_t compress(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity);
+
+	// decompresses to exactly size bytes, false if the block is malformed or a different size
+	bool decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t size);
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+	: data(nullptr), size(0), file(nullptr), mapping(nullptr)
+{
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("ERROR: Failed to open file " + path);
+	}
+	file = handle;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(handle, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+
+	// zero length files can't be mapped, leave data null
+	if (size > 0) {
+		mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data) {
+			if (mapping) CloseHandle(mapping);
+			CloseHandle(handle);
+			throw std::runtime_error("ERROR: Failed to map file " + path);
+		}
+	}
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("ERROR: Failed to open file " + path);
+	}
+	file = (void*)(intptr_t)fd;
+
+	struct stat info;
+	fstat(fd, &info);
+	size = (size_t)info.st_size;
+
+	if (size > 0) {
+		void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("ERROR: Failed to map file " + path);
+		}
+		data = (const uint8_t*)view;
+	}
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	CloseHandle(file);
+#else
+	if (data) munmap((void*)data, size);
+	close((int)(intptr_t)file);
+#endif
+}
+
+const uint8_t* MappedFile::getData() const
+{
+	return data;
+}
+
+size_t MappedFile::getSize() const
+{
+	return size;
+}
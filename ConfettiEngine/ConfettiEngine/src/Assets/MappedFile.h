@@ -0,0 +1,30 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// read only memory mapping of a whole file. Pages are faulted in on first touch, so opening
+// is cheap and only the parts that are read cost IO
+class MappedFile {
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* getData() const;
+	size_t getSize() const;
+
+private:
+	const uint8_t* data;
+	size_t size;
+
+	// platform handles, HANDLEs on windows and the descriptor elsewhere
+	void* file;
+	void* mapping;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "MeshAsset.h"
+#include "../Buffers/Buffer.h"
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+static bool sectionInside(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+	return offset <= fileSize && size <= fileSize - offset && offset % MESH_SECTION_ALIGNMENT == 0;
+}
+
+MeshAsset::MeshAsset(VkPhysicalDevice& p, VkDevice& d, const VirtualFileSystem& v, const std::string& path)
+	: physicalDevice(p), device(d), file(v.open(path)), header(nullptr)
+{
+	if (file.getSize() < sizeof(MeshFileHeader)) {
+		throw std::runtime_error("ERROR: " + path + " is not a cooked mesh!");
+	}
+
+	header = (const MeshFileHeader*)file.getData();
+
+	if (header->magic != MESH_MAGIC) {
+		throw std::runtime_error("ERROR: " + path + " is not a cooked mesh!");
+	}
+	if (header->version != MESH_VERSION || header->vertexStride != vertexStride((MeshVertexFormat)header->vertexFormat)) {
+		throw std::runtime_error("ERROR: " + path + " was cooked with another mesh version, recook it!");
+	}
+
+	// the only validation, offsets are trusted from here on
+	uint64_t indexSize = header->indexType == MESH_INDEX_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	if (header->fileSize != file.getSize()
+		|| !sectionInside(header->vertexOffset, (uint64_t)header->vertexCount * header->vertexStride, file.getSize())
+		|| !sectionInside(header->indexOffset, header->indexCount * indexSize, file.getSize())
+		|| !sectionInside(header->submeshOffset, (uint64_t)header->submeshCount * sizeof(MeshSubmesh), file.getSize())
+		|| !sectionInside(header->lodOffset, (uint64_t)header->lodCount * sizeof(MeshLod), file.getSize())
+		|| !sectionInside(header->meshletOffset, (uint64_t)header->meshletCount * sizeof(MeshMeshlet), file.getSize())
+		|| !sectionInside(header->meshletVertexOffset, (uint64_t)header->meshletVertexCount * sizeof(uint32_t), file.getSize())
+		|| !sectionInside(header->meshletTriangleOffset, (uint64_t)header->meshletTriangleCount * sizeof(uint32_t), file.getSize())
+		|| !sectionInside(header->materialOffset, (uint64_t)header->materialCount * sizeof(MeshMaterial), file.getSize())
+		|| !sectionInside(header->stringOffset, header->stringTableSize, file.getSize())) {
+		throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+	}
+}
+
+MeshAsset::~MeshAsset()
+{
+	releaseStaging();
+	if (vertexBuffer != VK_NULL_HANDLE) Buffer::destroy(device, vertexBuffer, vertexMemory);
+	if (indexBuffer != VK_NULL_HANDLE) Buffer::destroy(device, indexBuffer, indexMemory);
+}
+
+const MeshFileHeader& MeshAsset::getHeader() const
+{
+	return *header;
+}
+
+const void* MeshAsset::getVertices() const
+{
+	return file.getData() + header->vertexOffset;
+}
+
+MeshVertexFormat MeshAsset::getVertexFormat() const
+{
+	return (MeshVertexFormat)header->vertexFormat;
+}
+
+const void* MeshAsset::getIndices() const
+{
+	return file.getData() + header->indexOffset;
+}
+
+const MeshSubmesh* MeshAsset::getSubmeshes() const
+{
+	return (const MeshSubmesh*)(file.getData() + header->submeshOffset);
+}
+
+const MeshLod* MeshAsset::getLods() const
+{
+	return (const MeshLod*)(file.getData() + header->lodOffset);
+}
+
+const MeshMeshlet* MeshAsset::getMeshlets() const
+{
+	return (const MeshMeshlet*)(file.getData() + header->meshletOffset);
+}
+
+const uint32_t* MeshAsset::getMeshletVertices() const
+{
+	return (const uint32_t*)(file.getData() + header->meshletVertexOffset);
+}
+
+const uint32_t* MeshAsset::getMeshletTriangles() const
+{
+	return (const uint32_t*)(file.getData() + header->meshletTriangleOffset);
+}
+
+const MeshMaterial* MeshAsset::getMaterials() const
+{
+	return (const MeshMaterial*)(file.getData() + header->materialOffset);
+}
+
+const char* MeshAsset::getString(uint32_t offset) const
+{
+	if (offset == MESH_NO_STRING || offset >= header->stringTableSize) return nullptr;
+	return (const char*)(file.getData() + header->stringOffset + offset);
+}
+
+void MeshAsset::recordUpload(VkCommandBuffer cmd)
+{
+	VkDeviceSize vertexSize = (VkDeviceSize)header->vertexCount * header->vertexStride;
+	VkDeviceSize indexSize = (VkDeviceSize)header->indexCount * (header->indexType == MESH_INDEX_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+	// index data starts on a 16 byte boundary in the staging buffer too
+	VkDeviceSize indexStart = (vertexSize + 15) & ~(VkDeviceSize)15;
+
+	Buffer::create(physicalDevice, device, indexStart + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+
+	// straight from the mapped file, nothing is decoded on the way
+	void* mapped;
+	vkMapMemory(device, stagingMemory, 0, indexStart + indexSize, 0, &mapped);
+	memcpy(mapped, getVertices(), (size_t)vertexSize);
+	memcpy((uint8_t*)mapped + indexStart, getIndices(), (size_t)indexSize);
+	vkUnmapMemory(device, stagingMemory);
+
+	// storage usage lets compute passes (culling, skinning) read the same buffers
+	Buffer::create(physicalDevice, device, vertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexMemory);
+	Buffer::create(physicalDevice, device, indexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexMemory);
+
+	VkBufferCopy vertexCopy{ 0, 0, vertexSize };
+	VkBufferCopy indexCopy{ indexStart, 0, indexSize };
+	vkCmdCopyBuffer(cmd, stagingBuffer, vertexBuffer, 1, &vertexCopy);
+	vkCmdCopyBuffer(cmd, stagingBuffer, indexBuffer, 1, &indexCopy);
+
+	VkBufferMemoryBarrier barriers[2]{};
+	for (VkBufferMemoryBarrier& barrier : barriers) {
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+	barriers[0].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].buffer = vertexBuffer;
+	barriers[1].dstAccessMask = VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].buffer = indexBuffer;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 2, barriers, 0, nullptr);
+}
+
+void MeshAsset::releaseStaging()
+{
+	if (stagingBuffer != VK_NULL_HANDLE) Buffer::destroy(device, stagingBuffer, stagingMemory);
+}
+
+VkBuffer MeshAsset::getVertexBuffer() const
+{
+	return vertexBuffer;
+}
+
+VkBuffer MeshAsset::getIndexBuffer() const
+{
+	return indexBuffer;
+}
+
+VkIndexType MeshAsset::getIndexType() const
+{
+	return header->indexType == MESH_INDEX_UINT16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+uint32_t MeshAsset::vertexStride(MeshVertexFormat format)
+{
+	switch (format) {
+	case MESH_VERTEX_FLOAT: return sizeof(MeshVertex);
+	case MESH_VERTEX_PACKED: return sizeof(MeshPackedVertex);
+	}
+	return 0;
+}
+
+void MeshAsset::getVertexInput(MeshVertexFormat format, VkVertexInputBindingDescription& binding, std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+	binding.binding = 0;
+	binding.stride = vertexStride(format);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	// locations match gpuDriven.vert and gpuDrivenPacked.vert
+	if (format == MESH_VERTEX_PACKED) {
+		attributes = {
+			{ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(MeshPackedVertex, position) },
+			{ 1, 0, VK_FORMAT_R8G8B8A8_SNORM, offsetof(MeshPackedVertex, normalTangent) },
+			{ 2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(MeshPackedVertex, uv) }
+		};
+	}
+	else {
+		attributes = {
+			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(MeshVertex, position) },
+			{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(MeshVertex, normal) },
+			{ 2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(MeshVertex, tangent) },
+			{ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(MeshVertex, uv) }
+		};
+	}
+}
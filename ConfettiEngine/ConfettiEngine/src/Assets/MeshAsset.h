@@ -0,0 +1,66 @@
+#ifndef MESH_ASSET_H
+#define MESH_ASSET_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+#include "MeshFormat.h"
+#include "VirtualFileSystem.h"
+
+// runtime side of a cooked mesh. The file is opened through the VirtualFileSystem, so it is
+// mapped unless an archive compressed it. Only the header is checked, every section is used in
+// place, the vertex and index blobs are copied byte for byte into a staging buffer and from
+// there into device local memory
+class MeshAsset {
+public:
+	// throws if the file is missing, truncated or from another MESH_VERSION
+	MeshAsset(VkPhysicalDevice& p, VkDevice& d, const VirtualFileSystem& v, const std::string& path);
+	~MeshAsset();
+
+	const MeshFileHeader& getHeader() const;
+	// MeshVertex or MeshPackedVertex depending on getVertexFormat
+	const void* getVertices() const;
+	MeshVertexFormat getVertexFormat() const;
+	const void* getIndices() const;
+	const MeshSubmesh* getSubmeshes() const;
+	// MeshSubmesh::firstLod/lodCount index into this
+	const MeshLod* getLods() const;
+	// MeshSubmesh::firstMeshlet/meshletCount index into this, the offsets of a meshlet into the other two
+	const MeshMeshlet* getMeshlets() const;
+	const uint32_t* getMeshletVertices() const;
+	const uint32_t* getMeshletTriangles() const;
+	const MeshMaterial* getMaterials() const;
+	// nullptr for MESH_NO_STRING
+	const char* getString(uint32_t offset) const;
+
+	// records the copies into cmd, call releaseStaging once that submission has finished
+	void recordUpload(VkCommandBuffer cmd);
+	void releaseStaging();
+
+	VkBuffer getVertexBuffer() const;
+	VkBuffer getIndexBuffer() const;
+	VkIndexType getIndexType() const;
+
+	static uint32_t vertexStride(MeshVertexFormat format);
+	// vertex fetch for binding 0, packed attributes are decoded by the fixed function formats
+	static void getVertexInput(MeshVertexFormat format, VkVertexInputBindingDescription& binding, std::vector<VkVertexInputAttributeDescription>& attributes);
+
+private:
+	VkPhysicalDevice& physicalDevice;
+	VkDevice& device;
+
+	VfsFile file;
+	const MeshFileHeader* header;
+
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+};
+
+#endif
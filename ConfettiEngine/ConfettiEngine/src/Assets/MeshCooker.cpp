@@ -0,0 +1,557 @@
+#include "MeshCooker.h"
+#include "Hash.h"
+#include "ImageDecoder.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "VertexPacking.h"
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <assimp/Importer.hpp>
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/pbrmaterial.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+uint32_t MeshCooker::defaultPostProcess()
+{
+	return aiProcess_Triangulate
+		| aiProcess_GenSmoothNormals
+		| aiProcess_CalcTangentSpace
+		| aiProcess_JoinIdenticalVertices
+		| aiProcess_SortByPType
+		| aiProcess_RemoveRedundantMaterials
+		| aiProcess_FindInvalidData
+		| aiProcess_GenUVCoords
+		| aiProcess_ValidateDataStructure
+		// vulkan samples with the origin in the top left
+		| aiProcess_FlipUVs;
+}
+
+uint64_t MeshCooker::hashSettings(const Settings& settings)
+{
+	uint32_t values[11] = { COOKER_VERSION, MESH_VERSION, settings.postProcess != 0 ? settings.postProcess : defaultPostProcess(), 0, settings.optimize, settings.lodCount, 0, 0, settings.packVertices, settings.buildMeshlets, settings.bakeTransforms };
+	memcpy(&values[3], &settings.scale, sizeof(float));
+	memcpy(&values[6], &settings.lodReduction, sizeof(float));
+	memcpy(&values[7], &settings.lodMaxError, sizeof(float));
+	return Hash::compute(values, sizeof(values));
+}
+
+static uint32_t addString(MeshCooker::CookedMesh& mesh, const char* str)
+{
+	if (!str || !str[0]) return MESH_NO_STRING;
+
+	uint32_t offset = (uint32_t)mesh.strings.size();
+	mesh.strings.insert(mesh.strings.end(), str, str + strlen(str) + 1);
+	return offset;
+}
+
+static uint32_t addTexture(MeshCooker::CookedMesh& mesh, const aiScene* scene, const aiMaterial* material, aiTextureType type, aiTextureType fallback)
+{
+	aiString path;
+	if (material->GetTexture(type, 0, &path) != AI_SUCCESS && material->GetTexture(fallback, 0, &path) != AI_SUCCESS) {
+		return MESH_NO_STRING;
+	}
+
+	// some formats embed a texture but reference it by its original file name, always use the index
+	const aiTexture* embedded = scene->GetEmbeddedTexture(path.C_Str());
+	if (embedded) {
+		uint32_t index = (uint32_t)(std::find(scene->mTextures, scene->mTextures + scene->mNumTextures, embedded) - scene->mTextures);
+		return addString(mesh, ("*" + std::to_string(index)).c_str());
+	}
+	return addString(mesh, path.C_Str());
+}
+
+static void importEmbeddedTextures(MeshCooker::CookedMesh& mesh, const aiScene* scene)
+{
+	for (uint32_t t = 0; t < scene->mNumTextures; t++) {
+		const aiTexture* source = scene->mTextures[t];
+		MeshCooker::EmbeddedTexture texture;
+
+		if (source->mHeight == 0) {
+			// the compressed file as it was, mWidth is its size in bytes
+			texture.extension = source->achFormatHint[0] ? source->achFormatHint : "bin";
+			const uint8_t* data = (const uint8_t*)source->pcData;
+			texture.data.assign(data, data + source->mWidth);
+		}
+		else {
+			Bitmap bitmap;
+			bitmap.width = source->mWidth;
+			bitmap.height = source->mHeight;
+			bitmap.pixels.resize((size_t)bitmap.width * bitmap.height * 4);
+			for (size_t i = 0; i < (size_t)bitmap.width * bitmap.height; i++) {
+				const aiTexel& texel = source->pcData[i];
+				bitmap.pixels[i * 4 + 0] = texel.r;
+				bitmap.pixels[i * 4 + 1] = texel.g;
+				bitmap.pixels[i * 4 + 2] = texel.b;
+				bitmap.pixels[i * 4 + 3] = texel.a;
+			}
+			texture.extension = "tga";
+			texture.data = ImageDecoder::encodeTga(bitmap);
+		}
+		mesh.embeddedTextures.push_back(std::move(texture));
+	}
+}
+
+static void importMaterials(MeshCooker::CookedMesh& mesh, const aiScene* scene)
+{
+	for (uint32_t m = 0; m < scene->mNumMaterials; m++) {
+		const aiMaterial* source = scene->mMaterials[m];
+		MeshMaterial material{};
+
+		aiString name;
+		source->Get(AI_MATKEY_NAME, name);
+		material.name = addString(mesh, name.C_Str());
+
+		material.baseColorTexture = addTexture(mesh, scene, source, aiTextureType_BASE_COLOR, aiTextureType_DIFFUSE);
+		material.normalTexture = addTexture(mesh, scene, source, aiTextureType_NORMALS, aiTextureType_HEIGHT);
+		material.metallicRoughnessTexture = addTexture(mesh, scene, source, aiTextureType_UNKNOWN, aiTextureType_METALNESS);
+		material.emissiveTexture = addTexture(mesh, scene, source, aiTextureType_EMISSIVE, aiTextureType_EMISSION_COLOR);
+
+		aiColor4D baseColor(1.0f, 1.0f, 1.0f, 1.0f);
+		if (source->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_FACTOR, baseColor) != AI_SUCCESS) {
+			source->Get(AI_MATKEY_COLOR_DIFFUSE, baseColor);
+		}
+		aiColor3D emissive(0.0f, 0.0f, 0.0f);
+		source->Get(AI_MATKEY_COLOR_EMISSIVE, emissive);
+
+		float metallic = 0.0f, roughness = 1.0f;
+		source->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLIC_FACTOR, metallic);
+		source->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_ROUGHNESS_FACTOR, roughness);
+
+		material.baseColorFactor[0] = baseColor.r;
+		material.baseColorFactor[1] = baseColor.g;
+		material.baseColorFactor[2] = baseColor.b;
+		material.baseColorFactor[3] = baseColor.a;
+		material.emissiveFactor[0] = emissive.r;
+		material.emissiveFactor[1] = emissive.g;
+		material.emissiveFactor[2] = emissive.b;
+		material.metallicFactor = metallic;
+		material.roughnessFactor = roughness;
+
+		mesh.materials.push_back(material);
+	}
+}
+
+static void importMesh(MeshCooker::CookedMesh& mesh, const aiMesh* source, const glm::mat4& transform)
+{
+	// points and lines are split off by aiProcess_SortByPType, only triangles are kept
+	if (!(source->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) || !source->HasFaces()) return;
+
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+	// mirrored transforms flip the winding and the tangent frame
+	bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+
+	MeshSubmesh submesh{};
+	submesh.firstIndex = (uint32_t)mesh.indices.size();
+	submesh.vertexOffset = (int32_t)mesh.vertices.size();
+	submesh.vertexCount = source->mNumVertices;
+	submesh.materialIndex = source->mMaterialIndex;
+
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+
+	for (uint32_t v = 0; v < source->mNumVertices; v++) {
+		MeshVertex vertex{};
+
+		glm::vec3 position = glm::vec3(transform * glm::vec4(source->mVertices[v].x, source->mVertices[v].y, source->mVertices[v].z, 1.0f));
+		memcpy(vertex.position, glm::value_ptr(position), sizeof(vertex.position));
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+
+		if (source->HasNormals()) {
+			glm::vec3 normal = glm::normalize(normalMatrix * glm::vec3(source->mNormals[v].x, source->mNormals[v].y, source->mNormals[v].z));
+			memcpy(vertex.normal, glm::value_ptr(normal), sizeof(vertex.normal));
+		}
+
+		if (source->HasTangentsAndBitangents()) {
+			glm::vec3 normal(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+			glm::vec3 tangent = glm::normalize(glm::mat3(transform) * glm::vec3(source->mTangents[v].x, source->mTangents[v].y, source->mTangents[v].z));
+			glm::vec3 bitangent = glm::mat3(transform) * glm::vec3(source->mBitangents[v].x, source->mBitangents[v].y, source->mBitangents[v].z);
+			float sign = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+
+			vertex.tangent[0] = tangent.x;
+			vertex.tangent[1] = tangent.y;
+			vertex.tangent[2] = tangent.z;
+			vertex.tangent[3] = sign;
+		}
+
+		if (source->HasTextureCoords(0)) {
+			vertex.uv[0] = source->mTextureCoords[0][v].x;
+			vertex.uv[1] = source->mTextureCoords[0][v].y;
+		}
+
+		mesh.vertices.push_back(vertex);
+	}
+
+	for (uint32_t f = 0; f < source->mNumFaces; f++) {
+		const aiFace& face = source->mFaces[f];
+		if (face.mNumIndices != 3) continue;
+
+		mesh.indices.push_back(face.mIndices[0]);
+		mesh.indices.push_back(face.mIndices[mirrored ? 2 : 1]);
+		mesh.indices.push_back(face.mIndices[mirrored ? 1 : 2]);
+	}
+
+	submesh.indexCount = (uint32_t)mesh.indices.size() - submesh.firstIndex;
+
+	if (source->HasTextureCoords(0)) {
+		double surfaceArea = 0.0, uvArea = 0.0;
+		for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i += 3) {
+			const MeshVertex* corners[3];
+			for (uint32_t c = 0; c < 3; c++) corners[c] = &mesh.vertices[submesh.vertexOffset + mesh.indices[i + c]];
+
+			glm::vec3 p0 = glm::make_vec3(corners[0]->position);
+			surfaceArea += 0.5 * glm::length(glm::cross(glm::make_vec3(corners[1]->position) - p0, glm::make_vec3(corners[2]->position) - p0));
+			glm::vec2 t0 = glm::make_vec2(corners[0]->uv);
+			glm::vec2 e1 = glm::make_vec2(corners[1]->uv) - t0, e2 = glm::make_vec2(corners[2]->uv) - t0;
+			uvArea += 0.5 * std::fabs(e1.x * e2.y - e1.y * e2.x);
+		}
+		submesh.uvDensity = surfaceArea > 0.0 ? (float)std::sqrt(uvArea / surfaceArea) : 0.0f;
+	}
+
+	submesh.firstLod = (uint32_t)mesh.lods.size();
+	submesh.lodCount = 1;
+	mesh.lods.push_back({ submesh.firstIndex, submesh.indexCount, 0.0f });
+	memcpy(submesh.aabbMin, glm::value_ptr(boundsMin), sizeof(submesh.aabbMin));
+	memcpy(submesh.aabbMax, glm::value_ptr(boundsMax), sizeof(submesh.aabbMax));
+
+	if (source->HasNormals()) mesh.attributes |= MESH_ATTRIBUTE_NORMAL;
+	if (source->HasTangentsAndBitangents()) mesh.attributes |= MESH_ATTRIBUTE_TANGENT;
+	if (source->HasTextureCoords(0)) mesh.attributes |= MESH_ATTRIBUTE_UV;
+
+	mesh.submeshes.push_back(submesh);
+}
+
+static void importNode(MeshCooker::CookedMesh& mesh, const aiScene* scene, const aiNode* node, const glm::mat4& parent)
+{
+	// assimp matrices are row major
+	glm::mat4 transform = parent * glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+
+	for (uint32_t m = 0; m < node->mNumMeshes; m++) {
+		importMesh(mesh, scene->mMeshes[node->mMeshes[m]], transform);
+	}
+
+	for (uint32_t c = 0; c < node->mNumChildren; c++) {
+		importNode(mesh, scene, node->mChildren[c], transform);
+	}
+}
+
+// source meshes without triangles
+static const uint32_t NO_SUBMESH = 0xFFFFFFFF;
+
+// the hierarchy as it is, every source mesh was imported once as its own submesh
+static void importHierarchy(MeshCooker::CookedMesh& mesh, const aiNode* node, uint32_t parent, const std::vector<uint32_t>& submeshOfMesh, float rootScale)
+{
+	MeshCooker::CookedNode cooked;
+	cooked.parent = parent;
+	cooked.name = node->mName.C_Str();
+
+	aiVector3D scale, position;
+	aiQuaternion rotation;
+	node->mTransformation.Decompose(scale, rotation, position);
+	if (parent == MeshCooker::NO_PARENT) {
+		scale *= rootScale;
+		position *= rootScale;
+	}
+
+	cooked.position[0] = position.x;
+	cooked.position[1] = position.y;
+	cooked.position[2] = position.z;
+	cooked.rotation[0] = rotation.x;
+	cooked.rotation[1] = rotation.y;
+	cooked.rotation[2] = rotation.z;
+	cooked.rotation[3] = rotation.w;
+	cooked.scale[0] = scale.x;
+	cooked.scale[1] = scale.y;
+	cooked.scale[2] = scale.z;
+
+	for (uint32_t m = 0; m < node->mNumMeshes; m++) {
+		uint32_t submesh = submeshOfMesh[node->mMeshes[m]];
+		if (submesh != NO_SUBMESH) cooked.submeshes.push_back(submesh);
+	}
+
+	uint32_t index = (uint32_t)mesh.nodes.size();
+	mesh.nodes.push_back(std::move(cooked));
+
+	for (uint32_t c = 0; c < node->mNumChildren; c++) {
+		importHierarchy(mesh, node->mChildren[c], index, submeshOfMesh, rootScale);
+	}
+}
+
+// records every file assimp opens besides the source itself, e.g. .mtl libraries or .bin buffers
+class RecordingIOSystem : public Assimp::DefaultIOSystem {
+public:
+	RecordingIOSystem(const std::string& s, std::vector<std::string>& f) : source(s), files(f) {}
+
+	Assimp::IOStream* Open(const char* file, const char* mode) override {
+		Assimp::IOStream* stream = DefaultIOSystem::Open(file, mode);
+		if (stream && file != source && std::find(files.begin(), files.end(), file) == files.end()) {
+			files.push_back(file);
+		}
+		return stream;
+	}
+
+private:
+	std::string source;
+	std::vector<std::string>& files;
+};
+
+static std::string sourceDirectory(const std::string& source)
+{
+	size_t slash = source.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : source.substr(0, slash + 1);
+}
+
+static void addTextureDependencies(MeshCooker::CookedMesh& mesh, const std::string& source)
+{
+	std::string directory = sourceDirectory(source);
+	for (const MeshMaterial& material : mesh.materials) {
+		for (uint32_t texture : { material.baseColorTexture, material.normalTexture, material.metallicRoughnessTexture, material.emissiveTexture }) {
+			// '*' prefixed paths are textures embedded in the source itself
+			if (texture == MESH_NO_STRING || mesh.strings[texture] == '*') continue;
+
+			std::string path = directory + &mesh.strings[texture];
+			if (std::find(mesh.dependencies.begin(), mesh.dependencies.end(), path) == mesh.dependencies.end()) {
+				mesh.dependencies.push_back(path);
+			}
+		}
+	}
+}
+
+MeshCooker::CookedMesh MeshCooker::import(const std::string& source, const Settings& settings)
+{
+	CookedMesh mesh;
+
+	Assimp::Importer importer;
+	// owned by the importer
+	importer.SetIOHandler(new RecordingIOSystem(source, mesh.dependencies));
+	// strip what the runtime never reads so the post processing has less to chew on
+	importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_COLORS | aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS | aiComponent_LIGHTS | aiComponent_CAMERAS);
+	importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+
+	uint32_t steps = settings.postProcess != 0 ? settings.postProcess : defaultPostProcess();
+	const aiScene* scene = importer.ReadFile(source, steps | aiProcess_RemoveComponent);
+
+	if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode) {
+		throw std::runtime_error("ERROR: Failed to import " + source + ": " + importer.GetErrorString());
+	}
+
+	importMaterials(mesh, scene);
+	importEmbeddedTextures(mesh, scene);
+	if (settings.bakeTransforms) {
+		importNode(mesh, scene, scene->mRootNode, glm::mat4(settings.scale));
+	}
+	else {
+		// meshes without triangles don't get a submesh, nodes skip them
+		std::vector<uint32_t> submeshOfMesh(scene->mNumMeshes, NO_SUBMESH);
+		for (uint32_t m = 0; m < scene->mNumMeshes; m++) {
+			size_t before = mesh.submeshes.size();
+			importMesh(mesh, scene->mMeshes[m], glm::mat4(1.0f));
+			if (mesh.submeshes.size() > before) submeshOfMesh[m] = (uint32_t)before;
+		}
+		importHierarchy(mesh, scene->mRootNode, NO_PARENT, submeshOfMesh, settings.scale);
+	}
+
+	if (mesh.submeshes.empty()) {
+		throw std::runtime_error("ERROR: " + source + " contains no triangle meshes!");
+	}
+	addTextureDependencies(mesh, source);
+	mesh.directory = sourceDirectory(source);
+
+	if (settings.optimize) {
+		MeshOptimizer::Stats stats = MeshOptimizer::optimize(mesh);
+
+		// one write so lines from parallel cooks don't interleave
+		std::ostringstream report;
+		report.precision(3);
+		report << "Optimized " << source << ": ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+			<< ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr << "\n";
+		std::cout << report.str();
+	}
+
+	// after the optimizer so the lods are simplified from the final vertex order
+	MeshSimplifier::generateLods(mesh, settings.lodCount, settings.lodReduction, settings.lodMaxError);
+
+	// last, it reorders lod 0's triangles which the simplifier started from
+	if (settings.buildMeshlets) {
+		MeshletBuilder::generateMeshlets(mesh);
+	}
+
+	mesh.vertexFormat = settings.packVertices ? MESH_VERTEX_PACKED : MESH_VERTEX_FLOAT;
+
+	return mesh;
+}
+
+static uint64_t alignSection(uint64_t offset)
+{
+	return (offset + MESH_SECTION_ALIGNMENT - 1) & ~(uint64_t)(MESH_SECTION_ALIGNMENT - 1);
+}
+
+// points the materials' "*index" textures at <output stem>.<index>.<extension> next to output and
+// returns where each referenced embedded texture has to be written, empty for unused ones
+static std::vector<std::string> resolveEmbeddedTextures(const MeshCooker::CookedMesh& mesh, const std::string& output, std::vector<MeshMaterial>& materials, std::vector<char>& strings)
+{
+	std::vector<std::string> paths(mesh.embeddedTextures.size());
+	if (paths.empty()) return paths;
+
+	std::filesystem::path outputPath(output);
+	std::string stem = outputPath.stem().string();
+
+	for (MeshMaterial& material : materials) {
+		for (uint32_t* texture : { &material.baseColorTexture, &material.normalTexture, &material.metallicRoughnessTexture, &material.emissiveTexture }) {
+			if (*texture == MESH_NO_STRING || strings[*texture] != '*') continue;
+
+			uint32_t index = (uint32_t)std::strtoul(&strings[*texture] + 1, nullptr, 10);
+			if (index >= paths.size()) continue;
+
+			std::string name = stem + "." + std::to_string(index) + "." + mesh.embeddedTextures[index].extension;
+			paths[index] = (outputPath.parent_path() / name).string();
+
+			// relative to the mesh like every other texture path
+			*texture = (uint32_t)strings.size();
+			strings.insert(strings.end(), name.c_str(), name.c_str() + name.size() + 1);
+		}
+	}
+	return paths;
+}
+
+void MeshCooker::write(const CookedMesh& mesh, const std::string& output)
+{
+	std::vector<MeshMaterial> materials = mesh.materials;
+	std::vector<char> strings = mesh.strings;
+	std::vector<std::string> texturePaths = resolveEmbeddedTextures(mesh, output, materials, strings);
+
+	// 16 bit indices whenever every submesh is small enough, indices are submesh relative
+	bool shortIndices = std::all_of(mesh.submeshes.begin(), mesh.submeshes.end(), [](const MeshSubmesh& s) { return s.vertexCount <= 0xFFFF; });
+	uint32_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	MeshFileHeader header{};
+	header.magic = MESH_MAGIC;
+	header.version = MESH_VERSION;
+	bool packed = mesh.vertexFormat == MESH_VERTEX_PACKED;
+	header.vertexStride = packed ? sizeof(MeshPackedVertex) : sizeof(MeshVertex);
+	header.vertexFormat = mesh.vertexFormat;
+	header.attributes = mesh.attributes;
+	header.indexType = shortIndices ? MESH_INDEX_UINT16 : MESH_INDEX_UINT32;
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.submeshCount = (uint32_t)mesh.submeshes.size();
+	header.materialCount = (uint32_t)materials.size();
+	header.stringTableSize = (uint32_t)strings.size();
+	header.lodCount = (uint32_t)mesh.lods.size();
+	header.meshletCount = (uint32_t)mesh.meshlets.size();
+	header.meshletVertexCount = (uint32_t)mesh.meshletVertices.size();
+	header.meshletTriangleCount = (uint32_t)mesh.meshletTriangles.size();
+
+	header.vertexOffset = alignSection(sizeof(MeshFileHeader));
+	header.indexOffset = alignSection(header.vertexOffset + (uint64_t)mesh.vertices.size() * header.vertexStride);
+	header.submeshOffset = alignSection(header.indexOffset + (uint64_t)mesh.indices.size() * indexSize);
+	header.lodOffset = alignSection(header.submeshOffset + mesh.submeshes.size() * sizeof(MeshSubmesh));
+	header.meshletOffset = alignSection(header.lodOffset + mesh.lods.size() * sizeof(MeshLod));
+	header.meshletVertexOffset = alignSection(header.meshletOffset + mesh.meshlets.size() * sizeof(MeshMeshlet));
+	header.meshletTriangleOffset = alignSection(header.meshletVertexOffset + mesh.meshletVertices.size() * sizeof(uint32_t));
+	header.materialOffset = alignSection(header.meshletTriangleOffset + mesh.meshletTriangles.size() * sizeof(uint32_t));
+	header.stringOffset = alignSection(header.materialOffset + materials.size() * sizeof(MeshMaterial));
+	header.fileSize = header.stringOffset + strings.size();
+
+	for (int i = 0; i < 3; i++) {
+		header.aabbMin[i] = std::numeric_limits<float>::max();
+		header.aabbMax[i] = -std::numeric_limits<float>::max();
+	}
+	for (const MeshSubmesh& submesh : mesh.submeshes) {
+		for (int i = 0; i < 3; i++) {
+			header.aabbMin[i] = std::min(header.aabbMin[i], submesh.aabbMin[i]);
+			header.aabbMax[i] = std::max(header.aabbMax[i], submesh.aabbMax[i]);
+		}
+	}
+
+	// assemble the whole file in memory and write it in one go
+	std::vector<uint8_t> file(header.fileSize, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	if (packed) {
+		// quantized per submesh, against the same aabb the runtime dequantizes with
+		MeshPackedVertex* vertices = (MeshPackedVertex*)(file.data() + header.vertexOffset);
+		for (const MeshSubmesh& submesh : mesh.submeshes) {
+			glm::vec3 offset, scale;
+			VertexPacking::quantization(submesh, offset, scale);
+			for (uint32_t v = submesh.vertexOffset; v < submesh.vertexOffset + submesh.vertexCount; v++) {
+				vertices[v] = VertexPacking::pack(mesh.vertices[v], offset, scale);
+			}
+		}
+	}
+	else if (!mesh.vertices.empty()) {
+		memcpy(file.data() + header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshVertex));
+	}
+
+	if (shortIndices) {
+		uint16_t* indices = (uint16_t*)(file.data() + header.indexOffset);
+		for (size_t i = 0; i < mesh.indices.size(); i++) indices[i] = (uint16_t)mesh.indices[i];
+	}
+	else if (!mesh.indices.empty()) {
+		memcpy(file.data() + header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+	}
+
+	if (!mesh.submeshes.empty()) {
+		memcpy(file.data() + header.submeshOffset, mesh.submeshes.data(), mesh.submeshes.size() * sizeof(MeshSubmesh));
+	}
+	if (!mesh.lods.empty()) {
+		memcpy(file.data() + header.lodOffset, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+	}
+	if (!mesh.meshlets.empty()) {
+		memcpy(file.data() + header.meshletOffset, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(MeshMeshlet));
+		memcpy(file.data() + header.meshletVertexOffset, mesh.meshletVertices.data(), mesh.meshletVertices.size() * sizeof(uint32_t));
+		memcpy(file.data() + header.meshletTriangleOffset, mesh.meshletTriangles.data(), mesh.meshletTriangles.size() * sizeof(uint32_t));
+	}
+	if (!materials.empty()) {
+		memcpy(file.data() + header.materialOffset, materials.data(), materials.size() * sizeof(MeshMaterial));
+	}
+	if (!strings.empty()) {
+		memcpy(file.data() + header.stringOffset, strings.data(), strings.size());
+	}
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("ERROR: Failed to open " + output + " for writing!");
+	}
+	out.write((const char*)file.data(), file.size());
+	if (!out.good()) {
+		throw std::runtime_error("ERROR: Failed to write " + output + "!");
+	}
+
+	for (size_t t = 0; t < texturePaths.size(); t++) {
+		if (texturePaths[t].empty()) continue;
+
+		std::ofstream texture(texturePaths[t], std::ios::binary | std::ios::trunc);
+		texture.write((const char*)mesh.embeddedTextures[t].data.data(), mesh.embeddedTextures[t].data.size());
+		if (!texture.good()) {
+			throw std::runtime_error("ERROR: Failed to write " + texturePaths[t] + "!");
+		}
+	}
+}
+
+void MeshCooker::cook(const std::string& source, const std::string& output, const Settings& settings)
+{
+	CookedMesh mesh = import(source, settings);
+	write(mesh, output);
+
+	// lod 0 only, the lod chain shares the index buffer
+	size_t triangles = 0;
+	for (const MeshSubmesh& submesh : mesh.submeshes) triangles += submesh.indexCount / 3;
+
+	std::cout << "Cooked " << source << " -> " << output << " (" << mesh.vertices.size() << " vertices, "
+		<< triangles << " triangles, " << mesh.submeshes.size() << " submeshes, " << mesh.lods.size() << " lods, "
+		<< mesh.meshlets.size() << " meshlets)\n";
+}
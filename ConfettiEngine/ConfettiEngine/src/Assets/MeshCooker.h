@@ -0,0 +1,103 @@
+#ifndef MESH_COOKER_H
+#define MESH_COOKER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MeshFormat.h"
+
+// offline conversion of anything assimp can read into the cooked mesh format.
+// Node transforms are baked into the vertices, every mesh referenced by a node becomes a
+// submesh, so the runtime only ever sees flat vertex/index blobs. SceneCooker turns the baking
+// off and places the meshes with entities instead
+namespace MeshCooker {
+	struct Settings {
+		// aiPostProcessSteps, 0 picks defaultPostProcess()
+		uint32_t postProcess = 0;
+		// uniform scale applied on top of the node transforms, e.g. 0.01 for centimetre sources
+		float scale = 1.0f;
+		// vertex cache, overdraw and vertex fetch reordering, see MeshOptimizer
+		bool optimize = true;
+		// lod chain per submesh including the full mesh, 1 disables it, see MeshSimplifier
+		uint32_t lodCount = 4;
+		// each lod aims for this fraction of the previous one's triangles
+		float lodReduction = 0.5f;
+		// largest error any lod may have, relative to the submesh's bounding box diagonal
+		float lodMaxError = 0.05f;
+		// write MeshPackedVertex instead of MeshVertex
+		bool packVertices = true;
+		// split lod 0 into meshlets for cluster culling and mesh shaders, see MeshletBuilder
+		bool buildMeshlets = true;
+		// false keeps every source mesh once, in its own space, and records the node hierarchy
+		// in CookedMesh::nodes instead
+		bool bakeTransforms = true;
+	};
+
+	// texture stored inside the source (glb, fbx), materials refer to it as "*index"
+	struct EmbeddedTexture {
+		// png, jpg, ... or tga for textures assimp hands over as raw texels
+		std::string extension;
+		std::vector<uint8_t> data;
+	};
+
+	static const uint32_t NO_PARENT = 0xFFFFFFFF;
+
+	// node of the source's hierarchy, only imported without baked transforms
+	struct CookedNode {
+		// index into CookedMesh::nodes, parents come before their children
+		uint32_t parent;
+		std::string name;
+		// relative to the parent, the root's includes Settings::scale. Rotation is xyzw
+		float position[3];
+		float rotation[4];
+		float scale[3];
+		// what the node draws, indices into CookedMesh::submeshes
+		std::vector<uint32_t> submeshes;
+	};
+
+	// in memory form of the file, the step between import and write where processing happens
+	struct CookedMesh {
+		uint32_t attributes = 0;
+		// what write() stores, the in memory vertices are always full floats
+		MeshVertexFormat vertexFormat = MESH_VERTEX_FLOAT;
+		std::vector<MeshVertex> vertices;
+		// relative to the owning submesh's vertexOffset
+		std::vector<uint32_t> indices;
+		std::vector<MeshSubmesh> submeshes;
+		// contiguous per submesh, lod 0 of every submesh is its full index range
+		std::vector<MeshLod> lods;
+		// lod 0 of every submesh, its indices are in meshlet order
+		std::vector<MeshMeshlet> meshlets;
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint32_t> meshletTriangles;
+		std::vector<MeshMaterial> materials;
+		std::vector<char> strings;
+		// indexed by the number after the '*', write() saves them next to the output as
+		// <output stem>.<index>.<extension> and points the materials there
+		std::vector<EmbeddedTexture> embeddedTextures;
+		// every other file the import read or references (material libraries, external
+		// buffers, textures), resolved against the source's directory, for incremental cooking
+		std::vector<std::string> dependencies;
+		// the source's directory, what the materials' texture paths are relative to
+		std::string directory;
+		// empty when transforms are baked
+		std::vector<CookedNode> nodes;
+	};
+
+	// bump whenever the import or write code changes what ends up in the file,
+	// so every cooked mesh is considered stale
+	const uint32_t COOKER_VERSION = 7;
+
+	uint32_t defaultPostProcess();
+	// identifies the settings and cooker/format versions a mesh was cooked with
+	uint64_t hashSettings(const Settings& settings);
+
+	CookedMesh import(const std::string& source, const Settings& settings);
+	void write(const CookedMesh& mesh, const std::string& output);
+
+	// import + write, throws on failure
+	void cook(const std::string& source, const std::string& output, const Settings& settings = Settings());
+};
+
+#endif
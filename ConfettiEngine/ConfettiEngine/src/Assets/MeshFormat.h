@@ -0,0 +1,166 @@
+#ifndef MESH_FORMAT_H
+#define MESH_FORMAT_H
+
+#include <cstdint>
+
+// cooked mesh file, written by MeshCooker and mapped straight into memory by MeshAsset.
+// Everything is little endian and fixed size, sections start on MESH_SECTION_ALIGNMENT so
+// the vertex and index blobs can be copied to the GPU as they are.
+//
+// [MeshFileHeader][vertices][indices][MeshSubmesh * n][MeshLod * n][MeshMeshlet * n]
+// [meshlet vertices][meshlet triangles][MeshMaterial * n][string table]
+
+static const uint32_t MESH_MAGIC = 0x534D4643; // "CFMS"
+// bump whenever any struct below changes, old files are rejected and recooked
+static const uint32_t MESH_VERSION = 5;
+static const uint32_t MESH_SECTION_ALIGNMENT = 16;
+static const uint32_t MESH_NO_STRING = 0xFFFFFFFF;
+
+enum MeshIndexType : uint32_t {
+	MESH_INDEX_UINT16 = 0,
+	MESH_INDEX_UINT32 = 1
+};
+
+enum MeshVertexFormat : uint32_t {
+	// MeshVertex, plain floats
+	MESH_VERTEX_FLOAT = 0,
+	// MeshPackedVertex, decoded in Shaders/vertexDecode.glsl
+	MESH_VERTEX_PACKED = 1
+};
+
+// attributes the source actually provided, the rest are zero filled
+enum MeshAttributeFlags : uint32_t {
+	MESH_ATTRIBUTE_NORMAL = 1 << 0,
+	MESH_ATTRIBUTE_TANGENT = 1 << 1,
+	MESH_ATTRIBUTE_UV = 1 << 2
+};
+
+struct MeshVertex {
+	float position[3];
+	float normal[3];
+	// w is the bitangent sign
+	float tangent[4];
+	float uv[2];
+};
+
+// a third of MeshVertex. Every member is a format vertex fetch decodes by itself:
+// R16G16B16A16_UNORM, R8G8B8A8_SNORM and R16G16_SFLOAT
+struct MeshPackedVertex {
+	// xyz within the submesh aabb, see VertexPacking::quantization. w is the bitangent sign,
+	// 0 for -1 and 65535 for +1
+	uint16_t position[4];
+	// octahedral normal in xy, octahedral tangent in zw
+	int8_t normalTangent[4];
+	// half floats
+	uint16_t uv[2];
+};
+
+struct MeshSubmesh {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	// indices are relative to this, matches VkDrawIndexedIndirectCommand::vertexOffset
+	int32_t vertexOffset;
+	uint32_t vertexCount;
+	uint32_t materialIndex;
+	float aabbMin[3];
+	float aabbMax[3];
+	// range in the lod table, the first lod is firstIndex/indexCount above
+	uint32_t firstLod;
+	uint32_t lodCount;
+	// range in the meshlet table, lod 0 only
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	// uv units per mesh unit, the square root of uv area over surface area. Times a texture's
+	// width it is the material's texel density, what TextureStreamer picks mip levels from
+	float uvDensity;
+};
+
+// one level of a submesh's lod chain, finest first. Every level indexes the submesh's own
+// vertices, only the index range differs
+struct MeshLod {
+	// into the whole index buffer
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	// how far, in mesh units, the simplified surface may be from the original
+	float error;
+};
+
+// cluster of at most 64 vertices and 124 triangles of a submesh's lod 0, see MeshletBuilder.
+// The layout is read as is by Shaders/gpuScene.glsl
+struct MeshMeshlet {
+	// bounding sphere in mesh units
+	float center[3];
+	float radius;
+	// normal cone, every triangle faces away from a camera at c when
+	// dot(center - c, coneAxis) >= coneCutoff * length(center - c) + radius.
+	// Cutoff 1 never culls, for meshlets whose normals spread too far
+	float coneAxis[3];
+	float coneCutoff;
+	// into the meshlet vertex and meshlet triangle sections
+	uint32_t vertexOffset;
+	uint32_t triangleOffset;
+	// the same triangles as triangleCount * 3 indices into the whole index buffer
+	uint32_t firstIndex;
+	uint8_t vertexCount;
+	uint8_t triangleCount;
+	uint16_t pad;
+};
+
+struct MeshMaterial {
+	// offsets into the string table or MESH_NO_STRING
+	uint32_t name;
+	uint32_t baseColorTexture;
+	uint32_t normalTexture;
+	uint32_t metallicRoughnessTexture;
+	uint32_t emissiveTexture;
+	float baseColorFactor[4];
+	float emissiveFactor[3];
+	float metallicFactor;
+	float roughnessFactor;
+	uint32_t pad[2];
+};
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexStride;
+	uint32_t attributes;
+	uint32_t indexType;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t submeshCount;
+	uint32_t materialCount;
+	uint32_t stringTableSize;
+	uint32_t lodCount;
+	uint32_t vertexFormat;
+	uint32_t meshletCount;
+	// uint32_t each, submesh relative vertex indices
+	uint32_t meshletVertexCount;
+	// uint32_t each, three meshlet local uint8_t vertex indices in the low bytes
+	uint32_t meshletTriangleCount;
+	uint32_t pad;
+	// byte offsets from the start of the file
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t submeshOffset;
+	uint64_t lodOffset;
+	uint64_t meshletOffset;
+	uint64_t meshletVertexOffset;
+	uint64_t meshletTriangleOffset;
+	uint64_t materialOffset;
+	uint64_t stringOffset;
+	// total file size, catches truncated files
+	uint64_t fileSize;
+	float aabbMin[3];
+	float aabbMax[3];
+};
+
+static_assert(sizeof(MeshVertex) == 48, "MeshVertex layout changed, bump MESH_VERSION");
+static_assert(sizeof(MeshPackedVertex) == 16, "MeshPackedVertex layout changed, bump MESH_VERSION");
+static_assert(sizeof(MeshSubmesh) == 64, "MeshSubmesh layout changed, bump MESH_VERSION");
+static_assert(sizeof(MeshLod) == 12, "MeshLod layout changed, bump MESH_VERSION");
+static_assert(sizeof(MeshMeshlet) == 48, "MeshMeshlet layout changed, bump MESH_VERSION");
+static_assert(sizeof(MeshMaterial) == 64, "MeshMaterial layout changed, bump MESH_VERSION");
+static_assert(sizeof(MeshFileHeader) == 168, "MeshFileHeader layout changed, bump MESH_VERSION");
+
+#endif
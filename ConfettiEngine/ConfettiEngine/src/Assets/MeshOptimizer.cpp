@@ -0,0 +1,309 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+// vertices per triangle list that miss a FIFO cache, the cache is a timestamp per vertex
+struct CacheSimulation {
+	uint32_t misses;
+	uint32_t unique;
+};
+
+static CacheSimulation simulateCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> seen(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	CacheSimulation result{};
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t v = indices[i];
+		if (timestamp - cacheTime[v] > cacheSize) {
+			cacheTime[v] = timestamp++;
+			result.misses++;
+		}
+		if (!seen[v]) {
+			seen[v] = 1;
+			result.unique++;
+		}
+	}
+	return result;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	CacheSimulation simulation = simulateCache(indices, indexCount, vertexCount, cacheSize);
+
+	CacheStats stats;
+	if (indexCount >= 3) stats.acmr = (float)simulation.misses / (float)(indexCount / 3);
+	if (simulation.unique > 0) stats.atvr = (float)simulation.misses / (float)simulation.unique;
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* clusters)
+{
+	uint32_t triangleCount = (uint32_t)(indexCount / 3);
+	if (clusters) clusters->clear();
+	if (triangleCount == 0) return;
+
+	// triangles around each vertex, as offsets into one shared array
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; i++) live[indices[i]]++;
+
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+
+	std::vector<uint32_t> adjacency(indexCount);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		for (uint32_t k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = t;
+	}
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	uint32_t timestamp = CACHE_SIZE + 1;
+	// next vertex to try once both the fan and the dead end stack run dry
+	size_t cursor = 0;
+
+	auto nextUnfinished = [&]() -> uint32_t {
+		while (!deadEnds.empty()) {
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[v] > 0) return v;
+		}
+		for (; cursor < vertexCount; cursor++) {
+			if (live[cursor] > 0) return (uint32_t)cursor;
+		}
+		return INVALID;
+	};
+
+	uint32_t fanning = nextUnfinished();
+	if (clusters) clusters->push_back(0);
+
+	while (fanning != INVALID) {
+		candidates.clear();
+
+		// emit every remaining triangle around the fanning vertex
+		for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+			uint32_t t = adjacency[a];
+			if (emitted[t]) continue;
+			emitted[t] = 1;
+
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (timestamp - cacheTime[v] > CACHE_SIZE) cacheTime[v] = timestamp++;
+			}
+		}
+
+		// the oldest candidate that will still be in the cache after its own fan, so the
+		// fan doesn't push it out before it gets used
+		uint32_t next = INVALID;
+		int32_t best = -1;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0) continue;
+
+			int32_t priority = 0;
+			if (timestamp - cacheTime[v] + 2 * live[v] <= CACHE_SIZE) priority = (int32_t)(timestamp - cacheTime[v]);
+			if (priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+
+		if (next == INVALID) {
+			next = nextUnfinished();
+			if (next != INVALID && clusters) clusters->push_back((uint32_t)output.size());
+		}
+		fanning = next;
+	}
+
+	memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t stride, size_t vertexCount,
+	const std::vector<uint32_t>& clusters, float threshold)
+{
+	if (indexCount < 3 || clusters.empty()) return;
+
+	auto position = [&](uint32_t v) {
+		const float* p = (const float*)((const uint8_t*)positions + v * stride);
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	// split the hard clusters further wherever the ACMR of the piece so far is within threshold
+	// of the whole cluster's, small clusters sort better but each one starts with a cold cache
+	std::vector<uint32_t> boundaries;
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t timestamp = CACHE_SIZE + 1;
+
+	for (size_t c = 0; c < clusters.size(); c++) {
+		uint32_t begin = clusters[c];
+		uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : (uint32_t)indexCount;
+
+		timestamp += CACHE_SIZE + 1;
+		uint32_t clusterMisses = 0;
+		for (uint32_t i = begin; i < end; i++) {
+			uint32_t v = indices[i];
+			if (timestamp - cacheTime[v] > CACHE_SIZE) {
+				cacheTime[v] = timestamp++;
+				clusterMisses++;
+			}
+		}
+		float limit = threshold * (float)clusterMisses / (float)((end - begin) / 3);
+
+		uint32_t start = begin;
+		uint32_t misses = 0;
+		timestamp += CACHE_SIZE + 1;
+		boundaries.push_back(begin);
+		for (uint32_t i = begin; i < end; i += 3) {
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[i + k];
+				if (timestamp - cacheTime[v] > CACHE_SIZE) {
+					cacheTime[v] = timestamp++;
+					misses++;
+				}
+			}
+
+			uint32_t next = i + 3;
+			if (next < end && (float)misses <= limit * (float)((next - start) / 3)) {
+				boundaries.push_back(next);
+				start = next;
+				misses = 0;
+				timestamp += CACHE_SIZE + 1;
+			}
+		}
+	}
+
+	// area weighted centroid and normal per cluster
+	uint32_t clusterCount = (uint32_t)boundaries.size();
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	std::vector<float> areas(clusterCount, 0.0f);
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (uint32_t c = 0; c < clusterCount; c++) {
+		uint32_t end = c + 1 < clusterCount ? boundaries[c + 1] : (uint32_t)indexCount;
+		for (uint32_t i = boundaries[c]; i < end; i += 3) {
+			glm::vec3 a = position(indices[i]);
+			glm::vec3 b = position(indices[i + 1]);
+			glm::vec3 d = position(indices[i + 2]);
+			glm::vec3 normal = glm::cross(b - a, d - a);
+			float area = glm::length(normal);
+
+			centroids[c] += (a + b + d) * (area / 3.0f);
+			normals[c] += normal;
+			areas[c] += area;
+		}
+		meshCentroid += centroids[c];
+		meshArea += areas[c];
+	}
+	if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+	// clusters facing away from the centre are the ones most likely to cover the others
+	std::vector<float> scores(clusterCount, 0.0f);
+	for (uint32_t c = 0; c < clusterCount; c++) {
+		if (areas[c] <= 0.0f) continue;
+		float length = glm::length(normals[c]);
+		glm::vec3 normal = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+		scores[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normal);
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	for (uint32_t c = 0; c < clusterCount; c++) order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return scores[a] > scores[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+	for (uint32_t c : order) {
+		uint32_t end = c + 1 < clusterCount ? boundaries[c + 1] : (uint32_t)indexCount;
+		output.insert(output.end(), indices + boundaries[c], indices + end);
+	}
+	memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+uint32_t MeshOptimizer::optimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap)
+{
+	remap.assign(vertexCount, INVALID);
+
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t& mapped = remap[indices[i]];
+		if (mapped == INVALID) mapped = next++;
+		indices[i] = mapped;
+	}
+	return next;
+}
+
+MeshOptimizer::Stats MeshOptimizer::optimize(MeshCooker::CookedMesh& mesh, float overdrawThreshold)
+{
+	uint64_t triangles = 0;
+	uint64_t missesBefore = 0, uniqueBefore = 0;
+	uint64_t missesAfter = 0, uniqueAfter = 0;
+
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+	std::vector<uint32_t> clusters;
+	std::vector<uint32_t> remap;
+
+	for (MeshSubmesh& submesh : mesh.submeshes) {
+		uint32_t* indices = mesh.indices.data() + submesh.firstIndex;
+		const MeshVertex* source = mesh.vertices.data() + submesh.vertexOffset;
+
+		CacheSimulation before = simulateCache(indices, submesh.indexCount, submesh.vertexCount, CACHE_SIZE);
+		missesBefore += before.misses;
+		uniqueBefore += before.unique;
+		triangles += submesh.indexCount / 3;
+
+		optimizeVertexCache(indices, submesh.indexCount, submesh.vertexCount, &clusters);
+		optimizeOverdraw(indices, submesh.indexCount, source->position, sizeof(MeshVertex), submesh.vertexCount, clusters, overdrawThreshold);
+		uint32_t used = optimizeVertexFetch(indices, submesh.indexCount, submesh.vertexCount, remap);
+
+		// the submesh's vertices in their new order, anything unreferenced is gone
+		uint32_t offset = (uint32_t)vertices.size();
+		vertices.resize(offset + used);
+		for (uint32_t v = 0; v < submesh.vertexCount; v++) {
+			if (remap[v] != INVALID) vertices[offset + remap[v]] = source[v];
+		}
+		submesh.vertexOffset = (int32_t)offset;
+		submesh.vertexCount = used;
+
+		for (int i = 0; i < 3; i++) {
+			submesh.aabbMin[i] = std::numeric_limits<float>::max();
+			submesh.aabbMax[i] = -std::numeric_limits<float>::max();
+		}
+		for (uint32_t v = offset; v < offset + used; v++) {
+			for (int i = 0; i < 3; i++) {
+				submesh.aabbMin[i] = std::min(submesh.aabbMin[i], vertices[v].position[i]);
+				submesh.aabbMax[i] = std::max(submesh.aabbMax[i], vertices[v].position[i]);
+			}
+		}
+
+		CacheSimulation after = simulateCache(indices, submesh.indexCount, used, CACHE_SIZE);
+		missesAfter += after.misses;
+		uniqueAfter += after.unique;
+	}
+
+	mesh.vertices.swap(vertices);
+
+	Stats stats;
+	if (triangles > 0) {
+		stats.before.acmr = (float)missesBefore / (float)triangles;
+		stats.after.acmr = (float)missesAfter / (float)triangles;
+	}
+	if (uniqueBefore > 0) stats.before.atvr = (float)missesBefore / (float)uniqueBefore;
+	if (uniqueAfter > 0) stats.after.atvr = (float)missesAfter / (float)uniqueAfter;
+	return stats;
+}
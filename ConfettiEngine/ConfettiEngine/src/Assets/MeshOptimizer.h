@@ -0,0 +1,55 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshCooker.h"
+
+// cook time reordering of triangle lists, nothing here changes what is drawn, only the order:
+// - vertex cache: Tipsify (Sander et al. 2007), linear time and tuned for a cache of CACHE_SIZE
+// - overdraw: the Tipsify output is cut into clusters wherever that costs little cache
+//   efficiency, then the clusters facing outwards from the mesh centre are drawn first
+// - vertex fetch: vertices are renumbered in the order the indices first touch them
+// The low level functions work on plain index lists so other passes (lods, meshlets) can reuse them
+namespace MeshOptimizer {
+	// post transform cache size the passes are tuned for and the statistics simulate
+	const uint32_t CACHE_SIZE = 16;
+
+	struct CacheStats {
+		// average cache miss ratio, transformed vertices per triangle. 0.5 is the ideal, 3 the worst
+		float acmr = 0.0f;
+		// average transformed to vertex ratio, 1 is the ideal
+		float atvr = 0.0f;
+	};
+
+	struct Stats {
+		CacheStats before;
+		CacheStats after;
+	};
+
+	// FIFO cache simulation over a triangle list
+	CacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+	// reorders the triangles of indices in place for cache hits. When clusters isn't null it
+	// receives the index offsets where Tipsify had to jump to a new area (dead ends),
+	// those are the natural cluster boundaries for optimizeOverdraw
+	void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* clusters = nullptr);
+
+	// reorders the clusters of a cache optimized list, threshold is how much worse than the
+	// input the ACMR is allowed to get, 1.05 trades 5% for the overdraw reduction
+	void optimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t stride, size_t vertexCount,
+		const std::vector<uint32_t>& clusters, float threshold = 1.05f);
+
+	// remap[old] = new in order of first use, unreferenced vertices get INVALID. Rewrites the
+	// indices and returns how many vertices are referenced
+	uint32_t optimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+
+	const uint32_t INVALID = 0xFFFFFFFF;
+
+	// all three passes over every submesh, unreferenced vertices are dropped
+	Stats optimize(MeshCooker::CookedMesh& mesh, float overdrawThreshold = 1.05f);
+};
+
+#endif
@@ -0,0 +1,362 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+static const uint32_t INVALID = 0xFFFFFFFF;
+// border planes are weighted well above the surface so open edges hold their shape
+static const double BORDER_WEIGHT = 10.0;
+
+enum VertexKind : uint8_t {
+	VERTEX_INTERIOR,
+	// on an open edge, only collapses along it
+	VERTEX_BORDER,
+	// attribute seam or non manifold, never moves
+	VERTEX_LOCKED
+};
+
+// symmetric 4x4 error quadric, accumulated in double since the plane terms cancel heavily
+struct Quadric {
+	double a00, a11, a22, a01, a02, a12;
+	double b0, b1, b2;
+	double c;
+	double weight;
+};
+
+static void addPlane(Quadric& q, const glm::dvec3& n, double d, double weight)
+{
+	q.a00 += weight * n.x * n.x;
+	q.a11 += weight * n.y * n.y;
+	q.a22 += weight * n.z * n.z;
+	q.a01 += weight * n.x * n.y;
+	q.a02 += weight * n.x * n.z;
+	q.a12 += weight * n.y * n.z;
+	q.b0 += weight * n.x * d;
+	q.b1 += weight * n.y * d;
+	q.b2 += weight * n.z * d;
+	q.c += weight * d * d;
+	q.weight += weight;
+}
+
+static void addQuadric(Quadric& q, const Quadric& other)
+{
+	q.a00 += other.a00; q.a11 += other.a11; q.a22 += other.a22;
+	q.a01 += other.a01; q.a02 += other.a02; q.a12 += other.a12;
+	q.b0 += other.b0; q.b1 += other.b1; q.b2 += other.b2;
+	q.c += other.c;
+	q.weight += other.weight;
+}
+
+// weighted mean squared distance of p to the planes in q
+static double quadricError(const Quadric& q, const glm::dvec3& p)
+{
+	double r = q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z
+		+ 2.0 * (q.a01 * p.x * p.y + q.a02 * p.x * p.z + q.a12 * p.y * p.z)
+		+ 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z)
+		+ q.c;
+	return q.weight > 0.0 ? std::max(r, 0.0) / q.weight : 0.0;
+}
+
+struct PositionKey {
+	float p[3];
+
+	bool operator==(const PositionKey& other) const { return memcmp(p, other.p, sizeof(p)) == 0; }
+};
+
+struct PositionHash {
+	size_t operator()(const PositionKey& key) const {
+		uint32_t bits[3];
+		memcpy(bits, key.p, sizeof(bits));
+		return (size_t)((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+	}
+};
+
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	double cost;
+};
+
+size_t MeshSimplifier::simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t stride, size_t vertexCount,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	if (resultError) *resultError = 0.0f;
+
+	std::vector<uint32_t> result(indices, indices + indexCount);
+	if (indexCount <= targetIndexCount || vertexCount == 0) {
+		std::copy(result.begin(), result.end(), destination);
+		return indexCount;
+	}
+
+	auto position = [&](uint32_t v) {
+		const float* p = (const float*)((const uint8_t*)positions + v * stride);
+		return glm::dvec3(p[0], p[1], p[2]);
+	};
+
+	// vertices sharing a position are one vertex topologically, the rest of the work is done
+	// on these canonical vertices and only mapped back to real ones when rewriting indices
+	std::vector<uint32_t> canonical(vertexCount);
+	std::unordered_map<PositionKey, uint32_t, PositionHash> unique;
+	unique.reserve(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		const float* p = (const float*)((const uint8_t*)positions + v * stride);
+		PositionKey key = { { p[0], p[1], p[2] } };
+		canonical[v] = unique.emplace(key, v).first->second;
+	}
+
+	// the one referenced vertex of each canonical vertex, INVALID on attribute seams
+	std::vector<uint32_t> wedge(vertexCount, INVALID);
+	std::vector<uint8_t> kind(vertexCount, VERTEX_INTERIOR);
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t c = canonical[indices[i]];
+		if (wedge[c] == INVALID) wedge[c] = indices[i];
+		else if (wedge[c] != indices[i]) kind[c] = VERTEX_LOCKED;
+	}
+	for (uint32_t c = 0; c < vertexCount; c++) {
+		if (kind[c] == VERTEX_LOCKED) wedge[c] = INVALID;
+	}
+
+	auto edgeKey = [](uint32_t a, uint32_t b) { return ((uint64_t)a << 32) | b; };
+
+	std::unordered_map<uint64_t, uint32_t> edges;
+	edges.reserve(indexCount);
+	for (size_t i = 0; i < indexCount; i += 3) {
+		for (uint32_t k = 0; k < 3; k++) {
+			edges[edgeKey(canonical[indices[i + k]], canonical[indices[i + (k + 1) % 3]])]++;
+		}
+	}
+
+	// plane quadrics weighted by area, plus a perpendicular plane along every open edge
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < indexCount; i += 3) {
+		uint32_t v[3] = { canonical[indices[i]], canonical[indices[i + 1]], canonical[indices[i + 2]] };
+		glm::dvec3 p[3] = { position(v[0]), position(v[1]), position(v[2]) };
+
+		glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+		double area = glm::length(normal);
+		if (area <= 0.0) continue;
+		normal /= area;
+
+		for (uint32_t k = 0; k < 3; k++) addPlane(quadrics[v[k]], normal, -glm::dot(normal, p[0]), area);
+
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t a = v[k], b = v[(k + 1) % 3];
+			auto opposite = edges.find(edgeKey(b, a));
+
+			if (edges[edgeKey(a, b)] > 1 || (opposite != edges.end() && opposite->second > 1)) {
+				kind[a] = kind[b] = VERTEX_LOCKED;
+			}
+			else if (opposite == edges.end()) {
+				glm::dvec3 edge = p[(k + 1) % 3] - p[k];
+				glm::dvec3 borderNormal = glm::cross(edge, normal);
+				double length = glm::length(borderNormal);
+				if (length <= 0.0) continue;
+				borderNormal /= length;
+
+				double weight = glm::dot(edge, edge) * BORDER_WEIGHT;
+				addPlane(quadrics[a], borderNormal, -glm::dot(borderNormal, p[k]), weight);
+				addPlane(quadrics[b], borderNormal, -glm::dot(borderNormal, p[k]), weight);
+				if (kind[a] == VERTEX_INTERIOR) kind[a] = VERTEX_BORDER;
+				if (kind[b] == VERTEX_INTERIOR) kind[b] = VERTEX_BORDER;
+			}
+		}
+	}
+
+	std::vector<uint32_t> collapse(vertexCount);
+	for (uint32_t c = 0; c < vertexCount; c++) collapse[c] = c;
+
+	std::vector<uint32_t> offsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> candidates;
+	std::vector<uint8_t> touched(vertexCount);
+
+	double limit = (double)targetError * (double)targetError;
+	double maxError = 0.0;
+
+	// passes of independent collapses, cheapest first, until the target or the error limit
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+
+		// triangles around each canonical vertex
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint32_t index : result) offsets[canonical[index] + 1]++;
+		for (size_t c = 0; c < vertexCount; c++) offsets[c + 1] += offsets[c];
+		adjacency.resize(result.size());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (uint32_t k = 0; k < 3; k++) adjacency[fill[canonical[result[t * 3 + k]]]++] = (uint32_t)t;
+		}
+
+		auto corner = [&](uint32_t t, uint32_t k) { return canonical[result[t * 3 + k]]; };
+		auto hasEdge = [&](uint32_t a, uint32_t b) {
+			for (uint32_t i = offsets[a]; i < offsets[a + 1]; i++) {
+				uint32_t t = adjacency[i];
+				for (uint32_t k = 0; k < 3; k++) {
+					if (corner(t, k) == a && corner(t, (k + 1) % 3) == b) return true;
+				}
+			}
+			return false;
+		};
+
+		auto collapseCost = [&](uint32_t from, uint32_t to, bool borderEdge) {
+			if (kind[from] == VERTEX_LOCKED || wedge[to] == INVALID) return -1.0;
+			if (kind[from] == VERTEX_BORDER && !borderEdge) return -1.0;
+
+			Quadric q = quadrics[from];
+			addQuadric(q, quadrics[to]);
+			return quadricError(q, position(to));
+		};
+
+		candidates.clear();
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t a = corner(t, k), b = corner(t, (k + 1) % 3);
+				if (a == b) continue;
+				// interior edges show up once per side, only look at them from one
+				bool borderEdge = !hasEdge(b, a);
+				if (a > b && !borderEdge) continue;
+
+				double forward = collapseCost(a, b, borderEdge);
+				double backward = collapseCost(b, a, borderEdge);
+				if (forward < 0.0 && backward < 0.0) continue;
+
+				if (backward < 0.0 || (forward >= 0.0 && forward <= backward)) candidates.push_back({ a, b, forward });
+				else candidates.push_back({ b, a, backward });
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		size_t removeTarget = (result.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		bool progress = false;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		for (const Collapse& candidate : candidates) {
+			if (removed >= removeTarget || candidate.cost > limit) break;
+
+			uint32_t from = candidate.from, to = candidate.to;
+			if (touched[from] || touched[to]) continue;
+
+			// moving from onto to must not fold any remaining triangle over
+			glm::dvec3 target = position(to);
+			bool flips = false;
+			size_t collapsing = 0;
+			for (uint32_t i = offsets[from]; i < offsets[from + 1] && !flips; i++) {
+				uint32_t t = adjacency[i];
+				uint32_t v[3] = { corner(t, 0), corner(t, 1), corner(t, 2) };
+				if (v[0] == to || v[1] == to || v[2] == to) {
+					collapsing++;
+					continue;
+				}
+
+				glm::dvec3 p[3] = { position(v[0]), position(v[1]), position(v[2]) };
+				glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				for (uint32_t k = 0; k < 3; k++) {
+					if (v[k] == from) p[k] = target;
+				}
+				glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+				flips = glm::dot(before, after) <= 0.0;
+			}
+			if (flips) continue;
+
+			// the whole one ring is frozen for the rest of the pass, which keeps the flip test
+			// above exact since none of these triangles can change under it
+			for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++) {
+				uint32_t t = adjacency[i];
+				for (uint32_t k = 0; k < 3; k++) touched[corner(t, k)] = 1;
+			}
+
+			collapse[from] = to;
+			addQuadric(quadrics[to], quadrics[from]);
+			maxError = std::max(maxError, candidate.cost);
+			removed += collapsing;
+			progress = true;
+		}
+
+		if (!progress) break;
+
+		// rewrite onto the surviving vertices and drop what collapsed to a line
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t v[3];
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t c = canonical[result[i + k]];
+				v[k] = collapse[c] != c ? wedge[collapse[c]] : result[i + k];
+			}
+
+			uint32_t c0 = canonical[v[0]], c1 = canonical[v[1]], c2 = canonical[v[2]];
+			if (c0 == c1 || c1 == c2 || c0 == c2) continue;
+
+			result[write++] = v[0];
+			result[write++] = v[1];
+			result[write++] = v[2];
+		}
+		result.resize(write);
+
+		for (uint32_t c = 0; c < vertexCount; c++) {
+			if (collapse[c] != c) {
+				// gone for good, never a collapse target or source again
+				kind[c] = VERTEX_LOCKED;
+				wedge[c] = INVALID;
+				collapse[c] = c;
+			}
+		}
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+	if (resultError) *resultError = (float)std::sqrt(maxError);
+	return result.size();
+}
+
+void MeshSimplifier::generateLods(MeshCooker::CookedMesh& mesh, uint32_t levels, float reduction, float maxError)
+{
+	if (levels <= 1) return;
+
+	std::vector<MeshLod> lods;
+	std::vector<uint32_t> current;
+	std::vector<uint32_t> simplified;
+
+	for (MeshSubmesh& submesh : mesh.submeshes) {
+		uint32_t firstLod = (uint32_t)lods.size();
+		lods.push_back(mesh.lods[submesh.firstLod]);
+
+		glm::vec3 extent = glm::vec3(submesh.aabbMax[0], submesh.aabbMax[1], submesh.aabbMax[2]) - glm::vec3(submesh.aabbMin[0], submesh.aabbMin[1], submesh.aabbMin[2]);
+		float budget = maxError * glm::length(extent);
+		const float* positions = mesh.vertices[submesh.vertexOffset].position;
+
+		current.assign(mesh.indices.begin() + submesh.firstIndex, mesh.indices.begin() + submesh.firstIndex + submesh.indexCount);
+		float error = 0.0f;
+
+		for (uint32_t level = 1; level < levels; level++) {
+			size_t target = (size_t)(current.size() / 3 * reduction) * 3;
+			float levelError = 0.0f;
+
+			simplified.resize(current.size());
+			size_t count = simplify(simplified.data(), current.data(), current.size(), positions, sizeof(MeshVertex), submesh.vertexCount,
+				target, budget - error, &levelError);
+
+			// a level that didn't get at least halfway to its target isn't worth drawing
+			if (count == 0 || (float)count > (float)current.size() * (1.0f + reduction) * 0.5f) break;
+
+			simplified.resize(count);
+			MeshOptimizer::optimizeVertexCache(simplified.data(), count, submesh.vertexCount);
+
+			// each level is simplified from the previous one, so the errors add up
+			error += levelError;
+			lods.push_back({ (uint32_t)mesh.indices.size(), (uint32_t)count, error });
+			mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+			current.swap(simplified);
+		}
+
+		submesh.firstLod = firstLod;
+		submesh.lodCount = (uint32_t)lods.size() - firstLod;
+	}
+
+	mesh.lods.swap(lods);
+}
@@ -0,0 +1,28 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MeshCooker.h"
+
+// quadric error edge collapse (Garland & Heckbert 1997) for cook time lod chains.
+// Collapses are half edge, a vertex always moves onto one of its neighbours, so every lod
+// indexes the original vertex buffer and only needs an index range of its own.
+// Open borders only collapse along themselves and vertices on attribute seams (several
+// vertices at one position) are left alone, so neither cracks nor smears uvs
+namespace MeshSimplifier {
+	// writes at most indexCount indices to destination and returns how many. Stops at
+	// targetIndexCount or once a collapse would exceed targetError (mesh units), resultError
+	// receives the largest error actually introduced
+	size_t simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t stride, size_t vertexCount,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+	// appends the coarser levels of every submesh to mesh.indices and rebuilds mesh.lods.
+	// levels includes the full mesh, each level aims for reduction times the previous one's
+	// triangles and the chain stops early once a level would be further than maxError (relative
+	// to the submesh's bounding box diagonal) from the original, or barely gets any smaller
+	void generateLods(MeshCooker::CookedMesh& mesh, uint32_t levels, float reduction, float maxError);
+};
+
+#endif
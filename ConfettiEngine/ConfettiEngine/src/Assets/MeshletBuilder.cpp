@@ -0,0 +1,188 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+static const uint32_t INVALID = 0xFFFFFFFF;
+// normals spread over more than ~84 degrees from the axis, a cone that wide culls nothing
+static const float CONE_MIN_DOT = 0.1f;
+
+static glm::vec3 position(const float* positions, size_t stride, uint32_t v)
+{
+	const float* p = (const float*)((const uint8_t*)positions + v * stride);
+	return glm::vec3(p[0], p[1], p[2]);
+}
+
+size_t MeshletBuilder::build(std::vector<MeshMeshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint32_t>& meshletTriangles,
+	uint32_t* indices, size_t indexCount, const float* positions, size_t stride, size_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) return 0;
+
+	// local vertex indices and counts are stored in bytes
+	maxVertices = std::min(std::max(maxVertices, 3u), 255u);
+	maxTriangles = std::min(std::max(maxTriangles, 1u), 255u);
+
+	// triangles around every vertex, compressed rows
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = t;
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	// meshlet local index of every vertex in the current meshlet, INVALID for the rest
+	std::vector<uint32_t> local(vertexCount, INVALID);
+	std::vector<uint32_t> reordered;
+	reordered.reserve(triangleCount * 3);
+
+	size_t firstMeshlet = meshlets.size();
+	MeshMeshlet current{};
+	current.vertexOffset = (uint32_t)meshletVertices.size();
+	current.triangleOffset = (uint32_t)meshletTriangles.size();
+
+	auto newVertices = [&](uint32_t t) {
+		return (uint32_t)(local[indices[t * 3 + 0]] == INVALID) + (uint32_t)(local[indices[t * 3 + 1]] == INVALID) + (uint32_t)(local[indices[t * 3 + 2]] == INVALID);
+	};
+
+	auto flush = [&]() {
+		if (current.triangleCount == 0) return;
+		computeBounds(current, meshletVertices.data() + current.vertexOffset, meshletTriangles.data() + current.triangleOffset, positions, stride);
+		meshlets.push_back(current);
+
+		for (uint32_t i = 0; i < current.vertexCount; i++) local[meshletVertices[current.vertexOffset + i]] = INVALID;
+
+		current = MeshMeshlet{};
+		current.vertexOffset = (uint32_t)meshletVertices.size();
+		current.triangleOffset = (uint32_t)meshletTriangles.size();
+		current.firstIndex = (uint32_t)reordered.size();
+	};
+
+	size_t cursor = 0;
+	for (size_t done = 0; done < triangleCount; done++) {
+		// the unused triangle around the meshlet that adds the fewest vertices, earliest on ties
+		uint32_t best = INVALID;
+		uint32_t bestNew = 4;
+		for (uint32_t i = 0; i < current.vertexCount; i++) {
+			uint32_t v = meshletVertices[current.vertexOffset + i];
+			for (uint32_t a = offsets[v]; a < offsets[v + 1]; a++) {
+				uint32_t t = adjacency[a];
+				if (emitted[t]) continue;
+
+				uint32_t added = newVertices(t);
+				if (added < bestNew || (added == bestNew && t < best)) {
+					best = t;
+					bestNew = added;
+				}
+			}
+		}
+
+		bool full = best != INVALID && (current.vertexCount + bestNew > maxVertices || current.triangleCount + 1u > maxTriangles);
+		if (full) flush();
+
+		// nothing connected left, or a fresh meshlet: carry on in input order
+		if (best == INVALID || full) {
+			while (emitted[cursor]) cursor++;
+			best = (uint32_t)cursor;
+			if (current.vertexCount + newVertices(best) > maxVertices || current.triangleCount + 1u > maxTriangles) flush();
+		}
+
+		uint32_t packed = 0;
+		for (int k = 0; k < 3; k++) {
+			uint32_t v = indices[best * 3 + k];
+			if (local[v] == INVALID) {
+				local[v] = current.vertexCount++;
+				meshletVertices.push_back(v);
+			}
+			packed |= local[v] << (8 * k);
+			reordered.push_back(v);
+		}
+		meshletTriangles.push_back(packed);
+		current.triangleCount++;
+		emitted[best] = true;
+	}
+	flush();
+
+	std::copy(reordered.begin(), reordered.end(), indices);
+	return meshlets.size() - firstMeshlet;
+}
+
+void MeshletBuilder::computeBounds(MeshMeshlet& meshlet, const uint32_t* meshletVertices, const uint32_t* meshletTriangles, const float* positions, size_t stride)
+{
+	glm::vec3 lo(std::numeric_limits<float>::max());
+	glm::vec3 hi(-std::numeric_limits<float>::max());
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+		glm::vec3 p = position(positions, stride, meshletVertices[i]);
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+
+	glm::vec3 center = (lo + hi) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+		radius = std::max(radius, glm::length(position(positions, stride, meshletVertices[i]) - center));
+	}
+
+	// the cone axis is the average face normal, its cutoff the sine of the widest angle to it
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.triangleCount);
+	glm::vec3 axis(0.0f);
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		uint32_t packed = meshletTriangles[t];
+		glm::vec3 a = position(positions, stride, meshletVertices[packed & 0xFF]);
+		glm::vec3 b = position(positions, stride, meshletVertices[(packed >> 8) & 0xFF]);
+		glm::vec3 c = position(positions, stride, meshletVertices[(packed >> 16) & 0xFF]);
+
+		glm::vec3 n = glm::cross(b - a, c - a);
+		float length = glm::length(n);
+		// zero area triangles can't be seen from either side
+		if (length <= 0.0f) continue;
+
+		normals.push_back(n / length);
+		axis += normals.back();
+	}
+
+	float axisLength = glm::length(axis);
+	float minDot = 1.0f;
+	if (axisLength > 0.0f) {
+		axis /= axisLength;
+		for (const glm::vec3& n : normals) minDot = std::min(minDot, glm::dot(axis, n));
+	}
+
+	for (int i = 0; i < 3; i++) meshlet.center[i] = center[i];
+	meshlet.radius = radius;
+
+	if (axisLength <= 0.0f || minDot <= CONE_MIN_DOT) {
+		meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+		meshlet.coneCutoff = 1.0f;
+	}
+	else {
+		for (int i = 0; i < 3; i++) meshlet.coneAxis[i] = axis[i];
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+void MeshletBuilder::generateMeshlets(MeshCooker::CookedMesh& mesh)
+{
+	mesh.meshlets.clear();
+	mesh.meshletVertices.clear();
+	mesh.meshletTriangles.clear();
+
+	for (MeshSubmesh& submesh : mesh.submeshes) {
+		submesh.firstMeshlet = (uint32_t)mesh.meshlets.size();
+
+		// lod 0 is the submesh's own range, the other lods live elsewhere and keep their order
+		submesh.meshletCount = (uint32_t)build(mesh.meshlets, mesh.meshletVertices, mesh.meshletTriangles,
+			mesh.indices.data() + submesh.firstIndex, submesh.indexCount, mesh.vertices[submesh.vertexOffset].position, sizeof(MeshVertex), submesh.vertexCount);
+
+		for (uint32_t m = submesh.firstMeshlet; m < submesh.firstMeshlet + submesh.meshletCount; m++) {
+			mesh.meshlets[m].firstIndex += submesh.firstIndex;
+		}
+	}
+}
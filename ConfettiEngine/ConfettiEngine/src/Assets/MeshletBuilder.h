@@ -0,0 +1,35 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshCooker.h"
+
+// cook time split of triangle lists into meshlets, small clusters the GPU culls one by one
+// (Culling/ClusterCulling) and mesh shaders draw as one workgroup each.
+// Meshlets are grown greedily from the input order, always taking the neighbouring triangle
+// that adds the fewest new vertices, so a cache optimized list gives compact clusters
+namespace MeshletBuilder {
+	// what NV mesh shaders output comfortably per workgroup, 124 keeps the primitive
+	// indices of a meshlet within 372 bytes
+	const uint32_t MAX_VERTICES = 64;
+	const uint32_t MAX_TRIANGLES = 124;
+
+	// appends meshlets for a triangle list and reorders the triangles of indices in place so every
+	// meshlet is one contiguous range. Meshlet vertices are indices into positions, firstIndex is
+	// relative to indices and vertexOffset/triangleOffset to the two arrays. Returns how many
+	// meshlets were appended
+	size_t build(std::vector<MeshMeshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint32_t>& meshletTriangles,
+		uint32_t* indices, size_t indexCount, const float* positions, size_t stride, size_t vertexCount,
+		uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+	// bounding sphere and normal cone of a built meshlet
+	void computeBounds(MeshMeshlet& meshlet, const uint32_t* meshletVertices, const uint32_t* meshletTriangles, const float* positions, size_t stride);
+
+	// meshlets for lod 0 of every submesh, the coarser lods are small enough to cull whole
+	void generateMeshlets(MeshCooker::CookedMesh& mesh);
+};
+
+#endif
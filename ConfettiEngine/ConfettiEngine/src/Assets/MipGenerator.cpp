@@ -0,0 +1,137 @@
+#include "MipGenerator.h"
+#include "../Math/Simd.h"
+#include <algorithm>
+#include <cmath>
+
+// one RGBA pixel, aligned so a whole texel is a single Simd4 load
+struct alignas(16) Texel {
+	float v[4];
+};
+
+struct SrgbTables {
+	float toLinear[256];
+	// linear value at which the encoded byte rounds up to i + 1, so encoding is a search
+	// through these instead of a pow per channel
+	float thresholds[255];
+
+	static float decode(float e) {
+		return e <= 0.04045f ? e / 12.92f : std::pow((e + 0.055f) / 1.055f, 2.4f);
+	}
+
+	SrgbTables() {
+		for (uint32_t i = 0; i < 256; i++) toLinear[i] = decode(i / 255.0f);
+		for (uint32_t i = 0; i < 255; i++) thresholds[i] = decode((i + 0.5f) / 255.0f);
+	}
+
+	uint8_t encode(float linear) const {
+		return (uint8_t)(std::upper_bound(thresholds, thresholds + 255, linear) - thresholds);
+	}
+};
+
+static const SrgbTables& srgbTables()
+{
+	static const SrgbTables tables;
+	return tables;
+}
+
+static uint8_t encodeUnorm(float value)
+{
+	return (uint8_t)std::min(255.0f, std::max(0.0f, value * 255.0f + 0.5f));
+}
+
+// one source row averaged pairwise into width columns, an odd source folds its last column
+// into the last output
+static void filterRow(const Texel* row, uint32_t sourceWidth, uint32_t width, Texel* out)
+{
+	const Simd4::Float half = Simd4::set1(0.5f);
+	const Simd4::Float third = Simd4::set1(1.0f / 3.0f);
+	bool fold = sourceWidth > 1 && (sourceWidth & 1);
+
+	for (uint32_t x = 0; x < width; x++) {
+		uint32_t x0 = x * 2;
+		uint32_t x1 = std::min(x0 + 1, sourceWidth - 1);
+		Simd4::Float sum = Simd4::add(Simd4::load(row[x0].v), Simd4::load(row[x1].v));
+		if (fold && x == width - 1) {
+			Simd4::store(out[x].v, Simd4::mul(Simd4::add(sum, Simd4::load(row[x0 + 2].v)), third));
+		}
+		else {
+			Simd4::store(out[x].v, Simd4::mul(sum, half));
+		}
+	}
+}
+
+static void downsample(const std::vector<Texel>& source, uint32_t sourceWidth, uint32_t sourceHeight, std::vector<Texel>& out, uint32_t width, uint32_t height)
+{
+	const Simd4::Float half = Simd4::set1(0.5f);
+	const Simd4::Float third = Simd4::set1(1.0f / 3.0f);
+	bool fold = sourceHeight > 1 && (sourceHeight & 1);
+
+	std::vector<Texel> rows[3];
+	for (std::vector<Texel>& row : rows) row.resize(width);
+	out.resize((size_t)width * height);
+
+	for (uint32_t y = 0; y < height; y++) {
+		uint32_t y0 = y * 2;
+		uint32_t y1 = std::min(y0 + 1, sourceHeight - 1);
+		bool three = fold && y == height - 1;
+
+		filterRow(&source[(size_t)y0 * sourceWidth], sourceWidth, width, rows[0].data());
+		filterRow(&source[(size_t)y1 * sourceWidth], sourceWidth, width, rows[1].data());
+		if (three) filterRow(&source[(size_t)(y0 + 2) * sourceWidth], sourceWidth, width, rows[2].data());
+
+		Texel* destination = &out[(size_t)y * width];
+		for (uint32_t x = 0; x < width; x++) {
+			Simd4::Float sum = Simd4::add(Simd4::load(rows[0][x].v), Simd4::load(rows[1][x].v));
+			if (three) {
+				Simd4::store(destination[x].v, Simd4::mul(Simd4::add(sum, Simd4::load(rows[2][x].v)), third));
+			}
+			else {
+				Simd4::store(destination[x].v, Simd4::mul(sum, half));
+			}
+		}
+	}
+}
+
+uint32_t MipGenerator::levelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1) levels++;
+	return levels;
+}
+
+std::vector<Bitmap> MipGenerator::generate(const Bitmap& base, bool srgb)
+{
+	const SrgbTables& tables = srgbTables();
+	std::vector<Bitmap> levels;
+
+	std::vector<Texel> current((size_t)base.width * base.height);
+	for (size_t i = 0; i < current.size(); i++) {
+		const uint8_t* p = &base.pixels[i * 4];
+		for (uint32_t c = 0; c < 3; c++) current[i].v[c] = srgb ? tables.toLinear[p[c]] : p[c] / 255.0f;
+		current[i].v[3] = p[3] / 255.0f;
+	}
+
+	std::vector<Texel> next;
+	uint32_t width = base.width, height = base.height;
+	while (width > 1 || height > 1) {
+		uint32_t nextWidth = std::max(width / 2, 1u);
+		uint32_t nextHeight = std::max(height / 2, 1u);
+		downsample(current, width, height, next, nextWidth, nextHeight);
+
+		Bitmap level;
+		level.width = nextWidth;
+		level.height = nextHeight;
+		level.pixels.resize(next.size() * 4);
+		for (size_t i = 0; i < next.size(); i++) {
+			uint8_t* p = &level.pixels[i * 4];
+			for (uint32_t c = 0; c < 3; c++) p[c] = srgb ? tables.encode(next[i].v[c]) : encodeUnorm(next[i].v[c]);
+			p[3] = encodeUnorm(next[i].v[3]);
+		}
+		levels.push_back(std::move(level));
+
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return levels;
+}
@@ -0,0 +1,22 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageDecoder.h"
+
+// CPU mip chains for textures whose format can't be blitted with linear filtering.
+// Filtering happens on linear light values: sRGB colour is decoded before the 2x2 box filter
+// and encoded again afterwards, alpha is always linear. Levels are filtered from the previous
+// level's float values rather than its rounded bytes, so error doesn't build up down the chain
+namespace MipGenerator {
+	// levels in a full chain down to 1x1
+	uint32_t levelCount(uint32_t width, uint32_t height);
+
+	// every level after the base, largest first. Odd sizes round down and fold their last
+	// row/column into the previous one
+	std::vector<Bitmap> generate(const Bitmap& base, bool srgb);
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "PackArchive.h"
+#include "Hash.h"
+#include "Lz4.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+static bool sectionInside(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+	return offset <= fileSize && size <= fileSize - offset;
+}
+
+PackArchive::PackArchive(const std::string& path)
+	: path(path), file(path), header(nullptr), entries(nullptr), chunks(nullptr), strings(nullptr)
+{
+	if (file.getSize() < sizeof(PackHeader)) {
+		throw std::runtime_error("ERROR: " + path + " is not a pack archive!");
+	}
+
+	header = (const PackHeader*)file.getData();
+
+	if (header->magic != PACK_MAGIC) {
+		throw std::runtime_error("ERROR: " + path + " is not a pack archive!");
+	}
+	if (header->version != PACK_VERSION) {
+		throw std::runtime_error("ERROR: " + path + " was built with another pack version, rebuild it!");
+	}
+	if (header->fileSize != file.getSize()
+		|| !sectionInside(header->entryOffset, (uint64_t)header->entryCount * sizeof(PackEntry), file.getSize())
+		|| !sectionInside(header->chunkOffset, (uint64_t)header->chunkCount * sizeof(PackChunk), file.getSize())
+		|| !sectionInside(header->stringOffset, header->stringTableSize, file.getSize())
+		|| header->entryOffset % alignof(PackEntry) != 0 || header->chunkOffset % alignof(PackChunk) != 0
+		|| (header->stringTableSize > 0 && file.getData()[header->stringOffset + header->stringTableSize - 1] != 0)) {
+		throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+	}
+
+	entries = (const PackEntry*)(file.getData() + header->entryOffset);
+	chunks = (const PackChunk*)(file.getData() + header->chunkOffset);
+	strings = (const char*)(file.getData() + header->stringOffset);
+}
+
+const PackEntry* PackArchive::find(const std::string& entryPath) const
+{
+	uint64_t hash = Hash::compute(entryPath.data(), entryPath.size());
+
+	const PackEntry* end = entries + header->entryCount;
+	const PackEntry* entry = std::lower_bound(entries, end, hash, [](const PackEntry& e, uint64_t h) { return e.pathHash < h; });
+	for (; entry != end && entry->pathHash == hash; entry++) {
+		const char* name = getEntryPath(*entry);
+		if (name && entryPath == name) return entry;
+	}
+	return nullptr;
+}
+
+const std::string& PackArchive::getPath() const
+{
+	return path;
+}
+
+uint32_t PackArchive::getEntryCount() const
+{
+	return header->entryCount;
+}
+
+const PackEntry* PackArchive::getEntries() const
+{
+	return entries;
+}
+
+const char* PackArchive::getEntryPath(const PackEntry& entry) const
+{
+	if (entry.pathOffset >= header->stringTableSize) return nullptr;
+	return strings + entry.pathOffset;
+}
+
+const uint8_t* PackArchive::map(const PackEntry& entry) const
+{
+	if (entry.compression != PACK_COMPRESSION_NONE || !sectionInside(entry.dataOffset, entry.size, file.getSize())) return nullptr;
+	return file.getData() + entry.dataOffset;
+}
+
+bool PackArchive::read(const PackEntry& entry, uint64_t offset, uint64_t size, uint8_t* destination) const
+{
+	if (offset > entry.size || size > entry.size - offset) return false;
+	if (size == 0) return true;
+
+	if (entry.compression == PACK_COMPRESSION_NONE) {
+		const uint8_t* data = map(entry);
+		if (!data) return false;
+		memcpy(destination, data + offset, (size_t)size);
+		return true;
+	}
+
+	if (entry.compression != PACK_COMPRESSION_LZ4
+		|| entry.chunkCount != (entry.size + PACK_CHUNK_SIZE - 1) / PACK_CHUNK_SIZE
+		|| entry.firstChunk > header->chunkCount || entry.chunkCount > header->chunkCount - entry.firstChunk) {
+		return false;
+	}
+
+	// only for chunks the range starts or ends in the middle of
+	std::vector<uint8_t> scratch;
+
+	uint64_t end = offset + size;
+	for (uint64_t c = offset / PACK_CHUNK_SIZE; c * PACK_CHUNK_SIZE < end; c++) {
+		const PackChunk& chunk = chunks[entry.firstChunk + c];
+		uint64_t chunkStart = c * PACK_CHUNK_SIZE;
+		uint32_t chunkSize = (uint32_t)std::min<uint64_t>(PACK_CHUNK_SIZE, entry.size - chunkStart);
+		if (!sectionInside(chunk.offset, chunk.compressedSize, file.getSize())) return false;
+
+		const uint8_t* compressed = file.getData() + chunk.offset;
+		uint32_t from = (uint32_t)(std::max(offset, chunkStart) - chunkStart);
+		uint32_t to = (uint32_t)(std::min(end, chunkStart + chunkSize) - chunkStart);
+		uint8_t* out = destination + (chunkStart + from - offset);
+
+		if (chunk.compressedSize == chunkSize) {
+			memcpy(out, compressed + from, to - from);
+		}
+		else if (from == 0 && to == chunkSize) {
+			if (!Lz4::decompress(compressed, chunk.compressedSize, out, chunkSize)) return false;
+		}
+		else {
+			scratch.resize(chunkSize);
+			if (!Lz4::decompress(compressed, chunk.compressedSize, scratch.data(), chunkSize)) return false;
+			memcpy(out, scratch.data() + from, to - from);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+#ifndef PACK_ARCHIVE_H
+#define PACK_ARCHIVE_H
+
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+#include "PackFormat.h"
+
+// runtime side of a pack archive. The file is memory mapped, lookups are a binary search of the
+// hash index and stored entries are used in place. Every method is const and safe to call from
+// any number of threads
+class PackArchive {
+public:
+	// throws if the file is missing, truncated or from another PACK_VERSION
+	PackArchive(const std::string& path);
+
+	// nullptr if the archive doesn't have path, which must be normalised
+	const PackEntry* find(const std::string& path) const;
+
+	const std::string& getPath() const;
+	uint32_t getEntryCount() const;
+	const PackEntry* getEntries() const;
+	const char* getEntryPath(const PackEntry& entry) const;
+
+	// a stored entry's bytes in place, nullptr for compressed entries
+	const uint8_t* map(const PackEntry& entry) const;
+	// size bytes from offset into destination, only the chunks the range touches are decompressed.
+	// false if the range is outside the entry or the archive is corrupt
+	bool read(const PackEntry& entry, uint64_t offset, uint64_t size, uint8_t* destination) const;
+
+private:
+	std::string path;
+	MappedFile file;
+	const PackHeader* header;
+	const PackEntry* entries;
+	const PackChunk* chunks;
+	const char* strings;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "PackBuilder.h"
+#include "Hash.h"
+#include "Lz4.h"
+#include "MappedFile.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+static uint64_t alignData(uint64_t offset)
+{
+	return (offset + PACK_DATA_ALIGNMENT - 1) & ~(uint64_t)(PACK_DATA_ALIGNMENT - 1);
+}
+
+std::vector<PackBuilder::Input> PackBuilder::gatherDirectory(const std::string& directory)
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+	if (!fs::is_directory(directory, error)) {
+		throw std::runtime_error("ERROR: " + directory + " is not a directory!");
+	}
+
+	std::vector<Input> inputs;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(directory)) {
+		if (!entry.is_regular_file()) continue;
+		inputs.push_back({ fs::relative(entry.path(), directory).generic_string(), entry.path().generic_string() });
+	}
+	// directory iteration order is unspecified, keep the archive stable and neighbours together
+	std::sort(inputs.begin(), inputs.end(), [](const Input& a, const Input& b) { return a.path < b.path; });
+	return inputs;
+}
+
+void PackBuilder::build(const std::vector<Input>& inputs, const std::string& output, const Settings& settings)
+{
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("ERROR: Failed to open " + output + " for writing!");
+	}
+
+	static const uint8_t padding[PACK_DATA_ALIGNMENT] = {};
+
+	// rewritten once the index offsets are known
+	PackHeader header{};
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	out.write((const char*)&header, sizeof(header));
+	uint64_t position = sizeof(header);
+
+	std::vector<PackEntry> entries;
+	std::vector<PackChunk> chunks;
+	std::vector<char> strings;
+	std::set<std::string> paths;
+
+	std::vector<uint8_t> compressed(Lz4::compressBound(PACK_CHUNK_SIZE));
+	// one entry's chunks, written only if they saved enough
+	std::vector<uint8_t> blob;
+	std::vector<PackChunk> entryChunks;
+	uint64_t totalSize = 0;
+	uint32_t compressedCount = 0;
+
+	for (const Input& input : inputs) {
+		std::string path = VirtualFileSystem::normalize(input.path);
+		if (!paths.insert(path).second) {
+			throw std::runtime_error("ERROR: " + path + " is packed twice!");
+		}
+
+		MappedFile source(input.source);
+		const uint8_t* data = source.getData();
+		uint64_t size = source.getSize();
+		totalSize += size;
+
+		PackEntry entry{};
+		entry.pathHash = Hash::compute(path.data(), path.size());
+		entry.size = size;
+		entry.pathOffset = (uint32_t)strings.size();
+		strings.insert(strings.end(), path.c_str(), path.c_str() + path.size() + 1);
+
+		blob.clear();
+		entryChunks.clear();
+		if (settings.compress) {
+			for (uint64_t start = 0; start < size; start += PACK_CHUNK_SIZE) {
+				uint32_t chunkSize = (uint32_t)std::min<uint64_t>(PACK_CHUNK_SIZE, size - start);
+				size_t bytes = Lz4::compress(data + start, chunkSize, compressed.data(), compressed.size());
+
+				PackChunk chunk{};
+				chunk.offset = blob.size();
+				// a chunk that doesn't shrink is stored, the reader tells by the size
+				if (bytes >= chunkSize) {
+					blob.insert(blob.end(), data + start, data + start + chunkSize);
+					chunk.compressedSize = chunkSize;
+				}
+				else {
+					blob.insert(blob.end(), compressed.data(), compressed.data() + bytes);
+					chunk.compressedSize = (uint32_t)bytes;
+				}
+				entryChunks.push_back(chunk);
+			}
+		}
+
+		if (!entryChunks.empty() && (double)blob.size() <= (double)size * (1.0 - settings.minSaving)) {
+			entry.compression = PACK_COMPRESSION_LZ4;
+			entry.firstChunk = (uint32_t)chunks.size();
+			entry.chunkCount = (uint32_t)entryChunks.size();
+			for (PackChunk& chunk : entryChunks) {
+				chunk.offset += position;
+				chunks.push_back(chunk);
+			}
+			out.write((const char*)blob.data(), blob.size());
+			position += blob.size();
+			compressedCount++;
+		}
+		else {
+			uint64_t aligned = alignData(position);
+			out.write((const char*)padding, aligned - position);
+			entry.compression = PACK_COMPRESSION_NONE;
+			entry.dataOffset = aligned;
+			if (size > 0) out.write((const char*)data, size);
+			position = aligned + size;
+		}
+		entries.push_back(entry);
+	}
+
+	// the lookup order, ties broken by path so the same inputs always build the same archive
+	std::sort(entries.begin(), entries.end(), [&strings](const PackEntry& a, const PackEntry& b) {
+		if (a.pathHash != b.pathHash) return a.pathHash < b.pathHash;
+		return strcmp(strings.data() + a.pathOffset, strings.data() + b.pathOffset) < 0;
+	});
+
+	header.entryCount = (uint32_t)entries.size();
+	header.chunkCount = (uint32_t)chunks.size();
+	header.entryOffset = alignData(position);
+	header.chunkOffset = alignData(header.entryOffset + entries.size() * sizeof(PackEntry));
+	header.stringOffset = header.chunkOffset + chunks.size() * sizeof(PackChunk);
+	header.stringTableSize = strings.size();
+	header.fileSize = header.stringOffset + strings.size();
+
+	out.write((const char*)padding, header.entryOffset - position);
+	if (!entries.empty()) out.write((const char*)entries.data(), entries.size() * sizeof(PackEntry));
+	uint64_t entriesEnd = header.entryOffset + entries.size() * sizeof(PackEntry);
+	out.write((const char*)padding, header.chunkOffset - entriesEnd);
+	if (!chunks.empty()) out.write((const char*)chunks.data(), chunks.size() * sizeof(PackChunk));
+	if (!strings.empty()) out.write(strings.data(), strings.size());
+
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+	if (!out.good()) {
+		throw std::runtime_error("ERROR: Failed to write " + output + "!");
+	}
+
+	std::cout << "Packed " << entries.size() << " files into " << output << " (" << (totalSize >> 10) << " KB -> "
+		<< (header.fileSize >> 10) << " KB, " << compressedCount << " compressed)\n";
+}
@@ -0,0 +1,33 @@
+#ifndef PACK_BUILDER_H
+#define PACK_BUILDER_H
+
+#include <string>
+#include <vector>
+
+#include "PackFormat.h"
+
+// offline side of pack archives: gathers loose (usually cooked) files into one archive that
+// VirtualFileSystem mounts in their place, one open and one mapping instead of one per file
+namespace PackBuilder {
+	struct Input {
+		// what the file is looked up by, normalised when the archive is built
+		std::string path;
+		// the file on disk
+		std::string source;
+	};
+
+	struct Settings {
+		bool compress = true;
+		// entries that shrink by less than this fraction are stored, so they can be mapped
+		// in place instead of paying for decompression
+		float minSaving = 0.1f;
+	};
+
+	// every file below directory, looked up by its path relative to directory
+	std::vector<Input> gatherDirectory(const std::string& directory);
+
+	// throws on failure or if two inputs normalise to the same path
+	void build(const std::vector<Input>& inputs, const std::string& output, const Settings& settings = Settings());
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PACK_FORMAT_H
+#define PACK_FORMAT_H
+
+#include <cstdint>
+
+// pack archive, written by PackBuilder and mapped straight into memory by PackArchive.
+// Little endian and fixed size like the mesh format. The index sits at the end so the builder
+// can stream the data out, opening an archive only touches the header and the index pages.
+//
+// [PackHeader][entry data ...][PackEntry * n, sorted by pathHash][PackChunk * n][string table]
+//
+// Stored entries are one contiguous blob on PACK_DATA_ALIGNMENT, so they can be used in place
+// (a cooked mesh keeps its section alignment). Compressed entries are split into
+// PACK_CHUNK_SIZE chunks compressed on their own, so any range can be read by decompressing
+// only the chunks it touches.
+
+static const uint32_t PACK_MAGIC = 0x4B415043; // "CPAK"
+// bump whenever any struct below changes, old archives are rejected and rebuilt
+static const uint32_t PACK_VERSION = 1;
+static const uint32_t PACK_DATA_ALIGNMENT = 16;
+static const uint32_t PACK_CHUNK_SIZE = 64 * 1024;
+
+enum PackCompression : uint32_t {
+	PACK_COMPRESSION_NONE = 0,
+	// per chunk LZ4 blocks, see Lz4
+	PACK_COMPRESSION_LZ4 = 1
+};
+
+struct PackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t chunkCount;
+	uint64_t entryOffset;
+	uint64_t chunkOffset;
+	uint64_t stringOffset;
+	uint64_t stringTableSize;
+	uint64_t fileSize;
+};
+
+struct PackEntry {
+	// Hash::compute of the normalised path, see VirtualFileSystem::normalize
+	uint64_t pathHash;
+	// the stored bytes, unused for compressed entries
+	uint64_t dataOffset;
+	// uncompressed size
+	uint64_t size;
+	uint32_t compression;
+	// ceil(size / PACK_CHUNK_SIZE) chunks for compressed entries, 0 otherwise
+	uint32_t firstChunk;
+	uint32_t chunkCount;
+	// null terminated, collisions of pathHash are resolved by comparing it
+	uint32_t pathOffset;
+};
+
+struct PackChunk {
+	uint64_t offset;
+	// equal to the chunk's uncompressed size when it didn't compress and was stored as is
+	uint32_t compressedSize;
+	uint32_t pad;
+};
+
+static_assert(sizeof(PackHeader) == 56, "PackHeader layout changed, bump PACK_VERSION");
+static_assert(sizeof(PackEntry) == 40, "PackEntry layout changed, bump PACK_VERSION");
+static_assert(sizeof(PackChunk) == 16, "PackChunk layout changed, bump PACK_VERSION");
+
+#endif
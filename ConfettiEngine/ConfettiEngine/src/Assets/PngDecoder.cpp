@@ -0,0 +1,236 @@
+#include "ImageDecoder.h"
+#include "Inflate.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+// anything larger is treated as corrupt rather than allocated
+static const uint64_t MAX_PIXELS = 1ull << 28;
+
+// starting column/row and step of the seven Adam7 passes
+static const uint32_t ADAM7[7][4] = {
+	{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+static const uint32_t NOT_INTERLACED[1][4] = { { 0, 0, 1, 1 } };
+
+static uint32_t readBe32(const uint8_t* p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+struct PngInfo {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t depth = 0;
+	uint32_t colorType = 0;
+	uint32_t channels = 0;
+
+	uint8_t palette[256 * 4];
+	// tRNS colour key in the file's bit depth, grey uses the first value
+	bool hasKey = false;
+	uint16_t key[3] = {};
+};
+
+static bool unfilter(uint8_t filter, uint8_t* row, const uint8_t* previous, size_t stride, size_t bpp)
+{
+	switch (filter) {
+	case 0:
+		break;
+	case 1:
+		for (size_t i = bpp; i < stride; i++) row[i] += row[i - bpp];
+		break;
+	case 2:
+		for (size_t i = 0; i < stride; i++) row[i] += previous[i];
+		break;
+	case 3:
+		for (size_t i = 0; i < bpp; i++) row[i] += previous[i] / 2;
+		for (size_t i = bpp; i < stride; i++) row[i] += (uint8_t)((row[i - bpp] + previous[i]) / 2);
+		break;
+	case 4:
+		for (size_t i = 0; i < bpp; i++) row[i] += previous[i];
+		for (size_t i = bpp; i < stride; i++) {
+			int32_t a = row[i - bpp], b = previous[i], c = previous[i - bpp];
+			int32_t p = a + b - c;
+			int32_t pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+			row[i] += (uint8_t)(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+		}
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+// sample i of a row at the file's bit depth, 16 bit samples are big endian
+static uint32_t sample(const uint8_t* row, size_t i, uint32_t depth)
+{
+	if (depth == 8) return row[i];
+	if (depth == 16) return (uint32_t)row[i * 2] << 8 | row[i * 2 + 1];
+
+	size_t bit = i * depth;
+	return (row[bit / 8] >> (8 - depth - bit % 8)) & ((1u << depth) - 1);
+}
+
+// one unfiltered row of count pixels to RGBA8
+static void expandRow(const PngInfo& info, const uint8_t* row, uint32_t count, uint8_t* out)
+{
+	uint32_t depth = info.depth;
+	uint32_t maximum = (1u << depth) - 1;
+	auto to8 = [depth, maximum](uint32_t v) { return (uint8_t)(depth == 16 ? v >> 8 : v * 255 / maximum); };
+
+	if (info.colorType == 6 && depth == 8) {
+		memcpy(out, row, (size_t)count * 4);
+		return;
+	}
+
+	for (uint32_t x = 0; x < count; x++, out += 4) {
+		switch (info.colorType) {
+		case 0: {
+			uint32_t grey = sample(row, x, depth);
+			out[0] = out[1] = out[2] = to8(grey);
+			out[3] = info.hasKey && grey == info.key[0] ? 0 : 255;
+			break;
+		}
+		case 2: {
+			uint32_t r = sample(row, x * 3, depth), g = sample(row, x * 3 + 1, depth), b = sample(row, x * 3 + 2, depth);
+			out[0] = to8(r);
+			out[1] = to8(g);
+			out[2] = to8(b);
+			out[3] = info.hasKey && r == info.key[0] && g == info.key[1] && b == info.key[2] ? 0 : 255;
+			break;
+		}
+		case 3:
+			memcpy(out, &info.palette[sample(row, x, depth) * 4], 4);
+			break;
+		case 4:
+			out[0] = out[1] = out[2] = to8(sample(row, x * 2, depth));
+			out[3] = to8(sample(row, x * 2 + 1, depth));
+			break;
+		default:
+			for (uint32_t c = 0; c < 4; c++) out[c] = to8(sample(row, x * 4 + c, depth));
+			break;
+		}
+	}
+}
+
+Bitmap ImageDecoder::decodePng(const uint8_t* data, size_t size, const std::string& name)
+{
+	PngInfo info;
+	// missing palette entries decode as opaque black
+	memset(info.palette, 0, sizeof(info.palette));
+	for (uint32_t i = 0; i < 256; i++) info.palette[i * 4 + 3] = 255;
+
+	bool interlaced = false;
+	bool headerFound = false;
+	std::vector<uint8_t> compressed;
+
+	for (size_t position = 8; position + 12 <= size; ) {
+		uint32_t length = readBe32(data + position);
+		const uint8_t* type = data + position + 4;
+		const uint8_t* chunk = data + position + 8;
+		if (length > size - position - 12) {
+			throw std::runtime_error("ERROR: " + name + " is truncated or corrupt!");
+		}
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+			info.width = readBe32(chunk);
+			info.height = readBe32(chunk + 4);
+			info.depth = chunk[8];
+			info.colorType = chunk[9];
+			interlaced = chunk[12] == 1;
+			headerFound = chunk[10] == 0 && chunk[11] == 0 && chunk[12] <= 1;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0) {
+			for (uint32_t i = 0; i < length / 3 && i < 256; i++) memcpy(&info.palette[i * 4], chunk + i * 3, 3);
+		}
+		else if (memcmp(type, "tRNS", 4) == 0) {
+			if (info.colorType == 3) {
+				for (uint32_t i = 0; i < length && i < 256; i++) info.palette[i * 4 + 3] = chunk[i];
+			}
+			else if ((info.colorType == 0 && length >= 2) || (info.colorType == 2 && length >= 6)) {
+				info.hasKey = true;
+				for (uint32_t i = 0; i < (info.colorType == 0 ? 1u : 3u); i++) info.key[i] = (uint16_t)(chunk[i * 2] << 8 | chunk[i * 2 + 1]);
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0) {
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0) {
+			break;
+		}
+
+		position += 12 + (size_t)length;
+	}
+
+	static const uint32_t CHANNELS[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	if (headerFound && info.colorType <= 6) info.channels = CHANNELS[info.colorType];
+
+	uint32_t depth = info.depth;
+	bool depthValid = depth == 8 || depth == 16 || ((depth == 1 || depth == 2 || depth == 4) && (info.colorType == 0 || info.colorType == 3));
+	if (info.colorType == 3 && depth == 16) depthValid = false;
+	if (!headerFound || info.channels == 0 || !depthValid || info.width == 0 || info.height == 0
+		|| (uint64_t)info.width * info.height > MAX_PIXELS) {
+		throw std::runtime_error("ERROR: " + name + " is an unsupported or corrupt PNG!");
+	}
+
+	uint32_t bitsPerPixel = info.channels * depth;
+	// the filters work on whole pixels, or bytes below 8 bits per pixel
+	size_t bpp = bitsPerPixel >= 8 ? bitsPerPixel / 8 : 1;
+
+	const uint32_t (*passes)[4] = interlaced ? ADAM7 : NOT_INTERLACED;
+	uint32_t passCount = interlaced ? 7 : 1;
+
+	size_t expected = 0;
+	for (uint32_t p = 0; p < passCount; p++) {
+		uint64_t passWidth = info.width > passes[p][0] ? (info.width - passes[p][0] + passes[p][2] - 1) / passes[p][2] : 0;
+		uint64_t passHeight = info.height > passes[p][1] ? (info.height - passes[p][1] + passes[p][3] - 1) / passes[p][3] : 0;
+		if (passWidth && passHeight) expected += (size_t)(passHeight * (1 + (passWidth * bitsPerPixel + 7) / 8));
+	}
+
+	std::vector<uint8_t> raw;
+	raw.reserve(expected);
+	if (!Inflate::zlib(compressed.data(), compressed.size(), raw, expected) || raw.size() < expected) {
+		throw std::runtime_error("ERROR: " + name + " is truncated or corrupt!");
+	}
+
+	Bitmap bitmap;
+	bitmap.width = info.width;
+	bitmap.height = info.height;
+	bitmap.pixels.resize((size_t)info.width * info.height * 4);
+
+	const uint8_t* in = raw.data();
+	std::vector<uint8_t> previous, current, expanded;
+	for (uint32_t p = 0; p < passCount; p++) {
+		uint32_t startX = passes[p][0], startY = passes[p][1], stepX = passes[p][2], stepY = passes[p][3];
+		uint32_t passWidth = info.width > startX ? (info.width - startX + stepX - 1) / stepX : 0;
+		uint32_t passHeight = info.height > startY ? (info.height - startY + stepY - 1) / stepY : 0;
+		if (passWidth == 0 || passHeight == 0) continue;
+
+		size_t stride = ((size_t)passWidth * bitsPerPixel + 7) / 8;
+		// the row above the first is zeros
+		previous.assign(stride, 0);
+		current.resize(stride);
+		expanded.resize((size_t)passWidth * 4);
+
+		for (uint32_t y = 0; y < passHeight; y++) {
+			uint8_t filter = *in++;
+			memcpy(current.data(), in, stride);
+			in += stride;
+			if (!unfilter(filter, current.data(), previous.data(), stride, bpp)) {
+				throw std::runtime_error("ERROR: " + name + " is truncated or corrupt!");
+			}
+
+			uint8_t* row = bitmap.pixels.data() + ((size_t)(startY + y * stepY) * info.width) * 4;
+			if (stepX == 1) {
+				expandRow(info, current.data(), passWidth, row);
+			}
+			else {
+				expandRow(info, current.data(), passWidth, expanded.data());
+				for (uint32_t x = 0; x < passWidth; x++) memcpy(row + (size_t)(startX + x * stepX) * 4, &expanded[(size_t)x * 4], 4);
+			}
+			previous.swap(current);
+		}
+	}
+
+	return bitmap;
+}
@@ -0,0 +1,255 @@
+#include "SceneAsset.h"
+#include "../Scene/SceneComponents.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+static bool sectionInside(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+	return offset <= fileSize && size <= fileSize - offset && offset % SCENE_SECTION_ALIGNMENT == 0;
+}
+
+SceneAsset::SceneAsset(const VirtualFileSystem& v, const std::string& path)
+	: file(v.open(path)), header(nullptr)
+{
+	validate(path);
+}
+
+SceneAsset::SceneAsset(std::vector<uint8_t> bytes, const std::string& path)
+	: file(std::move(bytes)), header(nullptr)
+{
+	validate(path);
+}
+
+void SceneAsset::validate(const std::string& path)
+{
+	size_t slash = path.find_last_of('/');
+	directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+	if (file.getSize() < sizeof(SceneFileHeader)) {
+		throw std::runtime_error("ERROR: " + path + " is not a cooked scene!");
+	}
+
+	header = (const SceneFileHeader*)file.getData();
+
+	if (header->magic != SCENE_MAGIC) {
+		throw std::runtime_error("ERROR: " + path + " is not a cooked scene!");
+	}
+	if (header->version != SCENE_VERSION) {
+		throw std::runtime_error("ERROR: " + path + " was cooked with another scene version, recook it!");
+	}
+
+	if (header->fileSize != file.getSize()
+		|| !sectionInside(header->archetypeOffset, (uint64_t)header->archetypeCount * sizeof(SceneArchetype), file.getSize())
+		|| !sectionInside(header->componentArrayOffset, (uint64_t)header->componentArrayCount * sizeof(SceneComponentArray), file.getSize())
+		|| !sectionInside(header->meshOffset, (uint64_t)header->meshCount * sizeof(uint32_t), file.getSize())
+		|| !sectionInside(header->stringOffset, header->stringTableSize, file.getSize())
+		|| header->chunkSize == 0) {
+		throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+	}
+
+	// strings are used as C strings, the table has to end in one
+	if (header->stringTableSize != 0 && file.getData()[header->stringOffset + header->stringTableSize - 1] != 0) {
+		throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+	}
+	const uint32_t* meshTable = getMeshTable();
+	for (uint32_t i = 0; i < header->meshCount; i++) {
+		if (meshTable[i] >= header->stringTableSize) {
+			throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+		}
+	}
+
+	// chunks are read row by row through these, so every range is checked once here. The
+	// archetypes have to hand out scene indices back to back, instantiate relies on it
+	const SceneArchetype* archetypes = getArchetypes();
+	const SceneComponentArray* arrays = getComponentArrays();
+	uint32_t nextEntity = 0;
+	for (uint32_t a = 0; a < header->archetypeCount; a++) {
+		const SceneArchetype& archetype = archetypes[a];
+		if (archetype.capacity == 0
+			|| (uint64_t)archetype.capacity * sizeof(Entity) > header->chunkSize
+			|| archetype.chunkCount != (archetype.entityCount + (uint64_t)archetype.capacity - 1) / archetype.capacity
+			|| archetype.firstEntity != nextEntity
+			|| archetype.entityCount > header->entityCount - nextEntity
+			|| (uint64_t)archetype.firstComponent + archetype.componentCount > header->componentArrayCount
+			|| !sectionInside(archetype.chunkOffset, (uint64_t)archetype.chunkCount * header->chunkSize, file.getSize())) {
+			throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+		}
+		nextEntity += archetype.entityCount;
+
+		uint32_t types = 0;
+		for (uint32_t c = 0; c < archetype.componentCount; c++) {
+			const SceneComponentArray& array = arrays[archetype.firstComponent + c];
+			if (array.type >= SCENE_COMPONENT_TYPE_COUNT || (types & (1u << array.type)) != 0
+				|| (uint64_t)array.offset + (uint64_t)array.size * archetype.capacity > header->chunkSize) {
+				throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+			}
+			if (array.size != Components::info(SceneComponents::id((SceneComponentType)array.type)).size) {
+				throw std::runtime_error("ERROR: " + path + " was cooked with other components, recook it!");
+			}
+			types |= 1u << array.type;
+		}
+	}
+	if (nextEntity != header->entityCount) {
+		throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+	}
+}
+
+const SceneFileHeader& SceneAsset::getHeader() const
+{
+	return *header;
+}
+
+uint32_t SceneAsset::getMeshCount() const
+{
+	return header->meshCount;
+}
+
+std::string SceneAsset::getMeshPath(uint32_t i) const
+{
+	if (i >= header->meshCount) {
+		throw std::runtime_error("ERROR: Scene mesh index out of range!");
+	}
+	return directory + (const char*)(file.getData() + header->stringOffset + getMeshTable()[i]);
+}
+
+const SceneArchetype* SceneAsset::getArchetypes() const
+{
+	return (const SceneArchetype*)(file.getData() + header->archetypeOffset);
+}
+
+const SceneComponentArray* SceneAsset::getComponentArrays() const
+{
+	return (const SceneComponentArray*)(file.getData() + header->componentArrayOffset);
+}
+
+const uint32_t* SceneAsset::getMeshTable() const
+{
+	return (const uint32_t*)(file.getData() + header->meshOffset);
+}
+
+void SceneAsset::instantiate(World& world, const std::vector<uint32_t>& meshes, std::vector<Entity>& entities) const
+{
+	SceneInstantiation progress;
+	begin(progress, meshes);
+	step(world, progress, 0xFFFFFFFF);
+	entities = std::move(progress.entities);
+}
+
+void SceneAsset::begin(SceneInstantiation& progress, const std::vector<uint32_t>& meshes) const
+{
+	if (meshes.size() != header->meshCount) {
+		throw std::runtime_error("ERROR: Scene needs one mesh id per mesh table entry!");
+	}
+
+	progress = SceneInstantiation();
+	progress.entities.assign(header->entityCount, INVALID_ENTITY);
+	progress.meshes = meshes;
+}
+
+uint32_t SceneAsset::step(World& world, SceneInstantiation& progress, uint32_t maxRows) const
+{
+	const SceneArchetype* archetypes = getArchetypes();
+	uint32_t budget = maxRows;
+
+	while (budget > 0 && progress.archetype < header->archetypeCount) {
+		const SceneArchetype& cooked = archetypes[progress.archetype];
+		if (progress.row == cooked.entityCount) {
+			progress.archetype++;
+			progress.row = 0;
+			continue;
+		}
+
+		// never past the cooked chunk, slices that line up with the runtime chunks stay one memcpy
+		uint32_t count = std::min({ cooked.entityCount - progress.row, cooked.capacity - progress.row % cooked.capacity, budget });
+		createRows(world, progress, progress.archetype, progress.row, count);
+		progress.row += count;
+		budget -= count;
+	}
+
+	// every row exists now, point the Parents that came before their parent's row at it
+	while (budget > 0 && progress.fixup < progress.forwardParents.size()) {
+		const std::pair<Entity, uint32_t>& reference = progress.forwardParents[progress.fixup++];
+		Parent* parent = world.get<Parent>(reference.first);
+		if (parent != nullptr) parent->entity = progress.entities[reference.second];
+		budget--;
+	}
+
+	progress.done = progress.archetype == header->archetypeCount && progress.fixup == progress.forwardParents.size();
+	return maxRows - budget;
+}
+
+void SceneAsset::createRows(World& world, SceneInstantiation& progress, uint32_t archetypeIndex, uint32_t start, uint32_t count) const
+{
+	struct Run {
+		Archetype* archetype;
+		Chunk* chunk;
+		uint32_t row;
+		uint32_t rows;
+	};
+	std::vector<Run> runs;
+
+	const SceneArchetype& cooked = getArchetypes()[archetypeIndex];
+	const SceneComponentArray* components = getComponentArrays() + cooked.firstComponent;
+
+	ComponentId ids[SCENE_COMPONENT_TYPE_COUNT];
+	ComponentMask mask = 0;
+	for (uint32_t c = 0; c < cooked.componentCount; c++) {
+		ids[c] = SceneComponents::id((SceneComponentType)components[c].type);
+		mask |= ComponentMask(1) << ids[c];
+	}
+
+	// inside one cooked chunk, see step
+	uint32_t cookedRow = start % cooked.capacity;
+	const uint8_t* source = file.getData() + cooked.chunkOffset + (uint64_t)(start / cooked.capacity) * header->chunkSize;
+
+	world.createBatch(mask, count, progress.entities.data() + cooked.firstEntity + start,
+		[&](Archetype* archetype, Chunk* chunk, uint32_t row, uint32_t first, uint32_t rows) {
+			runs.push_back({ archetype, chunk, row, rows });
+
+			// same build, same layout: the cooked chunk is the runtime chunk. Both have to start
+			// at row 0, the entity array is overwritten by createBatch afterwards
+			bool sameLayout = header->chunkSize == Chunk::SIZE && archetype->getCapacity() == cooked.capacity
+				&& row == 0 && cookedRow + first == 0;
+			for (uint32_t c = 0; c < cooked.componentCount && sameLayout; c++) {
+				sameLayout = archetype->getArrayOffset(ids[c]) == components[c].offset;
+			}
+			if (sameLayout) {
+				memcpy(chunk->data, source, Chunk::SIZE);
+				return;
+			}
+
+			// otherwise one copy per component array
+			for (uint32_t c = 0; c < cooked.componentCount; c++) {
+				uint32_t size = components[c].size;
+				uint8_t* target = (uint8_t*)archetype->getArray(chunk, ids[c]) + (size_t)row * size;
+				memcpy(target, source + components[c].offset + (size_t)(cookedRow + first) * size, (size_t)rows * size);
+			}
+		});
+
+	// scene indices into handles and mesh table entries into ids
+	ComponentId parentId = SceneComponents::id(SCENE_COMPONENT_PARENT);
+	ComponentId instanceId = SceneComponents::id(SCENE_COMPONENT_MESH_INSTANCE);
+	for (const Run& run : runs) {
+		Parent* parents = (Parent*)run.archetype->getArray(run.chunk, parentId);
+		if (parents != nullptr) {
+			const Entity* handles = run.archetype->getEntities(run.chunk);
+			for (uint32_t i = run.row; i < run.row + run.rows; i++) {
+				uint32_t index = parents[i].entity.index;
+				parents[i].entity = index < progress.entities.size() ? progress.entities[index] : INVALID_ENTITY;
+				if (index < progress.entities.size() && parents[i].entity == INVALID_ENTITY) {
+					progress.forwardParents.emplace_back(handles[i], index);
+				}
+			}
+		}
+
+		MeshInstance* instances = (MeshInstance*)run.archetype->getArray(run.chunk, instanceId);
+		if (instances != nullptr) {
+			for (uint32_t i = run.row; i < run.row + run.rows; i++) {
+				uint32_t mesh = instances[i].mesh;
+				instances[i].mesh = mesh < progress.meshes.size() ? progress.meshes[mesh] : 0xFFFFFFFF;
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef SCENE_ASSET_H
+#define SCENE_ASSET_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SceneFormat.h"
+#include "VirtualFileSystem.h"
+#include "../Ecs/World.h"
+
+// progress of an instantiation spread over several SceneAsset::step calls, entities is the result
+struct SceneInstantiation {
+	// scene index order
+	std::vector<Entity> entities;
+	std::vector<uint32_t> meshes;
+	// next rows to create
+	uint32_t archetype = 0;
+	uint32_t row = 0;
+	// entity and scene index of Parents pointing at rows that weren't created yet
+	std::vector<std::pair<Entity, uint32_t>> forwardParents;
+	uint32_t fixup = 0;
+	bool done = false;
+};
+
+// runtime side of a cooked scene. The file stays mapped through the VirtualFileSystem and is
+// validated once here, instantiate then only copies chunks into the World and patches the
+// references, the same file can be instantiated any number of times
+class SceneAsset {
+public:
+	// throws if the file is missing, truncated, from another SCENE_VERSION or holds components
+	// that don't match the runtime ones
+	SceneAsset(const VirtualFileSystem& v, const std::string& path);
+	// the same for bytes read some other way, e.g. by the AssetStreamer. path only names the
+	// file in errors and is what mesh paths are resolved against
+	SceneAsset(std::vector<uint8_t> bytes, const std::string& path);
+
+	const SceneFileHeader& getHeader() const;
+	uint32_t getMeshCount() const;
+	// path of mesh table entry i, resolved against the scene's directory
+	std::string getMeshPath(uint32_t i) const;
+
+	// creates the scene's entities in world. meshes maps the mesh table to the ids MeshInstance
+	// should hold, one per getMeshCount(). entities receives the handles in scene index order
+	void instantiate(World& world, const std::vector<uint32_t>& meshes, std::vector<Entity>& entities) const;
+
+	// instantiate a few rows at a time, for loading next to a running frame. Rows created so far
+	// are complete entities, only a Parent whose row doesn't exist yet reads INVALID_ENTITY
+	void begin(SceneInstantiation& progress, const std::vector<uint32_t>& meshes) const;
+	// creates up to maxRows more entities or resolves as many of those Parents and returns how
+	// many it did, progress.done is set once the scene is complete
+	uint32_t step(World& world, SceneInstantiation& progress, uint32_t maxRows) const;
+
+private:
+	VfsFile file;
+	std::string directory;
+	const SceneFileHeader* header;
+
+	void validate(const std::string& path);
+	// rows [start, start + count) of archetype, all inside one cooked chunk
+	void createRows(World& world, SceneInstantiation& progress, uint32_t archetype, uint32_t start, uint32_t count) const;
+
+	const SceneArchetype* getArchetypes() const;
+	const SceneComponentArray* getComponentArrays() const;
+	const uint32_t* getMeshTable() const;
+};
+
+#endif
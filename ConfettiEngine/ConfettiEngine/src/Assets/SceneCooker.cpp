@@ -0,0 +1,234 @@
+#include "SceneCooker.h"
+#include "Hash.h"
+#include "../Ecs/Archetype.h"
+#include "../Scene/SceneComponents.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+MeshCooker::Settings SceneCooker::meshSettings(const MeshCooker::Settings& settings)
+{
+	MeshCooker::Settings result = settings;
+	result.bakeTransforms = false;
+	return result;
+}
+
+uint64_t SceneCooker::hashSettings(const MeshCooker::Settings& settings)
+{
+	uint32_t values[2] = { COOKER_VERSION, SCENE_VERSION };
+	return Hash::combine(Hash::compute(values, sizeof(values)), MeshCooker::hashSettings(meshSettings(settings)));
+}
+
+static uint64_t alignSection(uint64_t offset)
+{
+	return (offset + SCENE_SECTION_ALIGNMENT - 1) & ~(uint64_t)(SCENE_SECTION_ALIGNMENT - 1);
+}
+
+// one row of the scene before it is sorted into archetypes
+struct CookEntity {
+	ComponentMask mask;
+	// index into the cook's entities
+	uint32_t parent;
+	LocalTransform local;
+	MeshInstance instance;
+	uint32_t sceneIndex;
+};
+
+static SceneComponentType sceneType(ComponentId id)
+{
+	for (uint32_t type = 0; type < SCENE_COMPONENT_TYPE_COUNT; type++) {
+		if (SceneComponents::id((SceneComponentType)type) == id) return (SceneComponentType)type;
+	}
+	throw std::runtime_error("ERROR: Component isn't part of the scene format!");
+}
+
+void SceneCooker::write(const MeshCooker::CookedMesh& mesh, const std::string& output)
+{
+	if (mesh.nodes.empty()) {
+		throw std::runtime_error("ERROR: Scenes need meshes imported without baked transforms!");
+	}
+
+	// the scene's one mesh, referenced relative to the scene
+	std::filesystem::path outputPath(output);
+	std::string meshName = outputPath.stem().string() + ".mesh";
+	MeshCooker::write(mesh, (outputPath.parent_path() / meshName).string());
+
+	writeNodes(mesh.nodes, meshName, output);
+}
+
+SceneFileHeader SceneCooker::writeNodes(const std::vector<MeshCooker::CookedNode>& nodes, const std::string& meshName, const std::string& output)
+{
+	if (nodes.empty()) {
+		throw std::runtime_error("ERROR: Scenes need at least one node!");
+	}
+
+	ComponentId transformId = SceneComponents::id(SCENE_COMPONENT_LOCAL_TRANSFORM);
+	ComponentId parentId = SceneComponents::id(SCENE_COMPONENT_PARENT);
+	ComponentId instanceId = SceneComponents::id(SCENE_COMPONENT_MESH_INSTANCE);
+	ComponentMask transformBit = ComponentMask(1) << transformId;
+	ComponentMask parentBit = ComponentMask(1) << parentId;
+	ComponentMask instanceBit = ComponentMask(1) << instanceId;
+
+	std::vector<CookEntity> entities;
+	std::vector<uint32_t> entityOfNode(nodes.size());
+	for (size_t n = 0; n < nodes.size(); n++) {
+		const MeshCooker::CookedNode& node = nodes[n];
+
+		CookEntity entity{};
+		entity.mask = transformBit;
+		entity.parent = MeshCooker::NO_PARENT;
+		if (node.parent != MeshCooker::NO_PARENT) {
+			entity.mask |= parentBit;
+			entity.parent = entityOfNode[node.parent];
+		}
+		entity.local.position = glm::vec3(node.position[0], node.position[1], node.position[2]);
+		entity.local.rotation = glm::quat(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
+		entity.local.scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+		if (node.submeshes.size() == 1) {
+			entity.mask |= instanceBit;
+			entity.instance = { 0, node.submeshes[0] };
+		}
+
+		entityOfNode[n] = (uint32_t)entities.size();
+		entities.push_back(entity);
+
+		if (node.submeshes.size() < 2) continue;
+		for (uint32_t submesh : node.submeshes) {
+			CookEntity child{};
+			child.mask = transformBit | parentBit | instanceBit;
+			child.parent = entityOfNode[n];
+			child.local = { glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) };
+			child.instance = { 0, submesh };
+			entities.push_back(child);
+		}
+	}
+
+	// archetypes in order of first use, rows in hierarchy order so parents come first
+	std::vector<ComponentMask> masks;
+	std::vector<std::vector<uint32_t>> rows;
+	for (uint32_t e = 0; e < entities.size(); e++) {
+		size_t group = std::find(masks.begin(), masks.end(), entities[e].mask) - masks.begin();
+		if (group == masks.size()) {
+			masks.push_back(entities[e].mask);
+			rows.emplace_back();
+		}
+		rows[group].push_back(e);
+	}
+
+	uint32_t sceneIndex = 0;
+	for (const std::vector<uint32_t>& group : rows) {
+		for (uint32_t e : group) entities[e].sceneIndex = sceneIndex++;
+	}
+
+	std::vector<SceneArchetype> archetypes;
+	std::vector<SceneComponentArray> arrays;
+	uint64_t chunkBytes = 0;
+	for (size_t a = 0; a < masks.size(); a++) {
+		Archetype layout(masks[a]);
+
+		SceneArchetype archetype{};
+		archetype.firstComponent = (uint32_t)arrays.size();
+		archetype.componentCount = (uint32_t)layout.getComponents().size();
+		archetype.capacity = layout.getCapacity();
+		archetype.entityCount = (uint32_t)rows[a].size();
+		archetype.firstEntity = entities[rows[a][0]].sceneIndex;
+		archetype.chunkCount = (archetype.entityCount + archetype.capacity - 1) / archetype.capacity;
+		// relative to the chunk section until it is placed
+		archetype.chunkOffset = chunkBytes;
+		archetypes.push_back(archetype);
+		chunkBytes += (uint64_t)archetype.chunkCount * Chunk::SIZE;
+
+		for (ComponentId id : layout.getComponents()) {
+			arrays.push_back({ (uint32_t)sceneType(id), Components::info(id).size, layout.getArrayOffset(id), 0 });
+		}
+	}
+
+	std::vector<char> strings(meshName.c_str(), meshName.c_str() + meshName.size() + 1);
+	uint32_t meshPath = 0;
+
+	SceneFileHeader header{};
+	header.magic = SCENE_MAGIC;
+	header.version = SCENE_VERSION;
+	header.chunkSize = Chunk::SIZE;
+	header.entityCount = (uint32_t)entities.size();
+	header.archetypeCount = (uint32_t)archetypes.size();
+	header.componentArrayCount = (uint32_t)arrays.size();
+	header.meshCount = 1;
+	header.stringTableSize = (uint32_t)strings.size();
+	header.archetypeOffset = alignSection(sizeof(SceneFileHeader));
+	header.componentArrayOffset = alignSection(header.archetypeOffset + archetypes.size() * sizeof(SceneArchetype));
+	header.meshOffset = alignSection(header.componentArrayOffset + arrays.size() * sizeof(SceneComponentArray));
+	header.chunkOffset = alignSection(header.meshOffset + header.meshCount * sizeof(uint32_t));
+	header.stringOffset = alignSection(header.chunkOffset + chunkBytes);
+	header.fileSize = header.stringOffset + strings.size();
+
+	for (SceneArchetype& archetype : archetypes) {
+		archetype.chunkOffset += header.chunkOffset;
+	}
+
+	// assemble the whole file in memory and write it in one go
+	std::vector<uint8_t> file(header.fileSize, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + header.archetypeOffset, archetypes.data(), archetypes.size() * sizeof(SceneArchetype));
+	memcpy(file.data() + header.componentArrayOffset, arrays.data(), arrays.size() * sizeof(SceneComponentArray));
+	memcpy(file.data() + header.meshOffset, &meshPath, sizeof(meshPath));
+	memcpy(file.data() + header.stringOffset, strings.data(), strings.size());
+
+	// the rows go where Archetype would put them, references as scene indices
+	for (size_t a = 0; a < archetypes.size(); a++) {
+		const SceneArchetype& archetype = archetypes[a];
+		const SceneComponentArray* components = &arrays[archetype.firstComponent];
+
+		for (uint32_t r = 0; r < archetype.entityCount; r++) {
+			const CookEntity& entity = entities[rows[a][r]];
+			uint8_t* chunk = file.data() + archetype.chunkOffset + (uint64_t)(r / archetype.capacity) * Chunk::SIZE;
+			uint32_t row = r % archetype.capacity;
+
+			Entity handle = { entity.sceneIndex, 0 };
+			memcpy(chunk + row * sizeof(Entity), &handle, sizeof(Entity));
+
+			for (uint32_t c = 0; c < archetype.componentCount; c++) {
+				uint8_t* target = chunk + components[c].offset + (size_t)row * components[c].size;
+				switch (components[c].type) {
+				case SCENE_COMPONENT_LOCAL_TRANSFORM:
+					memcpy(target, &entity.local, sizeof(LocalTransform));
+					break;
+				case SCENE_COMPONENT_PARENT: {
+					Parent parent = { { entities[entity.parent].sceneIndex, 0 } };
+					memcpy(target, &parent, sizeof(Parent));
+					break;
+				}
+				case SCENE_COMPONENT_MESH_INSTANCE:
+					memcpy(target, &entity.instance, sizeof(MeshInstance));
+					break;
+				}
+			}
+		}
+	}
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("ERROR: Failed to open " + output + " for writing!");
+	}
+	out.write((const char*)file.data(), file.size());
+	if (!out.good()) {
+		throw std::runtime_error("ERROR: Failed to write " + output + "!");
+	}
+	return header;
+}
+
+void SceneCooker::cook(const std::string& source, const std::string& output, const MeshCooker::Settings& settings)
+{
+	MeshCooker::CookedMesh mesh = MeshCooker::import(source, meshSettings(settings));
+	SceneCooker::write(mesh, output);
+
+	uint32_t instances = 0;
+	for (const MeshCooker::CookedNode& node : mesh.nodes) instances += (uint32_t)node.submeshes.size();
+
+	std::cout << "Cooked " << source << " -> " << output << " (" << mesh.nodes.size() << " nodes, "
+		<< instances << " mesh instances, " << mesh.submeshes.size() << " submeshes)\n";
+}
@@ -0,0 +1,36 @@
+#ifndef SCENE_COOKER_H
+#define SCENE_COOKER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MeshCooker.h"
+#include "SceneFormat.h"
+
+// offline conversion of an assimp scene into a cooked scene plus the mesh it places.
+// Transforms aren't baked: every node becomes an entity with a LocalTransform and a Parent
+// below the root, nodes drawing one mesh get a MeshInstance, nodes drawing several get a child
+// entity per mesh. Every source mesh is cooked once however often it is placed, into
+// <output stem>.mesh next to the scene.
+// Chunks are built with the runtime Archetype, so a scene cooked by the same build loads with
+// a memcpy per chunk
+namespace SceneCooker {
+	// bump whenever the code changes what ends up in the file
+	const uint32_t COOKER_VERSION = 1;
+
+	// settings are the mesh cook's, transforms are never baked
+	MeshCooker::Settings meshSettings(const MeshCooker::Settings& settings);
+	uint64_t hashSettings(const MeshCooker::Settings& settings);
+
+	// mesh must come from MeshCooker::import with meshSettings
+	void write(const MeshCooker::CookedMesh& mesh, const std::string& output);
+	// just the scene, for nodes placing the submeshes of an already written mesh. meshName is
+	// relative to output's directory. Returns the header that was written
+	SceneFileHeader writeNodes(const std::vector<MeshCooker::CookedNode>& nodes, const std::string& meshName, const std::string& output);
+
+	// import + write, throws on failure
+	void cook(const std::string& source, const std::string& output, const MeshCooker::Settings& settings = MeshCooker::Settings());
+};
+
+#endif
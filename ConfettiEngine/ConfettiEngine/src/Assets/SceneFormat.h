@@ -0,0 +1,79 @@
+#ifndef SCENE_FORMAT_H
+#define SCENE_FORMAT_H
+
+#include <cstdint>
+
+// cooked scene, written by SceneCooker and instantiated by SceneAsset.
+// Entities are stored the way the ECS holds them: per archetype, in chunks with the SoA layout
+// Archetype gives them, so loading is mapping the file, one memcpy per chunk (per component
+// array when the runtime layout differs) and a fixup pass. Nothing in the file is a pointer:
+// entity references are scene indices (archetype by archetype, row by row), mesh references
+// index the mesh table, strings are string table offsets and sections are byte offsets from
+// the start of the file. Everything is little endian.
+//
+// [SceneFileHeader][SceneArchetype * n][SceneComponentArray * n][mesh table][chunks][string table]
+
+static const uint32_t SCENE_MAGIC = 0x4E534643; // "CFSN"
+// bump whenever any struct below or in Scene/SceneComponents.h changes
+static const uint32_t SCENE_VERSION = 1;
+// chunks are copied as they are, keep them on cache lines
+static const uint32_t SCENE_SECTION_ALIGNMENT = 64;
+
+// the components a scene can hold, see Scene/SceneComponents.h. Files name them by these rather
+// than by ComponentId, which follows registration order and differs between runs
+enum SceneComponentType : uint32_t {
+	SCENE_COMPONENT_LOCAL_TRANSFORM = 0,
+	SCENE_COMPONENT_PARENT = 1,
+	SCENE_COMPONENT_MESH_INSTANCE = 2,
+	SCENE_COMPONENT_TYPE_COUNT
+};
+
+struct SceneComponentArray {
+	uint32_t type;
+	// element size, must match the runtime component
+	uint32_t size;
+	// byte offset of the array inside each chunk
+	uint32_t offset;
+	uint32_t pad;
+};
+
+struct SceneArchetype {
+	// range in the component array table
+	uint32_t firstComponent;
+	uint32_t componentCount;
+	// rows per chunk, every chunk but the last is full
+	uint32_t capacity;
+	uint32_t entityCount;
+	// scene index of the first entity, the rest follow in row order
+	uint32_t firstEntity;
+	uint32_t chunkCount;
+	// byte offset of the first chunk, the others follow every chunkSize bytes. The entity
+	// arrays hold the rows' scene indices, generation 0
+	uint64_t chunkOffset;
+};
+
+struct SceneFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	// Chunk::SIZE of the cook
+	uint32_t chunkSize;
+	uint32_t entityCount;
+	uint32_t archetypeCount;
+	uint32_t componentArrayCount;
+	// uint32_t each, string table offsets of mesh paths relative to the scene file
+	uint32_t meshCount;
+	uint32_t stringTableSize;
+	uint64_t archetypeOffset;
+	uint64_t componentArrayOffset;
+	uint64_t meshOffset;
+	uint64_t chunkOffset;
+	uint64_t stringOffset;
+	// total file size, catches truncated files
+	uint64_t fileSize;
+};
+
+static_assert(sizeof(SceneComponentArray) == 16, "SceneComponentArray layout changed, bump SCENE_VERSION");
+static_assert(sizeof(SceneArchetype) == 32, "SceneArchetype layout changed, bump SCENE_VERSION");
+static_assert(sizeof(SceneFileHeader) == 80, "SceneFileHeader layout changed, bump SCENE_VERSION");
+
+#endif
@@ -0,0 +1,214 @@
+#include "Texture.h"
+#include "../Buffers/Buffer.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+static const VkPipelineStageFlags SHADER_STAGES = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+static VkImageMemoryBarrier levelBarrier(VkImage image, uint32_t baseLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1 };
+	return barrier;
+}
+
+Texture::Texture(VkPhysicalDevice physicalDevice, VkDevice device, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, bool blitMips, bool copySource)
+	: device(device), format(format), width(width), height(height), mipLevels(mipLevels), blitMips(blitMips)
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { width, height, 1 };
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (blitMips || copySource ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create texture image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	memorySize = memRequirements.size;
+
+	// the destructor doesn't run for a constructor that throws
+	try {
+		allocInfo.memoryTypeIndex = Buffer::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+			throw std::runtime_error("ERROR: Failed to allocate texture memory!");
+		}
+		vkBindImageMemory(device, image, memory, 0);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+
+		if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+			throw std::runtime_error("ERROR: Failed to create texture view!");
+		}
+	}
+	catch (...) {
+		vkDestroyImage(device, image, nullptr);
+		if (memory != VK_NULL_HANDLE) vkFreeMemory(device, memory, nullptr);
+		throw;
+	}
+}
+
+Texture::~Texture()
+{
+	vkDestroyImageView(device, view, nullptr);
+	vkDestroyImage(device, image, nullptr);
+	vkFreeMemory(device, memory, nullptr);
+}
+
+void Texture::recordPrepareUpload(VkCommandBuffer cmd)
+{
+	// nothing was written before, no access to wait for
+	VkImageMemoryBarrier toTransfer = levelBarrier(image, 0, mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		0, VK_ACCESS_TRANSFER_WRITE_BIT);
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &toTransfer);
+}
+
+void Texture::recordFinishUpload(VkCommandBuffer cmd)
+{
+	if (!blitMips) {
+		VkImageMemoryBarrier toRead = levelBarrier(image, 0, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES, 0,
+			0, nullptr, 0, nullptr, 1, &toRead);
+		return;
+	}
+
+	// each level is filtered from the one above it, which is then done and handed to the shaders
+	int32_t levelWidth = (int32_t)width;
+	int32_t levelHeight = (int32_t)height;
+	for (uint32_t level = 1; level < mipLevels; level++) {
+		VkImageMemoryBarrier toSource = levelBarrier(image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &toSource);
+
+		int32_t nextWidth = std::max(levelWidth / 2, 1);
+		int32_t nextHeight = std::max(levelHeight / 2, 1);
+
+		VkImageBlit blit{};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+		blit.srcOffsets[1] = { levelWidth, levelHeight, 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+		vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		VkImageMemoryBarrier toRead = levelBarrier(image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT);
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES, 0,
+			0, nullptr, 0, nullptr, 1, &toRead);
+
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	// the smallest level was only ever written
+	VkImageMemoryBarrier lastToRead = levelBarrier(image, mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES, 0,
+		0, nullptr, 0, nullptr, 1, &lastToRead);
+}
+
+void Texture::recordCopyLevels(VkCommandBuffer cmd, const Texture& source, uint32_t sourceLevel, uint32_t level, uint32_t count)
+{
+	// the source may still be sampled by earlier work in the queue
+	VkImageMemoryBarrier toSource = levelBarrier(source.image, sourceLevel, count, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	vkCmdPipelineBarrier(cmd, SHADER_STAGES, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &toSource);
+
+	std::vector<VkImageCopy> regions(count);
+	for (uint32_t i = 0; i < count; i++) {
+		VkImageCopy& region = regions[i];
+		region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, sourceLevel + i, 0, 1 };
+		region.srcOffset = { 0, 0, 0 };
+		region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level + i, 0, 1 };
+		region.dstOffset = { 0, 0, 0 };
+		region.extent = { std::max(width >> (level + i), 1u), std::max(height >> (level + i), 1u), 1 };
+	}
+	vkCmdCopyImage(cmd, source.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, count, regions.data());
+
+	VkImageMemoryBarrier toRead = levelBarrier(source.image, sourceLevel, count, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT);
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES, 0,
+		0, nullptr, 0, nullptr, 1, &toRead);
+}
+
+VkImage Texture::getImage() const
+{
+	return image;
+}
+
+VkImageView Texture::getView() const
+{
+	return view;
+}
+
+VkFormat Texture::getFormat() const
+{
+	return format;
+}
+
+uint32_t Texture::getWidth() const
+{
+	return width;
+}
+
+uint32_t Texture::getHeight() const
+{
+	return height;
+}
+
+uint32_t Texture::getMipLevels() const
+{
+	return mipLevels;
+}
+
+VkDeviceSize Texture::getMemorySize() const
+{
+	return memorySize;
+}
+
+bool Texture::supportsBlitMips(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+	VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (properties.optimalTilingFeatures & needed) == needed;
+}
+
+bool Texture::supportsSampling(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+	return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
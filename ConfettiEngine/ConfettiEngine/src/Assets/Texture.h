@@ -0,0 +1,62 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <cstdint>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// sampled 2D image with its own memory and a view over every level. Device local and optimally
+// tiled, so its contents only ever arrive through copies (AssetStreamer's staging ring).
+// Can be created on any thread, the record calls belong to whoever owns the command buffer
+class Texture {
+public:
+	// blitMips creates the image as a blit source too, only level 0 is uploaded and the rest is
+	// filtered from it by recordFinishUpload. Check supportsBlitMips for the format first.
+	// copySource lets a replacement texture copy levels out of this one, see recordCopyLevels
+	Texture(VkPhysicalDevice physicalDevice, VkDevice device, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, bool blitMips, bool copySource = false);
+	~Texture();
+
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	// every level from undefined to transfer dst, before the first copy
+	void recordPrepareUpload(VkCommandBuffer cmd);
+	// after the last copy. Generates the mips if the texture blits them and leaves every level
+	// shader read only, visible to the fragment and compute stages
+	void recordFinishUpload(VkCommandBuffer cmd);
+	// count levels of source from sourceLevel on into this texture's levels from level on, between
+	// recordPrepareUpload and recordFinishUpload. Source has to be a copySource texture in shader
+	// read only layout and is left that way, so it can stay bound while its levels move over
+	void recordCopyLevels(VkCommandBuffer cmd, const Texture& source, uint32_t sourceLevel, uint32_t level, uint32_t count);
+
+	VkImage getImage() const;
+	VkImageView getView() const;
+	VkFormat getFormat() const;
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	uint32_t getMipLevels() const;
+	// device memory the image occupies
+	VkDeviceSize getMemorySize() const;
+
+	// optimally tiled format can be both ends of a linear filtered blit. sRGB formats are
+	// filtered after conversion to linear, so blitted mips are gamma correct as well
+	static bool supportsBlitMips(VkPhysicalDevice physicalDevice, VkFormat format);
+	// optimally tiled format can be sampled, block compressed ones need their device feature
+	static bool supportsSampling(VkPhysicalDevice physicalDevice, VkFormat format);
+
+private:
+	VkDevice device;
+
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	bool blitMips;
+
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize memorySize = 0;
+	VkImageView view = VK_NULL_HANDLE;
+};
+
+#endif
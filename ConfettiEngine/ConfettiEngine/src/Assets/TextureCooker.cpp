@@ -0,0 +1,259 @@
+#include "TextureCooker.h"
+#include "Hash.h"
+#include "KtxFormat.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "../Jobs/JobSystem.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// data format descriptor values from the Khronos data format spec, only what the formats above need
+static const uint32_t DFD_VERSION = 2;
+static const uint32_t DFD_MODEL_BC1A = 128;
+static const uint32_t DFD_MODEL_BC3 = 130;
+static const uint32_t DFD_MODEL_BC4 = 131;
+static const uint32_t DFD_MODEL_BC5 = 132;
+static const uint32_t DFD_MODEL_BC7 = 134;
+static const uint32_t DFD_PRIMARIES_BT709 = 1;
+static const uint32_t DFD_TRANSFER_LINEAR = 1;
+static const uint32_t DFD_TRANSFER_SRGB = 2;
+static const uint32_t DFD_CHANNEL_ALPHA = 15;
+static const uint32_t DFD_QUALIFIER_LINEAR = 0x10;
+
+struct DfdSample {
+	uint32_t channel;
+	uint32_t bitOffset;
+	uint32_t bitLength;
+};
+
+uint64_t TextureCooker::hashSettings(const Settings& settings)
+{
+	uint32_t values[4] = { COOKER_VERSION, (uint32_t)settings.usage, settings.compact, settings.generateMips };
+	return Hash::compute(values, sizeof(values));
+}
+
+TextureUsage TextureCooker::usageFromName(const std::string& path)
+{
+	std::string stem = std::filesystem::path(path).stem().string();
+	std::transform(stem.begin(), stem.end(), stem.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+
+	auto endsWith = [&stem](const char* suffix) {
+		size_t length = strlen(suffix);
+		return stem.size() >= length && stem.compare(stem.size() - length, length, suffix) == 0;
+	};
+	if (endsWith("_n") || endsWith("_normal")) return TEXTURE_USAGE_NORMAL;
+	if (endsWith("_mask") || endsWith("_rough") || endsWith("_roughness") || endsWith("_ao") || endsWith("_metal") || endsWith("_metallic")) {
+		return TEXTURE_USAGE_MASK;
+	}
+	return TEXTURE_USAGE_COLOR;
+}
+
+BlockFormat TextureCooker::blockFormat(const Settings& settings, bool opaque)
+{
+	switch (settings.usage) {
+	case TEXTURE_USAGE_NORMAL:
+		return BLOCK_FORMAT_BC5;
+	case TEXTURE_USAGE_MASK:
+		return BLOCK_FORMAT_BC4;
+	default:
+		if (!settings.compact) return BLOCK_FORMAT_BC7;
+		return opaque ? BLOCK_FORMAT_BC1 : BLOCK_FORMAT_BC3;
+	}
+}
+
+static VkFormat vulkanFormat(BlockFormat format, bool srgb)
+{
+	switch (format) {
+	case BLOCK_FORMAT_BC1:
+		return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case BLOCK_FORMAT_BC3:
+		return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case BLOCK_FORMAT_BC4:
+		return VK_FORMAT_BC4_UNORM_BLOCK;
+	case BLOCK_FORMAT_BC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	default:
+		return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+}
+
+static bool isOpaque(const Bitmap& bitmap)
+{
+	for (size_t i = 3; i < bitmap.pixels.size(); i += 4) {
+		if (bitmap.pixels[i] != 255) return false;
+	}
+	return true;
+}
+
+// box filtering shortens normals, put them back on the unit sphere
+static void renormalize(Bitmap& bitmap)
+{
+	for (size_t i = 0; i < bitmap.pixels.size(); i += 4) {
+		float n[3];
+		float length = 0.0f;
+		for (uint32_t c = 0; c < 3; c++) {
+			n[c] = bitmap.pixels[i + c] / 127.5f - 1.0f;
+			length += n[c] * n[c];
+		}
+		if (length <= 0.0f) continue;
+
+		length = 1.0f / std::sqrt(length);
+		for (uint32_t c = 0; c < 3; c++) {
+			float value = (n[c] * length + 1.0f) * 127.5f;
+			bitmap.pixels[i + c] = (uint8_t)std::min(255.0f, std::max(0.0f, std::floor(value + 0.5f)));
+		}
+	}
+}
+
+static void appendU32(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.insert(out.end(), (const uint8_t*)&value, (const uint8_t*)&value + sizeof(value));
+}
+
+// one basic descriptor block, the format's layout spelled out for tools that don't know VkFormats
+static std::vector<uint8_t> buildDescriptor(BlockFormat format, bool srgb)
+{
+	uint32_t model;
+	std::vector<DfdSample> samples;
+	switch (format) {
+	case BLOCK_FORMAT_BC1:
+		model = DFD_MODEL_BC1A;
+		samples = { { 0, 0, 64 } };
+		break;
+	case BLOCK_FORMAT_BC3:
+		model = DFD_MODEL_BC3;
+		samples = { { DFD_CHANNEL_ALPHA, 0, 64 }, { 0, 64, 64 } };
+		break;
+	case BLOCK_FORMAT_BC4:
+		model = DFD_MODEL_BC4;
+		samples = { { 0, 0, 64 } };
+		break;
+	case BLOCK_FORMAT_BC5:
+		model = DFD_MODEL_BC5;
+		samples = { { 0, 0, 64 }, { 1, 64, 64 } };
+		break;
+	default:
+		model = DFD_MODEL_BC7;
+		samples = { { 0, 0, 128 } };
+		break;
+	}
+
+	uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+	std::vector<uint8_t> out;
+	// total size, then the block
+	appendU32(out, 4 + blockSize);
+	appendU32(out, 0);
+	appendU32(out, DFD_VERSION | blockSize << 16);
+	appendU32(out, model | DFD_PRIMARIES_BT709 << 8 | (srgb ? DFD_TRANSFER_SRGB : DFD_TRANSFER_LINEAR) << 16);
+	// 4x4x1 texel blocks, stored as dimension - 1
+	appendU32(out, 3 | 3 << 8);
+	appendU32(out, BlockCompression::blockBytes(format));
+	appendU32(out, 0);
+	for (const DfdSample& sample : samples) {
+		// alpha is never sRGB encoded
+		uint32_t qualifiers = srgb && sample.channel == DFD_CHANNEL_ALPHA ? DFD_QUALIFIER_LINEAR : 0;
+		appendU32(out, sample.bitOffset | (sample.bitLength - 1) << 16 | (sample.channel | qualifiers) << 24);
+		appendU32(out, 0);
+		appendU32(out, 0);
+		appendU32(out, 0xFFFFFFFF);
+	}
+	return out;
+}
+
+static std::vector<uint8_t> buildKeyValues()
+{
+	static const char ENTRY[] = "KTXwriter\0ConfettiEngine";
+
+	std::vector<uint8_t> out;
+	appendU32(out, sizeof(ENTRY));
+	out.insert(out.end(), ENTRY, ENTRY + sizeof(ENTRY));
+	while (out.size() % 4 != 0) out.push_back(0);
+	return out;
+}
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void TextureCooker::cook(const std::string& source, const std::string& output, JobSystem& jobs, const Settings& settings)
+{
+	std::vector<Bitmap> levels;
+	{
+		MappedFile file(source);
+		levels.push_back(ImageDecoder::decode(file.getData(), file.getSize(), source));
+	}
+
+	bool srgb = settings.usage == TEXTURE_USAGE_COLOR;
+	if (settings.generateMips) {
+		std::vector<Bitmap> mips = MipGenerator::generate(levels[0], srgb);
+		for (Bitmap& mip : mips) levels.push_back(std::move(mip));
+	}
+	if (settings.usage == TEXTURE_USAGE_NORMAL) {
+		for (size_t level = 1; level < levels.size(); level++) renormalize(levels[level]);
+	}
+
+	BlockFormat format = blockFormat(settings, isOpaque(levels[0]));
+	uint32_t blockBytes = BlockCompression::blockBytes(format);
+	uint32_t levelCount = (uint32_t)levels.size();
+
+	// compressing is the slow part, the levels go one after the other and their rows of blocks
+	// across the workers
+	std::vector<std::vector<uint8_t>> compressed(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		compressed[level] = BlockCompression::compress(levels[level], format, jobs);
+	}
+
+	std::vector<uint8_t> descriptor = buildDescriptor(format, srgb);
+	std::vector<uint8_t> keyValues = buildKeyValues();
+
+	Ktx2Header header{};
+	memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = vulkanFormat(format, srgb);
+	header.typeSize = 1;
+	header.pixelWidth = levels[0].width;
+	header.pixelHeight = levels[0].height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.supercompressionScheme = KTX2_SUPERCOMPRESSION_NONE;
+	header.dfdByteOffset = (uint32_t)(sizeof(Ktx2Header) + sizeof(Ktx2Level) * levelCount);
+	header.dfdByteLength = (uint32_t)descriptor.size();
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = (uint32_t)keyValues.size();
+
+	// smallest level first
+	std::vector<Ktx2Level> index(levelCount);
+	size_t offset = header.kvdByteOffset + header.kvdByteLength;
+	for (uint32_t level = levelCount; level-- > 0;) {
+		offset = alignUp(offset, blockBytes);
+		index[level].byteOffset = offset;
+		index[level].byteLength = compressed[level].size();
+		index[level].uncompressedByteLength = compressed[level].size();
+		offset += compressed[level].size();
+	}
+
+	std::vector<uint8_t> file(offset, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), index.data(), sizeof(Ktx2Level) * levelCount);
+	memcpy(file.data() + header.dfdByteOffset, descriptor.data(), descriptor.size());
+	memcpy(file.data() + header.kvdByteOffset, keyValues.data(), keyValues.size());
+	for (uint32_t level = 0; level < levelCount; level++) {
+		memcpy(file.data() + index[level].byteOffset, compressed[level].data(), compressed[level].size());
+	}
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		throw std::runtime_error("ERROR: Failed to open " + output + " for writing!");
+	}
+	out.write((const char*)file.data(), file.size());
+	if (!out) {
+		throw std::runtime_error("ERROR: Failed to write " + output + "!");
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+#include <cstdint>
+#include <string>
+
+#include "BlockCompression.h"
+
+class JobSystem;
+
+// what a texture holds, picks the block format and how its mips are filtered
+enum TextureUsage {
+	// sRGB colour, BC7 (or BC1/BC3 when compact)
+	TEXTURE_USAGE_COLOR = 0,
+	// tangent space normals in RG, BC5. Mips are renormalised
+	TEXTURE_USAGE_NORMAL,
+	// single channel data in R (roughness, ao, metalness, ...), BC4
+	TEXTURE_USAGE_MASK
+};
+
+// offline conversion of PNG/JPEG/TGA sources into block compressed KTX2 files with their full
+// mip chain (see KtxFormat.h), so loading one is a copy per level with no decoding at all
+namespace TextureCooker {
+	struct Settings {
+		TextureUsage usage = TEXTURE_USAGE_COLOR;
+		// BC1 for opaque colour and BC3 for colour with alpha instead of BC7, half the size
+		// for opaque textures at a visible cost in quality
+		bool compact = false;
+		bool generateMips = true;
+	};
+
+	// bump whenever the cook changes what ends up in the file, so every cooked texture is
+	// considered stale
+	const uint32_t COOKER_VERSION = 1;
+
+	// identifies the settings and cooker version a texture was cooked with
+	uint64_t hashSettings(const Settings& settings);
+
+	// guesses the usage from the file name: _n/_normal are normal maps, _mask/_rough/_ao/_metal
+	// masks, everything else colour
+	TextureUsage usageFromName(const std::string& path);
+
+	// the block format a texture of this usage is compressed to, opaque only matters for colour
+	BlockFormat blockFormat(const Settings& settings, bool opaque);
+
+	// decode, mips, compress (spread across jobs) and write. Throws on failure
+	void cook(const std::string& source, const std::string& output, JobSystem& jobs, const Settings& settings = Settings());
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "TextureLoader.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+uint32_t TextureLoader::blockBytes(VkFormat format)
+{
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+bool TextureLoader::isKtx2(const uint8_t* data, size_t size)
+{
+	return size >= sizeof(KTX2_IDENTIFIER) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+}
+
+void TextureLoader::parseKtx2(const uint8_t* data, size_t size, const std::string& name, Ktx2Header& header, std::vector<Ktx2Level>& levels)
+{
+	if (!isKtx2(data, size) || size < sizeof(header)) {
+		throw std::runtime_error("ERROR: " + name + " is not a KTX2 file!");
+	}
+	memcpy(&header, data, sizeof(header));
+
+	uint32_t bytesPerBlock = blockBytes((VkFormat)header.vkFormat);
+	if (bytesPerBlock == 0 || header.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE || header.pixelDepth > 1 ||
+		header.layerCount > 1 || header.faceCount != 1 || header.pixelWidth == 0 || header.pixelHeight == 0) {
+		throw std::runtime_error("ERROR: " + name + " is not a block compressed 2D KTX2 texture!");
+	}
+
+	// 0 asks for mips to be generated at load, which compressed formats can't do
+	header.levelCount = std::max(header.levelCount, 1u);
+	if (header.levelCount > 32 || sizeof(header) + sizeof(Ktx2Level) * header.levelCount > size) {
+		throw std::runtime_error("ERROR: " + name + " is truncated!");
+	}
+
+	levels.resize(header.levelCount);
+	memcpy(levels.data(), data + sizeof(header), sizeof(Ktx2Level) * header.levelCount);
+	for (uint32_t level = 0; level < header.levelCount; level++) {
+		uint32_t width = std::max(header.pixelWidth >> level, 1u);
+		uint32_t height = std::max(header.pixelHeight >> level, 1u);
+		if (levels[level].byteLength != (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * bytesPerBlock) {
+			throw std::runtime_error("ERROR: " + name + " has a malformed level index!");
+		}
+	}
+}
+
+StreamUpload TextureLoader::levelUpload(const Ktx2Header& header, uint32_t level, const uint8_t* data)
+{
+	StreamUpload upload;
+	upload.data = data;
+	upload.width = std::max(header.pixelWidth >> level, 1u);
+	upload.height = std::max(header.pixelHeight >> level, 1u);
+	upload.rowPitch = (VkDeviceSize)((upload.width + 3) / 4) * blockBytes((VkFormat)header.vkFormat);
+	upload.rowHeight = 4;
+	upload.size = upload.rowPitch * ((upload.height + 3) / 4);
+	return upload;
+}
+
+// cooked files are already compressed and mipped, every level is uploaded straight from the
+// file's bytes
+static std::shared_ptr<Texture> loadKtx2(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& name, std::vector<uint8_t>& bytes, StreamedAsset& asset)
+{
+	Ktx2Header header;
+	std::vector<Ktx2Level> levels;
+	TextureLoader::parseKtx2(bytes.data(), bytes.size(), name, header, levels);
+
+	VkFormat format = (VkFormat)header.vkFormat;
+	if (!Texture::supportsSampling(physicalDevice, format)) {
+		throw std::runtime_error("ERROR: " + name + " uses a format the device can't sample!");
+	}
+	for (const Ktx2Level& level : levels) {
+		if (level.byteOffset > bytes.size() || bytes.size() - level.byteOffset < level.byteLength) {
+			throw std::runtime_error("ERROR: " + name + " is truncated!");
+		}
+	}
+
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>(physicalDevice, device, format, header.pixelWidth, header.pixelHeight, header.levelCount, false);
+	for (uint32_t level = 0; level < header.levelCount; level++) {
+		StreamUpload upload = TextureLoader::levelUpload(header, level, bytes.data() + levels[level].byteOffset);
+		upload.image = texture->getImage();
+		upload.mipLevel = level;
+		asset.uploads.push_back(upload);
+	}
+	return texture;
+}
+
+// the streamer records the layout transitions around the copies, the asset owns the texture
+static void attach(const std::shared_ptr<Texture>& texture, StreamedAsset& asset)
+{
+	Texture* raw = texture.get();
+	asset.prepare = [raw](VkCommandBuffer cmd) { raw->recordPrepareUpload(cmd); };
+	asset.finalize = [raw](VkCommandBuffer cmd) { raw->recordFinishUpload(cmd); };
+	asset.object = texture;
+}
+
+AssetStreamer::DecodeFunction TextureLoader::decode(VkPhysicalDevice& p, VkDevice& d, const std::string& name, Settings settings)
+{
+	VkPhysicalDevice physicalDevice = p;
+	VkDevice device = d;
+	VkFormat format = settings.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	// format support doesn't change, ask once here rather than on every worker
+	bool blitMips = settings.generateMips && settings.gpuMips && Texture::supportsBlitMips(physicalDevice, format);
+
+	return [physicalDevice, device, name, format, settings, blitMips](std::vector<uint8_t>& bytes, StreamedAsset& asset) {
+		if (isKtx2(bytes.data(), bytes.size())) {
+			attach(loadKtx2(physicalDevice, device, name, bytes, asset), asset);
+			return true;
+		}
+
+		Bitmap base = ImageDecoder::decode(bytes.data(), bytes.size(), name);
+
+		std::vector<Bitmap> levels;
+		if (settings.generateMips && !blitMips) levels = MipGenerator::generate(base, settings.srgb);
+		uint32_t mipLevels = settings.generateMips ? MipGenerator::levelCount(base.width, base.height) : 1;
+
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>(physicalDevice, device, format, base.width, base.height, mipLevels, blitMips);
+
+		// the file's bytes are done with, the streamer keeps the pixels in their place until the copies retire
+		bytes.swap(base.pixels);
+		for (const Bitmap& level : levels) bytes.insert(bytes.end(), level.pixels.begin(), level.pixels.end());
+
+		size_t offset = 0;
+		for (uint32_t level = 0; level < (uint32_t)levels.size() + 1; level++) {
+			uint32_t width = level == 0 ? base.width : levels[level - 1].width;
+			uint32_t height = level == 0 ? base.height : levels[level - 1].height;
+
+			StreamUpload upload;
+			upload.data = bytes.data() + offset;
+			upload.size = (VkDeviceSize)width * height * 4;
+			upload.image = texture->getImage();
+			upload.mipLevel = level;
+			upload.width = width;
+			upload.height = height;
+			upload.rowPitch = (VkDeviceSize)width * 4;
+			asset.uploads.push_back(upload);
+
+			offset += (size_t)upload.size;
+		}
+
+		attach(texture, asset);
+		return true;
+	};
+}
+
+StreamHandle TextureLoader::load(AssetStreamer& streamer, VkPhysicalDevice& p, VkDevice& d, const std::string& path, StreamPriority priority, Settings settings)
+{
+	return streamer.load(path, priority, decode(p, d, path, settings));
+}
@@ -0,0 +1,44 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <string>
+#include <vector>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "AssetStreamer.h"
+#include "KtxFormat.h"
+#include "Texture.h"
+
+// PNG, JPEG and TGA files into Textures through the AssetStreamer. Decoding and CPU mip
+// generation run on the decode job, so several textures decode at once on the workers.
+// KTX2 files from TextureCooker skip all of that, their block compressed levels are uploaded
+// as they are and the settings don't apply.
+//
+//    StreamHandle albedo = TextureLoader::load(streamer, physicalDevice, device, "textures/rock.png", STREAM_PRIORITY_NORMAL);
+//    if (streamer.isReady(albedo)) bind(streamer.get<Texture>(albedo)->getView());
+namespace TextureLoader {
+	struct Settings {
+		// colour data, false for normal maps, masks and other non colour data
+		bool srgb = true;
+		bool generateMips = true;
+		// blit the mips on the GPU when the format allows it instead of uploading CPU filtered ones
+		bool gpuMips = true;
+	};
+
+	// name is only used for the TGA extension check and error messages
+	AssetStreamer::DecodeFunction decode(VkPhysicalDevice& p, VkDevice& d, const std::string& name, Settings settings = Settings());
+
+	StreamHandle load(AssetStreamer& streamer, VkPhysicalDevice& p, VkDevice& d, const std::string& path, StreamPriority priority, Settings settings = Settings());
+
+	// bytes per 4x4 block of the block compressed formats TextureCooker writes, 0 for anything else
+	uint32_t blockBytes(VkFormat format);
+	bool isKtx2(const uint8_t* data, size_t size);
+	// header and level index of a cooked texture. size only has to cover those, the level data
+	// isn't checked against it. Throws for anything the loaders can't upload as is
+	void parseKtx2(const uint8_t* data, size_t size, const std::string& name, Ktx2Header& header, std::vector<Ktx2Level>& levels);
+	// the copy of one level whose data starts at data, image and mipLevel are left to the caller
+	StreamUpload levelUpload(const Ktx2Header& header, uint32_t level, const uint8_t* data);
+};
+
+#endif
@@ -0,0 +1,446 @@
+#include "TextureStreamer.h"
+#include "TextureLoader.h"
+#include "VirtualFileSystem.h"
+#include "../Buffers/Buffer.h"
+#include "../Buffers/MemoryBudget.h"
+#include "../Resources/DeletionQueue.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// must match Shaders/textureFeedback.glsl
+static const float FEEDBACK_SCALE = 16.0f;
+static const float FEEDBACK_BIAS = 32.0f;
+static const uint32_t FEEDBACK_NONE = 0xFFFFFFFF;
+
+// the header plus the longest possible level index
+static const uint64_t HEADER_READ_SIZE = sizeof(Ktx2Header) + sizeof(Ktx2Level) * 32;
+
+TextureStreamer::TextureStreamer(VkPhysicalDevice& p, VkDevice& d, AssetStreamer& s, DeletionQueue& q, const VirtualFileSystem& v, const MemoryBudget& b, const Settings& settings)
+	: physicalDevice(p), device(d), streamer(s), deletions(q), fileSystem(v), memoryBudget(b), settings(settings)
+{
+	if (settings.framesInFlight == 0 || settings.framesInFlight > 32 || settings.maxTextures == 0) {
+		throw std::runtime_error("ERROR: Invalid texture streamer settings!");
+	}
+	entries.reserve(settings.maxTextures);
+
+	if (settings.feedback) {
+		VkDeviceSize size = (VkDeviceSize)settings.maxTextures * sizeof(uint32_t);
+		feedbackBuffers.resize(settings.framesInFlight);
+		feedbackMemory.resize(settings.framesInFlight);
+		feedbackData.resize(settings.framesInFlight);
+		feedbackFrames.assign(settings.framesInFlight, ~0ull);
+
+		// read by the CPU a few frames later, mapped for good
+		for (uint32_t slot = 0; slot < settings.framesInFlight; slot++) {
+			Buffer::create(physicalDevice, device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, feedbackBuffers[slot], feedbackMemory[slot]);
+
+			void* data;
+			vkMapMemory(device, feedbackMemory[slot], 0, size, 0, &data);
+			memset(data, 0xFF, (size_t)size);
+			feedbackData[slot] = (const uint32_t*)data;
+		}
+	}
+
+	std::cout << "Texture Streamer created (" << settings.maxTextures << " textures, " << settings.framesInFlight << " frames in flight"
+		<< (settings.feedback ? ", shader feedback" : "") << ")\n";
+}
+
+// the device must be idle
+TextureStreamer::~TextureStreamer()
+{
+	for (Entry& entry : entries) {
+		if (entry.load.isValid()) streamer.release(entry.load);
+	}
+	for (uint32_t slot = 0; slot < feedbackBuffers.size(); slot++) {
+		vkUnmapMemory(device, feedbackMemory[slot]);
+		Buffer::destroy(device, feedbackBuffers[slot], feedbackMemory[slot]);
+	}
+}
+
+uint32_t TextureStreamer::add(const std::string& path)
+{
+	if (entries.size() >= settings.maxTextures) {
+		throw std::runtime_error("ERROR: Texture streamer is full, can't add " + path + "!");
+	}
+
+	std::vector<uint8_t> bytes;
+	if (!fileSystem.read(path, 0, HEADER_READ_SIZE, bytes)) {
+		throw std::runtime_error("ERROR: Failed to read " + path + "!");
+	}
+
+	Entry entry;
+	entry.path = path;
+	TextureLoader::parseKtx2(bytes.data(), bytes.size(), path, entry.header, entry.levels);
+	if (!Texture::supportsSampling(physicalDevice, (VkFormat)entry.header.vkFormat)) {
+		throw std::runtime_error("ERROR: " + path + " uses a format the device can't sample!");
+	}
+
+	uint32_t levelCount = entry.header.levelCount;
+	entry.bytesFrom.assign(levelCount + 1, 0);
+	for (uint32_t level = levelCount; level-- > 0;) {
+		entry.bytesFrom[level] = entry.bytesFrom[level + 1] + entry.levels[level].byteLength;
+	}
+
+	// the last level at worst, for files cooked without mips
+	entry.tailLevel = levelCount - 1;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		if (std::max(entry.header.pixelWidth >> level, 1u) <= settings.tailSize && std::max(entry.header.pixelHeight >> level, 1u) <= settings.tailSize) {
+			entry.tailLevel = level;
+			break;
+		}
+	}
+
+	entry.residentLevel = levelCount;
+	entry.targetLevel = entry.tailLevel;
+	entry.requested = FLT_MAX;
+	entry.wantedLevel = entry.tailLevel;
+	entries.push_back(std::move(entry));
+
+	uint32_t id = (uint32_t)entries.size() - 1;
+	startLoad(id);
+	return id;
+}
+
+void TextureStreamer::request(uint32_t id, float level)
+{
+	if (id >= entries.size()) return;
+	entries[id].requested = std::min(entries[id].requested, level);
+}
+
+float TextureStreamer::levelFromDensity(float texelsPerUnit, float pixelsPerUnit)
+{
+	// off screen or no texture coordinates, nothing beyond the tail is needed
+	if (texelsPerUnit <= 0.0f || pixelsPerUnit <= 0.0f) return FLT_MAX;
+	return std::log2(texelsPerUnit / pixelsPerUnit);
+}
+
+void TextureStreamer::update(VkCommandBuffer cmd, uint64_t frame)
+{
+	if (settings.feedback) {
+		uint32_t slot = (uint32_t)(frame % settings.framesInFlight);
+		vkCmdFillBuffer(cmd, feedbackBuffers[slot], 0, VK_WHOLE_SIZE, FEEDBACK_NONE);
+
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = feedbackBuffers[slot];
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+		feedbackFrames[slot] = frame;
+	}
+
+	// swap in the replacements that finished
+	for (uint32_t id = 0; id < entries.size(); id++) {
+		Entry& entry = entries[id];
+		if (!entry.load.isValid()) continue;
+
+		StreamState state = streamer.getState(entry.load);
+		if (state != STREAM_READY && state != STREAM_FAILED) continue;
+
+		if (state == STREAM_READY) {
+			replace(id, entry.replacement->texture, entry.loadLevel, frame);
+		}
+		else {
+			// the streamer already said why, retrying would only fail again
+			entry.failed = true;
+		}
+		streamer.release(entry.load);
+		entry.load = StreamHandle();
+		entry.replacement.reset();
+	}
+
+	plan(frame);
+
+	std::vector<uint32_t> drops;
+	std::vector<uint32_t> loads;
+	for (uint32_t id = 0; id < entries.size(); id++) {
+		Entry& entry = entries[id];
+		if (entry.failed) continue;
+
+		if (entry.load.isValid()) {
+			// finer levels that aren't wanted anymore, the tail is always finished
+			if (entry.residentLevel < entry.header.levelCount && entry.targetLevel >= entry.residentLevel) {
+				streamer.release(entry.load);
+				entry.load = StreamHandle();
+				entry.replacement.reset();
+			}
+			continue;
+		}
+
+		if (entry.targetLevel < entry.residentLevel) loads.push_back(id);
+		else if (entry.targetLevel > entry.residentLevel) drops.push_back(id);
+	}
+
+	// drops first, they free the memory the loads need. The biggest changes go first either way
+	std::sort(drops.begin(), drops.end(), [this](uint32_t a, uint32_t b) {
+		return entries[a].targetLevel - entries[a].residentLevel > entries[b].targetLevel - entries[b].residentLevel;
+	});
+	std::sort(loads.begin(), loads.end(), [this](uint32_t a, uint32_t b) {
+		return entries[a].residentLevel - entries[a].targetLevel > entries[b].residentLevel - entries[b].targetLevel;
+	});
+
+	uint32_t changes = 0;
+	for (uint32_t id : drops) {
+		if (changes == settings.maxChangesPerFrame) break;
+		drop(id, cmd, frame);
+		changes++;
+	}
+	for (uint32_t id : loads) {
+		if (changes == settings.maxChangesPerFrame) break;
+		startLoad(id);
+		changes++;
+	}
+}
+
+void TextureStreamer::plan(uint64_t frame)
+{
+	// the driver's usage includes our own images, the budget left for them is what everything else doesn't use
+	MemoryBudget::Heap heap = memoryBudget.query();
+	VkDeviceSize others = heap.usage > residentBytes ? heap.usage - residentBytes : 0;
+	VkDeviceSize usable = (VkDeviceSize)((double)heap.budget * (1.0 - settings.headroom));
+	budget = usable > others ? usable - others : 0;
+	if (settings.maxBytes != 0) budget = std::min(budget, settings.maxBytes);
+
+	uint32_t maxBias = 0;
+	for (Entry& entry : entries) {
+		if (entry.requested != FLT_MAX) {
+			uint32_t level = (uint32_t)std::min(std::max(std::floor(entry.requested), 0.0f), (float)entry.tailLevel);
+
+			// finer levels are taken right away, coarser ones once the finer level went unrequested
+			// for keepFrames, so textures don't thrash at the edge between two levels
+			if (level <= entry.wantedLevel || frame - entry.wantedFrame > settings.keepFrames) {
+				entry.wantedLevel = level;
+				entry.wantedFrame = frame;
+			}
+			entry.requested = FLT_MAX;
+		}
+		else if (frame - entry.wantedFrame > settings.keepFrames) {
+			entry.wantedLevel = entry.tailLevel;
+		}
+		maxBias = std::max(maxBias, entry.tailLevel - entry.wantedLevel);
+	}
+
+	// the smallest number of levels every texture gives up for the lot to fit, tails always stay
+	for (levelBias = 0; levelBias < maxBias; levelBias++) {
+		VkDeviceSize total = 0;
+		for (const Entry& entry : entries) {
+			total += entry.bytesFrom[std::min(entry.wantedLevel + levelBias, entry.tailLevel)];
+		}
+		if (total <= budget) break;
+	}
+
+	for (Entry& entry : entries) {
+		entry.targetLevel = std::min(entry.wantedLevel + levelBias, entry.tailLevel);
+	}
+}
+
+void TextureStreamer::startLoad(uint32_t id)
+{
+	Entry& entry = entries[id];
+	uint32_t first = entry.targetLevel;
+	uint32_t last = entry.residentLevel;
+
+	// the missing levels are next to each other in the file, whichever way round they are stored
+	uint64_t start = ~0ull;
+	uint64_t end = 0;
+	for (uint32_t level = first; level < last; level++) {
+		start = std::min(start, entry.levels[level].byteOffset);
+		end = std::max(end, entry.levels[level].byteOffset + entry.levels[level].byteLength);
+	}
+
+	VkPhysicalDevice p = physicalDevice;
+	VkDevice d = device;
+	Ktx2Header header = entry.header;
+	std::vector<Ktx2Level> levels = entry.levels;
+	std::shared_ptr<Texture> old = entry.texture;
+	std::shared_ptr<Replacement> replacement = std::make_shared<Replacement>();
+	std::string path = entry.path;
+
+	AssetStreamer::DecodeFunction decode = [p, d, header, levels, first, last, start, old, replacement, path](std::vector<uint8_t>& bytes, StreamedAsset& asset) {
+		uint32_t levelCount = header.levelCount;
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>(p, d, (VkFormat)header.vkFormat,
+			std::max(header.pixelWidth >> first, 1u), std::max(header.pixelHeight >> first, 1u), levelCount - first, false, true);
+
+		for (uint32_t level = first; level < last; level++) {
+			uint64_t offset = levels[level].byteOffset - start;
+			if (offset + levels[level].byteLength > bytes.size()) {
+				throw std::runtime_error("ERROR: " + path + " is truncated!");
+			}
+
+			StreamUpload upload = TextureLoader::levelUpload(header, level, bytes.data() + offset);
+			upload.image = texture->getImage();
+			upload.mipLevel = level - first;
+			asset.uploads.push_back(upload);
+		}
+
+		// the levels already resident come over from the old image on the GPU
+		Texture* raw = texture.get();
+		asset.prepare = [raw, old, first, last, levelCount](VkCommandBuffer cmd) {
+			raw->recordPrepareUpload(cmd);
+			if (old) raw->recordCopyLevels(cmd, *old, 0, last - first, levelCount - last);
+		};
+		asset.finalize = [raw](VkCommandBuffer cmd) { raw->recordFinishUpload(cmd); };
+		asset.object = texture;
+		replacement->texture = texture;
+		return true;
+	};
+
+	// nothing can be sampled until the tail is in
+	StreamPriority priority = entry.texture ? STREAM_PRIORITY_NORMAL : STREAM_PRIORITY_HIGH;
+	entry.load = streamer.loadRange(entry.path, start, end - start, priority, decode);
+	entry.loadLevel = first;
+	entry.replacement = replacement;
+}
+
+void TextureStreamer::drop(uint32_t id, VkCommandBuffer cmd, uint64_t frame)
+{
+	Entry& entry = entries[id];
+	uint32_t level = entry.targetLevel;
+	uint32_t levelCount = entry.header.levelCount;
+
+	// running out of memory here isn't fatal, the texture keeps its levels and tries again next frame
+	std::shared_ptr<Texture> texture;
+	try {
+		texture = std::make_shared<Texture>(physicalDevice, device, (VkFormat)entry.header.vkFormat,
+			std::max(entry.header.pixelWidth >> level, 1u), std::max(entry.header.pixelHeight >> level, 1u), levelCount - level, false, true);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return;
+	}
+
+	texture->recordPrepareUpload(cmd);
+	texture->recordCopyLevels(cmd, *entry.texture, level - entry.residentLevel, 0, levelCount - level);
+	texture->recordFinishUpload(cmd);
+	replace(id, texture, level, frame);
+}
+
+void TextureStreamer::replace(uint32_t id, std::shared_ptr<Texture> texture, uint32_t level, uint64_t frame)
+{
+	Entry& entry = entries[id];
+
+	// frames up to this one may still sample it, or copy out of it. The image goes with the
+	// last reference, when the queue drops the copy
+	if (entry.texture) {
+		residentBytes -= entry.texture->getMemorySize();
+		deletions.defer([texture = entry.texture]() {}, frame);
+	}
+
+	entry.texture = texture;
+	entry.residentLevel = level;
+	residentBytes += texture->getMemorySize();
+
+	if (entry.staleSlots == 0) dirty.push_back(id);
+	entry.staleSlots = (uint32_t)((1ull << settings.framesInFlight) - 1);
+}
+
+void TextureStreamer::recordFeedbackBarrier(VkCommandBuffer cmd, uint64_t frame)
+{
+	if (!settings.feedback) return;
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = feedbackBuffers[frame % settings.framesInFlight];
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void TextureStreamer::retire(uint64_t completedFrame)
+{
+	if (settings.feedback) {
+		uint32_t slot = (uint32_t)(completedFrame % settings.framesInFlight);
+
+		// the shaders wrote the level relative to the texture's width, truncated to fixed point, see textureFeedback.glsl
+		if (feedbackFrames[slot] == completedFrame) {
+			const uint32_t* values = feedbackData[slot];
+			for (uint32_t id = 0; id < entries.size(); id++) {
+				if (values[id] == FEEDBACK_NONE) continue;
+				request(id, (values[id] + 0.5f) / FEEDBACK_SCALE - FEEDBACK_BIAS + std::log2((float)entries[id].header.pixelWidth));
+			}
+		}
+	}
+}
+
+void TextureStreamer::writeDescriptors(VkDescriptorSet set, uint32_t binding, VkSampler sampler, uint64_t frame)
+{
+	uint32_t slotBit = 1u << (frame % settings.framesInFlight);
+
+	// the writes point into images, it must not reallocate
+	std::vector<VkDescriptorImageInfo> images;
+	std::vector<VkWriteDescriptorSet> writes;
+	images.reserve(dirty.size());
+	writes.reserve(dirty.size());
+
+	for (uint32_t id : dirty) {
+		Entry& entry = entries[id];
+		if (!(entry.staleSlots & slotBit)) continue;
+		entry.staleSlots &= ~slotBit;
+
+		VkDescriptorImageInfo image{};
+		image.sampler = sampler;
+		image.imageView = entry.texture->getView();
+		image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		images.push_back(image);
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.dstArrayElement = id;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &images.back();
+		writes.push_back(write);
+	}
+
+	if (!writes.empty()) {
+		vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+	}
+
+	dirty.erase(std::remove_if(dirty.begin(), dirty.end(), [this](uint32_t id) { return entries[id].staleSlots == 0; }), dirty.end());
+}
+
+VkBuffer TextureStreamer::getFeedbackBuffer(uint64_t frame) const
+{
+	return settings.feedback ? feedbackBuffers[frame % settings.framesInFlight] : VK_NULL_HANDLE;
+}
+
+VkImageView TextureStreamer::getView(uint32_t id) const
+{
+	return entries[id].texture ? entries[id].texture->getView() : VK_NULL_HANDLE;
+}
+
+uint32_t TextureStreamer::getResidentLevel(uint32_t id) const
+{
+	return entries[id].residentLevel;
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const
+{
+	Stats stats;
+	stats.textures = (uint32_t)entries.size();
+	for (const Entry& entry : entries) {
+		if (entry.load.isValid()) stats.loading++;
+	}
+	stats.residentBytes = residentBytes;
+	stats.budget = budget;
+	stats.levelBias = levelBias;
+	return stats;
+}
@@ -0,0 +1,173 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "AssetStreamer.h"
+#include "KtxFormat.h"
+#include "Texture.h"
+
+class DeletionQueue;
+class MemoryBudget;
+class VirtualFileSystem;
+
+// keeps only the mip levels of cooked (KTX2) textures that are actually needed resident.
+// Every texture always has its small mip tail, finer levels are requested each frame, either
+// from the screen space texel density of the materials using them (levelFromDensity) or by
+// the shaders through a feedback buffer (Shaders/textureFeedback.glsl). When the wanted levels
+// don't fit the device local budget (VK_EXT_memory_budget when available) every texture gives
+// up the same number of levels, so quality drops evenly instead of some textures going blurry.
+//
+// A texture is one image holding its resident levels. Changing residency builds a replacement:
+// finer levels are read and uploaded by the AssetStreamer (only the missing levels' byte
+// range) and the levels already resident are copied over on the GPU, dropping levels copies
+// the ones that stay. The old image goes to the DeletionQueue with the frame that last used
+// it, the new view reaches each frame slot's descriptor set when that slot is written next, so
+// nothing ever waits on the GPU.
+//
+//    uint32_t albedo = textures.add("cooked/rock_albedo.ktx2");
+//    every frame: textures.retire(completedFrame); textures.update(cmd, frame);
+//                 textures.request(albedo, TextureStreamer::levelFromDensity(...));
+//                 textures.writeDescriptors(sets[frame % framesInFlight], 0, sampler, frame);
+//                 streamer.recordUploads(cmd, frame); ... draw ...
+//                 textures.recordFeedbackBarrier(cmd, frame);
+class TextureStreamer {
+public:
+	struct Settings {
+		// size of the bindless texture array and of the feedback buffers
+		uint32_t maxTextures = 4096;
+		// frames recorded ahead of the GPU, one descriptor set and feedback buffer each
+		uint32_t framesInFlight = 2;
+		// share of the budget never planned for, the driver's numbers lag behind allocations
+		float headroom = 0.1f;
+		// cap on streamed texture memory on top of the budget, 0 for none
+		VkDeviceSize maxBytes = 0;
+		// levels this size and smaller are loaded up front and never dropped
+		uint32_t tailSize = 64;
+		// a texture keeps finer levels this many frames after they were last requested
+		uint32_t keepFrames = 60;
+		// residency changes started per update, bounds image creation and copies per frame
+		uint32_t maxChangesPerFrame = 8;
+		// read the shaders' requests back from the feedback buffers
+		bool feedback = true;
+	};
+
+	struct Stats {
+		uint32_t textures = 0;
+		uint32_t loading = 0;
+		// memory of the current images, replacements in flight aren't counted
+		VkDeviceSize residentBytes = 0;
+		VkDeviceSize budget = 0;
+		// levels every texture gives up to fit the budget
+		uint32_t levelBias = 0;
+	};
+
+	TextureStreamer(VkPhysicalDevice& p, VkDevice& d, AssetStreamer& s, DeletionQueue& q, const VirtualFileSystem& v, const MemoryBudget& b, const Settings& settings);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// reads the header (a few hundred bytes) right away and queues the mip tail. The id is the
+	// texture's element in the bindless array and the feedback buffer. Throws for files that
+	// aren't cooked textures or when maxTextures is reached
+	uint32_t add(const std::string& path);
+
+	// level the texture is needed at this frame, 0 being full resolution. The finest request wins
+	void request(uint32_t id, float level);
+	// the level whose texels are about pixel sized. texelsPerUnit is the texture's width times
+	// MeshSubmesh::uvDensity, pixelsPerUnit the size of one mesh unit on screen at the
+	// object's distance, e.g. LodSelector::projectError(scale, distance)
+	static float levelFromDensity(float texelsPerUnit, float pixelsPerUnit);
+
+	// main thread, once per frame before the AssetStreamer records its uploads. Swaps in
+	// finished replacements, plans residency against the budget and starts the changes
+	void update(VkCommandBuffer cmd, uint64_t frame);
+	// after the last pass that reports feedback, makes the frame's requests readable by retire
+	void recordFeedbackBarrier(VkCommandBuffer cmd, uint64_t frame);
+	// every frame up to and including completedFrame has finished on the GPU. Reads that
+	// frame's feedback
+	void retire(uint64_t completedFrame);
+
+	// every view that changed since the set of frame's slot was last written, as combined
+	// image samplers at element id of binding. Call each frame after update and before the set
+	// is bound. Textures without a resident level yet are left alone, fill the array with a
+	// placeholder when the set is created
+	void writeDescriptors(VkDescriptorSet set, uint32_t binding, VkSampler sampler, uint64_t frame);
+
+	// maxTextures uints for frame's slot, reset to "nothing requested" by update
+	VkBuffer getFeedbackBuffer(uint64_t frame) const;
+	// VK_NULL_HANDLE until the tail is in
+	VkImageView getView(uint32_t id) const;
+	// finest resident level, the mip count while nothing is
+	uint32_t getResidentLevel(uint32_t id) const;
+	Stats getStats() const;
+
+private:
+	// filled in by the decode job, read once the AssetStreamer says it's ready
+	struct Replacement {
+		std::shared_ptr<Texture> texture;
+	};
+
+	struct Entry {
+		std::string path;
+		Ktx2Header header;
+		std::vector<Ktx2Level> levels;
+		// bytes of every level from the index on, one past the end is 0
+		std::vector<VkDeviceSize> bytesFrom;
+		// first level of the tail
+		uint32_t tailLevel;
+
+		// holds levels residentLevel and down
+		std::shared_ptr<Texture> texture;
+		uint32_t residentLevel;
+		uint32_t targetLevel;
+
+		// finest request since the last update
+		float requested;
+		uint32_t wantedLevel;
+		uint64_t wantedFrame = 0;
+
+		// finer levels in flight
+		StreamHandle load;
+		uint32_t loadLevel = 0;
+		std::shared_ptr<Replacement> replacement;
+		bool failed = false;
+
+		// bit per frame slot whose descriptor set doesn't have the current view yet
+		uint32_t staleSlots = 0;
+	};
+
+	void plan(uint64_t frame);
+	void startLoad(uint32_t id);
+	void drop(uint32_t id, VkCommandBuffer cmd, uint64_t frame);
+	void replace(uint32_t id, std::shared_ptr<Texture> texture, uint32_t level, uint64_t frame);
+
+	VkPhysicalDevice& physicalDevice;
+	VkDevice& device;
+	AssetStreamer& streamer;
+	DeletionQueue& deletions;
+	const VirtualFileSystem& fileSystem;
+	const MemoryBudget& memoryBudget;
+	Settings settings;
+
+	std::vector<Entry> entries;
+	// ids with stale slots
+	std::vector<uint32_t> dirty;
+	VkDeviceSize residentBytes = 0;
+	VkDeviceSize budget = 0;
+	uint32_t levelBias = 0;
+
+	// per frame slot
+	std::vector<VkBuffer> feedbackBuffers;
+	std::vector<VkDeviceMemory> feedbackMemory;
+	std::vector<const uint32_t*> feedbackData;
+	std::vector<uint64_t> feedbackFrames;
+};
+
+#endif
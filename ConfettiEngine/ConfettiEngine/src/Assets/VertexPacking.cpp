@@ -0,0 +1,101 @@
+#include "VertexPacking.h"
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
+
+static glm::vec2 signNotZero(const glm::vec2& v)
+{
+	return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+glm::vec2 VertexPacking::octEncode(const glm::vec3& n)
+{
+	glm::vec2 p = glm::vec2(n.x, n.y) / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+	if (n.z < 0.0f) {
+		p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+	}
+	return p;
+}
+
+glm::vec3 VertexPacking::octDecode(const glm::vec2& e)
+{
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	if (n.z < 0.0f) {
+		glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(glm::vec2(n.x, n.y));
+		n.x = folded.x;
+		n.y = folded.y;
+	}
+	return glm::normalize(n);
+}
+
+glm::vec2 VertexPacking::octEncodeSnorm8(const glm::vec3& n)
+{
+	glm::vec2 e = octEncode(n);
+
+	// try the four snorm8 neighbours of the exact encoding, keep whichever decodes closest
+	glm::vec2 base = glm::floor(glm::clamp(e, -1.0f, 1.0f) * 127.0f);
+	glm::vec2 best = base / 127.0f;
+	float bestDot = -2.0f;
+	for (int i = 0; i < 4; i++) {
+		glm::vec2 candidate = glm::clamp((base + glm::vec2((float)(i & 1), (float)(i >> 1))) / 127.0f, -1.0f, 1.0f);
+		float d = glm::dot(octDecode(candidate), n);
+		if (d > bestDot) {
+			bestDot = d;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+void VertexPacking::quantization(const MeshSubmesh& submesh, glm::vec3& offset, glm::vec3& scale)
+{
+	offset = glm::vec3(submesh.aabbMin[0], submesh.aabbMin[1], submesh.aabbMin[2]);
+	scale = glm::max(glm::vec3(submesh.aabbMax[0], submesh.aabbMax[1], submesh.aabbMax[2]) - offset, glm::vec3(0.0f));
+}
+
+MeshPackedVertex VertexPacking::pack(const MeshVertex& vertex, const glm::vec3& offset, const glm::vec3& scale)
+{
+	MeshPackedVertex packed{};
+
+	for (int i = 0; i < 3; i++) {
+		float t = scale[i] > 0.0f ? (vertex.position[i] - offset[i]) / scale[i] : 0.0f;
+		packed.position[i] = glm::packUnorm1x16(t);
+	}
+	packed.position[3] = vertex.tangent[3] < 0.0f ? 0 : 0xFFFF;
+
+	glm::vec3 normal(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+	glm::vec3 tangent(vertex.tangent[0], vertex.tangent[1], vertex.tangent[2]);
+	// missing attributes are zero filled, keep them decodable
+	glm::vec2 n = glm::dot(normal, normal) > 0.0f ? octEncodeSnorm8(glm::normalize(normal)) : glm::vec2(0.0f);
+	glm::vec2 t = glm::dot(tangent, tangent) > 0.0f ? octEncodeSnorm8(glm::normalize(tangent)) : glm::vec2(0.0f);
+	packed.normalTangent[0] = (int8_t)glm::packSnorm1x8(n.x);
+	packed.normalTangent[1] = (int8_t)glm::packSnorm1x8(n.y);
+	packed.normalTangent[2] = (int8_t)glm::packSnorm1x8(t.x);
+	packed.normalTangent[3] = (int8_t)glm::packSnorm1x8(t.y);
+
+	packed.uv[0] = glm::packHalf1x16(vertex.uv[0]);
+	packed.uv[1] = glm::packHalf1x16(vertex.uv[1]);
+	return packed;
+}
+
+MeshVertex VertexPacking::unpack(const MeshPackedVertex& packed, const glm::vec3& offset, const glm::vec3& scale)
+{
+	MeshVertex vertex{};
+
+	for (int i = 0; i < 3; i++) {
+		vertex.position[i] = offset[i] + scale[i] * glm::unpackUnorm1x16(packed.position[i]);
+	}
+
+	glm::vec3 normal = octDecode(glm::vec2(glm::unpackSnorm1x8((uint8_t)packed.normalTangent[0]), glm::unpackSnorm1x8((uint8_t)packed.normalTangent[1])));
+	glm::vec3 tangent = octDecode(glm::vec2(glm::unpackSnorm1x8((uint8_t)packed.normalTangent[2]), glm::unpackSnorm1x8((uint8_t)packed.normalTangent[3])));
+	for (int i = 0; i < 3; i++) {
+		vertex.normal[i] = normal[i];
+		vertex.tangent[i] = tangent[i];
+	}
+	vertex.tangent[3] = packed.position[3] != 0 ? 1.0f : -1.0f;
+
+	vertex.uv[0] = glm::unpackHalf1x16(packed.uv[0]);
+	vertex.uv[1] = glm::unpackHalf1x16(packed.uv[1]);
+	return vertex;
+}
@@ -0,0 +1,26 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <glm/glm.hpp>
+
+#include "MeshFormat.h"
+
+// conversion between MeshVertex and MeshPackedVertex. Shaders/vertexDecode.glsl is the GPU
+// side of unpack and has to stay in sync with it
+namespace VertexPacking {
+	// unit vector onto the [-1, 1] square: the octahedron |x| + |y| + |z| = 1 unfolded,
+	// the lower half folded over the diagonals
+	glm::vec2 octEncode(const glm::vec3& n);
+	glm::vec3 octDecode(const glm::vec2& e);
+	// the snorm8 encoding of n that decodes closest to it, better than plain rounding
+	glm::vec2 octEncodeSnorm8(const glm::vec3& n);
+
+	// packed position = (position - offset) / scale, so scale is the aabb size. Flat axes
+	// get a scale of 0 and decode to the offset
+	void quantization(const MeshSubmesh& submesh, glm::vec3& offset, glm::vec3& scale);
+
+	MeshPackedVertex pack(const MeshVertex& vertex, const glm::vec3& offset, const glm::vec3& scale);
+	MeshVertex unpack(const MeshPackedVertex& vertex, const glm::vec3& offset, const glm::vec3& scale);
+};
+
+#endif
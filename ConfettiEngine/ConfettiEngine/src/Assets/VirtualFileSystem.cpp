@@ -0,0 +1,257 @@
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// cancellation is checked between chunks, a multiple of PACK_CHUNK_SIZE so archive reads
+// decompress whole chunks
+static const size_t READ_CHUNK = 1 << 20;
+
+static bool isCancelled(const std::function<bool()>& cancelled)
+{
+	return cancelled && cancelled();
+}
+
+// size bytes from offset, clamped to the end of the file
+static size_t clampRange(uint64_t fileSize, uint64_t offset, uint64_t size)
+{
+	return (size_t)std::min(size, fileSize - offset);
+}
+
+// false if the file can't be opened or read or doesn't reach offset. Positioned reads, so any
+// number of threads can read at once without sharing a file position
+static bool readLooseFile(const std::string& path, uint64_t start, uint64_t size, std::vector<uint8_t>& bytes, const std::function<bool()>& cancelled)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	if (start > (uint64_t)fileSize.QuadPart) {
+		CloseHandle(file);
+		return false;
+	}
+	bytes.resize(clampRange((uint64_t)fileSize.QuadPart, start, size));
+
+	bool ok = true;
+	for (size_t offset = 0; offset < bytes.size() && ok; ) {
+		if (isCancelled(cancelled)) {
+			ok = false;
+			break;
+		}
+
+		// a synchronous handle still takes the position from the OVERLAPPED
+		OVERLAPPED overlapped{};
+		overlapped.Offset = (DWORD)(start + offset);
+		overlapped.OffsetHigh = (DWORD)((start + offset) >> 32);
+		DWORD chunk = (DWORD)std::min(READ_CHUNK, bytes.size() - offset);
+		DWORD read = 0;
+		ok = ReadFile(file, bytes.data() + offset, chunk, &read, &overlapped) && read > 0;
+		offset += read;
+	}
+	CloseHandle(file);
+	return ok;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || start > (uint64_t)info.st_size) {
+		close(fd);
+		return false;
+	}
+	bytes.resize(clampRange((uint64_t)info.st_size, start, size));
+	posix_fadvise(fd, (off_t)start, (off_t)bytes.size(), POSIX_FADV_SEQUENTIAL);
+
+	bool ok = true;
+	for (size_t offset = 0; offset < bytes.size() && ok; ) {
+		if (isCancelled(cancelled)) {
+			ok = false;
+			break;
+		}
+
+		ssize_t read = pread(fd, bytes.data() + offset, std::min(READ_CHUNK, bytes.size() - offset), (off_t)(start + offset));
+		if (read < 0 && errno == EINTR) continue;
+		ok = read > 0;
+		if (ok) offset += (size_t)read;
+	}
+	close(fd);
+	return ok;
+#endif
+}
+
+VfsFile::VfsFile(std::vector<uint8_t> b)
+	: size(b.size()), bytes(std::move(b))
+{
+	data = bytes.data();
+}
+
+const uint8_t* VfsFile::getData() const
+{
+	return data;
+}
+
+size_t VfsFile::getSize() const
+{
+	return size;
+}
+
+void VirtualFileSystem::mountDirectory(const std::string& directory, const std::string& mountPoint)
+{
+	Mount mount;
+	mount.mountPoint = normalize(mountPoint);
+	mount.directory = directory.empty() ? "." : directory;
+	mounts.push_back(std::move(mount));
+}
+
+void VirtualFileSystem::mountArchive(const std::string& path, const std::string& mountPoint)
+{
+	Mount mount;
+	mount.mountPoint = normalize(mountPoint);
+	mount.archive = std::make_unique<PackArchive>(path);
+	mounts.push_back(std::move(mount));
+}
+
+bool VirtualFileSystem::exists(const std::string& path) const
+{
+	std::string normalized = normalize(path);
+	for (auto mount = mounts.rbegin(); mount != mounts.rend(); mount++) {
+		std::string relative;
+		if (!resolve(*mount, normalized, relative)) continue;
+
+		if (mount->archive) {
+			if (mount->archive->find(relative)) return true;
+		}
+		else {
+			std::error_code error;
+			if (std::filesystem::is_regular_file(mount->directory + "/" + relative, error)) return true;
+		}
+	}
+	return false;
+}
+
+VfsFile VirtualFileSystem::open(const std::string& path) const
+{
+	std::string normalized = normalize(path);
+	for (auto mount = mounts.rbegin(); mount != mounts.rend(); mount++) {
+		std::string relative;
+		if (!resolve(*mount, normalized, relative)) continue;
+
+		VfsFile file;
+		if (mount->archive) {
+			const PackEntry* entry = mount->archive->find(relative);
+			if (!entry) continue;
+
+			file.size = (size_t)entry->size;
+			file.data = mount->archive->map(*entry);
+			if (!file.data) {
+				file.bytes.resize(file.size);
+				if (!mount->archive->read(*entry, 0, entry->size, file.bytes.data())) {
+					throw std::runtime_error("ERROR: " + normalized + " is corrupt in " + mount->archive->getPath() + "!");
+				}
+				file.data = file.bytes.data();
+			}
+			return file;
+		}
+
+		std::string full = mount->directory + "/" + relative;
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(full, error)) continue;
+
+		file.mapped = std::make_unique<MappedFile>(full);
+		file.data = file.mapped->getData();
+		file.size = file.mapped->getSize();
+		return file;
+	}
+
+	throw std::runtime_error("ERROR: Failed to open file " + path);
+}
+
+bool VirtualFileSystem::read(const std::string& path, std::vector<uint8_t>& bytes, const std::function<bool()>& cancelled) const
+{
+	return read(path, 0, WHOLE_FILE, bytes, cancelled);
+}
+
+bool VirtualFileSystem::read(const std::string& path, uint64_t start, uint64_t size, std::vector<uint8_t>& bytes, const std::function<bool()>& cancelled) const
+{
+	std::string normalized = normalize(path);
+	for (auto mount = mounts.rbegin(); mount != mounts.rend(); mount++) {
+		std::string relative;
+		if (!resolve(*mount, normalized, relative)) continue;
+
+		if (!mount->archive) {
+			// a failed open is the only lookup, no separate stat
+			if (readLooseFile(mount->directory + "/" + relative, start, size, bytes, cancelled)) return true;
+			if (isCancelled(cancelled)) return false;
+			continue;
+		}
+
+		const PackEntry* entry = mount->archive->find(relative);
+		if (!entry) continue;
+
+		if (start > entry->size) return false;
+
+		bytes.resize(clampRange(entry->size, start, size));
+		for (uint64_t offset = 0; offset < bytes.size(); offset += READ_CHUNK) {
+			if (isCancelled(cancelled)) return false;
+			uint64_t chunk = std::min<uint64_t>(READ_CHUNK, bytes.size() - offset);
+			if (!mount->archive->read(*entry, start + offset, chunk, bytes.data() + offset)) return false;
+		}
+		return true;
+	}
+	return false;
+}
+
+std::string VirtualFileSystem::normalize(const std::string& path)
+{
+	std::vector<std::string> components;
+	size_t start = 0;
+	while (start <= path.size()) {
+		size_t end = path.find_first_of("/\\", start);
+		if (end == std::string::npos) end = path.size();
+
+		std::string component = path.substr(start, end - start);
+		if (component == "..") {
+			if (!components.empty() && components.back() != "..") components.pop_back();
+			else components.push_back(component);
+		}
+		else if (!component.empty() && component != ".") {
+			components.push_back(component);
+		}
+		start = end + 1;
+	}
+
+	std::string result;
+	for (const std::string& component : components) {
+		if (!result.empty()) result += '/';
+		result += component;
+	}
+	return result;
+}
+
+bool VirtualFileSystem::resolve(const Mount& mount, const std::string& path, std::string& result)
+{
+	if (mount.mountPoint.empty()) {
+		result = path;
+		return true;
+	}
+
+	if (path.compare(0, mount.mountPoint.size(), mount.mountPoint) != 0) return false;
+	if (path.size() == mount.mountPoint.size() || path[mount.mountPoint.size()] != '/') return false;
+
+	result = path.substr(mount.mountPoint.size() + 1);
+	return true;
+}
@@ -0,0 +1,79 @@
+#ifndef VIRTUAL_FILE_SYSTEM_H
+#define VIRTUAL_FILE_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PackArchive.h"
+
+// a file opened through the VirtualFileSystem. Loose files and stored archive entries are
+// mapped in place, compressed entries are decompressed into memory it owns
+class VfsFile {
+public:
+	VfsFile() = default;
+	// takes over bytes read some other way, e.g. by the AssetStreamer
+	explicit VfsFile(std::vector<uint8_t> b);
+
+	const uint8_t* getData() const;
+	size_t getSize() const;
+
+private:
+	friend class VirtualFileSystem;
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	std::unique_ptr<MappedFile> mapped;
+	std::vector<uint8_t> bytes;
+};
+
+// one namespace of files over loose directories and pack archives. Later mounts shadow earlier
+// ones, so a patch archive mounted last overrides the base game, and a shipping build that
+// mounts its archive after the working directory never stats a loose file for what it packs.
+// Mount everything before loading starts, lookups don't lock and may run on any thread.
+//
+//    vfs.mountDirectory(".");
+//    vfs.mountArchive("data.pak");
+//    VfsFile mesh = vfs.open("cooked/rock.mesh");
+class VirtualFileSystem {
+public:
+	// size for reads up to the end of the file
+	static const uint64_t WHOLE_FILE = ~0ull;
+
+	// mountPoint is the prefix paths below directory are looked up with, "" for the root
+	void mountDirectory(const std::string& directory, const std::string& mountPoint = "");
+	// throws if the archive can't be opened, archives stay mapped until the VirtualFileSystem is gone
+	void mountArchive(const std::string& path, const std::string& mountPoint = "");
+
+	bool exists(const std::string& path) const;
+	// throws if no mount has the file. The result may point into a mounted archive
+	VfsFile open(const std::string& path) const;
+	// the whole file into bytes, for when it has to be owned anyway. False if no mount has it,
+	// it can't be read or cancelled returned true, which is checked between chunks
+	bool read(const std::string& path, std::vector<uint8_t>& bytes, const std::function<bool()>& cancelled = nullptr) const;
+	// size bytes from start (fewer if the file ends first), e.g. single mip levels out of a
+	// texture. False as above or if the file is shorter than start
+	bool read(const std::string& path, uint64_t start, uint64_t size, std::vector<uint8_t>& bytes, const std::function<bool()>& cancelled = nullptr) const;
+
+	// forward slashes without "." or empty components, what archives are indexed by
+	static std::string normalize(const std::string& path);
+
+private:
+	struct Mount {
+		std::string mountPoint;
+		std::string directory;
+		// nullptr for directories
+		std::unique_ptr<PackArchive> archive;
+	};
+
+	// path below mount, false if path isn't inside the mount point
+	static bool resolve(const Mount& mount, const std::string& path, std::string& result);
+
+	std::vector<Mount> mounts;
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include "WorldCooker.h"
+#include "Hash.h"
+#include "SceneCooker.h"
+#include "../Ecs/Component.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+uint64_t WorldCooker::hashSettings(const Settings& settings)
+{
+	uint32_t values[7] = { COOKER_VERSION, WORLD_VERSION, 0, settings.buildHlod, 0, 0, settings.hlod.tileSize };
+	memcpy(&values[2], &settings.cellSize, sizeof(float));
+	memcpy(&values[4], &settings.hlod.reduction, sizeof(float));
+	memcpy(&values[5], &settings.hlod.maxError, sizeof(float));
+	return Hash::combine(Hash::compute(values, sizeof(values)), SceneCooker::hashSettings(settings.mesh));
+}
+
+static uint64_t alignSection(uint64_t offset)
+{
+	return (offset + WORLD_SECTION_ALIGNMENT - 1) & ~(uint64_t)(WORLD_SECTION_ALIGNMENT - 1);
+}
+
+static glm::mat4 localMatrix(const MeshCooker::CookedNode& node)
+{
+	glm::quat rotation(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
+	return glm::translate(glm::mat4(1.0f), glm::vec3(node.position[0], node.position[1], node.position[2]))
+		* glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+}
+
+struct Bounds {
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+	void add(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	void add(const Bounds& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+	bool isEmpty() const { return min.x > max.x; }
+};
+
+// the submeshes' boxes in world space, corners transformed so rotated boxes stay covered
+static Bounds drawnBounds(const MeshCooker::CookedMesh& mesh, const std::vector<uint32_t>& submeshes, const glm::mat4& world)
+{
+	Bounds bounds;
+	for (uint32_t s : submeshes) {
+		const MeshSubmesh& submesh = mesh.submeshes[s];
+		for (uint32_t corner = 0; corner < 8; corner++) {
+			glm::vec3 local((corner & 1) ? submesh.aabbMax[0] : submesh.aabbMin[0],
+				(corner & 2) ? submesh.aabbMax[1] : submesh.aabbMin[1],
+				(corner & 4) ? submesh.aabbMax[2] : submesh.aabbMin[2]);
+			bounds.add(glm::vec3(world * glm::vec4(local, 1.0f)));
+		}
+	}
+	return bounds;
+}
+
+// a subtree going into one cell, or the submeshes of the last wrapper node when node is NO_PARENT
+struct CellObject {
+	uint32_t node;
+	Bounds bounds;
+};
+
+struct CookCell {
+	std::vector<CellObject> objects;
+	Bounds bounds;
+};
+
+// the cell's submeshes with where they end up, the input of its HLOD proxy
+static std::vector<HlodBuilder::Instance> cellInstances(const MeshCooker::CookedMesh& mesh, const CookCell& cell, uint32_t split,
+	const std::vector<uint32_t>& end, const std::vector<glm::mat4>& world)
+{
+	std::vector<HlodBuilder::Instance> instances;
+	for (const CellObject& object : cell.objects) {
+		uint32_t first = object.node == MeshCooker::NO_PARENT ? split : object.node;
+		uint32_t last = object.node == MeshCooker::NO_PARENT ? split + 1 : end[object.node];
+		for (uint32_t n = first; n < last; n++) {
+			for (uint32_t submesh : mesh.nodes[n].submeshes) instances.push_back({ submesh, world[n] });
+		}
+	}
+	return instances;
+}
+
+static void writeFile(const std::string& output, const std::vector<uint8_t>& file)
+{
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("ERROR: Failed to open " + output + " for writing!");
+	}
+	out.write((const char*)file.data(), file.size());
+	if (!out.good()) {
+		throw std::runtime_error("ERROR: Failed to write " + output + "!");
+	}
+}
+
+void WorldCooker::write(const MeshCooker::CookedMesh& mesh, const std::string& output, const Settings& settings)
+{
+	float cellSize = settings.cellSize;
+	const std::vector<MeshCooker::CookedNode>& nodes = mesh.nodes;
+	if (nodes.empty()) {
+		throw std::runtime_error("ERROR: Worlds need meshes imported without baked transforms!");
+	}
+	if (!(cellSize > 0.0f)) {
+		throw std::runtime_error("ERROR: World cell size must be positive!");
+	}
+
+	std::filesystem::path outputPath(output);
+	std::string stem = outputPath.stem().string();
+	std::string meshName = stem + ".mesh";
+	MeshCooker::write(mesh, (outputPath.parent_path() / meshName).string());
+
+	// nodes are in preorder, so a subtree is the range [n, end[n]) and is finished before its parent
+	uint32_t count = (uint32_t)nodes.size();
+	std::vector<uint32_t> end(count);
+	std::vector<uint32_t> children(count, 0);
+	std::vector<glm::mat4> world(count);
+	std::vector<Bounds> bounds(count);
+	for (uint32_t n = 0; n < count; n++) {
+		end[n] = n + 1;
+		world[n] = nodes[n].parent == MeshCooker::NO_PARENT ? localMatrix(nodes[n]) : world[nodes[n].parent] * localMatrix(nodes[n]);
+		if (nodes[n].parent != MeshCooker::NO_PARENT) children[nodes[n].parent]++;
+	}
+	for (uint32_t n = count; n-- > 0;) {
+		bounds[n].add(drawnBounds(mesh, nodes[n].submeshes, world[n]));
+		if (bounds[n].isEmpty()) bounds[n].add(glm::vec3(world[n][3]));
+		uint32_t parent = nodes[n].parent;
+		if (parent != MeshCooker::NO_PARENT) {
+			end[parent] = std::max(end[parent], end[n]);
+			bounds[parent].add(bounds[n]);
+		}
+	}
+
+	// wrappers go into every cell, the nodes below the last one are what gets distributed
+	uint32_t split = 0;
+	while (nodes[split].submeshes.empty() && children[split] == 1) split++;
+
+	std::map<std::pair<int32_t, int32_t>, CookCell> cells;
+	auto place = [&](uint32_t node, const Bounds& objectBounds) {
+		glm::vec3 center = (objectBounds.min + objectBounds.max) * 0.5f;
+		std::pair<int32_t, int32_t> key((int32_t)std::floor(center.x / cellSize), (int32_t)std::floor(center.z / cellSize));
+		CookCell& cell = cells[key];
+		cell.objects.push_back({ node, objectBounds });
+		cell.bounds.add(objectBounds);
+	};
+
+	if (!nodes[split].submeshes.empty()) {
+		place(MeshCooker::NO_PARENT, drawnBounds(mesh, nodes[split].submeshes, world[split]));
+	}
+	for (uint32_t n = split + 1; n < end[split]; n = end[n]) {
+		place(n, bounds[n]);
+	}
+	// nothing below the wrappers, the world is a single cell of just them
+	if (cells.empty()) cells[std::make_pair(0, 0)].bounds.add(bounds[split]);
+
+	// the proxies share one mesh, each with its own atlas
+	MeshCooker::CookedMesh proxy;
+	proxy.vertexFormat = mesh.vertexFormat;
+	std::string proxyName = stem + ".hlod.mesh";
+
+	std::vector<WorldCell> worldCells;
+	std::vector<char> strings;
+	for (const auto& entry : cells) {
+		const CookCell& cell = entry.second;
+
+		std::vector<MeshCooker::CookedNode> cellNodes(nodes.begin(), nodes.begin() + split + 1);
+		for (MeshCooker::CookedNode& wrapper : cellNodes) wrapper.submeshes.clear();
+
+		for (const CellObject& object : cell.objects) {
+			if (object.node == MeshCooker::NO_PARENT) {
+				MeshCooker::CookedNode drawn = nodes[split];
+				drawn.parent = split;
+				float identity[10] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+				memcpy(drawn.position, identity, sizeof(drawn.position));
+				memcpy(drawn.rotation, identity + 3, sizeof(drawn.rotation));
+				memcpy(drawn.scale, identity + 7, sizeof(drawn.scale));
+				cellNodes.push_back(drawn);
+				continue;
+			}
+
+			// the subtree keeps its order, parents shift by where it starts in the cell
+			uint32_t base = (uint32_t)cellNodes.size();
+			for (uint32_t n = object.node; n < end[object.node]; n++) {
+				MeshCooker::CookedNode node = nodes[n];
+				node.parent = n == object.node ? split : base + (node.parent - object.node);
+				cellNodes.push_back(node);
+			}
+		}
+
+		std::string cellStem = stem + "." + std::to_string(entry.first.first) + "_" + std::to_string(entry.first.second);
+		std::string cellName = cellStem + ".scene";
+		SceneFileHeader scene = SceneCooker::writeNodes(cellNodes, meshName, (outputPath.parent_path() / cellName).string());
+
+		WorldCell worldCell{};
+		worldCell.x = entry.first.first;
+		worldCell.z = entry.first.second;
+		for (int i = 0; i < 3; i++) {
+			worldCell.aabbMin[i] = cell.bounds.min[i];
+			worldCell.aabbMax[i] = cell.bounds.max[i];
+		}
+		worldCell.path = (uint32_t)strings.size();
+		worldCell.entityCount = scene.entityCount;
+		// the file stays loaded for as long as the cell, the chunks are what the entities take
+		worldCell.memorySize = scene.fileSize + (scene.stringOffset - scene.chunkOffset) + (uint64_t)scene.entityCount * sizeof(Entity);
+		worldCell.proxySubmesh = WORLD_NO_PROXY;
+
+		std::vector<HlodBuilder::Instance> instances = cellInstances(mesh, cell, split, end, world);
+		if (settings.buildHlod && !instances.empty()) {
+			Bitmap atlas;
+			std::string atlasName = cellStem + ".hlod.tga";
+			worldCell.proxySubmesh = HlodBuilder::build(mesh, instances, atlasName, settings.hlod, proxy, atlas);
+			writeFile((outputPath.parent_path() / atlasName).string(), ImageDecoder::encodeTga(atlas));
+		}
+
+		worldCells.push_back(worldCell);
+		strings.insert(strings.end(), cellName.c_str(), cellName.c_str() + cellName.size() + 1);
+	}
+
+	uint32_t proxyMesh = WORLD_NO_PROXY;
+	if (!proxy.submeshes.empty()) {
+		MeshCooker::write(proxy, (outputPath.parent_path() / proxyName).string());
+		proxyMesh = (uint32_t)strings.size();
+		strings.insert(strings.end(), proxyName.c_str(), proxyName.c_str() + proxyName.size() + 1);
+	}
+
+	WorldFileHeader header{};
+	header.magic = WORLD_MAGIC;
+	header.version = WORLD_VERSION;
+	header.cellSize = cellSize;
+	header.cellCount = (uint32_t)worldCells.size();
+	header.stringTableSize = (uint32_t)strings.size();
+	header.proxyMesh = proxyMesh;
+	header.cellOffset = alignSection(sizeof(WorldFileHeader));
+	header.stringOffset = alignSection(header.cellOffset + worldCells.size() * sizeof(WorldCell));
+	header.fileSize = header.stringOffset + strings.size();
+
+	std::vector<uint8_t> file(header.fileSize, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + header.cellOffset, worldCells.data(), worldCells.size() * sizeof(WorldCell));
+	memcpy(file.data() + header.stringOffset, strings.data(), strings.size());
+	writeFile(output, file);
+}
+
+void WorldCooker::cook(const std::string& source, const std::string& output, const Settings& settings)
+{
+	MeshCooker::CookedMesh mesh = MeshCooker::import(source, SceneCooker::meshSettings(settings.mesh));
+	write(mesh, output, settings);
+
+	std::cout << "Cooked " << source << " -> " << output << " (" << mesh.nodes.size() << " nodes, "
+		<< mesh.submeshes.size() << " submeshes, cells of " << settings.cellSize << " units)\n";
+}
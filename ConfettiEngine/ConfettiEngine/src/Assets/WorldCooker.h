@@ -0,0 +1,40 @@
+#ifndef WORLD_COOKER_H
+#define WORLD_COOKER_H
+
+#include <cstdint>
+#include <string>
+
+#include "HlodBuilder.h"
+#include "MeshCooker.h"
+#include "WorldFormat.h"
+
+// offline conversion of an assimp scene into a partitioned world, see WorldFormat.h.
+// The hierarchy is split below the root: wrapper nodes on the way down (a single child and
+// nothing drawn, what most exporters put on top) are copied into every cell, each node under
+// them goes with its whole subtree into the cell holding the center of its bounds. Every
+// source mesh is cooked once into <output stem>.mesh, cells into <output stem>.<x>_<z>.scene,
+// all next to output. Every cell also gets an HLOD proxy, a submesh of <output stem>.hlod.mesh
+// textured by <output stem>.<x>_<z>.hlod.tga, see HlodBuilder
+namespace WorldCooker {
+	// bump whenever the code changes what ends up in the files
+	const uint32_t COOKER_VERSION = 2;
+
+	struct Settings {
+		// transforms are never baked, see SceneCooker::meshSettings
+		MeshCooker::Settings mesh;
+		// edge length of a cell in world units, after MeshCooker::Settings::scale
+		float cellSize = 64.0f;
+		bool buildHlod = true;
+		HlodBuilder::Settings hlod;
+	};
+
+	uint64_t hashSettings(const Settings& settings);
+
+	// mesh must come from MeshCooker::import with SceneCooker::meshSettings
+	void write(const MeshCooker::CookedMesh& mesh, const std::string& output, const Settings& settings);
+
+	// import + write, throws on failure
+	void cook(const std::string& source, const std::string& output, const Settings& settings);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef WORLD_FORMAT_H
+#define WORLD_FORMAT_H
+
+#include <cstdint>
+
+// index of a partitioned world, written by WorldCooker and streamed by WorldPartition.
+// The world is cut into square cells on the XZ plane, each cell is a cooked scene of its own
+// (SceneFormat.h) next to the index, all of them placing submeshes of one shared mesh. Only
+// cells holding something are listed. Every cell is also an HLOD cluster: the proxy mesh
+// holds a merged, simplified submesh per cell in world space (see HlodBuilder) that stands in
+// for the cell's entities at a distance. Everything is little endian.
+//
+// [WorldFileHeader][WorldCell * cellCount][string table]
+
+static const uint32_t WORLD_MAGIC = 0x44574643; // "CFWD"
+// bump whenever any struct below changes
+static const uint32_t WORLD_VERSION = 2;
+static const uint32_t WORLD_SECTION_ALIGNMENT = 16;
+static const uint32_t WORLD_NO_PROXY = 0xFFFFFFFF;
+
+struct WorldCell {
+	// grid coordinates, the cell covers [x, x + 1) * cellSize on X and the same on Z
+	int32_t x;
+	int32_t z;
+	// world space bounds of what the cell places, can reach past the cell's square
+	float aabbMin[3];
+	float aabbMax[3];
+	// string table offset of the cell's scene, relative to the index
+	uint32_t path;
+	uint32_t entityCount;
+	// bytes the cell costs while loaded, the scene file plus its entities' chunks
+	uint64_t memorySize;
+	// submesh of the proxy mesh or WORLD_NO_PROXY
+	uint32_t proxySubmesh;
+	uint32_t pad;
+};
+
+struct WorldFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	float cellSize;
+	uint32_t cellCount;
+	uint32_t stringTableSize;
+	// string table offset of the proxy mesh, relative to the index, or WORLD_NO_PROXY
+	uint32_t proxyMesh;
+	uint64_t cellOffset;
+	uint64_t stringOffset;
+	// total file size, catches truncated files
+	uint64_t fileSize;
+};
+
+static_assert(sizeof(WorldCell) == 56, "WorldCell layout changed, bump WORLD_VERSION");
+static_assert(sizeof(WorldFileHeader) == 48, "WorldFileHeader layout changed, bump WORLD_VERSION");
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+namespace Buffer {
+	// finds a memory type on the physical device matching both the buffer's requirements and the requested properties
+	uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+	void create(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory);
+
+	void destroy(VkDevice device, VkBuffer& buffer, VkDeviceMemory& memory);
+};
+
+#endif
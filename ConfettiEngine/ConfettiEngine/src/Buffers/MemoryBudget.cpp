@@ -0,0 +1,48 @@
+#include "MemoryBudget.h"
+#include <iostream>
+
+MemoryBudget::MemoryBudget(VkInstance instance, VkPhysicalDevice p, bool extensionEnabled)
+	: physicalDevice(p)
+{
+	if (extensionEnabled) {
+		getProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+	}
+
+	Heap heap = query();
+	std::cout << "Memory Budget created (" << (heap.budget >> 20) << " of " << (heap.size >> 20) << " MB device local"
+		<< (isExact() ? "" : ", estimated") << ")\n";
+}
+
+MemoryBudget::Heap MemoryBudget::query() const
+{
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+	budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	VkPhysicalDeviceMemoryProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	properties.pNext = &budget;
+
+	if (getProperties2) getProperties2(physicalDevice, &properties);
+	else vkGetPhysicalDeviceMemoryProperties(physicalDevice, &properties.memoryProperties);
+
+	Heap heap;
+	const VkPhysicalDeviceMemoryProperties& memory = properties.memoryProperties;
+	for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+		if (!(memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+
+		heap.size += memory.memoryHeaps[i].size;
+		if (getProperties2) {
+			heap.budget += budget.heapBudget[i];
+			heap.usage += budget.heapUsage[i];
+		}
+		else {
+			heap.budget += (VkDeviceSize)(memory.memoryHeaps[i].size * FALLBACK_HEAP_SHARE);
+		}
+	}
+	return heap;
+}
+
+bool MemoryBudget::isExact() const
+{
+	return getProperties2 != nullptr;
+}
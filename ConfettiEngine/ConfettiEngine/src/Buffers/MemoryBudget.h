@@ -0,0 +1,35 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// how much device local memory the process may use and how much it does, summed over the
+// device local heaps. With VK_EXT_memory_budget these are the driver's live numbers, which
+// account for other processes and everything the driver allocated behind our back. Without it
+// the budget is a fixed share of the heaps and usage is unknown (0), callers add their own.
+// The instance needs VK_KHR_get_physical_device_properties2 for the extension path
+class MemoryBudget {
+public:
+	// share of the heap size assumed available when the driver can't tell
+	const float FALLBACK_HEAP_SHARE = 0.5f;
+
+	struct Heap {
+		VkDeviceSize size = 0;
+		VkDeviceSize budget = 0;
+		VkDeviceSize usage = 0;
+	};
+
+	// extensionEnabled is whether VK_EXT_memory_budget was enabled on the device
+	MemoryBudget(VkInstance instance, VkPhysicalDevice physicalDevice, bool extensionEnabled);
+
+	// cheap enough to call every frame, the values can change any time
+	Heap query() const;
+	bool isExact() const;
+
+private:
+	VkPhysicalDevice physicalDevice;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getProperties2 = nullptr;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "StagingRing.h"
+#include "Buffer.h"
+
+// copies out of the ring never need more, keeps every physical offset aligned after a wrap
+static const VkDeviceSize RING_GRANULARITY = 256;
+
+StagingRing::StagingRing(VkPhysicalDevice& p, VkDevice& d, VkDeviceSize s)
+	: device(d), size((s + RING_GRANULARITY - 1) & ~(RING_GRANULARITY - 1))
+{
+	Buffer::create(p, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+	vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, (void**)&mapped);
+}
+
+StagingRing::~StagingRing()
+{
+	vkUnmapMemory(device, memory);
+	Buffer::destroy(device, buffer, memory);
+}
+
+VkDeviceSize StagingRing::alignedHead(VkDeviceSize bytes, VkDeviceSize alignment) const
+{
+	VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+	// doesn't fit before the end of the buffer, skip to the start
+	if (offset % size + bytes > size) offset = (offset / size + 1) * size;
+	return offset;
+}
+
+uint8_t* StagingRing::allocate(VkDeviceSize bytes, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	if (bytes == 0 || bytes > size) return nullptr;
+
+	VkDeviceSize start = alignedHead(bytes, alignment);
+	if (start + bytes - tail > size) return nullptr;
+
+	head = start + bytes;
+	offset = start % size;
+	return mapped + offset;
+}
+
+VkDeviceSize StagingRing::available(VkDeviceSize alignment) const
+{
+	VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+	if (offset - tail >= size) return 0;
+	VkDeviceSize free = size - (offset - tail);
+
+	// contiguous space up to the end of the buffer, or from the start after a wrap
+	VkDeviceSize toEnd = size - offset % size;
+	if (free <= toEnd) return free;
+	VkDeviceSize fromStart = free - toEnd;
+	return toEnd > fromStart ? toEnd : fromStart;
+}
+
+void StagingRing::endFrame(uint64_t frame)
+{
+	if (!frames.empty() && frames.back().end == head) return;
+	frames.push_back({ frame, head });
+}
+
+void StagingRing::retire(uint64_t completedFrame)
+{
+	while (!frames.empty() && frames.front().frame <= completedFrame) {
+		tail = frames.front().end;
+		frames.pop_front();
+	}
+}
+
+VkBuffer StagingRing::getBuffer() const
+{
+	return buffer;
+}
+
+VkDeviceSize StagingRing::getSize() const
+{
+	return size;
+}
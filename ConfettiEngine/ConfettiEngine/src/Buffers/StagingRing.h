@@ -0,0 +1,56 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include <cstdint>
+#include <deque>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// persistently mapped upload buffer handed out front to back. Allocations are tagged with the
+// frame that copies out of them and their space comes back once that frame has finished on
+// the GPU, so the ring never waits on the device itself, it only runs out of room.
+// Offsets grow forever and wrap inside the buffer, an allocation never straddles the end.
+class StagingRing {
+public:
+	StagingRing(VkPhysicalDevice& p, VkDevice& d, VkDeviceSize s);
+	~StagingRing();
+
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	// bytes at alignment (a power of two up to 256), nullptr while the ring is full.
+	// offset receives the position inside getBuffer() for the copy
+	uint8_t* allocate(VkDeviceSize bytes, VkDeviceSize alignment, VkDeviceSize& offset);
+	// largest allocation that would currently succeed
+	VkDeviceSize available(VkDeviceSize alignment) const;
+
+	// everything allocated since the last call is read by frame
+	void endFrame(uint64_t frame);
+	// frees the space of every frame up to and including completedFrame
+	void retire(uint64_t completedFrame);
+
+	VkBuffer getBuffer() const;
+	VkDeviceSize getSize() const;
+
+private:
+	VkDeviceSize alignedHead(VkDeviceSize bytes, VkDeviceSize alignment) const;
+
+	VkDevice& device;
+
+	VkDeviceSize size;
+	// virtual offsets, the physical one is modulo size
+	VkDeviceSize head = 0;
+	VkDeviceSize tail = 0;
+
+	struct Frame {
+		uint64_t frame;
+		VkDeviceSize end;
+	};
+	std::deque<Frame> frames;
+
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+};
+
+#endif
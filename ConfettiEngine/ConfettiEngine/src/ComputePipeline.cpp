@@ -0,0 +1,97 @@
+#include "ComputePipeline.h"
+#include "Shaders/Shader.h"
+#include <iostream>
+
+ComputePipeline::ComputePipeline(VkDevice& d, std::string c, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t pushConstantSize)
+	: device(d)
+{
+	//************* DESCRIPTOR LAYOUT *************//
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create compute descriptor set layout!");
+	}
+
+	//************* PIPELINE LAYOUT *************//
+	// push constants are the cheapest way to hand small per-dispatch data (planes, counts) to the shader
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create compute pipeline layout!");
+	}
+
+	//************* PIPELINE CREATION *************//
+	std::vector<char> compCode = Shader::read(c);
+	VkShaderModule comp = createModule(compCode);
+
+	VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+	compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compShaderStageInfo.module = comp;
+	compShaderStageInfo.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = compShaderStageInfo;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+	pipelineInfo.basePipelineIndex = -1; // Optional
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create compute pipeline!");
+	}
+	else std::cout << "Compute Pipeline created successfully (" << c << ")\n";
+
+	//************* CLEANUP *************//
+	vkDestroyShaderModule(device, comp, nullptr);
+}
+
+ComputePipeline::~ComputePipeline()
+{
+	vkDestroyPipeline(device, computePipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+const VkPipelineLayout& ComputePipeline::getLayout()
+{
+	return pipelineLayout;
+}
+
+const VkDescriptorSetLayout& ComputePipeline::getSetLayout()
+{
+	return descriptorSetLayout;
+}
+
+const VkPipeline& ComputePipeline::getPipeline()
+{
+	return computePipeline;
+}
+
+VkShaderModule ComputePipeline::createModule(const std::vector<char>& code)
+{
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(&code[0]);
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create shader module!");
+	}
+
+	return shaderModule;
+}
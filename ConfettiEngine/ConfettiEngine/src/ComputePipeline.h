@@ -0,0 +1,31 @@
+#ifndef COMPUTE_PIPELINE_H
+#define COMPUTE_PIPELINE_H
+
+#include <vector>
+#include <string>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// single compute shader pipeline with one descriptor set and an optional push constant block
+class ComputePipeline {
+public:
+	ComputePipeline(VkDevice& d, std::string c, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t pushConstantSize);
+	~ComputePipeline();
+
+	const VkPipelineLayout& getLayout();
+	const VkDescriptorSetLayout& getSetLayout();
+	const VkPipeline& getPipeline();
+
+private:
+	VkShaderModule createModule(const std::vector<char>& code);
+
+	VkDescriptorSetLayout descriptorSetLayout;
+
+	VkPipelineLayout pipelineLayout;
+
+	VkPipeline computePipeline;
+
+	VkDevice& device;
+};
+
+#endif
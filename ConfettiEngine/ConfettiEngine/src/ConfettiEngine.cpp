@@ -5,9 +5,157 @@
 //#include <glm/gtx/string_cast.hpp>
 
 #include "Application.h"
+#include "Assets/AssetCooker.h"
+#include "Assets/MeshCooker.h"
+#include "Assets/PackBuilder.h"
+#include "Assets/SceneCooker.h"
+#include "Assets/WorldCooker.h"
+#include "Jobs/JobSystem.h"
 
-int main()
+// false (and value untouched) when text isn't a number, for the optional cook arguments
+static bool parseFloat(const char* text, float& value)
 {
+    try {
+        size_t used = 0;
+        float parsed = std::stof(text, &used);
+        if (text[used] != '\0') return false;
+        value = parsed;
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+// offline mode: ConfettiEngine --cook <source> <output> [scale]
+static int cook(int argc, char** argv)
+{
+    MeshCooker::Settings settings;
+    if (argc < 4 || (argc > 4 && !parseFloat(argv[4], settings.scale))) {
+        std::cerr << "usage: " << argv[0] << " --cook <source> <output> [scale]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        MeshCooker::cook(argv[2], argv[3], settings);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// offline mode: ConfettiEngine --cook-scene <source> <output> [scale]
+// keeps the node hierarchy, the meshes end up in <output stem>.mesh next to output
+static int cookScene(int argc, char** argv)
+{
+    MeshCooker::Settings settings;
+    if (argc < 4 || (argc > 4 && !parseFloat(argv[4], settings.scale))) {
+        std::cerr << "usage: " << argv[0] << " --cook-scene <source> <output> [scale]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        SceneCooker::cook(argv[2], argv[3], settings);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// offline mode: ConfettiEngine --cook-world <source> <output> [cell size] [scale]
+// splits the scene into streamable cells, written next to output with the mesh they share
+// and an HLOD proxy per cell
+static int cookWorld(int argc, char** argv)
+{
+    WorldCooker::Settings settings;
+    if (argc < 4 || (argc > 4 && !parseFloat(argv[4], settings.cellSize)) || (argc > 5 && !parseFloat(argv[5], settings.mesh.scale))) {
+        std::cerr << "usage: " << argv[0] << " --cook-world <source> <output> [cell size] [scale]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        WorldCooker::cook(argv[2], argv[3], settings);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// offline mode: ConfettiEngine --cook-all <source dir> <output dir> [scale]
+// cooks every mesh and texture below source dir that changed since the last run, tracked in <output dir>/manifest.txt
+static int cookAll(int argc, char** argv)
+{
+    MeshCooker::Settings settings;
+    if (argc < 4 || (argc > 4 && !parseFloat(argv[4], settings.scale))) {
+        std::cerr << "usage: " << argv[0] << " --cook-all <source dir> <output dir> [scale]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        JobSystem jobs;
+        AssetCooker cooker(jobs, std::string(argv[3]) + "/manifest.txt");
+        cooker.addMeshDirectory(argv[2], argv[3], settings);
+        cooker.addTextureDirectory(argv[2], argv[3], TextureCooker::Settings());
+        if (cooker.run().failed > 0) return EXIT_FAILURE;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// offline mode: ConfettiEngine --pack <directory> <output> [--store]
+// archives every file below directory, mount the result with VirtualFileSystem::mountArchive
+static int pack(int argc, char** argv)
+{
+    if (argc < 4) {
+        std::cerr << "usage: " << argv[0] << " --pack <directory> <output> [--store]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    PackBuilder::Settings settings;
+    if (argc > 4 && std::string(argv[4]) == "--store") settings.compress = false;
+
+    try {
+        PackBuilder::build(PackBuilder::gatherDirectory(argv[2]), argv[3], settings);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--cook") {
+        return cook(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--cook-scene") {
+        return cookScene(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--cook-world") {
+        return cookWorld(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--cook-all") {
+        return cookAll(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--pack") {
+        return pack(argc, argv);
+    }
+
     /* TESTING DEMO 
     std::cout << "Hello World!\n";
     vec3 potato(1, 2, 3);
@@ -0,0 +1,390 @@
+#include "ClusterCulling.h"
+#include "../Assets/MeshletBuilder.h"
+#include "../Buffers/Buffer.h"
+#include "../Shaders/Shader.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// workgroups per dispatch dimension every device supports
+static const uint32_t MAX_GROUPS_X = 65535;
+
+static const char* CLUSTER_CULL_SHADER = "./src/Shaders/clusterCull.comp.spv";
+static const char* CLUSTER_OCCLUSION_CULL_SHADER = "./src/Shaders/clusterOcclusionCull.comp.spv";
+
+// binding 0: instances, 1: meshes, 2: meshlets, 3: draw commands, 4: clusters, 5: draw count, 6: camera
+static const uint32_t CLUSTER_CULL_BINDINGS = 7;
+// binding 0: instances, 1: meshes, 2: meshlets, 3: meshlet vertices, 4: meshlet triangles, 5: vertices, 6: clusters
+static const uint32_t CLUSTER_DRAW_BINDINGS = 7;
+
+ClusterCulling::ClusterCulling(VkPhysicalDevice& p, VkDevice& d, GpuCulling& c, uint32_t maxMeshlet, uint32_t maxCluster, bool drawCount, bool multiDraw, bool meshShader)
+	: physicalDevice(p), device(d), culling(c), maxMeshlets(maxMeshlet), maxClusters(maxCluster),
+	drawIndirectCountSupported(drawCount), multiDrawIndirectSupported(multiDraw), meshShaderSupported(meshShader)
+{
+	// both extensions are 1.0 add-ons, so their commands have to be loaded manually
+	if (meshShaderSupported) {
+		cmdDrawMeshTasksIndirect = (PFN_vkCmdDrawMeshTasksIndirectNV)vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksIndirectNV");
+		meshShaderSupported = cmdDrawMeshTasksIndirect != nullptr;
+	}
+	if (drawIndirectCountSupported) {
+		cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+		drawIndirectCountSupported = cmdDrawIndexedIndirectCount != nullptr;
+	}
+
+	// the CPU doesn't know how many clusters survive, one call per slot would defeat the point
+	if (!meshShaderSupported && !drawIndirectCountSupported && !multiDrawIndirectSupported) {
+		throw std::runtime_error("ERROR: Cluster culling needs mesh shaders, indirect count or multi draw indirect!");
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings(CLUSTER_CULL_BINDINGS);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 6 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+
+	cullPipeline = new ComputePipeline(device, CLUSTER_CULL_SHADER, bindings, sizeof(ClusterConstants));
+
+	// binding 7: depth pyramid
+	VkDescriptorSetLayoutBinding pyramidBinding{};
+	pyramidBinding.binding = 7;
+	pyramidBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidBinding.descriptorCount = 1;
+	pyramidBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings.push_back(pyramidBinding);
+
+	occlusionPipeline = new ComputePipeline(device, CLUSTER_OCCLUSION_CULL_SHADER, bindings, sizeof(ClusterConstants));
+
+	// the draw side is the vertex shader without mesh shaders, it only touches bindings 0 and 1
+	std::vector<VkDescriptorSetLayoutBinding> drawBindings(CLUSTER_DRAW_BINDINGS);
+	for (uint32_t i = 0; i < drawBindings.size(); i++) {
+		drawBindings[i].binding = i;
+		drawBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		drawBindings[i].descriptorCount = 1;
+		drawBindings[i].stageFlags = meshShaderSupported ? VK_SHADER_STAGE_MESH_BIT_NV : VK_SHADER_STAGE_VERTEX_BIT;
+		drawBindings[i].pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = (uint32_t)drawBindings.size();
+	layoutInfo.pBindings = drawBindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &drawSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create cluster draw descriptor set layout!");
+	}
+
+	createBuffers();
+	createDescriptors();
+
+	std::cout << "Cluster Culling created (" << maxMeshlets << " meshlets, "
+		<< (meshShaderSupported ? "mesh shaders" : "indirect draws") << ")\n";
+}
+
+ClusterCulling::~ClusterCulling()
+{
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, drawSetLayout, nullptr);
+
+	vkUnmapMemory(device, meshletMemory);
+	vkUnmapMemory(device, meshletVertexMemory);
+	vkUnmapMemory(device, meshletTriangleMemory);
+
+	Buffer::destroy(device, meshletBuffer, meshletMemory);
+	Buffer::destroy(device, meshletVertexBuffer, meshletVertexMemory);
+	Buffer::destroy(device, meshletTriangleBuffer, meshletTriangleMemory);
+	Buffer::destroy(device, drawCommandBuffer, drawCommandMemory);
+	Buffer::destroy(device, clusterBuffer, clusterMemory);
+	Buffer::destroy(device, drawCountBuffer, drawCountMemory);
+
+	delete(occlusionPipeline);
+	delete(cullPipeline);
+}
+
+bool ClusterCulling::shadersAvailable()
+{
+	return Shader::exists(CLUSTER_CULL_SHADER) && Shader::exists(CLUSTER_OCCLUSION_CULL_SHADER);
+}
+
+uint32_t ClusterCulling::addMeshlets(const MeshMeshlet* meshlets, uint32_t count, const uint32_t* vertices, uint32_t vertexCount,
+	const uint32_t* triangles, uint32_t triangleCount, uint32_t indexBase)
+{
+	if (meshletCount + count > maxMeshlets
+		|| meshletVertexCount + vertexCount > maxMeshlets * MeshletBuilder::MAX_VERTICES
+		|| meshletTriangleCount + triangleCount > maxMeshlets * MeshletBuilder::MAX_TRIANGLES) {
+		throw std::runtime_error("ERROR: Cluster culling meshlet capacity exceeded!");
+	}
+
+	uint32_t first = meshletCount;
+	for (uint32_t i = 0; i < count; i++) {
+		MeshMeshlet& meshlet = mappedMeshlets[first + i];
+		meshlet = meshlets[i];
+		meshlet.vertexOffset += meshletVertexCount;
+		meshlet.triangleOffset += meshletTriangleCount;
+		meshlet.firstIndex += indexBase;
+	}
+
+	memcpy(mappedMeshletVertices + meshletVertexCount, vertices, vertexCount * sizeof(uint32_t));
+	memcpy(mappedMeshletTriangles + meshletTriangleCount, triangles, triangleCount * sizeof(uint32_t));
+
+	meshletCount += count;
+	meshletVertexCount += vertexCount;
+	meshletTriangleCount += triangleCount;
+	return first;
+}
+
+void ClusterCulling::setDepthPyramid(HiZPyramid* pyramid)
+{
+	depthPyramid = pyramid;
+	if (depthPyramid == nullptr) return;
+
+	VkDescriptorImageInfo pyramidInfo{};
+	pyramidInfo.sampler = depthPyramid->getSampler();
+	pyramidInfo.imageView = depthPyramid->getView();
+	pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = occlusionSet;
+	write.dstBinding = 7;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &pyramidInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void ClusterCulling::setVertexBuffer(VkBuffer buffer)
+{
+	VkDescriptorBufferInfo bufferInfo{ buffer, 0, VK_WHOLE_SIZE };
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = drawSet;
+	write.dstBinding = 5;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+bool ClusterCulling::usesMeshShader() const
+{
+	return meshShaderSupported;
+}
+
+void ClusterCulling::recordCull(VkCommandBuffer cmd)
+{
+	uint32_t instanceCount = culling.getInstanceCount();
+	if (instanceCount == 0 || meshletCount == 0) return;
+
+	ClusterConstants constants{};
+	constants.instanceCount = instanceCount;
+	constants.maxClusters = maxClusters;
+	constants.meshShader = meshShaderSupported;
+
+	VkPipelineStageFlags drawStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | (meshShaderSupported ? VK_PIPELINE_STAGE_MESH_SHADER_BIT_NV : 0);
+
+	// last frame's draws must be done with the list and count before they're rewritten
+	VkMemoryBarrier readToWrite{};
+	readToWrite.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	readToWrite.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	readToWrite.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmd, drawStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		1, &readToWrite, 0, nullptr, 0, nullptr);
+
+	vkCmdFillBuffer(cmd, drawCountBuffer, 0, VK_WHOLE_SIZE, 0);
+	// plain multi draw executes every slot, so the unused ones have to be no-ops
+	if (!meshShaderSupported && !drawIndirectCountSupported) {
+		vkCmdFillBuffer(cmd, drawCommandBuffer, 0, VK_WHOLE_SIZE, 0);
+	}
+
+	VkMemoryBarrier clearToCull{};
+	clearToCull.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearToCull.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearToCull.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &clearToCull, 0, nullptr, 0, nullptr);
+
+	ComputePipeline* pipeline = depthPyramid != nullptr ? occlusionPipeline : cullPipeline;
+	VkDescriptorSet set = depthPyramid != nullptr ? occlusionSet : cullSet;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getPipeline());
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getLayout(), 0, 1, &set, 0, nullptr);
+	vkCmdPushConstants(cmd, pipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterConstants), &constants);
+
+	// one workgroup per instance
+	uint32_t groupsX = std::min(instanceCount, MAX_GROUPS_X);
+	vkCmdDispatch(cmd, groupsX, (instanceCount + groupsX - 1) / groupsX, 1);
+
+	VkMemoryBarrier cullToDraw{};
+	cullToDraw.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullToDraw.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullToDraw.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, drawStages, 0,
+		1, &cullToDraw, 0, nullptr, 0, nullptr);
+}
+
+void ClusterCulling::recordDraw(VkCommandBuffer cmd)
+{
+	if (culling.getInstanceCount() == 0 || meshletCount == 0) return;
+
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (meshShaderSupported) {
+		// the count buffer doubles as the task command, one mesh workgroup per visible cluster
+		cmdDrawMeshTasksIndirect(cmd, drawCountBuffer, 0, 1, sizeof(VkDrawMeshTasksIndirectCommandNV));
+	}
+	else if (drawIndirectCountSupported) {
+		cmdDrawIndexedIndirectCount(cmd, drawCommandBuffer, 0, drawCountBuffer, 0, maxClusters, stride);
+	}
+	else {
+		vkCmdDrawIndexedIndirect(cmd, drawCommandBuffer, 0, maxClusters, stride);
+	}
+}
+
+const VkDescriptorSetLayout& ClusterCulling::getDrawSetLayout()
+{
+	return drawSetLayout;
+}
+
+const VkDescriptorSet& ClusterCulling::getDrawSet()
+{
+	return drawSet;
+}
+
+void ClusterCulling::createBuffers()
+{
+	Buffer::create(physicalDevice, device, sizeof(MeshMeshlet) * maxMeshlets,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		meshletBuffer, meshletMemory);
+	vkMapMemory(device, meshletMemory, 0, VK_WHOLE_SIZE, 0, (void**)&mappedMeshlets);
+
+	Buffer::create(physicalDevice, device, sizeof(uint32_t) * maxMeshlets * MeshletBuilder::MAX_VERTICES,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		meshletVertexBuffer, meshletVertexMemory);
+	vkMapMemory(device, meshletVertexMemory, 0, VK_WHOLE_SIZE, 0, (void**)&mappedMeshletVertices);
+
+	Buffer::create(physicalDevice, device, sizeof(uint32_t) * maxMeshlets * MeshletBuilder::MAX_TRIANGLES,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		meshletTriangleBuffer, meshletTriangleMemory);
+	vkMapMemory(device, meshletTriangleMemory, 0, VK_WHOLE_SIZE, 0, (void**)&mappedMeshletTriangles);
+
+	// only one of the two outputs is used, the other keeps a single slot so the descriptor stays valid
+	Buffer::create(physicalDevice, device, sizeof(VkDrawIndexedIndirectCommand) * (meshShaderSupported ? 1 : maxClusters),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		drawCommandBuffer, drawCommandMemory);
+
+	Buffer::create(physicalDevice, device, sizeof(uint32_t) * 2 * (meshShaderSupported ? maxClusters : 1),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		clusterBuffer, clusterMemory);
+
+	// sized for VkDrawMeshTasksIndirectCommandNV, firstTask stays zero
+	Buffer::create(physicalDevice, device, sizeof(uint32_t) * 2,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		drawCountBuffer, drawCountMemory);
+}
+
+void ClusterCulling::createDescriptors()
+{
+	VkDescriptorPoolSize poolSizes[3] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 12 + CLUSTER_DRAW_BINDINGS },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 3;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create cluster culling descriptor pool!");
+	}
+
+	VkDescriptorSetLayout layouts[3] = { cullPipeline->getSetLayout(), occlusionPipeline->getSetLayout(), drawSetLayout };
+	VkDescriptorSet sets[3];
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 3;
+	allocInfo.pSetLayouts = layouts;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to allocate cluster culling descriptor sets!");
+	}
+
+	cullSet = sets[0];
+	occlusionSet = sets[1];
+	drawSet = sets[2];
+
+	// the occlusion set's pyramid is written once one is set
+	writeBufferDescriptors(cullSet);
+	writeBufferDescriptors(occlusionSet);
+
+	// binding 5, the vertex buffer, comes from setVertexBuffer
+	VkDescriptorBufferInfo drawInfos[CLUSTER_DRAW_BINDINGS] = {
+		{ culling.getInstanceBuffer(), 0, VK_WHOLE_SIZE },
+		{ culling.getMeshBuffer(), 0, VK_WHOLE_SIZE },
+		{ meshletBuffer, 0, VK_WHOLE_SIZE },
+		{ meshletVertexBuffer, 0, VK_WHOLE_SIZE },
+		{ meshletTriangleBuffer, 0, VK_WHOLE_SIZE },
+		{ VK_NULL_HANDLE, 0, VK_WHOLE_SIZE },
+		{ clusterBuffer, 0, VK_WHOLE_SIZE }
+	};
+
+	std::vector<VkWriteDescriptorSet> writes;
+	for (uint32_t i = 0; i < CLUSTER_DRAW_BINDINGS; i++) {
+		if (i == 5) continue;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = drawSet;
+		write.dstBinding = i;
+		write.dstArrayElement = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.descriptorCount = 1;
+		write.pBufferInfo = &drawInfos[i];
+		writes.push_back(write);
+	}
+
+	vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+}
+
+void ClusterCulling::writeBufferDescriptors(VkDescriptorSet set)
+{
+	VkDescriptorBufferInfo bufferInfos[CLUSTER_CULL_BINDINGS] = {
+		{ culling.getInstanceBuffer(), 0, VK_WHOLE_SIZE },
+		{ culling.getMeshBuffer(), 0, VK_WHOLE_SIZE },
+		{ meshletBuffer, 0, VK_WHOLE_SIZE },
+		{ drawCommandBuffer, 0, VK_WHOLE_SIZE },
+		{ clusterBuffer, 0, VK_WHOLE_SIZE },
+		{ drawCountBuffer, 0, VK_WHOLE_SIZE },
+		{ culling.getUniformBuffer(), 0, VK_WHOLE_SIZE }
+	};
+
+	VkWriteDescriptorSet writes[CLUSTER_CULL_BINDINGS]{};
+	for (uint32_t i = 0; i < CLUSTER_CULL_BINDINGS; i++) {
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = set;
+		writes[i].dstBinding = i;
+		writes[i].dstArrayElement = 0;
+		writes[i].descriptorType = i == 6 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].descriptorCount = 1;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(device, CLUSTER_CULL_BINDINGS, writes, 0, nullptr);
+}
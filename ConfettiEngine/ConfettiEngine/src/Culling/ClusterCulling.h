@@ -0,0 +1,123 @@
+#ifndef CLUSTER_CULLING_H
+#define CLUSTER_CULLING_H
+
+#include <vector>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "../ComputePipeline.h"
+#include "../Assets/MeshFormat.h"
+#include "GpuCulling.h"
+#include "HiZPyramid.h"
+
+// push constants for the cluster cull dispatch
+struct ClusterConstants {
+	uint32_t instanceCount;
+	uint32_t maxClusters;
+	uint32_t meshShader;
+	uint32_t pad;
+};
+
+// per meshlet culling for meshes cooked with meshlets (MeshletBuilder). Shares the instance,
+// mesh and camera buffers of a GpuCulling, whose instance passes skip every mesh registered with
+// meshlets. A compute pass tests each meshlet of the visible instances against the frustum, its
+// normal cone and the depth pyramid, then the survivors are drawn either
+// - with VK_NV_mesh_shader: one vkCmdDrawMeshTasksIndirectNV, Shaders/meshlet.mesh draws one
+//   cluster per workgroup straight from the meshlet tables
+// - otherwise: one VkDrawIndexedIndirectCommand per cluster over the meshlet's index range, so
+//   gpuDriven.vert/gpuDrivenPacked.vert draw them exactly like whole instances
+//
+// Record the cull after GpuCulling has culled the early phase, with a pyramid set after it
+// was built from the early draws, and the draw in the render pass that follows:
+//   gpu.recordCull(LATE) -> clusters.recordCull -> render pass: gpu.recordDraw(LATE), clusters.recordDraw
+// The draw pipeline is created by the caller with getDrawSetLayout as set 0 and a mat4 view
+// projection push constant, the same interface the gpuDriven vertex shaders have.
+class ClusterCulling {
+public:
+	// throws when neither mesh shaders nor one of the indirect count/multi draw paths are available
+	ClusterCulling(VkPhysicalDevice& p, VkDevice& d, GpuCulling& c, uint32_t maxMeshlet, uint32_t maxCluster, bool drawCount, bool multiDraw, bool meshShader);
+	~ClusterCulling();
+
+	// false until clusterCull.comp and clusterOcclusionCull.comp are compiled (Shaders/compileTest.bat)
+	static bool shadersAvailable();
+
+	// copies a cooked mesh's meshlet tables (MeshAsset::getMeshlets etc.). indexBase is where the
+	// mesh's indices start in the shared index buffer. Returns the first meshlet for GpuCulling::addMesh
+	uint32_t addMeshlets(const MeshMeshlet* meshlets, uint32_t count, const uint32_t* vertices, uint32_t vertexCount,
+		const uint32_t* triangles, uint32_t triangleCount, uint32_t indexBase);
+
+	// enables the occlusion test, nullptr turns it back off
+	void setDepthPyramid(HiZPyramid* pyramid);
+	// the shared vertex buffer, mesh shaders fetch MeshPackedVertex from it as storage
+	void setVertexBuffer(VkBuffer buffer);
+
+	bool usesMeshShader() const;
+
+	// record outside of a render pass, after GpuCulling::recordCull(CULL_EARLY)
+	void recordCull(VkCommandBuffer cmd);
+	// record inside the render pass with the draw pipeline, getDrawSet and, without mesh
+	// shaders, the shared vertex/index buffers bound
+	void recordDraw(VkCommandBuffer cmd);
+
+	const VkDescriptorSetLayout& getDrawSetLayout();
+	const VkDescriptorSet& getDrawSet();
+
+private:
+	void createBuffers();
+	void createDescriptors();
+	void writeBufferDescriptors(VkDescriptorSet set);
+
+	VkPhysicalDevice& physicalDevice;
+	VkDevice& device;
+	GpuCulling& culling;
+
+	uint32_t maxMeshlets;
+	uint32_t maxClusters;
+	uint32_t meshletCount = 0;
+	uint32_t meshletVertexCount = 0;
+	uint32_t meshletTriangleCount = 0;
+
+	bool drawIndirectCountSupported;
+	bool multiDrawIndirectSupported;
+	bool meshShaderSupported;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+	PFN_vkCmdDrawMeshTasksIndirectNV cmdDrawMeshTasksIndirect = nullptr;
+
+	HiZPyramid* depthPyramid = nullptr;
+
+	ComputePipeline* cullPipeline;
+	ComputePipeline* occlusionPipeline;
+
+	// meshlet tables are written once per mesh by the CPU, so they stay host visible
+	VkBuffer meshletBuffer;
+	VkDeviceMemory meshletMemory;
+	MeshMeshlet* mappedMeshlets;
+
+	VkBuffer meshletVertexBuffer;
+	VkDeviceMemory meshletVertexMemory;
+	uint32_t* mappedMeshletVertices;
+
+	VkBuffer meshletTriangleBuffer;
+	VkDeviceMemory meshletTriangleMemory;
+	uint32_t* mappedMeshletTriangles;
+
+	// one indexed command per visible cluster, without mesh shaders
+	VkBuffer drawCommandBuffer;
+	VkDeviceMemory drawCommandMemory;
+
+	// instance id and meshlet index per visible cluster, with mesh shaders
+	VkBuffer clusterBuffer;
+	VkDeviceMemory clusterMemory;
+
+	// the indexed draw count, or a VkDrawMeshTasksIndirectCommandNV whose taskCount is the count
+	VkBuffer drawCountBuffer;
+	VkDeviceMemory drawCountMemory;
+
+	VkDescriptorSetLayout drawSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet cullSet;
+	VkDescriptorSet occlusionSet;
+	VkDescriptorSet drawSet;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// six planes pointing inwards, stored as (normal.xyz, distance)
+// order: left, right, bottom, top, near, far
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// Gribb/Hartmann plane extraction from a view-projection matrix
+	// glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+	static Frustum fromMatrix(const glm::mat4& m) {
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum f;
+		f.planes[0] = row3 + row0;
+		f.planes[1] = row3 - row0;
+		f.planes[2] = row3 + row1;
+		f.planes[3] = row3 - row1;
+#ifdef GLM_FORCE_DEPTH_ZERO_TO_ONE
+		// vulkan style clip space, near plane is z >= 0
+		f.planes[4] = row2;
+#else
+		f.planes[4] = row3 + row2;
+#endif
+		f.planes[5] = row3 - row2;
+
+		// normalise so distances are in world units, required for sphere tests
+		for (glm::vec4& p : f.planes) {
+			p /= glm::length(glm::vec3(p));
+		}
+
+		return f;
+	}
+
+	bool sphereVisible(const glm::vec3& center, float radius) const {
+		for (const glm::vec4& p : planes) {
+			if (glm::dot(glm::vec3(p), center) + p.w < -radius) return false;
+		}
+		return true;
+	}
+
+	// tests the corner furthest along each plane normal (the "positive vertex")
+	bool aabbVisible(const glm::vec3& min, const glm::vec3& max) const {
+		for (const glm::vec4& p : planes) {
+			glm::vec3 positive(p.x >= 0.0f ? max.x : min.x, p.y >= 0.0f ? max.y : min.y, p.z >= 0.0f ? max.z : min.z);
+			if (glm::dot(glm::vec3(p), positive) + p.w < 0.0f) return false;
+		}
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "FrustumCuller.h"
+#include "../Math/Simd.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// extent and radius of unused bounds, d - FLT_MAX is always behind the plane
+static const float CULLED = -std::numeric_limits<float>::max();
+
+FrustumCuller::FrustumCuller(JobSystem& j, BoundsType t)
+	: jobs(j), type(t), count(0)
+{
+}
+
+void FrustumCuller::resize(uint32_t c)
+{
+	count = c;
+	uint32_t padded = (count + Simd::WIDTH - 1) / Simd::WIDTH * Simd::WIDTH;
+
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+
+	if (type == BOUNDS_AABB) {
+		extentX.resize(padded, CULLED);
+		extentY.resize(padded, CULLED);
+		extentZ.resize(padded, CULLED);
+		// shrinking leaves stale bounds in the padding
+		std::fill(extentX.begin() + count, extentX.end(), CULLED);
+		std::fill(extentY.begin() + count, extentY.end(), CULLED);
+		std::fill(extentZ.begin() + count, extentZ.end(), CULLED);
+	}
+	else {
+		radius.resize(padded, CULLED);
+		std::fill(radius.begin() + count, radius.end(), CULLED);
+	}
+}
+
+uint32_t FrustumCuller::getCount() const
+{
+	return count;
+}
+
+void FrustumCuller::setAabb(uint32_t index, const glm::vec3& min, const glm::vec3& max)
+{
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extent = (max - min) * 0.5f;
+
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	extentX[index] = extent.x;
+	extentY[index] = extent.y;
+	extentZ[index] = extent.z;
+}
+
+void FrustumCuller::setSphere(uint32_t index, const glm::vec3& center, float r)
+{
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	radius[index] = r;
+}
+
+uint32_t FrustumCuller::cull(const glm::mat4& viewProj, std::vector<uint32_t>& visible)
+{
+	return cull(Frustum::fromMatrix(viewProj), visible);
+}
+
+template<bool AABB>
+uint32_t FrustumCuller::cullRange(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* out) const
+{
+	Simd::Float px[6], py[6], pz[6], pw[6];
+	Simd::Float ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++) {
+		px[p] = Simd::set1(frustum.planes[p].x);
+		py[p] = Simd::set1(frustum.planes[p].y);
+		pz[p] = Simd::set1(frustum.planes[p].z);
+		pw[p] = Simd::set1(frustum.planes[p].w);
+		ax[p] = Simd::set1(std::abs(frustum.planes[p].x));
+		ay[p] = Simd::set1(std::abs(frustum.planes[p].y));
+		az[p] = Simd::set1(std::abs(frustum.planes[p].z));
+	}
+
+	const Simd::Float zero = Simd::zero();
+	uint32_t written = 0;
+
+	for (uint32_t i = begin; i < end; i += Simd::WIDTH) {
+		Simd::Float cx = Simd::load(&centerX[i]);
+		Simd::Float cy = Simd::load(&centerY[i]);
+		Simd::Float cz = Simd::load(&centerZ[i]);
+
+		Simd::Float ex, ey, ez, r;
+		if (AABB) {
+			ex = Simd::load(&extentX[i]);
+			ey = Simd::load(&extentY[i]);
+			ez = Simd::load(&extentZ[i]);
+		}
+		else {
+			r = Simd::load(&radius[i]);
+		}
+
+		// smallest signed distance over the planes, one compare at the end instead of six.
+		// Each distance is split into two short chains so the multiply-adds overlap
+		Simd::Float closest = Simd::set1(std::numeric_limits<float>::max());
+		for (int p = 0; p < 6; p++) {
+			Simd::Float a = Simd::madd(px[p], cx, pw[p]);
+			Simd::Float b = Simd::mul(py[p], cy);
+			if (AABB) {
+				a = Simd::madd(ax[p], ex, a);
+				b = Simd::madd(ay[p], ey, b);
+				a = Simd::madd(az[p], ez, a);
+			}
+			else {
+				a = Simd::add(r, a);
+			}
+			b = Simd::madd(pz[p], cz, b);
+			closest = Simd::min(closest, Simd::add(a, b));
+		}
+
+		// most lanes are culled or most are visible, only mixed masks pay for compaction
+		int mask = Simd::moveMask(Simd::cmpge(closest, zero));
+		if (mask == 0) continue;
+
+		written += Simd::compress(mask, i, out + written);
+	}
+
+	return written;
+}
+
+uint32_t FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible)
+{
+	if (count == 0) {
+		visible.clear();
+		return 0;
+	}
+
+	uint32_t padded = (uint32_t)centerX.size();
+	uint32_t blocks = (padded + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	// every block culls into its own stretch of scratch
+	scratch.resize(padded + Simd::WIDTH);
+	blockCounts.resize(blocks + 1);
+
+	jobs.parallelFor(blocks, 1, [&](uint32_t block) {
+		uint32_t begin = block * BLOCK_SIZE;
+		uint32_t end = std::min(padded, begin + BLOCK_SIZE);
+		uint32_t* out = &scratch[begin];
+		blockCounts[block] = type == BOUNDS_AABB ? cullRange<true>(frustum, begin, end, out) : cullRange<false>(frustum, begin, end, out);
+	});
+
+	// exclusive prefix sum, then gather the blocks in parallel
+	uint32_t total = 0;
+	for (uint32_t block = 0; block < blocks; block++) {
+		uint32_t blockCount = blockCounts[block];
+		blockCounts[block] = total;
+		total += blockCount;
+	}
+	blockCounts[blocks] = total;
+
+	visible.resize(total);
+	if (total > 0) {
+		jobs.parallelFor(blocks, 1, [&](uint32_t block) {
+			uint32_t blockCount = blockCounts[block + 1] - blockCounts[block];
+			if (blockCount > 0) {
+				memcpy(&visible[blockCounts[block]], &scratch[block * BLOCK_SIZE], blockCount * sizeof(uint32_t));
+			}
+		});
+	}
+
+	return total;
+}
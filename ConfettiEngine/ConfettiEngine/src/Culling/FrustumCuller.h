@@ -0,0 +1,67 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+#include "../Jobs/JobSystem.h"
+
+// CPU frustum culling over packed world space bounds, the fallback when GPU driven
+// culling is disabled or unsupported.
+// Bounds are stored SoA (one array per component) and tested Simd::WIDTH at a time
+// against all six planes without branches. Boxes are kept as center/extent so a plane
+// test is dot(n, c) + w >= -dot(|n|, e), spheres use the radius in place of the extent term.
+// Blocks are culled in parallel into scratch space and then compacted, so the visible
+// list stays in ascending index order.
+//
+// feed it the view-projection built with glm::perspective (glm/ext/matrix_clip_space.hpp),
+// GLM_FORCE_DEPTH_ZERO_TO_ONE gives the vulkan near plane
+class FrustumCuller {
+public:
+	enum BoundsType {
+		BOUNDS_AABB,
+		BOUNDS_SPHERE
+	};
+
+	FrustumCuller(JobSystem& j, BoundsType t);
+
+	// new bounds start out culled until they are set
+	void resize(uint32_t count);
+	uint32_t getCount() const;
+
+	void setAabb(uint32_t index, const glm::vec3& min, const glm::vec3& max);
+	void setSphere(uint32_t index, const glm::vec3& center, float radius);
+
+	// indices of every visible bound in ascending order, returns the visible count
+	uint32_t cull(const glm::mat4& viewProj, std::vector<uint32_t>& visible);
+	uint32_t cull(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+private:
+	// bounds per job, a multiple of every Simd::WIDTH
+	static const uint32_t BLOCK_SIZE = 16 * 1024;
+
+	template<bool AABB>
+	uint32_t cullRange(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* out) const;
+
+	JobSystem& jobs;
+	BoundsType type;
+	uint32_t count;
+
+	// sized to a multiple of Simd::WIDTH, the padding never passes the test
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	// boxes only
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+	// spheres only
+	std::vector<float> radius;
+
+	std::vector<uint32_t> scratch;
+	std::vector<uint32_t> blockCounts;
+};
+
+#endif
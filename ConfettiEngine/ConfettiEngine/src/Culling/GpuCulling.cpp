@@ -0,0 +1,361 @@
+#include "GpuCulling.h"
+#include "Frustum.h"
+#include "../Buffers/Buffer.h"
+#include "../Shaders/Shader.h"
+#include <iostream>
+#include <stdexcept>
+
+static const uint32_t CULL_GROUP_SIZE = 64;
+
+static const char* FRUSTUM_CULL_SHADER = "./src/Shaders/frustumCull.comp.spv";
+static const char* OCCLUSION_CULL_SHADER = "./src/Shaders/occlusionCull.comp.spv";
+
+// binding 0: instances, 1: meshes, 2: draw commands, 3: draw counts, 4: visibility, 5: camera
+static const uint32_t CULL_BUFFER_BINDINGS = 6;
+
+GpuCulling::GpuCulling(VkPhysicalDevice& p, VkDevice& d, uint32_t maxInst, uint32_t maxMesh, bool drawCount, bool multiDraw)
+	: physicalDevice(p), device(d), maxInstances(maxInst), maxMeshes(maxMesh),
+	drawIndirectCountSupported(drawCount), multiDrawIndirectSupported(multiDraw)
+{
+	std::vector<VkDescriptorSetLayoutBinding> bindings(CULL_BUFFER_BINDINGS);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 5 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+
+	earlyPipeline = new ComputePipeline(device, FRUSTUM_CULL_SHADER, bindings, sizeof(CullConstants));
+
+	// binding 6: depth pyramid
+	VkDescriptorSetLayoutBinding pyramidBinding{};
+	pyramidBinding.binding = 6;
+	pyramidBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidBinding.descriptorCount = 1;
+	pyramidBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings.push_back(pyramidBinding);
+
+	latePipeline = new ComputePipeline(device, OCCLUSION_CULL_SHADER, bindings, sizeof(CullConstants));
+
+	createBuffers();
+	createDescriptors();
+
+	// count draws are an extension on 1.0, so the command has to be loaded manually
+	if (drawIndirectCountSupported) {
+		cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+		drawIndirectCountSupported = cmdDrawIndexedIndirectCount != nullptr;
+	}
+
+	std::cout << "GPU Culling created (" << maxInstances << " instances, indirect count "
+		<< (drawIndirectCountSupported ? "enabled" : "unavailable") << ")\n";
+}
+
+GpuCulling::~GpuCulling()
+{
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+	vkUnmapMemory(device, instanceMemory);
+	vkUnmapMemory(device, meshMemory);
+
+	Buffer::destroy(device, instanceBuffer, instanceMemory);
+	Buffer::destroy(device, meshBuffer, meshMemory);
+	Buffer::destroy(device, drawCommandBuffer, drawCommandMemory);
+	Buffer::destroy(device, drawCountBuffer, drawCountMemory);
+	Buffer::destroy(device, visibilityBuffer, visibilityMemory);
+	Buffer::destroy(device, uniformBuffer, uniformMemory);
+
+	delete(latePipeline);
+	delete(earlyPipeline);
+}
+
+bool GpuCulling::shadersAvailable()
+{
+	return Shader::exists(FRUSTUM_CULL_SHADER) && Shader::exists(OCCLUSION_CULL_SHADER);
+}
+
+uint32_t GpuCulling::addMesh(uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset, const glm::vec3& positionOffset, const glm::vec3& positionScale,
+	uint32_t firstMeshlet, uint32_t meshletCount)
+{
+	if (meshCount >= maxMeshes) {
+		throw std::runtime_error("ERROR: GPU culling mesh capacity exceeded!");
+	}
+
+	GpuMesh& mesh = mappedMeshes[meshCount];
+	mesh.indexCount = indexCount;
+	mesh.firstIndex = firstIndex;
+	mesh.vertexOffset = vertexOffset;
+	mesh.firstMeshlet = firstMeshlet;
+	mesh.meshletCount = meshletCount;
+	mesh.pad[0] = mesh.pad[1] = mesh.pad[2] = 0;
+	mesh.positionOffset = glm::vec4(positionOffset, 0.0f);
+	mesh.positionScale = glm::vec4(positionScale, 0.0f);
+
+	return meshCount++;
+}
+
+GpuInstance* GpuCulling::getInstances()
+{
+	return mappedInstances;
+}
+
+void GpuCulling::setInstanceCount(uint32_t count)
+{
+	if (count > maxInstances) {
+		throw std::runtime_error("ERROR: GPU culling instance capacity exceeded!");
+	}
+	instanceCount = count;
+}
+
+uint32_t GpuCulling::getInstanceCount() const
+{
+	return instanceCount;
+}
+
+void GpuCulling::setCamera(const glm::mat4& view, const glm::mat4& proj)
+{
+	Frustum frustum = Frustum::fromMatrix(proj * view);
+
+	uniforms.view = view;
+	for (int i = 0; i < 6; i++) {
+		uniforms.planes[i] = frustum.planes[i];
+	}
+	uniforms.projection = glm::vec4(proj[0][0], proj[1][1], proj[2][2], proj[3][2]);
+	// zero to one perspective: P22 = f / (n - f) and P32 = -fn / (f - n), so n = P32 / P22
+	uniforms.pyramid.z = proj[3][2] / proj[2][2];
+}
+
+void GpuCulling::setDepthPyramid(HiZPyramid* pyramid)
+{
+	depthPyramid = pyramid;
+	if (depthPyramid == nullptr) return;
+
+	uniforms.pyramid.x = (float)depthPyramid->getExtent().width;
+	uniforms.pyramid.y = (float)depthPyramid->getExtent().height;
+
+	VkDescriptorImageInfo pyramidInfo{};
+	pyramidInfo.sampler = depthPyramid->getSampler();
+	pyramidInfo.imageView = depthPyramid->getView();
+	pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = lateSet;
+	write.dstBinding = 6;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &pyramidInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void GpuCulling::recordCull(VkCommandBuffer cmd, CullPhase phase)
+{
+	if (instanceCount == 0) return;
+
+	const VkDeviceSize regionSize = sizeof(VkDrawIndexedIndirectCommand) * maxInstances;
+
+	CullConstants constants{};
+	constants.instanceCount = instanceCount;
+	constants.phase = phase;
+	constants.drawOffset = phase * maxInstances;
+	constants.occlusionEnabled = depthPyramid != nullptr;
+
+	if (phase == CULL_EARLY) {
+		// last frame's draws and culls must be done with these buffers before they're rewritten
+		VkMemoryBarrier readToWrite{};
+		readToWrite.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		readToWrite.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+		readToWrite.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			1, &readToWrite, 0, nullptr, 0, nullptr);
+
+		if (!visibilityCleared) {
+			vkCmdFillBuffer(cmd, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+			visibilityCleared = true;
+		}
+
+		vkCmdUpdateBuffer(cmd, uniformBuffer, 0, sizeof(CullUniforms), &uniforms);
+		vkCmdFillBuffer(cmd, drawCountBuffer, 0, VK_WHOLE_SIZE, 0);
+		// without a GPU side count every slot is drawn, so culled slots have to be zeroed to become no-ops
+		if (!drawIndirectCountSupported) {
+			vkCmdFillBuffer(cmd, drawCommandBuffer, 0, sizeof(VkDrawIndexedIndirectCommand) * instanceCount, 0);
+			vkCmdFillBuffer(cmd, drawCommandBuffer, regionSize, sizeof(VkDrawIndexedIndirectCommand) * instanceCount, 0);
+		}
+
+		VkMemoryBarrier clearToCull{};
+		clearToCull.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearToCull.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearToCull.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &clearToCull, 0, nullptr, 0, nullptr);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, earlyPipeline->getPipeline());
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, earlyPipeline->getLayout(), 0, 1, &earlySet, 0, nullptr);
+		vkCmdPushConstants(cmd, earlyPipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+	}
+	else {
+		if (depthPyramid == nullptr) return;
+
+		// early cull reads visibility which the late cull overwrites
+		VkMemoryBarrier earlyToLate{};
+		earlyToLate.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		earlyToLate.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		earlyToLate.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &earlyToLate, 0, nullptr, 0, nullptr);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, latePipeline->getPipeline());
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, latePipeline->getLayout(), 0, 1, &lateSet, 0, nullptr);
+		vkCmdPushConstants(cmd, latePipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+	}
+
+	vkCmdDispatch(cmd, (instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// compacted commands feed the indirect draw, the instance buffer is read again by the vertex shader
+	VkMemoryBarrier cullToDraw{};
+	cullToDraw.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullToDraw.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullToDraw.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+		1, &cullToDraw, 0, nullptr, 0, nullptr);
+}
+
+void GpuCulling::recordDraw(VkCommandBuffer cmd, CullPhase phase)
+{
+	if (instanceCount == 0) return;
+	if (phase == CULL_LATE && depthPyramid == nullptr) return;
+
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	const VkDeviceSize commandOffset = (VkDeviceSize)stride * maxInstances * phase;
+	const VkDeviceSize countOffset = sizeof(uint32_t) * phase;
+
+	if (drawIndirectCountSupported) {
+		cmdDrawIndexedIndirectCount(cmd, drawCommandBuffer, commandOffset, drawCountBuffer, countOffset, instanceCount, stride);
+	}
+	else if (multiDrawIndirectSupported) {
+		vkCmdDrawIndexedIndirect(cmd, drawCommandBuffer, commandOffset, instanceCount, stride);
+	}
+	else {
+		// last resort, one indirect call per slot. CPU cost scales with instances again
+		for (uint32_t i = 0; i < instanceCount; i++) {
+			vkCmdDrawIndexedIndirect(cmd, drawCommandBuffer, commandOffset + i * stride, 1, stride);
+		}
+	}
+}
+
+const VkBuffer& GpuCulling::getInstanceBuffer()
+{
+	return instanceBuffer;
+}
+
+const VkBuffer& GpuCulling::getMeshBuffer()
+{
+	return meshBuffer;
+}
+
+const VkBuffer& GpuCulling::getUniformBuffer()
+{
+	return uniformBuffer;
+}
+
+void GpuCulling::createBuffers()
+{
+	// instances and meshes are written by the CPU each frame, so they stay host visible
+	Buffer::create(physicalDevice, device, sizeof(GpuInstance) * maxInstances,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		instanceBuffer, instanceMemory);
+	vkMapMemory(device, instanceMemory, 0, VK_WHOLE_SIZE, 0, (void**)&mappedInstances);
+
+	Buffer::create(physicalDevice, device, sizeof(GpuMesh) * maxMeshes,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		meshBuffer, meshMemory);
+	vkMapMemory(device, meshMemory, 0, VK_WHOLE_SIZE, 0, (void**)&mappedMeshes);
+
+	// everything else is only ever touched by the GPU
+	Buffer::create(physicalDevice, device, sizeof(VkDrawIndexedIndirectCommand) * maxInstances * 2,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		drawCommandBuffer, drawCommandMemory);
+
+	Buffer::create(physicalDevice, device, sizeof(uint32_t) * 2,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		drawCountBuffer, drawCountMemory);
+
+	Buffer::create(physicalDevice, device, sizeof(uint32_t) * maxInstances,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		visibilityBuffer, visibilityMemory);
+
+	Buffer::create(physicalDevice, device, sizeof(CullUniforms),
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		uniformBuffer, uniformMemory);
+}
+
+void GpuCulling::createDescriptors()
+{
+	VkDescriptorPoolSize poolSizes[3] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 2;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create culling descriptor pool!");
+	}
+
+	VkDescriptorSetLayout layouts[2] = { earlyPipeline->getSetLayout(), latePipeline->getSetLayout() };
+	VkDescriptorSet sets[2];
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 2;
+	allocInfo.pSetLayouts = layouts;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to allocate culling descriptor sets!");
+	}
+
+	earlySet = sets[0];
+	lateSet = sets[1];
+
+	// the late set's pyramid is written once one is set
+	writeBufferDescriptors(earlySet);
+	writeBufferDescriptors(lateSet);
+}
+
+void GpuCulling::writeBufferDescriptors(VkDescriptorSet set)
+{
+	VkDescriptorBufferInfo bufferInfos[CULL_BUFFER_BINDINGS] = {
+		{ instanceBuffer, 0, VK_WHOLE_SIZE },
+		{ meshBuffer, 0, VK_WHOLE_SIZE },
+		{ drawCommandBuffer, 0, VK_WHOLE_SIZE },
+		{ drawCountBuffer, 0, VK_WHOLE_SIZE },
+		{ visibilityBuffer, 0, VK_WHOLE_SIZE },
+		{ uniformBuffer, 0, VK_WHOLE_SIZE }
+	};
+
+	VkWriteDescriptorSet writes[CULL_BUFFER_BINDINGS]{};
+	for (uint32_t i = 0; i < CULL_BUFFER_BINDINGS; i++) {
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = set;
+		writes[i].dstBinding = i;
+		writes[i].dstArrayElement = 0;
+		writes[i].descriptorType = i == 5 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].descriptorCount = 1;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(device, CULL_BUFFER_BINDINGS, writes, 0, nullptr);
+}
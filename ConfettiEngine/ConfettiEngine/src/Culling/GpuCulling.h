@@ -0,0 +1,159 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include <vector>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "../ComputePipeline.h"
+#include "HiZPyramid.h"
+
+// per instance data, must match the std430 layout in Shaders/gpuScene.glsl
+struct GpuInstance {
+	glm::mat4 model;
+	// local space bounding sphere, xyz = center, w = radius
+	glm::vec4 boundingSphere;
+	uint32_t meshIndex;
+	uint32_t pad[3];
+};
+
+// index range of a mesh inside the shared vertex/index buffers
+struct GpuMesh {
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	// range in ClusterCulling's meshlet table. Meshes with meshlets are skipped by the
+	// instance passes here and drawn cluster by cluster instead
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	uint32_t pad[3];
+	// dequantization of packed positions, position = offset + scale * unorm. Zero and one
+	// for float vertices
+	glm::vec4 positionOffset;
+	glm::vec4 positionScale;
+};
+
+// per frame camera data, uploaded inline with vkCmdUpdateBuffer
+struct CullUniforms {
+	glm::mat4 view;
+	// world space frustum planes
+	glm::vec4 planes[6];
+	// P00, P11, P22, P32 of the projection matrix
+	glm::vec4 projection;
+	// pyramid width, pyramid height, near plane, unused
+	glm::vec4 pyramid;
+};
+
+// push constants for the cull dispatches
+struct CullConstants {
+	uint32_t instanceCount;
+	uint32_t phase;
+	uint32_t drawOffset;
+	uint32_t occlusionEnabled;
+};
+
+enum CullPhase {
+	// instances visible last frame, frustum tested only
+	CULL_EARLY = 0,
+	// everything else, tested against the depth pyramid built from the early draws
+	CULL_LATE = 1
+};
+
+// GPU driven submission: instances live in storage buffers, compute passes cull them and
+// append one VkDrawIndexedIndirectCommand per visible instance. The CPU only ever records
+// a few dispatches and indirect draws, regardless of how many instances there are.
+// Draws use firstInstance as the instance id, so the device needs drawIndirectFirstInstance.
+//
+// With a depth pyramid set, culling runs in two phases each frame:
+//   recordCull(EARLY) -> render pass: recordDraw(EARLY) -> pyramid->recordBuild(depth)
+//   -> recordCull(LATE) -> render pass (load): recordDraw(LATE)
+// Newly revealed objects are drawn in the late phase of the same frame, so nothing pops in.
+// Without a pyramid only the early phase is needed and it culls against the frustum alone.
+// Projection matrices are expected to be zero to one depth (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+class GpuCulling {
+public:
+	GpuCulling(VkPhysicalDevice& p, VkDevice& d, uint32_t maxInst, uint32_t maxMesh, bool drawCount, bool multiDraw);
+	~GpuCulling();
+
+	// false until frustumCull.comp and occlusionCull.comp are compiled (Shaders/compileTest.bat)
+	static bool shadersAvailable();
+
+	uint32_t addMesh(uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset,
+		const glm::vec3& positionOffset = glm::vec3(0.0f), const glm::vec3& positionScale = glm::vec3(1.0f),
+		uint32_t firstMeshlet = 0, uint32_t meshletCount = 0);
+
+	// instance memory is persistently mapped, write straight into it then set the count
+	GpuInstance* getInstances();
+	void setInstanceCount(uint32_t count);
+	uint32_t getInstanceCount() const;
+
+	void setCamera(const glm::mat4& view, const glm::mat4& proj);
+	// enables two phase occlusion culling, nullptr turns it back off
+	void setDepthPyramid(HiZPyramid* pyramid);
+
+	// record outside of a render pass, before the draws that consume the results
+	void recordCull(VkCommandBuffer cmd, CullPhase phase);
+	// record inside the render pass with the mesh vertex/index buffers already bound
+	void recordDraw(VkCommandBuffer cmd, CullPhase phase);
+
+	const VkBuffer& getInstanceBuffer();
+	// shared with ClusterCulling, the camera uniforms are written by recordCull(CULL_EARLY)
+	const VkBuffer& getMeshBuffer();
+	const VkBuffer& getUniformBuffer();
+
+private:
+	void createBuffers();
+	void createDescriptors();
+	void writeBufferDescriptors(VkDescriptorSet set);
+
+	VkPhysicalDevice& physicalDevice;
+	VkDevice& device;
+
+	uint32_t maxInstances;
+	uint32_t maxMeshes;
+	uint32_t instanceCount = 0;
+	uint32_t meshCount = 0;
+
+	// VK_KHR_draw_indirect_count lets the GPU decide how many draws are executed
+	bool drawIndirectCountSupported;
+	bool multiDrawIndirectSupported;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+
+	CullUniforms uniforms{};
+	HiZPyramid* depthPyramid = nullptr;
+	// device local visibility starts out undefined and is cleared on first use
+	bool visibilityCleared = false;
+
+	ComputePipeline* earlyPipeline;
+	ComputePipeline* latePipeline;
+
+	VkBuffer instanceBuffer;
+	VkDeviceMemory instanceMemory;
+	GpuInstance* mappedInstances;
+
+	VkBuffer meshBuffer;
+	VkDeviceMemory meshMemory;
+	GpuMesh* mappedMeshes;
+
+	// one region of maxInstances commands per phase
+	VkBuffer drawCommandBuffer;
+	VkDeviceMemory drawCommandMemory;
+
+	// one count per phase
+	VkBuffer drawCountBuffer;
+	VkDeviceMemory drawCountMemory;
+
+	// 1 if the instance passed the last late phase
+	VkBuffer visibilityBuffer;
+	VkDeviceMemory visibilityMemory;
+
+	VkBuffer uniformBuffer;
+	VkDeviceMemory uniformMemory;
+
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet earlySet;
+	VkDescriptorSet lateSet;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include "HiZPyramid.h"
+#include "../Buffers/Buffer.h"
+#include "../Shaders/Shader.h"
+#include <iostream>
+#include <stdexcept>
+
+static const uint32_t REDUCE_GROUP_SIZE = 8;
+
+static const char* DEPTH_REDUCE_SHADER = "./src/Shaders/depthReduce.comp.spv";
+
+HiZPyramid::HiZPyramid(VkPhysicalDevice& p, VkDevice& d, VkExtent2D depthExtent)
+	: physicalDevice(p), device(d), depthExtent(depthExtent)
+{
+	extent.width = (depthExtent.width + 1) / 2;
+	extent.height = (depthExtent.height + 1) / 2;
+
+	mipCount = 1;
+	for (uint32_t w = extent.width, h = extent.height; w > 1 || h > 1; mipCount++) {
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	// binding 0: source level, 1: destination level
+	std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	reducePipeline = new ComputePipeline(device, DEPTH_REDUCE_SHADER, bindings, sizeof(ReduceConstants));
+
+	createImage();
+	createDescriptors();
+
+	std::cout << "Depth Pyramid created (" << extent.width << "x" << extent.height << ", " << mipCount << " levels)\n";
+}
+
+HiZPyramid::~HiZPyramid()
+{
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroySampler(device, sampler, nullptr);
+
+	for (auto mipView : mipViews) {
+		vkDestroyImageView(device, mipView, nullptr);
+	}
+	vkDestroyImageView(device, view, nullptr);
+
+	vkDestroyImage(device, image, nullptr);
+	vkFreeMemory(device, imageMemory, nullptr);
+
+	delete(reducePipeline);
+}
+
+bool HiZPyramid::shadersAvailable()
+{
+	return Shader::exists(DEPTH_REDUCE_SHADER);
+}
+
+void HiZPyramid::recordBuild(VkCommandBuffer cmd, VkImageView depthView)
+{
+	if (depthView != boundDepthView) {
+		// only changes when the depth buffer is recreated, the device is idle at that point
+		writeSourceDescriptor(0, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+		boundDepthView = depthView;
+	}
+
+	// the whole pyramid is rewritten, so old contents can be discarded.
+	// Still has to wait for last frame's occlusion test to finish reading it
+	VkImageMemoryBarrier toGeneral{};
+	toGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	toGeneral.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	toGeneral.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	toGeneral.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	toGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toGeneral.image = image;
+	toGeneral.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipCount, 0, 1 };
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &toGeneral);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline->getPipeline());
+
+	VkExtent2D source = depthExtent;
+	VkExtent2D destination = extent;
+
+	for (uint32_t level = 0; level < mipCount; level++) {
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline->getLayout(), 0, 1, &descriptorSets[level], 0, nullptr);
+
+		ReduceConstants constants{};
+		constants.sourceWidth = (int32_t)source.width;
+		constants.sourceHeight = (int32_t)source.height;
+		constants.destinationWidth = (int32_t)destination.width;
+		constants.destinationHeight = (int32_t)destination.height;
+		vkCmdPushConstants(cmd, reducePipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants), &constants);
+
+		vkCmdDispatch(cmd, (destination.width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+			(destination.height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+
+		// next level reads this one, the last barrier also covers the occlusion test
+		VkImageMemoryBarrier levelBarrier{};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.image = image;
+		levelBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+		source = destination;
+		destination.width = (destination.width + 1) / 2;
+		destination.height = (destination.height + 1) / 2;
+	}
+}
+
+const VkImageView& HiZPyramid::getView()
+{
+	return view;
+}
+
+const VkSampler& HiZPyramid::getSampler()
+{
+	return sampler;
+}
+
+VkExtent2D HiZPyramid::getExtent() const
+{
+	return extent;
+}
+
+uint32_t HiZPyramid::getMipCount() const
+{
+	return mipCount;
+}
+
+void HiZPyramid::createImage()
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = mipCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create depth pyramid image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = Buffer::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to allocate depth pyramid memory!");
+	}
+
+	vkBindImageMemory(device, image, imageMemory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipCount, 0, 1 };
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create depth pyramid view!");
+	}
+
+	mipViews.resize(mipCount);
+	for (uint32_t i = 0; i < mipCount; i++) {
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 };
+
+		if (vkCreateImageView(device, &viewInfo, nullptr, &mipViews[i]) != VK_SUCCESS) {
+			throw std::runtime_error("ERROR: Failed to create depth pyramid mip view!");
+		}
+	}
+
+	// texelFetch ignores filtering, nearest + clamp keeps the sampler valid for any format
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = (float)mipCount;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create depth pyramid sampler!");
+	}
+}
+
+void HiZPyramid::createDescriptors()
+{
+	VkDescriptorPoolSize poolSizes[2] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mipCount },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, mipCount }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = mipCount;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create depth pyramid descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(mipCount, reducePipeline->getSetLayout());
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = mipCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	descriptorSets.resize(mipCount);
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to allocate depth pyramid descriptor sets!");
+	}
+
+	for (uint32_t level = 0; level < mipCount; level++) {
+		// level 0's source is the depth buffer, bound on first build
+		if (level > 0) {
+			writeSourceDescriptor(level, mipViews[level - 1], VK_IMAGE_LAYOUT_GENERAL);
+		}
+
+		VkDescriptorImageInfo destinationInfo{};
+		destinationInfo.imageView = mipViews[level];
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSets[level];
+		write.dstBinding = 1;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		write.pImageInfo = &destinationInfo;
+
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+}
+
+void HiZPyramid::writeSourceDescriptor(uint32_t level, VkImageView source, VkImageLayout layout)
+{
+	VkDescriptorImageInfo sourceInfo{};
+	sourceInfo.sampler = sampler;
+	sourceInfo.imageView = source;
+	sourceInfo.imageLayout = layout;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSets[level];
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &sourceInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
@@ -0,0 +1,65 @@
+#ifndef HI_Z_PYRAMID_H
+#define HI_Z_PYRAMID_H
+
+#include <vector>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "../ComputePipeline.h"
+
+// push constants for depthReduce.comp
+struct ReduceConstants {
+	int32_t sourceWidth;
+	int32_t sourceHeight;
+	int32_t destinationWidth;
+	int32_t destinationHeight;
+};
+
+// hierarchical max depth pyramid, built by compute from a depth buffer.
+// Level 0 is half the depth resolution, every following level halves again (rounding up).
+// The image stays in VK_IMAGE_LAYOUT_GENERAL so it can be written as storage and sampled
+class HiZPyramid {
+public:
+	HiZPyramid(VkPhysicalDevice& p, VkDevice& d, VkExtent2D depthExtent);
+	~HiZPyramid();
+
+	// false until depthReduce.comp is compiled (Shaders/compileTest.bat)
+	static bool shadersAvailable();
+
+	// depth must be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL with its writes
+	// already made visible to the compute stage
+	void recordBuild(VkCommandBuffer cmd, VkImageView depthView);
+
+	const VkImageView& getView();
+	const VkSampler& getSampler();
+	VkExtent2D getExtent() const;
+	uint32_t getMipCount() const;
+
+private:
+	void createImage();
+	void createDescriptors();
+	void writeSourceDescriptor(uint32_t level, VkImageView source, VkImageLayout layout);
+
+	VkPhysicalDevice& physicalDevice;
+	VkDevice& device;
+
+	VkExtent2D depthExtent;
+	VkExtent2D extent;
+	uint32_t mipCount;
+
+	VkImage image;
+	VkDeviceMemory imageMemory;
+	// full chain, used by the occlusion test
+	VkImageView view;
+	// one single level view per mip, used while building
+	std::vector<VkImageView> mipViews;
+	VkSampler sampler;
+
+	ComputePipeline* reducePipeline;
+	VkDescriptorPool descriptorPool;
+	std::vector<VkDescriptorSet> descriptorSets;
+	// depth view that level 0's descriptor currently points at
+	VkImageView boundDepthView = VK_NULL_HANDLE;
+};
+
+#endif
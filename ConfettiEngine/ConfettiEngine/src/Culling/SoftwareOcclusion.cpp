@@ -0,0 +1,282 @@
+#include "SoftwareOcclusion.h"
+#include "../Math/Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// vertices closer than this in clip w are treated as crossing the near plane
+static const float NEAR_W = 1e-4f;
+
+SoftwareOcclusion::SoftwareOcclusion(JobSystem& j, uint32_t w, uint32_t h)
+	: jobs(j), width(w), height(h), viewProj(1.0f)
+{
+	if (width == 0 || height == 0 || width % TILE_WIDTH != 0 || height % TILE_HEIGHT != 0) {
+		throw std::runtime_error("ERROR: Software occlusion buffer size must be a multiple of the tile size!");
+	}
+
+	tilesX = width / TILE_WIDTH;
+	tilesY = height / TILE_HEIGHT;
+
+	depth.resize(width * height, 1.0f);
+	tileMaxDepth.resize(tilesX * tilesY, 1.0f);
+	bins.resize(tilesX * tilesY);
+}
+
+void SoftwareOcclusion::begin(const glm::mat4& vp)
+{
+	viewProj = vp;
+
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.0f);
+
+	triangles.clear();
+	for (auto& bin : bins) {
+		bin.clear();
+	}
+}
+
+void SoftwareOcclusion::addOccluder(const glm::mat4& model, const glm::vec3* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	glm::mat4 mvp = viewProj * model;
+
+	// clip space -> pixel space with depth, w kept for the near plane check
+	screenVertices.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		glm::vec4 clip = mvp * glm::vec4(vertices[i], 1.0f);
+
+		if (clip.w <= NEAR_W) {
+			screenVertices[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+			continue;
+		}
+
+		float invW = 1.0f / clip.w;
+		screenVertices[i] = glm::vec4(
+			(clip.x * invW * 0.5f + 0.5f) * width,
+			(clip.y * invW * 0.5f + 0.5f) * height,
+			clip.z * invW,
+			clip.w);
+	}
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+		const glm::vec4& v0 = screenVertices[indices[i]];
+		const glm::vec4& v1 = screenVertices[indices[i + 1]];
+		const glm::vec4& v2 = screenVertices[indices[i + 2]];
+
+		// dropping near clipped occluder triangles only loses occlusion, never hides anything wrongly
+		if (v0.w <= 0.0f || v1.w <= 0.0f || v2.w <= 0.0f) continue;
+
+		binTriangle(v0, v1, v2);
+	}
+}
+
+void SoftwareOcclusion::binTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+{
+	Triangle tri;
+
+	// pixel rectangle, centres sit at +0.5
+	tri.minX = std::max(0, (int32_t)std::floor(std::min({ v0.x, v1.x, v2.x })));
+	tri.minY = std::max(0, (int32_t)std::floor(std::min({ v0.y, v1.y, v2.y })));
+	tri.maxX = std::min((int32_t)width - 1, (int32_t)std::ceil(std::max({ v0.x, v1.x, v2.x })));
+	tri.maxY = std::min((int32_t)height - 1, (int32_t)std::ceil(std::max({ v0.y, v1.y, v2.y })));
+
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY) return;
+
+	// edge i is opposite vertex i, so it doubles as that vertex's barycentric weight
+	const glm::vec4* v[3] = { &v0, &v1, &v2 };
+	for (int e = 0; e < 3; e++) {
+		const glm::vec4& a = *v[(e + 1) % 3];
+		const glm::vec4& b = *v[(e + 2) % 3];
+		tri.edgeA[e] = a.y - b.y;
+		tri.edgeB[e] = b.x - a.x;
+		tri.edgeC[e] = a.x * b.y - a.y * b.x;
+	}
+
+	float area = tri.edgeC[0] + tri.edgeA[0] * v0.x + tri.edgeB[0] * v0.y;
+	if (std::abs(area) < 1e-6f) return;
+
+	// both windings are rasterized, flip so the inside is always positive
+	if (area < 0.0f) {
+		for (int e = 0; e < 3; e++) {
+			tri.edgeA[e] = -tri.edgeA[e];
+			tri.edgeB[e] = -tri.edgeB[e];
+			tri.edgeC[e] = -tri.edgeC[e];
+		}
+		area = -area;
+	}
+
+	float invArea = 1.0f / area;
+	tri.zA = (tri.edgeA[0] * v0.z + tri.edgeA[1] * v1.z + tri.edgeA[2] * v2.z) * invArea;
+	tri.zB = (tri.edgeB[0] * v0.z + tri.edgeB[1] * v1.z + tri.edgeB[2] * v2.z) * invArea;
+	tri.zC = (tri.edgeC[0] * v0.z + tri.edgeC[1] * v1.z + tri.edgeC[2] * v2.z) * invArea;
+
+	uint32_t index = (uint32_t)triangles.size();
+	triangles.push_back(tri);
+
+	for (int32_t ty = tri.minY / (int32_t)TILE_HEIGHT; ty <= tri.maxY / (int32_t)TILE_HEIGHT; ty++) {
+		for (int32_t tx = tri.minX / (int32_t)TILE_WIDTH; tx <= tri.maxX / (int32_t)TILE_WIDTH; tx++) {
+			bins[ty * tilesX + tx].push_back(index);
+		}
+	}
+}
+
+void SoftwareOcclusion::rasterize()
+{
+	jobs.parallelFor(tilesX * tilesY, 1, [this](uint32_t tile) { rasterizeTile(tile); });
+}
+
+void SoftwareOcclusion::rasterizeTile(uint32_t tile)
+{
+	const int32_t tileX = (int32_t)(tile % tilesX * TILE_WIDTH);
+	const int32_t tileY = (int32_t)(tile / tilesX * TILE_HEIGHT);
+
+	const Simd::Float zeroes = Simd::zero();
+	const Simd::Float offsets = Simd::add(Simd::laneOffsets(), Simd::set1(0.5f));
+
+	for (uint32_t index : bins[tile]) {
+		const Triangle& tri = triangles[index];
+
+		int32_t minX = std::max(tri.minX, tileX);
+		int32_t maxX = std::min(tri.maxX, tileX + (int32_t)TILE_WIDTH - 1);
+		int32_t minY = std::max(tri.minY, tileY);
+		int32_t maxY = std::min(tri.maxY, tileY + (int32_t)TILE_HEIGHT - 1);
+		// tiles are a multiple of the simd width, so aligning down never leaves the tile
+		int32_t startX = minX - (minX - tileX) % (int32_t)Simd::WIDTH;
+
+		Simd::Float a0 = Simd::set1(tri.edgeA[0]), a1 = Simd::set1(tri.edgeA[1]), a2 = Simd::set1(tri.edgeA[2]);
+		Simd::Float zA = Simd::set1(tri.zA);
+		Simd::Float spanMin = Simd::set1((float)minX);
+		Simd::Float spanMax = Simd::set1((float)maxX + 1.0f);
+
+		for (int32_t y = minY; y <= maxY; y++) {
+			float py = (float)y + 0.5f;
+			Simd::Float row0 = Simd::set1(tri.edgeB[0] * py + tri.edgeC[0]);
+			Simd::Float row1 = Simd::set1(tri.edgeB[1] * py + tri.edgeC[1]);
+			Simd::Float row2 = Simd::set1(tri.edgeB[2] * py + tri.edgeC[2]);
+			Simd::Float rowZ = Simd::set1(tri.zB * py + tri.zC);
+
+			float* line = &depth[y * width];
+
+			for (int32_t x = startX; x <= maxX; x += Simd::WIDTH) {
+				Simd::Float px = Simd::add(Simd::set1((float)x), offsets);
+
+				// coverage mask: inside all three edges and within the clipped span
+				Simd::Float mask = Simd::cmpge(Simd::madd(a0, px, row0), zeroes);
+				mask = Simd::bitAnd(mask, Simd::cmpge(Simd::madd(a1, px, row1), zeroes));
+				mask = Simd::bitAnd(mask, Simd::cmpge(Simd::madd(a2, px, row2), zeroes));
+				mask = Simd::bitAnd(mask, Simd::cmpge(px, spanMin));
+				mask = Simd::bitAnd(mask, Simd::cmplt(px, spanMax));
+
+				if (!Simd::any(mask)) continue;
+
+				Simd::Float z = Simd::madd(zA, px, rowZ);
+				Simd::Float current = Simd::load(line + x);
+				Simd::store(line + x, Simd::select(current, Simd::min(current, z), mask));
+			}
+		}
+	}
+
+	// reduce the tile to its furthest depth
+	Simd::Float furthest = Simd::zero();
+	for (int32_t y = tileY; y < tileY + (int32_t)TILE_HEIGHT; y++) {
+		const float* line = &depth[y * width];
+		for (int32_t x = tileX; x < tileX + (int32_t)TILE_WIDTH; x += Simd::WIDTH) {
+			furthest = Simd::max(furthest, Simd::load(line + x));
+		}
+	}
+
+	float lanes[Simd::WIDTH];
+	Simd::store(lanes, furthest);
+	tileMaxDepth[tile] = *std::max_element(lanes, lanes + Simd::WIDTH);
+}
+
+bool SoftwareOcclusion::testAabb(const glm::vec3& min, const glm::vec3& max) const
+{
+	float minX = (float)width, minY = (float)height, maxX = 0.0f, maxY = 0.0f;
+	float minZ = 1.0f;
+
+	for (int i = 0; i < 8; i++) {
+		glm::vec4 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, 1.0f);
+		glm::vec4 clip = viewProj * corner;
+
+		// crossing the near plane, can't project reliably so assume visible
+		if (clip.w <= NEAR_W) return true;
+
+		float invW = 1.0f / clip.w;
+		float sx = (clip.x * invW * 0.5f + 0.5f) * width;
+		float sy = (clip.y * invW * 0.5f + 0.5f) * height;
+
+		minX = std::min(minX, sx);
+		maxX = std::max(maxX, sx);
+		minY = std::min(minY, sy);
+		maxY = std::max(maxY, sy);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	int32_t x0 = std::max(0, (int32_t)std::floor(minX));
+	int32_t y0 = std::max(0, (int32_t)std::floor(minY));
+	int32_t x1 = std::min((int32_t)width - 1, (int32_t)std::ceil(maxX));
+	int32_t y1 = std::min((int32_t)height - 1, (int32_t)std::ceil(maxY));
+
+	// entirely off screen
+	if (x0 > x1 || y0 > y1) return false;
+
+	return testRect(x0, y0, x1, y1, std::max(minZ, 0.0f));
+}
+
+bool SoftwareOcclusion::testRect(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, float minZ) const
+{
+	const Simd::Float boxZ = Simd::set1(minZ);
+	const Simd::Float offsets = Simd::laneOffsets();
+	const Simd::Float spanMin = Simd::set1((float)minX);
+	const Simd::Float spanMax = Simd::set1((float)maxX + 1.0f);
+
+	for (int32_t ty = minY / (int32_t)TILE_HEIGHT; ty <= maxY / (int32_t)TILE_HEIGHT; ty++) {
+		for (int32_t tx = minX / (int32_t)TILE_WIDTH; tx <= maxX / (int32_t)TILE_WIDTH; tx++) {
+			// everything in this tile is nearer than the box
+			if (minZ > tileMaxDepth[ty * tilesX + tx]) continue;
+
+			int32_t tileX = tx * (int32_t)TILE_WIDTH;
+			int32_t tileY = ty * (int32_t)TILE_HEIGHT;
+			int32_t x0 = std::max(minX, tileX);
+			int32_t x1 = std::min(maxX, tileX + (int32_t)TILE_WIDTH - 1);
+			int32_t y0 = std::max(minY, tileY);
+			int32_t y1 = std::min(maxY, tileY + (int32_t)TILE_HEIGHT - 1);
+			int32_t startX = x0 - (x0 - tileX) % (int32_t)Simd::WIDTH;
+
+			for (int32_t y = y0; y <= y1; y++) {
+				const float* line = &depth[y * width];
+				for (int32_t x = startX; x <= x1; x += Simd::WIDTH) {
+					Simd::Float px = Simd::add(Simd::set1((float)x), offsets);
+					Simd::Float inside = Simd::bitAnd(Simd::cmpge(px, spanMin), Simd::cmplt(px, spanMax));
+					// a pixel whose occluder is behind the box's nearest point can't hide it
+					Simd::Float behind = Simd::cmpge(Simd::load(line + x), boxZ);
+					if (Simd::any(Simd::bitAnd(inside, behind))) return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+void SoftwareOcclusion::testAabbs(const glm::vec3* mins, const glm::vec3* maxs, uint32_t count, uint8_t* visible) const
+{
+	jobs.parallelFor(count, 256, [&](uint32_t i) {
+		visible[i] = testAabb(mins[i], maxs[i]) ? 1 : 0;
+	});
+}
+
+const float* SoftwareOcclusion::getDepth() const
+{
+	return depth.data();
+}
+
+uint32_t SoftwareOcclusion::getWidth() const
+{
+	return width;
+}
+
+uint32_t SoftwareOcclusion::getHeight() const
+{
+	return height;
+}
@@ -0,0 +1,73 @@
+#ifndef SOFTWARE_OCCLUSION_H
+#define SOFTWARE_OCCLUSION_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../Jobs/JobSystem.h"
+
+// CPU occlusion culling. Selected occluder meshes are rasterized into a small depth buffer
+// with SIMD edge functions (see Math/Simd.h), then occludee boxes are tested against it.
+// The buffer is split into screen tiles, triangles are binned per tile and tiles are
+// rasterized in parallel on the job system since they never share pixels.
+// Depth is zero to one with 1 as the far plane, each pixel keeps the nearest occluder depth.
+//
+// per frame: begin(viewProj) -> addOccluder(...) * n -> rasterize() -> testAabb(...) * n
+class SoftwareOcclusion {
+public:
+	// width must be a multiple of TILE_WIDTH and height of TILE_HEIGHT
+	SoftwareOcclusion(JobSystem& j, uint32_t w, uint32_t h);
+
+	static const uint32_t TILE_WIDTH = 64;
+	static const uint32_t TILE_HEIGHT = 16;
+
+	void begin(const glm::mat4& viewProj);
+
+	void addOccluder(const glm::mat4& model, const glm::vec3* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+	void rasterize();
+
+	// true if any part of the world space box could be visible
+	bool testAabb(const glm::vec3& min, const glm::vec3& max) const;
+	void testAabbs(const glm::vec3* mins, const glm::vec3* maxs, uint32_t count, uint8_t* visible) const;
+
+	const float* getDepth() const;
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+
+private:
+	// screen space triangle setup, edges are A * x + B * y + C >= 0 inside
+	struct Triangle {
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		// depth plane, z = zA * x + zB * y + zC
+		float zA, zB, zC;
+		int32_t minX, minY, maxX, maxY;
+	};
+
+	void binTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+	void rasterizeTile(uint32_t tile);
+	bool testRect(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, float minZ) const;
+
+	JobSystem& jobs;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t tilesX;
+	uint32_t tilesY;
+
+	glm::mat4 viewProj;
+
+	std::vector<float> depth;
+	// furthest depth inside each tile, lets most tests finish without touching pixels
+	std::vector<float> tileMaxDepth;
+
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<uint32_t>> bins;
+	// screen space vertices of the occluder being added
+	std::vector<glm::vec4> screenVertices;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "Archetype.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+// arrays start on cache line boundaries
+static const uint32_t ARRAY_ALIGNMENT = 64;
+// offset of components that aren't part of the archetype
+static const uint32_t NOT_PRESENT = 0xFFFFFFFF;
+
+static uint32_t alignUp(uint32_t value, uint32_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+Archetype::Archetype(ComponentMask m)
+	: mask(m), capacity(0)
+{
+	std::fill(std::begin(offsets), std::end(offsets), NOT_PRESENT);
+	std::fill(std::begin(sizes), std::end(sizes), 0);
+
+	uint32_t rowSize = sizeof(Entity);
+	for (ComponentId id = 0; id < MAX_COMPONENTS; id++) {
+		if (mask & (ComponentMask(1) << id)) {
+			components.push_back(id);
+			rowSize += Components::info(id).size;
+		}
+	}
+
+	// start from the unpadded estimate and back off until the aligned arrays fit
+	for (capacity = Chunk::SIZE / rowSize; capacity > 0; capacity--) {
+		uint32_t offset = alignUp(sizeof(Entity) * capacity, ARRAY_ALIGNMENT);
+		for (ComponentId id : components) {
+			const ComponentInfo& info = Components::info(id);
+			offset = alignUp(offset, std::max(info.align, ARRAY_ALIGNMENT));
+			offset += info.size * capacity;
+		}
+		if (offset <= Chunk::SIZE) break;
+	}
+
+	if (capacity == 0) {
+		throw std::runtime_error("ERROR: Archetype row doesn't fit in a chunk!");
+	}
+
+	uint32_t offset = alignUp(sizeof(Entity) * capacity, ARRAY_ALIGNMENT);
+	for (ComponentId id : components) {
+		const ComponentInfo& info = Components::info(id);
+		offset = alignUp(offset, std::max(info.align, ARRAY_ALIGNMENT));
+		offsets[id] = offset;
+		sizes[id] = info.size;
+		offset += info.size * capacity;
+	}
+}
+
+Archetype::~Archetype()
+{
+	for (Chunk* chunk : chunks) {
+		::operator delete(chunk->data, std::align_val_t(ARRAY_ALIGNMENT));
+		delete(chunk);
+	}
+}
+
+ComponentMask Archetype::getMask() const
+{
+	return mask;
+}
+
+uint32_t Archetype::getCapacity() const
+{
+	return capacity;
+}
+
+const std::vector<ComponentId>& Archetype::getComponents() const
+{
+	return components;
+}
+
+const std::vector<Chunk*>& Archetype::getChunks() const
+{
+	return chunks;
+}
+
+bool Archetype::has(ComponentId id) const
+{
+	return offsets[id] != NOT_PRESENT;
+}
+
+Entity* Archetype::getEntities(Chunk* chunk) const
+{
+	return (Entity*)chunk->data;
+}
+
+void* Archetype::getArray(Chunk* chunk, ComponentId id) const
+{
+	return offsets[id] == NOT_PRESENT ? nullptr : chunk->data + offsets[id];
+}
+
+void* Archetype::getComponent(uint32_t chunk, uint32_t row, ComponentId id) const
+{
+	if (offsets[id] == NOT_PRESENT) return nullptr;
+	return chunks[chunk]->data + offsets[id] + (size_t)row * sizes[id];
+}
+
+uint32_t Archetype::getArrayOffset(ComponentId id) const
+{
+	return offsets[id];
+}
+
+void Archetype::allocate(Entity entity, uint32_t& chunk, uint32_t& row)
+{
+	allocateRows(1, chunk, row);
+	getEntities(chunks.back())[row] = entity;
+}
+
+uint32_t Archetype::allocateRows(uint32_t count, uint32_t& chunk, uint32_t& row)
+{
+	if (chunks.empty() || chunks.back()->count == capacity) {
+		Chunk* fresh = new Chunk();
+		fresh->data = (uint8_t*)::operator new(Chunk::SIZE, std::align_val_t(ARRAY_ALIGNMENT));
+		fresh->count = 0;
+		chunks.push_back(fresh);
+	}
+
+	chunk = (uint32_t)chunks.size() - 1;
+	row = chunks.back()->count;
+	uint32_t added = std::min(count, capacity - row);
+	chunks.back()->count += added;
+	return added;
+}
+
+Entity Archetype::remove(uint32_t chunk, uint32_t row)
+{
+	Chunk* last = chunks.back();
+	uint32_t lastRow = last->count - 1;
+	Entity moved = INVALID_ENTITY;
+
+	if (chunks[chunk] != last || row != lastRow) {
+		Chunk* target = chunks[chunk];
+		moved = getEntities(last)[lastRow];
+		getEntities(target)[row] = moved;
+
+		for (ComponentId id : components) {
+			uint32_t size = sizes[id];
+			memcpy(target->data + offsets[id] + (size_t)row * size, last->data + offsets[id] + (size_t)lastRow * size, size);
+		}
+	}
+
+	if (--last->count == 0) {
+		::operator delete(last->data, std::align_val_t(ARRAY_ALIGNMENT));
+		delete(last);
+		chunks.pop_back();
+	}
+
+	return moved;
+}
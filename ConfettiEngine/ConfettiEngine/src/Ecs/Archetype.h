@@ -0,0 +1,64 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Component.h"
+
+// fixed size block holding up to Archetype::getCapacity() entities of one archetype.
+// Layout is SoA: the entity array followed by one contiguous array per component, each
+// array 64 byte aligned so systems can stream it with SIMD loads
+struct Chunk {
+	static const uint32_t SIZE = 16 * 1024;
+
+	uint8_t* data;
+	uint32_t count;
+};
+
+// every entity with exactly the same set of components. Rows are kept dense, removing an
+// entity moves the last row of the last chunk into the hole, so only the last chunk is
+// ever partially filled
+class Archetype {
+public:
+	Archetype(ComponentMask m);
+	~Archetype();
+
+	Archetype(const Archetype&) = delete;
+	Archetype& operator=(const Archetype&) = delete;
+
+	ComponentMask getMask() const;
+	uint32_t getCapacity() const;
+	const std::vector<ComponentId>& getComponents() const;
+	const std::vector<Chunk*>& getChunks() const;
+
+	bool has(ComponentId id) const;
+
+	Entity* getEntities(Chunk* chunk) const;
+	// start of the component's array in the chunk, nullptr if not part of this archetype
+	void* getArray(Chunk* chunk, ComponentId id) const;
+	void* getComponent(uint32_t chunk, uint32_t row, ComponentId id) const;
+	// where getArray puts the component in every chunk, for code that writes chunks itself
+	uint32_t getArrayOffset(ComponentId id) const;
+
+	// appends a row for the entity, component data is left uninitialized
+	void allocate(Entity entity, uint32_t& chunk, uint32_t& row);
+	// appends up to count rows to the last chunk, a new one if it is full, and returns how many.
+	// They are [row, row + added) of chunk, entities and components uninitialized
+	uint32_t allocateRows(uint32_t count, uint32_t& chunk, uint32_t& row);
+
+	// swap removes the row, returns the entity that was moved into it or INVALID_ENTITY
+	Entity remove(uint32_t chunk, uint32_t row);
+
+private:
+	ComponentMask mask;
+	uint32_t capacity;
+	std::vector<ComponentId> components;
+	// byte offset of each component array inside a chunk, and the element size
+	uint32_t offsets[MAX_COMPONENTS];
+	uint32_t sizes[MAX_COMPONENTS];
+
+	std::vector<Chunk*> chunks;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "CommandBuffer.h"
+#include <cstring>
+
+void CommandBuffer::record(Op op, Entity entity, ComponentId component, const void* payload, uint32_t size)
+{
+	size_t offset = payloads.size();
+	if (size > 0) {
+		payloads.resize(offset + size);
+		memcpy(payloads.data() + offset, payload, size);
+	}
+
+	commands.push_back({ op, entity, component, size, offset });
+}
+
+void CommandBuffer::destroy(Entity entity)
+{
+	record(OP_DESTROY, entity, 0, nullptr, 0);
+}
+
+void CommandBuffer::playback(World& world)
+{
+	std::vector<ComponentId> ids;
+	std::vector<const void*> data;
+
+	for (size_t i = 0; i < commands.size(); i++) {
+		const Command& command = commands[i];
+
+		switch (command.op) {
+		case OP_CREATE:
+			ids.clear();
+			data.clear();
+			for (uint32_t c = 0; c < command.count; c++) {
+				const Command& component = commands[i + 1 + c];
+				ids.push_back(component.component);
+				data.push_back(payloads.data() + component.offset);
+			}
+			world.createRaw(ids.data(), data.data(), command.count);
+			i += command.count;
+			break;
+		case OP_DESTROY:
+			world.destroy(command.entity);
+			break;
+		case OP_ADD:
+			if (world.isAlive(command.entity)) {
+				world.addRaw(command.entity, command.component, payloads.data() + command.offset);
+			}
+			break;
+		case OP_REMOVE:
+			world.removeRaw(command.entity, command.component);
+			break;
+		default:
+			break;
+		}
+	}
+
+	clear();
+}
+
+bool CommandBuffer::empty() const
+{
+	return commands.empty();
+}
+
+void CommandBuffer::clear()
+{
+	commands.clear();
+	payloads.clear();
+}
@@ -0,0 +1,75 @@
+#ifndef ECS_COMMAND_BUFFER_H
+#define ECS_COMMAND_BUFFER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "World.h"
+
+// records structural changes while a query is running and applies them afterwards.
+// Not thread safe, give every job its own buffer and play them back in a fixed order
+// so the result doesn't depend on scheduling
+class CommandBuffer {
+public:
+	template<typename... Ts>
+	void create(const Ts&... components);
+	void destroy(Entity entity);
+
+	template<typename T>
+	void add(Entity entity, const T& component);
+	template<typename T>
+	void remove(Entity entity);
+
+	// applies every command in recording order then clears the buffer.
+	// Commands on entities that died in the meantime are dropped
+	void playback(World& world);
+
+	bool empty() const;
+	void clear();
+
+private:
+	enum Op : uint32_t {
+		OP_CREATE,
+		OP_DESTROY,
+		OP_ADD,
+		OP_REMOVE,
+		// component payload belonging to the preceding OP_CREATE
+		OP_CREATE_COMPONENT
+	};
+
+	struct Command {
+		Op op;
+		Entity entity;
+		ComponentId component;
+		// OP_CREATE: number of OP_CREATE_COMPONENT that follow, otherwise payload size
+		uint32_t count;
+		size_t offset;
+	};
+
+	void record(Op op, Entity entity, ComponentId component, const void* payload, uint32_t size);
+
+	std::vector<Command> commands;
+	// component bytes, only ever memcpy'd so no alignment is needed
+	std::vector<uint8_t> payloads;
+};
+
+template<typename... Ts>
+void CommandBuffer::create(const Ts&... components)
+{
+	commands.push_back({ OP_CREATE, INVALID_ENTITY, 0, (uint32_t)sizeof...(Ts), 0 });
+	(record(OP_CREATE_COMPONENT, INVALID_ENTITY, Components::id<Ts>(), &components, sizeof(Ts)), ...);
+}
+
+template<typename T>
+void CommandBuffer::add(Entity entity, const T& component)
+{
+	record(OP_ADD, entity, Components::id<T>(), &component, sizeof(T));
+}
+
+template<typename T>
+void CommandBuffer::remove(Entity entity)
+{
+	record(OP_REMOVE, entity, Components::id<T>(), nullptr, 0);
+}
+
+#endif
@@ -0,0 +1,25 @@
+#include "Component.h"
+#include <mutex>
+#include <stdexcept>
+
+// fixed array so readers never see it move while another type registers
+static ComponentInfo registry[MAX_COMPONENTS];
+static uint32_t registryCount = 0;
+static std::mutex registryLock;
+
+ComponentId Components::registerType(uint32_t size, uint32_t align)
+{
+	std::lock_guard<std::mutex> guard(registryLock);
+
+	if (registryCount >= MAX_COMPONENTS) {
+		throw std::runtime_error("ERROR: Too many component types registered!");
+	}
+
+	registry[registryCount] = { size, align };
+	return registryCount++;
+}
+
+const ComponentInfo& Components::info(ComponentId id)
+{
+	return registry[id];
+}
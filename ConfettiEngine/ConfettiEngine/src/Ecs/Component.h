@@ -0,0 +1,49 @@
+#ifndef COMPONENT_H
+#define COMPONENT_H
+
+#include <cstdint>
+#include <type_traits>
+
+using ComponentId = uint32_t;
+// one bit per component type, identifies an archetype
+using ComponentMask = uint64_t;
+
+static const uint32_t MAX_COMPONENTS = 64;
+
+// generation is bumped when an index is reused so stale handles can be detected
+struct Entity {
+	uint32_t index;
+	uint32_t generation;
+
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+static const Entity INVALID_ENTITY = { 0xFFFFFFFF, 0 };
+
+struct ComponentInfo {
+	uint32_t size;
+	uint32_t align;
+};
+
+// components are plain data, chunks move them around with memcpy
+namespace Components {
+	ComponentId registerType(uint32_t size, uint32_t align);
+	const ComponentInfo& info(ComponentId id);
+
+	template<typename T>
+	ComponentId id()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "ERROR: Components must be trivially copyable!");
+		static const ComponentId value = registerType(sizeof(T), alignof(T));
+		return value;
+	}
+
+	template<typename... Ts>
+	ComponentMask mask()
+	{
+		return (ComponentMask(0) | ... | (ComponentMask(1) << id<Ts>()));
+	}
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "World.h"
+#include <cstring>
+#include <stdexcept>
+
+World::~World()
+{
+	for (Archetype* archetype : archetypeList) {
+		delete(archetype);
+	}
+}
+
+Archetype* World::getArchetype(ComponentMask mask)
+{
+	auto it = archetypes.find(mask);
+	if (it != archetypes.end()) return it->second;
+
+	Archetype* archetype = new Archetype(mask);
+	archetypes[mask] = archetype;
+	archetypeList.push_back(archetype);
+	return archetype;
+}
+
+Entity World::createRaw(const ComponentId* ids, const void* const* data, uint32_t count)
+{
+	ComponentMask mask = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		mask |= ComponentMask(1) << ids[i];
+	}
+
+	Entity entity = allocateEntity();
+
+	Record& record = records[entity.index];
+	record.archetype = getArchetype(mask);
+	record.archetype->allocate(entity, record.chunk, record.row);
+
+	for (uint32_t i = 0; i < count; i++) {
+		memcpy(record.archetype->getComponent(record.chunk, record.row, ids[i]), data[i], Components::info(ids[i]).size);
+	}
+
+	return entity;
+}
+
+Entity World::allocateEntity()
+{
+	Entity entity;
+	if (!freeIndices.empty()) {
+		entity.index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else {
+		entity.index = (uint32_t)records.size();
+		records.push_back({ nullptr, 0, 0, 0 });
+	}
+	entity.generation = records[entity.index].generation;
+
+	entityCount++;
+	return entity;
+}
+
+void World::destroy(Entity entity)
+{
+	if (!isAlive(entity)) return;
+
+	Record& record = records[entity.index];
+	removeRow(record.archetype, record.chunk, record.row);
+
+	record.archetype = nullptr;
+	record.generation++;
+	freeIndices.push_back(entity.index);
+	entityCount--;
+}
+
+bool World::isAlive(Entity entity) const
+{
+	return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype != nullptr;
+}
+
+void World::removeRow(Archetype* archetype, uint32_t chunk, uint32_t row)
+{
+	Entity moved = archetype->remove(chunk, row);
+	if (moved != INVALID_ENTITY) {
+		records[moved.index].chunk = chunk;
+		records[moved.index].row = row;
+	}
+}
+
+void World::migrate(Entity entity, Archetype* target)
+{
+	Record& record = records[entity.index];
+	Archetype* source = record.archetype;
+
+	uint32_t chunk, row;
+	target->allocate(entity, chunk, row);
+
+	for (ComponentId id : source->getComponents()) {
+		if (!target->has(id)) continue;
+		memcpy(target->getComponent(chunk, row, id), source->getComponent(record.chunk, record.row, id), Components::info(id).size);
+	}
+
+	removeRow(source, record.chunk, record.row);
+
+	record.archetype = target;
+	record.chunk = chunk;
+	record.row = row;
+}
+
+void World::addRaw(Entity entity, ComponentId id, const void* data)
+{
+	if (!isAlive(entity)) {
+		throw std::runtime_error("ERROR: Adding a component to a dead entity!");
+	}
+
+	Record& record = records[entity.index];
+	if (!record.archetype->has(id)) {
+		migrate(entity, getArchetype(record.archetype->getMask() | (ComponentMask(1) << id)));
+	}
+
+	memcpy(record.archetype->getComponent(record.chunk, record.row, id), data, Components::info(id).size);
+}
+
+void World::removeRaw(Entity entity, ComponentId id)
+{
+	if (!isAlive(entity)) return;
+
+	Record& record = records[entity.index];
+	if (!record.archetype->has(id)) return;
+
+	migrate(entity, getArchetype(record.archetype->getMask() & ~(ComponentMask(1) << id)));
+}
+
+void* World::getRaw(Entity entity, ComponentId id)
+{
+	if (!isAlive(entity)) return nullptr;
+
+	const Record& record = records[entity.index];
+	return record.archetype->getComponent(record.chunk, record.row, id);
+}
+
+bool World::hasRaw(Entity entity, ComponentId id) const
+{
+	return isAlive(entity) && records[entity.index].archetype->has(id);
+}
+
+uint32_t World::getEntityCount() const
+{
+	return entityCount;
+}
@@ -0,0 +1,199 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Archetype.h"
+#include "Component.h"
+#include "../Jobs/JobSystem.h"
+
+// archetype based entity component system. Entities with the same component set share an
+// Archetype and live in its 16KB chunks, so a query walks a handful of contiguous arrays
+// per chunk instead of chasing pointers per entity.
+//
+// Structural changes (create, destroy, add, remove) move rows between chunks and are not
+// allowed while iterating, record them into a CommandBuffer and play it back afterwards.
+class World {
+public:
+	World() = default;
+	~World();
+
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Ts>
+	Entity create(const Ts&... components);
+	// count entities with exactly the components of mask, for loaders that fill chunks in bulk.
+	// fn(archetype, chunk, row, first, rows) is called for every run of rows they were appended
+	// to, rows [row, row + rows) of chunk hold entities [first, first + rows) of the batch.
+	// Components are uninitialized until fn writes them, the entity array is written after it
+	// returns. The handles end up in entities, count long
+	template<typename Fn>
+	void createBatch(ComponentMask mask, uint32_t count, Entity* entities, Fn fn);
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+
+	template<typename T>
+	void add(Entity entity, const T& component);
+	template<typename T>
+	void remove(Entity entity);
+
+	// nullptr if the entity is dead or lacks the component. Only valid until the next
+	// structural change
+	template<typename T>
+	T* get(Entity entity);
+	template<typename T>
+	bool has(Entity entity) const;
+
+	// fn(Ts&...) for every entity that has all of Ts
+	template<typename... Ts, typename Fn>
+	void each(Fn fn);
+
+	// fn(count, entities, Ts* arrays...) once per chunk, the arrays are count long
+	template<typename... Ts, typename Fn>
+	void eachChunk(Fn fn);
+
+	// eachChunk with the chunks spread over the job system, returns once all are done.
+	// Chunks never share rows so writes to the arrays need no synchronization
+	template<typename... Ts, typename Fn>
+	void parallelEachChunk(JobSystem& jobs, Fn fn);
+
+	uint32_t getEntityCount() const;
+
+	// type erased versions the templates and CommandBuffer go through
+	Entity createRaw(const ComponentId* ids, const void* const* data, uint32_t count);
+	void addRaw(Entity entity, ComponentId id, const void* data);
+	void removeRaw(Entity entity, ComponentId id);
+	void* getRaw(Entity entity, ComponentId id);
+	bool hasRaw(Entity entity, ComponentId id) const;
+
+private:
+	struct Record {
+		Archetype* archetype;
+		uint32_t chunk;
+		uint32_t row;
+		uint32_t generation;
+	};
+
+	Archetype* getArchetype(ComponentMask mask);
+	// a free index with its generation, the record is left to the caller
+	Entity allocateEntity();
+	// moves the entity's row into another archetype, copying the components both share
+	void migrate(Entity entity, Archetype* target);
+	void removeRow(Archetype* archetype, uint32_t chunk, uint32_t row);
+
+	template<typename Fn>
+	void forMatchingChunks(ComponentMask mask, Fn fn);
+
+	std::vector<Record> records;
+	std::vector<uint32_t> freeIndices;
+	uint32_t entityCount = 0;
+
+	std::unordered_map<ComponentMask, Archetype*> archetypes;
+	// creation order, keeps iteration deterministic
+	std::vector<Archetype*> archetypeList;
+};
+
+template<typename... Ts>
+Entity World::create(const Ts&... components)
+{
+	ComponentId ids[] = { Components::id<Ts>()..., 0 };
+	const void* data[] = { (const void*)&components..., nullptr };
+	return createRaw(ids, data, sizeof...(Ts));
+}
+
+template<typename Fn>
+void World::createBatch(ComponentMask mask, uint32_t count, Entity* entities, Fn fn)
+{
+	Archetype* archetype = getArchetype(mask);
+
+	for (uint32_t first = 0; first < count;) {
+		uint32_t chunk, row;
+		uint32_t rows = archetype->allocateRows(count - first, chunk, row);
+		Chunk* target = archetype->getChunks()[chunk];
+		fn(archetype, target, row, first, rows);
+
+		Entity* chunkEntities = archetype->getEntities(target);
+		for (uint32_t i = 0; i < rows; i++) {
+			Entity entity = allocateEntity();
+			records[entity.index] = { archetype, chunk, row + i, entity.generation };
+			chunkEntities[row + i] = entity;
+			entities[first + i] = entity;
+		}
+		first += rows;
+	}
+}
+
+template<typename T>
+void World::add(Entity entity, const T& component)
+{
+	addRaw(entity, Components::id<T>(), &component);
+}
+
+template<typename T>
+void World::remove(Entity entity)
+{
+	removeRaw(entity, Components::id<T>());
+}
+
+template<typename T>
+T* World::get(Entity entity)
+{
+	return (T*)getRaw(entity, Components::id<T>());
+}
+
+template<typename T>
+bool World::has(Entity entity) const
+{
+	return hasRaw(entity, Components::id<T>());
+}
+
+template<typename Fn>
+void World::forMatchingChunks(ComponentMask mask, Fn fn)
+{
+	for (Archetype* archetype : archetypeList) {
+		if ((archetype->getMask() & mask) != mask) continue;
+
+		for (Chunk* chunk : archetype->getChunks()) {
+			fn(archetype, chunk);
+		}
+	}
+}
+
+template<typename... Ts, typename Fn>
+void World::eachChunk(Fn fn)
+{
+	forMatchingChunks(Components::mask<Ts...>(), [&](Archetype* archetype, Chunk* chunk) {
+		fn(chunk->count, (const Entity*)archetype->getEntities(chunk), (Ts*)archetype->getArray(chunk, Components::id<Ts>())...);
+	});
+}
+
+template<typename... Ts, typename Fn>
+void World::each(Fn fn)
+{
+	eachChunk<Ts...>([&](uint32_t count, const Entity*, Ts*... arrays) {
+		for (uint32_t i = 0; i < count; i++) {
+			fn(arrays[i]...);
+		}
+	});
+}
+
+template<typename... Ts, typename Fn>
+void World::parallelEachChunk(JobSystem& jobs, Fn fn)
+{
+	std::vector<std::pair<Archetype*, Chunk*>> chunks;
+	forMatchingChunks(Components::mask<Ts...>(), [&](Archetype* archetype, Chunk* chunk) {
+		chunks.emplace_back(archetype, chunk);
+	});
+
+	jobs.parallelFor((uint32_t)chunks.size(), 1, [&](uint32_t i) {
+		Archetype* archetype = chunks[i].first;
+		Chunk* chunk = chunks[i].second;
+		fn(chunk->count, (const Entity*)archetype->getEntities(chunk), (Ts*)archetype->getArray(chunk, Components::id<Ts>())...);
+	});
+}
+
+#endif
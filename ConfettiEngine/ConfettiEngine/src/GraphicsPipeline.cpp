@@ -2,8 +2,8 @@
 #include "Shaders/Shader.h"
 #include <iostream>
 
-GraphicsPipeline::GraphicsPipeline(VkInstance& i, VkDevice& d, VkExtent2D& e, VkFormat& s, std::string v, std::string f)
-	: instance(i), device(d), extents(e), swapChainImageFormat(s)
+GraphicsPipeline::GraphicsPipeline(ResourceManager& r, DeletionQueue& q, VkDevice d, VkExtent2D e, VkFormat s, std::string v, std::string f)
+	: resources(r), deletions(q), device(d), extents(e), swapChainImageFormat(s)
 {
 	createRenderPass();
 
@@ -29,7 +29,7 @@ GraphicsPipeline::GraphicsPipeline(VkInstance& i, VkDevice& d, VkExtent2D& e, Vk
 	fragShaderStageInfo.module = frag;
 	fragShaderStageInfo.pName = "main";
 
-	shaderStages = { vertShaderStageInfo, fragShaderStageInfo };
+	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
 	//************* FIXED PIPELINE SETUP *************//
 	// Vertex input
@@ -144,6 +144,9 @@ GraphicsPipeline::GraphicsPipeline(VkInstance& i, VkDevice& d, VkExtent2D& e, Vk
 	pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
 
 	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		vkDestroyShaderModule(device, vert, nullptr);
+		vkDestroyShaderModule(device, frag, nullptr);
+		vkDestroyRenderPass(device, renderPass, nullptr);
 		throw std::runtime_error("ERROR: Failed to create pipeline layout!");
 	}
 	else std::cout << "Graphics Pipeline Layout created successfully\n";
@@ -152,7 +155,7 @@ GraphicsPipeline::GraphicsPipeline(VkInstance& i, VkDevice& d, VkExtent2D& e, Vk
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = &shaderStages[0];
+	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
 	pipelineInfo.pViewportState = &viewportState;
@@ -172,11 +175,18 @@ GraphicsPipeline::GraphicsPipeline(VkInstance& i, VkDevice& d, VkExtent2D& e, Vk
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
 
-	// vkCreateGraphicsPipeline can actually be used to make multiple VkPipelines in one call
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-		throw std::runtime_error("ERROR: Failed to create graphics pipeline!");
+	// the resource manager takes over the layout once the pipeline exists
+	try {
+		graphicsPipeline = resources.createGraphicsPipeline(pipelineInfo);
 	}
-	else std::cout << "Graphics Pipeline created successfully\n";
+	catch (...) {
+		vkDestroyShaderModule(device, vert, nullptr);
+		vkDestroyShaderModule(device, frag, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyRenderPass(device, renderPass, nullptr);
+		throw;
+	}
+	std::cout << "Graphics Pipeline created successfully\n";
 
 	//************* CLEANUP *************//
 	vkDestroyShaderModule(device, vert, nullptr);
@@ -186,25 +196,24 @@ GraphicsPipeline::GraphicsPipeline(VkInstance& i, VkDevice& d, VkExtent2D& e, Vk
 
 GraphicsPipeline::~GraphicsPipeline()
 {
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+	// the layout goes with the pipeline, both once the frames recorded with them are done
+	deletions.destroy(graphicsPipeline);
+	deletions.defer([device = device, renderPass = renderPass]() { vkDestroyRenderPass(device, renderPass, nullptr); });
 }
 
-GraphicsPipeline& GraphicsPipeline::operator=(const GraphicsPipeline& other)
+VkPipelineLayout GraphicsPipeline::getLayout() const
 {
-	if (&other != this) {
-		instance = other.instance;
-		device = other.device;
-		extents = other.extents;
-		shaderStages = other.shaderStages;
-	}
-	return *this;
+	return pipelineLayout;
 }
 
-const VkPipelineLayout& GraphicsPipeline::getLayout()
+PipelineHandle GraphicsPipeline::getPipeline() const
 {
-	return pipelineLayout;
+	return graphicsPipeline;
+}
+
+VkRenderPass GraphicsPipeline::getRenderPass() const
+{
+	return renderPass;
 }
 
 VkShaderModule GraphicsPipeline::createModule(const std::vector<char>& code)
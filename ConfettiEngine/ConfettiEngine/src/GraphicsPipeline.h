@@ -6,36 +6,40 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-class Application;
+#include "Resources/DeletionQueue.h"
+#include "Resources/ResourceManager.h"
 
+// the pipeline and its layout live in the ResourceManager, the render pass here. Extent and
+// format are copied, a new swap chain needs a new pipeline. Destroying it hands everything to
+// the DeletionQueue, frames still in flight can keep drawing with it
 class GraphicsPipeline {
 public:
-	GraphicsPipeline(VkInstance& i, VkDevice& d, VkExtent2D& e, VkFormat& s, std::string v, std::string f);
-	// GraphicsPipeline(VkInstance& i, VkDevice& d, std::string v, std::string g, std::string f);
+	GraphicsPipeline(ResourceManager& r, DeletionQueue& q, VkDevice d, VkExtent2D e, VkFormat s, std::string v, std::string f);
+	// GraphicsPipeline(ResourceManager& r, DeletionQueue& q, VkDevice d, VkExtent2D e, VkFormat s, std::string v, std::string g, std::string f);
 	~GraphicsPipeline();
 
-	GraphicsPipeline& operator=(const GraphicsPipeline& other);
+	GraphicsPipeline(const GraphicsPipeline&) = delete;
+	GraphicsPipeline& operator=(const GraphicsPipeline&) = delete;
 
-	const VkPipelineLayout& getLayout();
+	VkPipelineLayout getLayout() const;
+	PipelineHandle getPipeline() const;
+	VkRenderPass getRenderPass() const;
 
 private:
-	friend class Application;
-
 	VkShaderModule createModule(const std::vector<char>& code);
 
-	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
-
-	VkRenderPass renderPass;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
 	void createRenderPass();
 
-	VkPipelineLayout pipelineLayout;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
 
-	VkPipeline graphicsPipeline;
+	PipelineHandle graphicsPipeline;
 
-	VkExtent2D& extents;
-	VkInstance& instance;
-	VkDevice& device;
-	VkFormat& swapChainImageFormat;
+	ResourceManager& resources;
+	DeletionQueue& deletions;
+	VkDevice device;
+	VkExtent2D extents;
+	VkFormat swapChainImageFormat;
 };
 
 #endif
\ No newline at end of file
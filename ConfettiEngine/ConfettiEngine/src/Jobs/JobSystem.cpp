@@ -0,0 +1,275 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <iostream>
+
+struct TaskGroup::Job {
+	std::function<void()> task;
+	TaskGroup* group;
+};
+
+// which system and worker the calling thread belongs to
+static thread_local JobSystem* currentSystem = nullptr;
+static thread_local uint32_t currentThread = JobSystem::INVALID_THREAD;
+
+// idle rounds before a worker goes to sleep
+static const uint32_t SPIN_COUNT = 64;
+
+void TaskGroup::dependsOn(TaskGroup& prerequisite)
+{
+	std::lock_guard<std::mutex> guard(prerequisite.lock);
+	if (prerequisite.finished) return;
+
+	prerequisite.dependents.push_back(this);
+	blockers.fetch_add(1);
+	pending.fetch_add(1);
+}
+
+bool TaskGroup::isFinished() const
+{
+	if (pending.load(std::memory_order_acquire) > 0) return false;
+
+	// the finishing thread sets the flag under the lock, taking it here means it is done
+	// with the group and the caller is free to destroy it
+	std::lock_guard<std::mutex> guard(lock);
+	return finished;
+}
+
+JobSystem::JobSystem(uint32_t threadCount)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+		workers.push_back(std::make_unique<Worker>());
+	}
+
+	// the creating thread is worker 0 and only helps while waiting
+	currentSystem = this;
+	currentThread = 0;
+
+	for (uint32_t i = 1; i < threadCount; i++) {
+		workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+	}
+
+	std::cout << "Job System created successfully (" << threadCount << " threads)\n";
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping.store(true);
+	}
+	wake.notify_all();
+
+	for (auto& worker : workers) {
+		if (worker->thread.joinable()) worker->thread.join();
+	}
+
+	if (currentSystem == this) {
+		currentSystem = nullptr;
+		currentThread = INVALID_THREAD;
+	}
+}
+
+void JobSystem::run(TaskGroup& group, std::function<void()> task)
+{
+	TaskGroup::Job* job = new TaskGroup::Job{ std::move(task), &group };
+	group.pending.fetch_add(1);
+
+	if (group.blockers.load() > 0) {
+		// recheck under the lock, release takes the held list under the same lock
+		std::lock_guard<std::mutex> guard(group.lock);
+		if (group.blockers.load() > 0) {
+			group.held.push_back(job);
+			return;
+		}
+	}
+
+	enqueue(job);
+}
+
+void JobSystem::enqueue(TaskGroup::Job* job)
+{
+	uint32_t thread = getThreadIndex();
+
+	if (thread != INVALID_THREAD) {
+		if (!workers[thread]->deque.push(job)) {
+			// deque full, running it here is the cheapest way out
+			execute(job);
+			return;
+		}
+	}
+	else {
+		std::lock_guard<std::mutex> guard(injectLock);
+		injected.push_back(job);
+		injectedCount.fetch_add(1);
+	}
+
+	// pairs with the sleeping increment in workerLoop, one side always sees the other
+	queued.fetch_add(1);
+	if (sleeping.load() > 0) {
+		std::lock_guard<std::mutex> guard(sleepLock);
+		wake.notify_one();
+	}
+}
+
+TaskGroup::Job* JobSystem::findJob(uint32_t thread)
+{
+	TaskGroup::Job* job = nullptr;
+
+	if (thread != INVALID_THREAD) {
+		job = workers[thread]->deque.pop();
+	}
+
+	if (!job && injectedCount.load(std::memory_order_relaxed) > 0) {
+		std::lock_guard<std::mutex> guard(injectLock);
+		if (!injected.empty()) {
+			job = injected.back();
+			injected.pop_back();
+			injectedCount.fetch_sub(1);
+		}
+	}
+
+	if (!job) {
+		// start at a random victim so thieves don't all pile onto worker 0
+		static thread_local uint32_t seed = 0x9E3779B9u ^ (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		uint32_t count = (uint32_t)workers.size();
+		for (uint32_t i = 0; i < count && !job; i++) {
+			uint32_t victim = (seed + i) % count;
+			if (victim == thread) continue;
+			job = workers[victim]->deque.steal();
+		}
+	}
+
+	if (job) queued.fetch_sub(1);
+	return job;
+}
+
+void JobSystem::execute(TaskGroup::Job* job)
+{
+	job->task();
+
+	TaskGroup& group = *job->group;
+	delete(job);
+	finish(group);
+}
+
+void JobSystem::finish(TaskGroup& group)
+{
+	if (group.pending.fetch_sub(1) != 1) return;
+
+	std::vector<TaskGroup*> dependents;
+	{
+		std::lock_guard<std::mutex> guard(group.lock);
+		group.finished = true;
+		dependents.swap(group.dependents);
+	}
+	// group may be destroyed by a waiter from here on
+
+	for (TaskGroup* dependent : dependents) {
+		if (dependent->blockers.fetch_sub(1) == 1) {
+			release(*dependent);
+		}
+		else {
+			finish(*dependent);
+		}
+	}
+}
+
+void JobSystem::release(TaskGroup& group)
+{
+	std::vector<TaskGroup::Job*> jobs;
+	{
+		std::lock_guard<std::mutex> guard(group.lock);
+		jobs.swap(group.held);
+	}
+
+	for (TaskGroup::Job* job : jobs) {
+		enqueue(job);
+	}
+
+	// drop the reference the last prerequisite held
+	finish(group);
+}
+
+void JobSystem::submit(TaskGroup& group)
+{
+	if (group.submitted) return;
+
+	group.submitted = true;
+	finish(group);
+}
+
+void JobSystem::wait(TaskGroup& group)
+{
+	submit(group);
+
+	uint32_t thread = getThreadIndex();
+	while (!group.isFinished()) {
+		TaskGroup::Job* job = findJob(thread);
+		if (job) execute(job);
+		else std::this_thread::yield();
+	}
+}
+
+void JobSystem::runRange(TaskGroup& group, std::shared_ptr<RangeBody> body, uint32_t begin, uint32_t end, uint32_t grain)
+{
+	uint32_t thread = getThreadIndex();
+
+	while (begin < end) {
+		// lazy binary splitting: only hand work off when there's nothing left for thieves
+		if (end - begin > grain && (thread == INVALID_THREAD || workers[thread]->deque.empty())) {
+			uint32_t mid = begin + (end - begin) / 2;
+			run(group, [this, &group, body, mid, end, grain]() { runRange(group, body, mid, end, grain); });
+			end = mid;
+			continue;
+		}
+
+		uint32_t chunkEnd = std::min(end, begin + grain);
+		(*body)(begin, chunkEnd);
+		begin = chunkEnd;
+	}
+}
+
+void JobSystem::workerLoop(uint32_t thread)
+{
+	currentSystem = this;
+	currentThread = thread;
+
+	uint32_t idle = 0;
+	while (!stopping.load(std::memory_order_relaxed)) {
+		TaskGroup::Job* job = findJob(thread);
+		if (job) {
+			execute(job);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < SPIN_COUNT) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		sleeping.fetch_add(1);
+		wake.wait(guard, [this]() { return stopping.load() || queued.load() > 0; });
+		sleeping.fetch_sub(1);
+		idle = 0;
+	}
+}
+
+uint32_t JobSystem::getThreadCount() const
+{
+	return (uint32_t)workers.size();
+}
+
+uint32_t JobSystem::getThreadIndex() const
+{
+	return currentSystem == this ? currentThread : INVALID_THREAD;
+}
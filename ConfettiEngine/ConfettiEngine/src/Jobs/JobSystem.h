@@ -0,0 +1,151 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WorkStealingDeque.h"
+
+class JobSystem;
+
+// a set of jobs that finish together. Groups can depend on other groups, jobs run into a
+// blocked group are held back until every prerequisite has finished.
+// One shot: add dependencies first, run jobs into it, then submit (or wait) to close it.
+//
+//    TaskGroup cull, record;
+//    record.dependsOn(cull);
+//    jobs.parallelFor(cull, count, 64, [&](uint32_t i) { ... });
+//    jobs.run(record, [&]() { ... });
+//    jobs.submit(cull);
+//    jobs.wait(record);
+class TaskGroup {
+public:
+	TaskGroup() = default;
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	// must be called before any job is run into this group
+	void dependsOn(TaskGroup& prerequisite);
+
+	bool isFinished() const;
+
+private:
+	friend class JobSystem;
+
+	struct Job;
+
+	// jobs queued or running, plus one held by the builder until submit and one per
+	// unfinished prerequisite, so a blocked group can't finish early
+	std::atomic<int32_t> pending{ 1 };
+	// unfinished prerequisite groups
+	std::atomic<int32_t> blockers{ 0 };
+	bool submitted = false;
+
+	// only touched when a group blocks, releases or finishes
+	mutable std::mutex lock;
+	bool finished = false;
+	std::vector<Job*> held;
+	std::vector<TaskGroup*> dependents;
+};
+
+// fixed pool of workers, one per core with the thread that creates the system counting as
+// worker 0. Every worker owns a work-stealing deque, idle workers steal from the others
+// and sleep when nothing is queued anywhere. The creating thread has no loop of its own,
+// it runs jobs while it waits on a group.
+// Threads outside the pool can still run jobs, they go through a locked injection queue.
+class JobSystem {
+public:
+	// 0 = one worker per hardware thread
+	JobSystem(uint32_t threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void run(TaskGroup& group, std::function<void()> task);
+
+	// fn(i) for i in [0, count). The range is split lazily, a job only hands off half of its
+	// remaining range while its own deque is empty, so chunks adapt to how busy the pool is.
+	// grain is the smallest range that is ever split off
+	template<typename Fn>
+	void parallelFor(TaskGroup& group, uint32_t count, uint32_t grain, Fn fn);
+
+	// blocking version, the calling thread works on the range as well
+	template<typename Fn>
+	void parallelFor(uint32_t count, uint32_t grain, Fn fn);
+
+	// no more jobs will be added, the group finishes once its jobs do
+	void submit(TaskGroup& group);
+
+	// submits if needed and runs jobs on the calling thread until the group has finished
+	void wait(TaskGroup& group);
+
+	uint32_t getThreadCount() const;
+
+	// index of the calling worker, INVALID_THREAD for threads outside the pool
+	uint32_t getThreadIndex() const;
+
+	static const uint32_t INVALID_THREAD = 0xFFFFFFFF;
+
+private:
+	using RangeBody = std::function<void(uint32_t, uint32_t)>;
+
+	void enqueue(TaskGroup::Job* job);
+	TaskGroup::Job* findJob(uint32_t thread);
+	void execute(TaskGroup::Job* job);
+	void finish(TaskGroup& group);
+	void release(TaskGroup& group);
+
+	void runRange(TaskGroup& group, std::shared_ptr<RangeBody> body, uint32_t begin, uint32_t end, uint32_t grain);
+	void workerLoop(uint32_t thread);
+
+	struct alignas(64) Worker {
+		WorkStealingDeque<TaskGroup::Job> deque;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	// jobs pushed by threads outside the pool
+	std::mutex injectLock;
+	std::vector<TaskGroup::Job*> injected;
+	std::atomic<int32_t> injectedCount{ 0 };
+
+	// queued jobs across every deque, lets idle workers sleep without missing a push
+	std::atomic<int32_t> queued{ 0 };
+	std::atomic<int32_t> sleeping{ 0 };
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<bool> stopping{ false };
+};
+
+template<typename Fn>
+void JobSystem::parallelFor(TaskGroup& group, uint32_t count, uint32_t grain, Fn fn)
+{
+	if (count == 0) return;
+
+	auto body = std::make_shared<RangeBody>([fn](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			fn(i);
+		}
+	});
+
+	uint32_t g = grain > 0 ? grain : 1;
+	run(group, [this, &group, body, count, g]() { runRange(group, body, 0, count, g); });
+}
+
+template<typename Fn>
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, Fn fn)
+{
+	TaskGroup group;
+	parallelFor(group, count, grain, fn);
+	wait(group);
+}
+
+#endif
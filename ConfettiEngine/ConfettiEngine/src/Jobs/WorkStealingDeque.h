@@ -0,0 +1,85 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstdint>
+
+// Chase-Lev deque with the C11 memory orders from Le et al. "Correct and Efficient
+// Work-Stealing for Weak Memory Models". The owning thread pushes and pops at the bottom
+// (LIFO, keeps caches warm), any other thread steals from the top (FIFO, takes the oldest
+// and usually largest work). Fixed capacity, push fails when full and the caller runs the
+// item itself.
+template<typename T, uint32_t CAPACITY = 4096>
+class WorkStealingDeque {
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+	// owner only
+	bool push(T* item)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= (int64_t)CAPACITY) return false;
+
+		buffer[b & (CAPACITY - 1)].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// owner only
+	T* pop()
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			// empty
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (t == b) {
+			// last item, race the thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				item = nullptr;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// any thread
+	T* steal()
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b) return nullptr;
+
+		T* item = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			// lost to another thief or the owner
+			return nullptr;
+		}
+		return item;
+	}
+
+	// approximate when called from a thief
+	bool empty() const
+	{
+		return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+	}
+
+private:
+	// top and bottom on separate cache lines, thieves hammer top while the owner works bottom
+	alignas(64) std::atomic<int64_t> top{ 0 };
+	alignas(64) std::atomic<int64_t> bottom{ 0 };
+	alignas(64) std::atomic<T*> buffer[CAPACITY];
+};
+
+#endif
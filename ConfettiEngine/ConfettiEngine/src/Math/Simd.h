@@ -0,0 +1,214 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+// thin wrapper over the intrinsics glm selects in glm/simd/platform.h, so a kernel is written once
+// and compiles to 8 wide AVX, 4 wide SSE or plain scalar code depending on GLM_ARCH.
+// Requires GLM_FORCE_INTRINSICS for anything but the scalar path.
+// Masks are full lanes of set bits, as returned by the comparisons.
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/common.h>
+#include <glm/simd/matrix.h>
+#endif
+
+namespace Simd {
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+
+	typedef __m256 Float;
+	const uint32_t WIDTH = 8;
+
+	inline Float set1(float f) { return _mm256_set1_ps(f); }
+	inline Float zero() { return _mm256_setzero_ps(); }
+	// 0, 1, 2 ... WIDTH - 1
+	inline Float laneOffsets() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+	inline Float load(const float* p) { return _mm256_loadu_ps(p); }
+	inline void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+
+	inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	inline Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	inline Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	inline Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+	inline Float round(Float a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+	inline Float cmpge(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	inline Float cmplt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline Float bitAnd(Float a, Float b) { return _mm256_and_ps(a, b); }
+	inline Float bitOr(Float a, Float b) { return _mm256_or_ps(a, b); }
+	// lanes of b where mask is set, otherwise a
+	inline Float select(Float a, Float b, Float mask) { return _mm256_blendv_ps(a, b, mask); }
+	inline int moveMask(Float mask) { return _mm256_movemask_ps(mask); }
+
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+
+	typedef glm_vec4 Float;
+	const uint32_t WIDTH = 4;
+
+	inline Float set1(float f) { return _mm_set1_ps(f); }
+	inline Float zero() { return _mm_setzero_ps(); }
+	inline Float laneOffsets() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+	inline Float load(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+
+	inline Float add(Float a, Float b) { return glm_vec4_add(a, b); }
+	inline Float sub(Float a, Float b) { return glm_vec4_sub(a, b); }
+	inline Float mul(Float a, Float b) { return glm_vec4_mul(a, b); }
+	inline Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+	inline Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+	// through a 32 bit integer, so only for |a| < 2^31
+	inline Float round(Float a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+
+	inline Float cmpge(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+	inline Float cmplt(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+	inline Float bitAnd(Float a, Float b) { return _mm_and_ps(a, b); }
+	inline Float bitOr(Float a, Float b) { return _mm_or_ps(a, b); }
+#if GLM_ARCH & GLM_ARCH_SSE41_BIT
+	inline Float select(Float a, Float b, Float mask) { return _mm_blendv_ps(a, b, mask); }
+#else
+	inline Float select(Float a, Float b, Float mask) { return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a)); }
+#endif
+	inline int moveMask(Float mask) { return _mm_movemask_ps(mask); }
+
+#else
+
+	typedef float Float;
+	const uint32_t WIDTH = 1;
+
+	inline Float fromBits(uint32_t bits) { Float f; memcpy(&f, &bits, sizeof(f)); return f; }
+	inline uint32_t toBits(Float f) { uint32_t bits; memcpy(&bits, &f, sizeof(bits)); return bits; }
+
+	inline Float set1(float f) { return f; }
+	inline Float zero() { return 0.0f; }
+	inline Float laneOffsets() { return 0.0f; }
+	inline Float load(const float* p) { return *p; }
+	inline void store(float* p, Float v) { *p = v; }
+
+	inline Float add(Float a, Float b) { return a + b; }
+	inline Float sub(Float a, Float b) { return a - b; }
+	inline Float mul(Float a, Float b) { return a * b; }
+	inline Float min(Float a, Float b) { return a < b ? a : b; }
+	inline Float max(Float a, Float b) { return a > b ? a : b; }
+	inline Float round(Float a) { return std::nearbyint(a); }
+
+	inline Float cmpge(Float a, Float b) { return fromBits(a >= b ? ~0u : 0u); }
+	inline Float cmplt(Float a, Float b) { return fromBits(a < b ? ~0u : 0u); }
+	inline Float bitAnd(Float a, Float b) { return fromBits(toBits(a) & toBits(b)); }
+	inline Float bitOr(Float a, Float b) { return fromBits(toBits(a) | toBits(b)); }
+	inline Float select(Float a, Float b, Float mask) { return toBits(mask) ? b : a; }
+	inline int moveMask(Float mask) { return toBits(mask) >> 31; }
+
+#endif
+
+	// a * b + c, fused when the target has FMA (implied by /arch:AVX2 on msvc)
+#if (GLM_ARCH & GLM_ARCH_AVX2_BIT) && (defined(__FMA__) || defined(_MSC_VER))
+	inline Float madd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+	inline Float madd(Float a, Float b, Float c) { return add(mul(a, b), c); }
+#endif
+	inline bool any(Float mask) { return moveMask(mask) != 0; }
+
+	// stream compaction of one moveMask: writes base + lane for every set lane packed to the
+	// front of out and returns how many there were. Always stores WIDTH values, so out needs
+	// WIDTH - 1 entries of slack past the last real one
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+	// per mask: the set lanes as 3 bit indices, the count in the top byte
+	struct CompressTable {
+		uint32_t entries[256];
+
+		constexpr CompressTable() : entries() {
+			for (uint32_t mask = 0; mask < 256; mask++) {
+				uint32_t count = 0;
+				for (uint32_t lane = 0; lane < 8; lane++) {
+					if (mask & (1 << lane)) entries[mask] |= lane << (3 * count++);
+				}
+				entries[mask] |= count << 24;
+			}
+		}
+	};
+	inline constexpr CompressTable COMPRESS_TABLE{};
+
+	inline uint32_t compress(int mask, uint32_t base, uint32_t* out) {
+		uint32_t entry = COMPRESS_TABLE.entries[mask];
+		__m256i lanes = _mm256_srlv_epi32(_mm256_set1_epi32((int)entry), _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21));
+		lanes = _mm256_and_si256(lanes, _mm256_set1_epi32(7));
+		_mm256_storeu_si256((__m256i*)out, _mm256_add_epi32(lanes, _mm256_set1_epi32((int)base)));
+		return entry >> 24;
+	}
+#else
+	inline uint32_t compress(int mask, uint32_t base, uint32_t* out) {
+		uint32_t count = 0;
+		for (uint32_t lane = 0; lane < WIDTH; lane++) {
+			out[count] = base + lane;
+			count += (mask >> lane) & 1;
+		}
+		return count;
+	}
+#endif
+};
+
+// always four lanes, for data that is naturally four wide such as BVH nodes
+namespace Simd4 {
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+
+	typedef glm_vec4 Float;
+
+	inline Float set1(float f) { return _mm_set1_ps(f); }
+	// p must be 16 byte aligned
+	inline Float load(const float* p) { return _mm_load_ps(p); }
+	inline void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+
+	inline Float add(Float a, Float b) { return glm_vec4_add(a, b); }
+	inline Float sub(Float a, Float b) { return glm_vec4_sub(a, b); }
+	inline Float mul(Float a, Float b) { return glm_vec4_mul(a, b); }
+	inline Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+	inline Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+	inline Float cmplt(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+	inline Float cmple(Float a, Float b) { return _mm_cmple_ps(a, b); }
+	inline Float bitAnd(Float a, Float b) { return _mm_and_ps(a, b); }
+	inline Float bitOr(Float a, Float b) { return _mm_or_ps(a, b); }
+	inline int moveMask(Float mask) { return _mm_movemask_ps(mask); }
+
+#else
+
+	struct Float {
+		float v[4];
+	};
+
+	inline Float set1(float f) { return { { f, f, f, f } }; }
+	inline Float load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+	inline void store(float* p, Float v) { memcpy(p, v.v, sizeof(v.v)); }
+
+	template<typename Op>
+	inline Float apply(Float a, Float b, Op op) {
+		return { { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) } };
+	}
+
+	inline Float add(Float a, Float b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+	inline Float sub(Float a, Float b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+	inline Float mul(Float a, Float b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+	inline Float min(Float a, Float b) { return apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+	inline Float max(Float a, Float b) { return apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+
+	// comparisons keep 1 or 0 per lane, only ever consumed by bitAnd/bitOr/moveMask
+	inline Float cmplt(Float a, Float b) { return apply(a, b, [](float x, float y) { return x < y ? 1.0f : 0.0f; }); }
+	inline Float cmple(Float a, Float b) { return apply(a, b, [](float x, float y) { return x <= y ? 1.0f : 0.0f; }); }
+	inline Float bitAnd(Float a, Float b) { return apply(a, b, [](float x, float y) { return (x != 0.0f && y != 0.0f) ? 1.0f : 0.0f; }); }
+	inline Float bitOr(Float a, Float b) { return apply(a, b, [](float x, float y) { return (x != 0.0f || y != 0.0f) ? 1.0f : 0.0f; }); }
+	inline int moveMask(Float mask) {
+		return (mask.v[0] != 0.0f) | (mask.v[1] != 0.0f) << 1 | (mask.v[2] != 0.0f) << 2 | (mask.v[3] != 0.0f) << 3;
+	}
+
+#endif
+
+	inline Float madd(Float a, Float b, Float c) { return add(mul(a, b), c); }
+};
+
+#endif
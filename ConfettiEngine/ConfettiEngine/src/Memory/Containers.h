@@ -0,0 +1,96 @@
+#ifndef CONTAINERS_H
+#define CONTAINERS_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "LinearArena.h"
+#include "Pool.h"
+#include "ScratchArena.h"
+
+// standard allocator over a LinearArena. Deallocation does nothing, the memory goes when the
+// arena is rewound or reset, so containers must not outlive their scope or frame and a vector
+// that grows leaves its old storage behind, reserve up front where the size is known.
+// Default constructed allocators use the calling thread's scratch arena, containers made that
+// way stay on that thread and inside the ScratchScope they were made in
+template<typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	ArenaAllocator() : arena(&Scratch::get()) {}
+	ArenaAllocator(LinearArena& a) : arena(&a) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return arena->allocate<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+	LinearArena* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+template<typename T, typename Less = std::less<T>>
+using ArenaSet = std::set<T, Less, ArenaAllocator<T>>;
+template<typename K, typename V, typename Less = std::less<K>>
+using ArenaMap = std::map<K, V, Less, ArenaAllocator<std::pair<const K, V>>>;
+
+// standard allocator for node based containers over a Pool. Single objects that fit the
+// pool's blocks come from it, anything else (bucket arrays, containers of larger nodes) from
+// the heap, so size the pool for the container's node, which is implementation defined: a
+// few pointers plus the value. Not thread safe, like the pool
+template<typename T>
+class PoolAllocator {
+public:
+	typedef T value_type;
+
+	PoolAllocator(Pool& p) : pool(&p) {}
+	template<typename U>
+	PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+	T* allocate(size_t count)
+	{
+		if (fits(count)) return (T*)pool->allocate();
+		return (T*)::operator new(count * sizeof(T), std::align_val_t(alignof(T)));
+	}
+	void deallocate(T* pointer, size_t count)
+	{
+		if (fits(count)) pool->free(pointer);
+		else ::operator delete(pointer, std::align_val_t(alignof(T)));
+	}
+
+	template<typename U>
+	bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+	template<typename U>
+	bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+
+	Pool* pool;
+
+private:
+	bool fits(size_t count) const { return count == 1 && sizeof(T) <= pool->getBlockSize() && alignof(T) <= pool->getAlignment(); }
+};
+
+template<typename T>
+using PoolList = std::list<T, PoolAllocator<T>>;
+template<typename T, typename Less = std::less<T>>
+using PoolSet = std::set<T, Less, PoolAllocator<T>>;
+template<typename K, typename V, typename Less = std::less<K>>
+using PoolMap = std::map<K, V, Less, PoolAllocator<std::pair<const K, V>>>;
+template<typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+using PoolHashMap = std::unordered_map<K, V, Hash, Equal, PoolAllocator<std::pair<const K, V>>>;
+
+#endif
@@ -0,0 +1,37 @@
+#include "FrameArena.h"
+#include <iostream>
+#include <stdexcept>
+
+FrameArena::FrameArena(size_t capacity, uint32_t frames)
+{
+	if (frames == 0) {
+		throw std::runtime_error("ERROR: Frame arenas need at least one frame!");
+	}
+
+	for (uint32_t i = 0; i < frames; i++) {
+		arenas.push_back(std::make_unique<LinearArena>(capacity));
+	}
+
+	std::cout << "Frame Arena created (" << frames << " x " << (capacity >> 10) << " KB)\n";
+}
+
+void FrameArena::beginFrame()
+{
+	current = (current + 1) % (uint32_t)arenas.size();
+	arenas[current]->reset();
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	return arenas[current]->allocate(bytes, alignment);
+}
+
+LinearArena& FrameArena::get()
+{
+	return *arenas[current];
+}
+
+uint32_t FrameArena::getFrameCount() const
+{
+	return (uint32_t)arenas.size();
+}
@@ -0,0 +1,47 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "LinearArena.h"
+
+// memory that lives for a frame and then some: one LinearArena per frame in flight, used in
+// turn. beginFrame moves on to the next one and resets it, so what a frame allocated stays
+// valid while the frames after it are built, until that frame's arena comes around again.
+// With two frames in flight everything survives into the next frame, long enough for jobs and
+// command buffers recorded from it. Main thread only, jobs get their memory handed out before
+// they start or use their thread's scratch arena
+class FrameArena {
+public:
+	// capacity per frame, the arenas grow to what the busiest frame needed
+	FrameArena(size_t capacity, uint32_t frames);
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// call before anything is allocated for the frame
+	void beginFrame();
+
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	template<typename T>
+	T* allocate(size_t count);
+
+	// the current frame's arena, for ArenaAllocator
+	LinearArena& get();
+	uint32_t getFrameCount() const;
+
+private:
+	std::vector<std::unique_ptr<LinearArena>> arenas;
+	uint32_t current = 0;
+};
+
+template<typename T>
+T* FrameArena::allocate(size_t count)
+{
+	return arenas[current]->allocate<T>(count);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "LinearArena.h"
+#include <algorithm>
+#include <new>
+
+// the block is cache line aligned so the first allocation of any type lands on a line
+static const size_t BLOCK_ALIGNMENT = 64;
+
+LinearArena::LinearArena(size_t c)
+	: capacity(c)
+{
+	if (capacity > 0) block = (uint8_t*)::operator new(capacity, std::align_val_t(BLOCK_ALIGNMENT));
+}
+
+LinearArena::~LinearArena()
+{
+	freeOverflow(0);
+	if (block) ::operator delete(block, std::align_val_t(BLOCK_ALIGNMENT));
+}
+
+void* LinearArena::allocate(size_t bytes, size_t alignment)
+{
+	uintptr_t address = ((uintptr_t)block + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	size_t end = address - (uintptr_t)block + bytes;
+	if (block && end <= capacity) {
+		offset = end;
+		peak = std::max(peak, offset + overflowBytes);
+		return (void*)address;
+	}
+
+	// doesn't fit, the heap takes it until the arena is empty again and grows to cover it
+	void* memory = ::operator new(std::max<size_t>(bytes, 1), std::align_val_t(std::max(alignment, alignof(std::max_align_t))));
+	overflow.push_back({ memory, bytes, alignment });
+	overflowBytes += bytes + alignment;
+	peak = std::max(peak, offset + overflowBytes);
+	return memory;
+}
+
+LinearArena::Marker LinearArena::getMarker() const
+{
+	return { offset, overflow.size() };
+}
+
+void LinearArena::rewind(const Marker& marker)
+{
+	freeOverflow(marker.overflowCount);
+	offset = marker.offset;
+
+	// empty and too small for what the last round needed, nothing points into the block
+	if (offset == 0 && peak > capacity) {
+		if (block) ::operator delete(block, std::align_val_t(BLOCK_ALIGNMENT));
+		capacity = (peak + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+		block = (uint8_t*)::operator new(capacity, std::align_val_t(BLOCK_ALIGNMENT));
+	}
+}
+
+void LinearArena::reset()
+{
+	rewind({ 0, 0 });
+}
+
+void LinearArena::freeOverflow(size_t count)
+{
+	while (overflow.size() > count) {
+		const Overflow& last = overflow.back();
+		::operator delete(last.memory, std::align_val_t(std::max(last.alignment, alignof(std::max_align_t))));
+		overflowBytes -= last.bytes + last.alignment;
+		overflow.pop_back();
+	}
+}
+
+size_t LinearArena::getUsed() const
+{
+	return offset + overflowBytes;
+}
+
+size_t LinearArena::getCapacity() const
+{
+	return capacity;
+}
+
+size_t LinearArena::getPeak() const
+{
+	return peak;
+}
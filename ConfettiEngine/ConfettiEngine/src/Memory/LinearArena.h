@@ -0,0 +1,71 @@
+#ifndef LINEAR_ARENA_H
+#define LINEAR_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// bump allocator over one block. Allocating moves an offset, nothing is freed on its own,
+// rewinding to a marker or resetting gives everything after it back at once without touching
+// the allocations. Allocations that don't fit go to the heap one block each and are freed on
+// the next rewind past them. Once the arena is empty again the block grows to the high water
+// mark, so a workload that repeats (a frame, a query) stops reaching the heap after its first
+// round. Not thread safe, every thread needs its own (see ScratchArena.h)
+class LinearArena {
+public:
+	// capacity 0 starts without a block, the first round's high water mark sizes it
+	explicit LinearArena(size_t capacity);
+	~LinearArena();
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	// alignment is a power of two, never nullptr
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	// uninitialised room for count Ts, constructing them is up to the caller
+	template<typename T>
+	T* allocate(size_t count);
+
+	struct Marker {
+		size_t offset;
+		size_t overflowCount;
+	};
+
+	Marker getMarker() const;
+	// frees everything allocated after marker was taken, markers taken since are invalid
+	void rewind(const Marker& marker);
+	// frees everything, O(1) unless the arena overflowed since the last reset
+	void reset();
+
+	// bytes handed out since the last reset, overflow included
+	size_t getUsed() const;
+	size_t getCapacity() const;
+	// most bytes ever in use at once
+	size_t getPeak() const;
+
+private:
+	// frees the overflow blocks past the first count
+	void freeOverflow(size_t count);
+
+	uint8_t* block = nullptr;
+	size_t capacity = 0;
+	size_t offset = 0;
+	size_t peak = 0;
+
+	struct Overflow {
+		void* memory;
+		size_t bytes;
+		size_t alignment;
+	};
+	std::vector<Overflow> overflow;
+	size_t overflowBytes = 0;
+};
+
+template<typename T>
+T* LinearArena::allocate(size_t count)
+{
+	return (T*)allocate(sizeof(T) * count, alignof(T));
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "Pool.h"
+#include <algorithm>
+#include <stdexcept>
+
+Pool::Pool(size_t size, size_t a, size_t perPage)
+	: alignment(std::max(a, alignof(FreeBlock))), blocksPerPage(perPage)
+{
+	if ((alignment & (alignment - 1)) != 0) {
+		throw std::runtime_error("ERROR: Pool alignment must be a power of two!");
+	}
+	if (blocksPerPage == 0) {
+		throw std::runtime_error("ERROR: Pool pages need at least one block!");
+	}
+
+	// every block is aligned when the first one is
+	blockSize = (std::max(size, sizeof(FreeBlock)) + alignment - 1) & ~(alignment - 1);
+}
+
+Pool::~Pool()
+{
+	for (void* page : pages) {
+		::operator delete(page, std::align_val_t(alignment));
+	}
+}
+
+void* Pool::allocate()
+{
+	if (!freeList) addPage();
+
+	FreeBlock* block = freeList;
+	freeList = block->next;
+	liveCount++;
+	return block;
+}
+
+void Pool::free(void* block)
+{
+	if (!block) return;
+
+	FreeBlock* freed = (FreeBlock*)block;
+	freed->next = freeList;
+	freeList = freed;
+	liveCount--;
+}
+
+void Pool::addPage()
+{
+	uint8_t* page = (uint8_t*)::operator new(blockSize * blocksPerPage, std::align_val_t(alignment));
+	pages.push_back(page);
+
+	// threaded back to front so blocks are handed out in address order
+	for (size_t i = blocksPerPage; i-- > 0;) {
+		FreeBlock* block = (FreeBlock*)(page + i * blockSize);
+		block->next = freeList;
+		freeList = block;
+	}
+}
+
+size_t Pool::getBlockSize() const
+{
+	return blockSize;
+}
+
+size_t Pool::getAlignment() const
+{
+	return alignment;
+}
+
+size_t Pool::getLiveCount() const
+{
+	return liveCount;
+}
+
+size_t Pool::getPageCount() const
+{
+	return pages.size();
+}
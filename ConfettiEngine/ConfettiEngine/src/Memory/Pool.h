@@ -0,0 +1,85 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// fixed size blocks in O(1): freed blocks go onto an intrusive free list and are handed out
+// again first, pages of blocksPerPage blocks are added when the list runs dry and only given
+// back when the pool goes away. Not thread safe
+class Pool {
+public:
+	// blockSize is rounded up to hold a pointer and keep alignment
+	Pool(size_t blockSize, size_t alignment = alignof(std::max_align_t), size_t blocksPerPage = 256);
+	// every block has to be freed already, their memory goes with the pool
+	~Pool();
+
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	void* allocate();
+	// block must come from this pool
+	void free(void* block);
+
+	size_t getBlockSize() const;
+	size_t getAlignment() const;
+	// blocks handed out and not freed
+	size_t getLiveCount() const;
+	size_t getPageCount() const;
+
+private:
+	void addPage();
+
+	size_t blockSize;
+	size_t alignment;
+	size_t blocksPerPage;
+
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+	FreeBlock* freeList = nullptr;
+	size_t liveCount = 0;
+
+	std::vector<void*> pages;
+};
+
+// typed front end of a Pool
+//
+//    ObjectPool<Node> nodes;
+//    Node* node = nodes.create(parent);
+//    nodes.destroy(node);
+template<typename T>
+class ObjectPool {
+public:
+	ObjectPool(size_t blocksPerPage = 256) : pool(sizeof(T), alignof(T), blocksPerPage) {}
+
+	template<typename... Args>
+	T* create(Args&&... args)
+	{
+		void* block = pool.allocate();
+		try {
+			return new (block) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			pool.free(block);
+			throw;
+		}
+	}
+
+	void destroy(T* object)
+	{
+		if (!object) return;
+		object->~T();
+		pool.free(object);
+	}
+
+	size_t getLiveCount() const { return pool.getLiveCount(); }
+
+private:
+	Pool pool;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#include "ScratchArena.h"
+
+LinearArena& Scratch::get()
+{
+	static thread_local LinearArena arena(ARENA_SIZE);
+	return arena;
+}
+
+ScratchScope::ScratchScope()
+	: arena(Scratch::get()), marker(arena.getMarker())
+{
+}
+
+ScratchScope::~ScratchScope()
+{
+	arena.rewind(marker);
+}
+
+LinearArena& ScratchScope::get()
+{
+	return arena;
+}
@@ -0,0 +1,36 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <cstddef>
+
+#include "LinearArena.h"
+
+// every thread has a LinearArena of its own for temporaries, made on first use. Scopes nest
+// like the stack: whatever was allocated while a ScratchScope is alive is freed when it ends,
+// so functions only ever see memory from their own or enclosing scopes.
+//
+//    ScratchScope scratch;
+//    ArenaVector<VkExtensionProperties> extensions(count);
+namespace Scratch {
+	// initial size of a thread's arena, grows to the thread's high water mark
+	const size_t ARENA_SIZE = 64 << 10;
+
+	LinearArena& get();
+};
+
+class ScratchScope {
+public:
+	ScratchScope();
+	~ScratchScope();
+
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	LinearArena& get();
+
+private:
+	LinearArena& arena;
+	LinearArena::Marker marker;
+};
+
+#endif
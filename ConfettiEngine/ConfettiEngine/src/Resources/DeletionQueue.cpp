@@ -0,0 +1,134 @@
+#include "DeletionQueue.h"
+#include "ResourceManager.h"
+#include <iostream>
+
+DeletionQueue::DeletionQueue(ResourceManager& r)
+	: resources(r)
+{
+	std::cout << "Deletion Queue created\n";
+}
+
+DeletionQueue::~DeletionQueue()
+{
+	flush();
+}
+
+void DeletionQueue::beginFrame(uint64_t frame)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	currentFrame = frame;
+}
+
+void DeletionQueue::destroy(BufferHandle handle, uint64_t frame)
+{
+	if (!handle.isValid()) return;
+	std::lock_guard<std::mutex> guard(lock);
+	batchFor(frame).buffers.push_back(handle);
+}
+
+void DeletionQueue::destroy(ImageHandle handle, uint64_t frame)
+{
+	if (!handle.isValid()) return;
+	std::lock_guard<std::mutex> guard(lock);
+	batchFor(frame).images.push_back(handle);
+}
+
+void DeletionQueue::destroy(PipelineHandle handle, uint64_t frame)
+{
+	if (!handle.isValid()) return;
+	std::lock_guard<std::mutex> guard(lock);
+	batchFor(frame).pipelines.push_back(handle);
+}
+
+void DeletionQueue::destroy(SamplerHandle handle, uint64_t frame)
+{
+	if (!handle.isValid()) return;
+	std::lock_guard<std::mutex> guard(lock);
+	batchFor(frame).samplers.push_back(handle);
+}
+
+void DeletionQueue::defer(std::function<void()> release, uint64_t frame)
+{
+	if (!release) return;
+	std::lock_guard<std::mutex> guard(lock);
+	batchFor(frame).releases.push_back(std::move(release));
+}
+
+void DeletionQueue::retire(uint64_t completedFrame)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		while (!batches.empty() && batches.front().frame <= completedFrame) {
+			ready.push_back(std::move(batches.front()));
+			batches.pop_front();
+		}
+	}
+	if (ready.empty()) return;
+
+	// releasing may hand more over (a texture's last reference dropping, say), the lock is free
+	for (Batch& batch : ready) release(batch);
+
+	std::lock_guard<std::mutex> guard(lock);
+	for (Batch& batch : ready) spare.push_back(std::move(batch));
+	ready.clear();
+}
+
+void DeletionQueue::flush()
+{
+	// what the releases hand over lands in new batches, keep going until nothing is left
+	bool pending = true;
+	while (pending) {
+		retire(UINT64_MAX);
+		std::lock_guard<std::mutex> guard(lock);
+		pending = !batches.empty();
+	}
+}
+
+uint64_t DeletionQueue::getFrame() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return currentFrame;
+}
+
+DeletionQueue::Stats DeletionQueue::getStats() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Stats stats;
+	stats.batches = (uint32_t)batches.size();
+	for (const Batch& batch : batches) {
+		stats.pending += (uint32_t)(batch.buffers.size() + batch.images.size() + batch.pipelines.size() + batch.samplers.size() + batch.releases.size());
+	}
+	return stats;
+}
+
+DeletionQueue::Batch& DeletionQueue::batchFor(uint64_t frame)
+{
+	if (frame == CURRENT_FRAME) frame = currentFrame;
+
+	// older frames join the newest batch, which only delays them
+	if (batches.empty() || batches.back().frame < frame) {
+		if (spare.empty()) batches.emplace_back();
+		else {
+			batches.push_back(std::move(spare.back()));
+			spare.pop_back();
+		}
+		batches.back().frame = frame;
+	}
+	return batches.back();
+}
+
+void DeletionQueue::release(Batch& batch)
+{
+	for (BufferHandle handle : batch.buffers) resources.destroy(handle);
+	for (ImageHandle handle : batch.images) resources.destroy(handle);
+	for (PipelineHandle handle : batch.pipelines) resources.destroy(handle);
+	for (SamplerHandle handle : batch.samplers) resources.destroy(handle);
+	for (std::function<void()>& release : batch.releases) release();
+
+	batch.buffers.clear();
+	batch.images.clear();
+	batch.pipelines.clear();
+	batch.samplers.clear();
+	// captured references go here
+	batch.releases.clear();
+}
@@ -0,0 +1,89 @@
+#ifndef DELETION_QUEUE_H
+#define DELETION_QUEUE_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "Handle.h"
+
+class ResourceManager;
+
+// destroys GPU resources once the GPU is past the last frame that used them, instead of
+// waiting for the device to go idle. Frames are whatever only grows and is known to have
+// completed: frame numbers behind fences or timeline semaphore values.
+// Everything handed over for the same frame lands in one batch, retire releases whole batches
+// oldest first. Handing something over for a frame older than the newest batch puts it in that
+// batch, it just lives a little longer. Batches are reused, their lists keep their capacity.
+// Any thread may hand resources over, retire and flush are for the main thread
+//
+//    every frame: deletions.beginFrame(frame); ... deletions.destroy(handle); ...
+//                 deletions.retire(completedFrame);
+//    shutdown:    vkDeviceWaitIdle(device); deletions.flush();
+class DeletionQueue {
+public:
+	// resources handed over without a frame were last used by the frame being recorded
+	static const uint64_t CURRENT_FRAME = UINT64_MAX;
+
+	struct Stats {
+		uint32_t batches = 0;
+		uint32_t pending = 0;
+	};
+
+	DeletionQueue(ResourceManager& r);
+	// flushes, the device must be idle
+	~DeletionQueue();
+
+	DeletionQueue(const DeletionQueue&) = delete;
+	DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+	// the frame being recorded from now on, before anything is handed over for it
+	void beginFrame(uint64_t frame);
+
+	// destroyed through the ResourceManager, stale and invalid handles are ignored then
+	void destroy(BufferHandle handle, uint64_t frame = CURRENT_FRAME);
+	void destroy(ImageHandle handle, uint64_t frame = CURRENT_FRAME);
+	void destroy(PipelineHandle handle, uint64_t frame = CURRENT_FRAME);
+	void destroy(SamplerHandle handle, uint64_t frame = CURRENT_FRAME);
+	// anything the manager doesn't own: raw Vulkan objects, or a shared_ptr captured so the
+	// last reference goes when release runs
+	void defer(std::function<void()> release, uint64_t frame = CURRENT_FRAME);
+
+	// every frame up to and including completedFrame has finished on the GPU
+	void retire(uint64_t completedFrame);
+	// releases everything, the device must be idle
+	void flush();
+
+	uint64_t getFrame() const;
+	Stats getStats() const;
+
+private:
+	struct Batch {
+		uint64_t frame;
+		std::vector<BufferHandle> buffers;
+		std::vector<ImageHandle> images;
+		std::vector<PipelineHandle> pipelines;
+		std::vector<SamplerHandle> samplers;
+		std::vector<std::function<void()>> releases;
+	};
+
+	// lock held
+	Batch& batchFor(uint64_t frame);
+	// lock not held, leaves the batch's lists empty
+	void release(Batch& batch);
+
+	ResourceManager& resources;
+
+	mutable std::mutex lock;
+	uint64_t currentFrame = 0;
+	// oldest first, frames strictly increasing
+	std::deque<Batch> batches;
+	// emptied batches, reused before new ones are made
+	std::vector<Batch> spare;
+	// taken off by retire, released outside the lock
+	std::vector<Batch> ready;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include <cstdint>
+
+// refers to an object in a SlotArray: the slot's index and the generation the slot had when
+// the object was put there. The generation is bumped whenever the slot is emptied, so handles
+// to destroyed objects fail their lookup instead of reaching whatever reused the slot.
+// Tag only keeps handles of different kinds apart, a BufferHandle doesn't convert to an
+// ImageHandle. Plain values, fine to copy around and hand to other threads
+template<typename Tag>
+struct Handle {
+	uint32_t index = 0xFFFFFFFF;
+	uint32_t generation = 0;
+
+	bool isValid() const { return index != 0xFFFFFFFF; }
+
+	bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+struct BufferTag;
+struct ImageTag;
+struct PipelineTag;
+struct SamplerTag;
+
+typedef Handle<BufferTag> BufferHandle;
+typedef Handle<ImageTag> ImageHandle;
+typedef Handle<PipelineTag> PipelineHandle;
+typedef Handle<SamplerTag> SamplerHandle;
+
+#endif
@@ -0,0 +1,269 @@
+#include "ResourceManager.h"
+#include "../Buffers/Buffer.h"
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+ResourceManager::ResourceManager(VkPhysicalDevice p, VkDevice d)
+	: physicalDevice(p), device(d)
+{
+	std::cout << "Resource Manager created\n";
+}
+
+ResourceManager::~ResourceManager()
+{
+	for (const BufferInfo& info : buffers) release(info);
+	for (const ImageInfo& info : images) release(info);
+	for (const PipelineInfo& info : pipelines) release(info);
+	for (const SamplerInfo& info : samplers) release(info);
+}
+
+BufferHandle ResourceManager::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	BufferInfo info{};
+	info.size = size;
+	info.usage = usage;
+	info.properties = properties;
+	Buffer::create(physicalDevice, device, size, usage, properties, info.buffer, info.memory);
+
+	std::unique_lock<std::shared_mutex> guard(lock);
+	return buffers.insert(info);
+}
+
+ImageHandle ResourceManager::createImage(const VkImageCreateInfo& imageInfo, VkImageAspectFlags aspect)
+{
+	ImageInfo info{};
+	info.format = imageInfo.format;
+	info.extent = imageInfo.extent;
+	info.mipLevels = imageInfo.mipLevels;
+	info.arrayLayers = imageInfo.arrayLayers;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &info.image) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create image!");
+	}
+
+	// nothing is registered yet, a failure cleans up what was made so far
+	try {
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(device, info.image, &memRequirements);
+		info.memorySize = memRequirements.size;
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = Buffer::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &info.memory) != VK_SUCCESS) {
+			throw std::runtime_error("ERROR: Failed to allocate image memory!");
+		}
+		vkBindImageMemory(device, info.image, info.memory, 0);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = info.image;
+		viewInfo.viewType = imageInfo.imageType == VK_IMAGE_TYPE_3D ? VK_IMAGE_VIEW_TYPE_3D
+			: imageInfo.arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = imageInfo.format;
+		viewInfo.subresourceRange = { aspect, 0, imageInfo.mipLevels, 0, imageInfo.arrayLayers };
+
+		if (vkCreateImageView(device, &viewInfo, nullptr, &info.view) != VK_SUCCESS) {
+			throw std::runtime_error("ERROR: Failed to create image view!");
+		}
+	}
+	catch (...) {
+		vkDestroyImage(device, info.image, nullptr);
+		if (info.memory != VK_NULL_HANDLE) vkFreeMemory(device, info.memory, nullptr);
+		throw;
+	}
+
+	std::unique_lock<std::shared_mutex> guard(lock);
+	return images.insert(info);
+}
+
+PipelineHandle ResourceManager::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo)
+{
+	PipelineInfo info{};
+	info.layout = createInfo.layout;
+	info.bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &info.pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create graphics pipeline!");
+	}
+
+	std::unique_lock<std::shared_mutex> guard(lock);
+	return pipelines.insert(info);
+}
+
+PipelineHandle ResourceManager::createComputePipeline(const VkComputePipelineCreateInfo& createInfo)
+{
+	PipelineInfo info{};
+	info.layout = createInfo.layout;
+	info.bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &info.pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create compute pipeline!");
+	}
+
+	std::unique_lock<std::shared_mutex> guard(lock);
+	return pipelines.insert(info);
+}
+
+SamplerHandle ResourceManager::createSampler(const VkSamplerCreateInfo& samplerInfo)
+{
+	SamplerInfo info{};
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &info.sampler) != VK_SUCCESS) {
+		throw std::runtime_error("ERROR: Failed to create sampler!");
+	}
+
+	std::unique_lock<std::shared_mutex> guard(lock);
+	return samplers.insert(info);
+}
+
+void ResourceManager::destroy(BufferHandle handle)
+{
+	BufferInfo info;
+	{
+		std::unique_lock<std::shared_mutex> guard(lock);
+		const BufferInfo* found = buffers.get(handle);
+		if (!found) return;
+		info = *found;
+		buffers.remove(handle);
+	}
+	release(info);
+}
+
+void ResourceManager::destroy(ImageHandle handle)
+{
+	ImageInfo info;
+	{
+		std::unique_lock<std::shared_mutex> guard(lock);
+		const ImageInfo* found = images.get(handle);
+		if (!found) return;
+		info = *found;
+		images.remove(handle);
+	}
+	release(info);
+}
+
+void ResourceManager::destroy(PipelineHandle handle)
+{
+	PipelineInfo info;
+	{
+		std::unique_lock<std::shared_mutex> guard(lock);
+		const PipelineInfo* found = pipelines.get(handle);
+		if (!found) return;
+		info = *found;
+		pipelines.remove(handle);
+	}
+	release(info);
+}
+
+void ResourceManager::destroy(SamplerHandle handle)
+{
+	SamplerInfo info;
+	{
+		std::unique_lock<std::shared_mutex> guard(lock);
+		const SamplerInfo* found = samplers.get(handle);
+		if (!found) return;
+		info = *found;
+		samplers.remove(handle);
+	}
+	release(info);
+}
+
+bool ResourceManager::get(BufferHandle handle, BufferInfo& info) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const BufferInfo* found = buffers.get(handle);
+	if (found) info = *found;
+	return found != nullptr;
+}
+
+bool ResourceManager::get(ImageHandle handle, ImageInfo& info) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const ImageInfo* found = images.get(handle);
+	if (found) info = *found;
+	return found != nullptr;
+}
+
+bool ResourceManager::get(PipelineHandle handle, PipelineInfo& info) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const PipelineInfo* found = pipelines.get(handle);
+	if (found) info = *found;
+	return found != nullptr;
+}
+
+bool ResourceManager::get(SamplerHandle handle, SamplerInfo& info) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const SamplerInfo* found = samplers.get(handle);
+	if (found) info = *found;
+	return found != nullptr;
+}
+
+VkBuffer ResourceManager::getBuffer(BufferHandle handle) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const BufferInfo* found = buffers.get(handle);
+	return found ? found->buffer : VK_NULL_HANDLE;
+}
+
+VkImageView ResourceManager::getView(ImageHandle handle) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const ImageInfo* found = images.get(handle);
+	return found ? found->view : VK_NULL_HANDLE;
+}
+
+VkPipeline ResourceManager::getPipeline(PipelineHandle handle) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const PipelineInfo* found = pipelines.get(handle);
+	return found ? found->pipeline : VK_NULL_HANDLE;
+}
+
+VkSampler ResourceManager::getSampler(SamplerHandle handle) const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	const SamplerInfo* found = samplers.get(handle);
+	return found ? found->sampler : VK_NULL_HANDLE;
+}
+
+ResourceManager::Stats ResourceManager::getStats() const
+{
+	std::shared_lock<std::shared_mutex> guard(lock);
+	Stats stats;
+	stats.buffers = buffers.size();
+	stats.images = images.size();
+	stats.pipelines = pipelines.size();
+	stats.samplers = samplers.size();
+	for (const BufferInfo& info : buffers) stats.bytes += info.size;
+	for (const ImageInfo& info : images) stats.bytes += info.memorySize;
+	return stats;
+}
+
+void ResourceManager::release(const BufferInfo& info)
+{
+	VkBuffer buffer = info.buffer;
+	VkDeviceMemory memory = info.memory;
+	Buffer::destroy(device, buffer, memory);
+}
+
+void ResourceManager::release(const ImageInfo& info)
+{
+	vkDestroyImageView(device, info.view, nullptr);
+	vkDestroyImage(device, info.image, nullptr);
+	vkFreeMemory(device, info.memory, nullptr);
+}
+
+void ResourceManager::release(const PipelineInfo& info)
+{
+	vkDestroyPipeline(device, info.pipeline, nullptr);
+	vkDestroyPipelineLayout(device, info.layout, nullptr);
+}
+
+void ResourceManager::release(const SamplerInfo& info)
+{
+	vkDestroySampler(device, info.sampler, nullptr);
+}
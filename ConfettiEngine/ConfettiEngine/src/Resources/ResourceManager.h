@@ -0,0 +1,111 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <cstdint>
+#include <shared_mutex>
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "Handle.h"
+#include "SlotArray.h"
+
+// what the manager knows about each resource, kept densely per kind so walking them (budgets,
+// debug listings, teardown) stays inside a few arrays
+struct BufferInfo {
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	VkBufferUsageFlags usage;
+	VkMemoryPropertyFlags properties;
+};
+
+struct ImageInfo {
+	VkImage image;
+	VkDeviceMemory memory;
+	// over every level and layer
+	VkImageView view;
+	VkFormat format;
+	VkExtent3D extent;
+	uint32_t mipLevels;
+	uint32_t arrayLayers;
+	VkDeviceSize memorySize;
+};
+
+struct PipelineInfo {
+	VkPipeline pipeline;
+	VkPipelineLayout layout;
+	VkPipelineBindPoint bindPoint;
+};
+
+struct SamplerInfo {
+	VkSampler sampler;
+};
+
+// owns GPU resources behind typed generational handles (Handle.h). Lookups are O(1) and a
+// handle to something already destroyed fails its lookup instead of reaching whatever took its
+// slot, so streaming and jobs can hold handles without holding the resources alive.
+// Creating, destroying and looking up are safe from any thread: lookups share a lock and hand
+// out copies, never pointers into the arrays. Whatever is left when the manager goes away is
+// destroyed with it
+class ResourceManager {
+public:
+	ResourceManager(VkPhysicalDevice p, VkDevice d);
+	~ResourceManager();
+
+	ResourceManager(const ResourceManager&) = delete;
+	ResourceManager& operator=(const ResourceManager&) = delete;
+
+	BufferHandle createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+	// device local, with a view over every level and layer of aspect
+	ImageHandle createImage(const VkImageCreateInfo& imageInfo, VkImageAspectFlags aspect);
+	// the pipeline takes over info.layout, destroying it along with the pipeline. On failure the
+	// layout stays with the caller
+	PipelineHandle createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info);
+	PipelineHandle createComputePipeline(const VkComputePipelineCreateInfo& info);
+	SamplerHandle createSampler(const VkSamplerCreateInfo& samplerInfo);
+
+	// the resource must be idle on the GPU. Stale and invalid handles are ignored
+	void destroy(BufferHandle handle);
+	void destroy(ImageHandle handle);
+	void destroy(PipelineHandle handle);
+	void destroy(SamplerHandle handle);
+
+	// false (and info untouched) for stale or invalid handles
+	bool get(BufferHandle handle, BufferInfo& info) const;
+	bool get(ImageHandle handle, ImageInfo& info) const;
+	bool get(PipelineHandle handle, PipelineInfo& info) const;
+	bool get(SamplerHandle handle, SamplerInfo& info) const;
+
+	// VK_NULL_HANDLE for stale or invalid handles
+	VkBuffer getBuffer(BufferHandle handle) const;
+	VkImageView getView(ImageHandle handle) const;
+	VkPipeline getPipeline(PipelineHandle handle) const;
+	VkSampler getSampler(SamplerHandle handle) const;
+
+	struct Stats {
+		uint32_t buffers = 0;
+		uint32_t images = 0;
+		uint32_t pipelines = 0;
+		uint32_t samplers = 0;
+		// buffer sizes plus image memory sizes
+		VkDeviceSize bytes = 0;
+	};
+	Stats getStats() const;
+
+private:
+	void release(const BufferInfo& info);
+	void release(const ImageInfo& info);
+	void release(const PipelineInfo& info);
+	void release(const SamplerInfo& info);
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	mutable std::shared_mutex lock;
+	SlotArray<BufferInfo, BufferTag> buffers;
+	SlotArray<ImageInfo, ImageTag> images;
+	SlotArray<PipelineInfo, PipelineTag> pipelines;
+	SlotArray<SamplerInfo, SamplerTag> samplers;
+};
+
+#endif
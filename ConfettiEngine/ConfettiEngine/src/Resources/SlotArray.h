@@ -0,0 +1,127 @@
+#ifndef SLOT_ARRAY_H
+#define SLOT_ARRAY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Handle.h"
+
+// objects packed densely in insertion order (swap removed), reached in O(1) through a slot per
+// handle index that holds the object's dense position and the slot's generation. Walking every
+// object is a linear pass over the dense array, lookups are two loads.
+// Freed slots are reused last in first out, a slot whose generation would wrap is retired
+// instead so a handle can never match a later object. Not thread safe
+template<typename T, typename Tag>
+class SlotArray {
+public:
+	typedef Handle<Tag> HandleType;
+
+	HandleType insert(const T& value);
+	// false for stale or invalid handles
+	bool remove(HandleType handle);
+
+	// nullptr for stale or invalid handles, pointers move on insert and remove
+	T* get(HandleType handle);
+	const T* get(HandleType handle) const;
+	bool contains(HandleType handle) const;
+
+	uint32_t size() const { return (uint32_t)values.size(); }
+	bool empty() const { return values.empty(); }
+
+	// dense order, handleAt(i) is the handle of values()[i]
+	T* data() { return values.data(); }
+	const T* data() const { return values.data(); }
+	HandleType handleAt(uint32_t dense) const;
+
+	typename std::vector<T>::iterator begin() { return values.begin(); }
+	typename std::vector<T>::iterator end() { return values.end(); }
+	typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+	typename std::vector<T>::const_iterator end() const { return values.end(); }
+
+private:
+	struct Slot {
+		uint32_t dense;
+		// odd while the slot holds an object, even while it is free
+		uint32_t generation;
+	};
+
+	std::vector<T> values;
+	// slot index of every dense value
+	std::vector<uint32_t> owners;
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+};
+
+template<typename T, typename Tag>
+Handle<Tag> SlotArray<T, Tag>::insert(const T& value)
+{
+	uint32_t index;
+	if (!freeSlots.empty()) {
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else {
+		index = (uint32_t)slots.size();
+		slots.push_back({ 0, 0 });
+	}
+
+	Slot& slot = slots[index];
+	slot.dense = (uint32_t)values.size();
+	slot.generation++;
+	values.push_back(value);
+	owners.push_back(index);
+
+	HandleType handle;
+	handle.index = index;
+	handle.generation = slot.generation;
+	return handle;
+}
+
+template<typename T, typename Tag>
+bool SlotArray<T, Tag>::remove(HandleType handle)
+{
+	if (!contains(handle)) return false;
+
+	Slot& slot = slots[handle.index];
+	uint32_t last = (uint32_t)values.size() - 1;
+	if (slot.dense != last) {
+		values[slot.dense] = values[last];
+		owners[slot.dense] = owners[last];
+		slots[owners[slot.dense]].dense = slot.dense;
+	}
+	values.pop_back();
+	owners.pop_back();
+
+	slot.generation++;
+	if (slot.generation != 0xFFFFFFFE) freeSlots.push_back(handle.index);
+	return true;
+}
+
+template<typename T, typename Tag>
+T* SlotArray<T, Tag>::get(HandleType handle)
+{
+	return contains(handle) ? &values[slots[handle.index].dense] : nullptr;
+}
+
+template<typename T, typename Tag>
+const T* SlotArray<T, Tag>::get(HandleType handle) const
+{
+	return contains(handle) ? &values[slots[handle.index].dense] : nullptr;
+}
+
+template<typename T, typename Tag>
+bool SlotArray<T, Tag>::contains(HandleType handle) const
+{
+	return handle.index < slots.size() && slots[handle.index].generation == handle.generation && (handle.generation & 1) != 0;
+}
+
+template<typename T, typename Tag>
+Handle<Tag> SlotArray<T, Tag>::handleAt(uint32_t dense) const
+{
+	HandleType handle;
+	handle.index = owners[dense];
+	handle.generation = slots[handle.index].generation;
+	return handle;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "LodSelector.h"
+#include <algorithm>
+
+const uint32_t LodSelector::INVALID;
+
+// inside the bounding sphere every level would be projected to infinity
+static const float MIN_DISTANCE = 1e-3f;
+
+LodSelector::LodSelector(float pixelThreshold, float h)
+	: threshold(pixelThreshold), hysteresis(h)
+{
+}
+
+void LodSelector::setCamera(const glm::mat4& view, const glm::mat4& proj, float viewportHeight)
+{
+	eye = glm::vec3(glm::inverse(view)[3]);
+	// proj[1][1] = 1 / tan(fovy / 2), which covers half the viewport
+	pixelsPerUnit = std::abs(proj[1][1]) * viewportHeight * 0.5f;
+}
+
+void LodSelector::setThreshold(float pixelThreshold, float h)
+{
+	threshold = pixelThreshold;
+	hysteresis = h;
+}
+
+float LodSelector::projectError(float error, float distance) const
+{
+	return error * pixelsPerUnit / std::max(distance, MIN_DISTANCE);
+}
+
+uint32_t LodSelector::select(const MeshLod* lods, uint32_t lodCount, const glm::vec3& center, float radius, float scale, uint32_t current) const
+{
+	if (lodCount == 0) return 0;
+
+	// closest point of the bounds, so big objects refine before the camera is inside them
+	float distance = glm::length(center - eye) - radius;
+
+	// errors grow monotonically along the chain, stop at the first level that shows
+	uint32_t lod = 0;
+	while (lod + 1 < lodCount && projectError(lods[lod + 1].error * scale, distance) <= threshold) lod++;
+
+	if (current < lodCount && lod > current) {
+		// only coarsen as far as levels that are well below the threshold
+		float coarsen = threshold * (1.0f - hysteresis);
+		uint32_t coarsest = current;
+		while (coarsest < lod && projectError(lods[coarsest + 1].error * scale, distance) <= coarsen) coarsest++;
+		lod = coarsest;
+	}
+
+	return lod;
+}
@@ -0,0 +1,42 @@
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../Assets/MeshFormat.h"
+
+// picks the coarsest level of a cooked lod chain whose simplification error, projected onto
+// the screen, stays below a pixel threshold. Levels only get coarser once they are clearly
+// under the threshold (by the hysteresis fraction) so objects sitting right at a switch
+// distance don't flicker between two levels every frame, refining is never delayed.
+//
+//    selector.setCamera(view, proj, (float)swapChainExtent.height);
+//    lod = selector.select(lods + submesh.firstLod, submesh.lodCount, center, radius, scale, lod);
+class LodSelector {
+public:
+	LodSelector(float pixelThreshold = 1.0f, float hysteresis = 0.25f);
+
+	// proj is a glm::perspective projection, height the viewport height in pixels
+	void setCamera(const glm::mat4& view, const glm::mat4& proj, float viewportHeight);
+	void setThreshold(float pixelThreshold, float hysteresis);
+
+	// size in pixels of a world space error at distance from the camera
+	float projectError(float error, float distance) const;
+
+	// center and radius are the world space bounding sphere, scale the largest scale of the
+	// world matrix (lod errors are in mesh units). current is what this instance used last
+	// frame, INVALID on the first one
+	uint32_t select(const MeshLod* lods, uint32_t lodCount, const glm::vec3& center, float radius, float scale, uint32_t current = INVALID) const;
+
+	static const uint32_t INVALID = 0xFFFFFFFF;
+
+private:
+	glm::vec3 eye = glm::vec3(0.0f);
+	// pixels covered by one unit at distance one
+	float pixelsPerUnit = 1.0f;
+	float threshold;
+	float hysteresis;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#include "SceneComponents.h"
+#include <stdexcept>
+
+ComponentId SceneComponents::id(SceneComponentType type)
+{
+	switch (type) {
+	case SCENE_COMPONENT_LOCAL_TRANSFORM:
+		return Components::id<LocalTransform>();
+	case SCENE_COMPONENT_PARENT:
+		return Components::id<Parent>();
+	case SCENE_COMPONENT_MESH_INSTANCE:
+		return Components::id<MeshInstance>();
+	default:
+		throw std::runtime_error("ERROR: Unknown scene component type!");
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef SCENE_COMPONENTS_H
+#define SCENE_COMPONENTS_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../Assets/SceneFormat.h"
+#include "../Ecs/Component.h"
+
+// components cooked scenes are made of. They are copied byte for byte out of scene files,
+// changing any of them means bumping SCENE_VERSION
+
+// relative to the Parent, or the world without one
+struct LocalTransform {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+struct Parent {
+	Entity entity;
+};
+
+// submesh of one of the meshes the scene was instantiated with, mesh is the id the caller
+// handed SceneAsset::instantiate for the scene's mesh table entry
+struct MeshInstance {
+	uint32_t mesh;
+	uint32_t submesh;
+};
+
+static_assert(sizeof(LocalTransform) == 40, "LocalTransform layout changed, bump SCENE_VERSION");
+static_assert(sizeof(Parent) == 8, "Parent layout changed, bump SCENE_VERSION");
+static_assert(sizeof(MeshInstance) == 8, "MeshInstance layout changed, bump SCENE_VERSION");
+
+namespace SceneComponents {
+	// runtime id of the component a scene file means, throws for unknown types
+	ComponentId id(SceneComponentType type);
+};
+
+#endif
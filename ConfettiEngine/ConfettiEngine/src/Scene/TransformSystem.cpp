@@ -0,0 +1,335 @@
+#include "TransformSystem.h"
+#include "../Math/Simd.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+
+const uint32_t TransformSystem::INVALID;
+
+// slots handed to one job, and gathered per kernel call
+static const uint32_t UPDATE_GRAIN = 256;
+static const uint32_t BATCH_SIZE = 64;
+
+// worlds[slots[i]] = worlds[parents[slots[i]]] * locals[slots[i]]
+static void multiplyBatch(const uint32_t* slots, uint32_t count, const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds)
+{
+	uint32_t i = 0;
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+	// two matrices per 256 bit register, one in each lane. The column broadcast is an
+	// in-lane permute so both halves proceed like glm_mat4_mul independently
+	for (; i + 2 <= count; i += 2) {
+		const float* p0 = &worlds[parents[slots[i]]][0][0];
+		const float* p1 = &worlds[parents[slots[i + 1]]][0][0];
+		const float* l0 = &locals[slots[i]][0][0];
+		const float* l1 = &locals[slots[i + 1]][0][0];
+
+		__m256 parent[4];
+		for (int c = 0; c < 4; c++) {
+			parent[c] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p0 + c * 4)), _mm_loadu_ps(p1 + c * 4), 1);
+		}
+
+		__m256 result[4];
+		for (int c = 0; c < 4; c++) {
+			__m256 local = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(l0 + c * 4)), _mm_loadu_ps(l1 + c * 4), 1);
+			__m256 a0 = _mm256_mul_ps(parent[0], _mm256_permute_ps(local, _MM_SHUFFLE(0, 0, 0, 0)));
+			__m256 a1 = _mm256_mul_ps(parent[1], _mm256_permute_ps(local, _MM_SHUFFLE(1, 1, 1, 1)));
+			__m256 a2 = _mm256_mul_ps(parent[2], _mm256_permute_ps(local, _MM_SHUFFLE(2, 2, 2, 2)));
+			__m256 a3 = _mm256_mul_ps(parent[3], _mm256_permute_ps(local, _MM_SHUFFLE(3, 3, 3, 3)));
+			result[c] = _mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3));
+		}
+
+		float* o0 = &worlds[slots[i]][0][0];
+		float* o1 = &worlds[slots[i + 1]][0][0];
+		for (int c = 0; c < 4; c++) {
+			_mm_storeu_ps(o0 + c * 4, _mm256_castps256_ps128(result[c]));
+			_mm_storeu_ps(o1 + c * 4, _mm256_extractf128_ps(result[c], 1));
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+		// glm's types aren't aligned without GLM_FORCE_DEFAULT_ALIGNED_GENTYPES, go through registers
+		const float* p = &worlds[parents[slots[i]]][0][0];
+		const float* l = &locals[slots[i]][0][0];
+		glm_vec4 parent[4] = { _mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8), _mm_loadu_ps(p + 12) };
+		glm_vec4 local[4] = { _mm_loadu_ps(l), _mm_loadu_ps(l + 4), _mm_loadu_ps(l + 8), _mm_loadu_ps(l + 12) };
+		glm_vec4 result[4];
+		glm_mat4_mul(parent, local, result);
+
+		float* o = &worlds[slots[i]][0][0];
+		for (int c = 0; c < 4; c++) {
+			_mm_storeu_ps(o + c * 4, result[c]);
+		}
+#else
+		worlds[slots[i]] = worlds[parents[slots[i]]] * locals[slots[i]];
+#endif
+	}
+}
+
+uint32_t TransformSystem::create(uint32_t parent)
+{
+	if (parent != INVALID && !isAlive(parent)) {
+		throw std::runtime_error("ERROR: Transform parent doesn't exist!");
+	}
+
+	uint32_t node;
+	if (!freeNodes.empty()) {
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else {
+		node = (uint32_t)nodes.size();
+		nodes.push_back({});
+	}
+
+	// new nodes go at the end until the next rebuild sorts them in
+	nodes[node] = { parent, (uint32_t)slotNode.size(), true };
+	slotNode.push_back(node);
+	slotParent.push_back(INVALID);
+	slotInstance.push_back(INVALID);
+	locals.push_back(glm::mat4(1.0f));
+	worlds.push_back(glm::mat4(1.0f));
+	dirty.push_back(1);
+
+	structureChanged = true;
+	return node;
+}
+
+void TransformSystem::destroy(uint32_t node)
+{
+	if (!isAlive(node)) return;
+
+	// descendants are found and removed by the rebuild
+	nodes[node].alive = false;
+	structureChanged = true;
+}
+
+bool TransformSystem::isAlive(uint32_t node) const
+{
+	return node < nodes.size() && nodes[node].alive;
+}
+
+uint32_t TransformSystem::slotOf(uint32_t node) const
+{
+	if (!isAlive(node)) {
+		throw std::runtime_error("ERROR: Invalid transform node!");
+	}
+	return nodes[node].slot;
+}
+
+void TransformSystem::setParent(uint32_t node, uint32_t parent)
+{
+	slotOf(node);
+
+	for (uint32_t ancestor = parent; ancestor != INVALID; ancestor = nodes[ancestor].parent) {
+		if (!isAlive(ancestor)) {
+			throw std::runtime_error("ERROR: Transform parent doesn't exist!");
+		}
+		if (ancestor == node) {
+			throw std::runtime_error("ERROR: Transform parent would create a cycle!");
+		}
+	}
+
+	nodes[node].parent = parent;
+	markDirty(node);
+	structureChanged = true;
+}
+
+uint32_t TransformSystem::getParent(uint32_t node) const
+{
+	slotOf(node);
+	return nodes[node].parent;
+}
+
+void TransformSystem::setLocal(uint32_t node, const glm::mat4& local)
+{
+	uint32_t slot = slotOf(node);
+	locals[slot] = local;
+	dirty[slot] = 1;
+}
+
+void TransformSystem::setLocal(uint32_t node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	glm::mat4 local = glm::mat4_cast(rotation);
+	local[0] *= scale.x;
+	local[1] *= scale.y;
+	local[2] *= scale.z;
+	local[3] = glm::vec4(position, 1.0f);
+	setLocal(node, local);
+}
+
+const glm::mat4& TransformSystem::getLocal(uint32_t node) const
+{
+	return locals[slotOf(node)];
+}
+
+const glm::mat4& TransformSystem::getWorld(uint32_t node) const
+{
+	return worlds[slotOf(node)];
+}
+
+void TransformSystem::bindInstance(uint32_t node, uint32_t instance)
+{
+	uint32_t slot = slotOf(node);
+	slotInstance[slot] = instance;
+	dirty[slot] = 1;
+}
+
+void TransformSystem::markDirty(uint32_t node)
+{
+	dirty[nodes[node].slot] = 1;
+}
+
+void TransformSystem::rebuild()
+{
+	// depth of every node, nodes below a destroyed ancestor die with it.
+	// DEPTH_UNKNOWN until resolved, walks up until it meets a resolved node
+	const uint32_t DEPTH_UNKNOWN = 0xFFFFFFFE;
+	std::vector<uint32_t> depth(nodes.size(), DEPTH_UNKNOWN);
+	std::vector<uint32_t> path;
+
+	for (uint32_t node = 0; node < nodes.size(); node++) {
+		if (nodes[node].slot == INVALID) depth[node] = INVALID;
+	}
+
+	for (uint32_t node = 0; node < nodes.size(); node++) {
+		path.clear();
+		uint32_t current = node;
+		while (current != INVALID && depth[current] == DEPTH_UNKNOWN) {
+			path.push_back(current);
+			if (!nodes[current].alive) break;
+			current = nodes[current].parent;
+		}
+
+		uint32_t base;
+		if (!path.empty() && !nodes[path.back()].alive) base = INVALID;
+		else if (current == INVALID) base = 0;
+		else base = depth[current] == INVALID ? INVALID : depth[current] + 1;
+
+		for (size_t i = path.size(); i-- > 0;) {
+			depth[path[i]] = base;
+			if (base != INVALID) base++;
+		}
+	}
+
+	// counting sort by depth, stable so siblings keep their relative order
+	uint32_t maxDepth = 0;
+	uint32_t liveCount = 0;
+	for (uint32_t node = 0; node < nodes.size(); node++) {
+		if (depth[node] == INVALID) continue;
+		maxDepth = std::max(maxDepth, depth[node]);
+		liveCount++;
+	}
+
+	levels.assign(liveCount > 0 ? maxDepth + 2 : 1, 0);
+	for (uint32_t node = 0; node < nodes.size(); node++) {
+		if (depth[node] != INVALID) levels[depth[node] + 1]++;
+	}
+	for (size_t d = 1; d < levels.size(); d++) {
+		levels[d] += levels[d - 1];
+	}
+
+	std::vector<uint32_t> newNode(liveCount);
+	std::vector<uint32_t> newInstance(liveCount);
+	std::vector<glm::mat4> newLocals(liveCount);
+	std::vector<glm::mat4> newWorlds(liveCount);
+	std::vector<uint8_t> newDirty(liveCount);
+	std::vector<uint32_t> cursor(levels.begin(), levels.end() - 1);
+
+	// walk in old slot order so the sort stays stable
+	for (uint32_t oldSlot = 0; oldSlot < slotNode.size(); oldSlot++) {
+		uint32_t node = slotNode[oldSlot];
+		if (depth[node] == INVALID) continue;
+
+		uint32_t slot = cursor[depth[node]]++;
+		newNode[slot] = node;
+		newInstance[slot] = slotInstance[oldSlot];
+		newLocals[slot] = locals[oldSlot];
+		newWorlds[slot] = worlds[oldSlot];
+		newDirty[slot] = dirty[oldSlot];
+	}
+
+	for (uint32_t node = 0; node < nodes.size(); node++) {
+		if (nodes[node].slot != INVALID && depth[node] == INVALID) {
+			// handle can only be reused once no descendant can point at it anymore
+			nodes[node] = { INVALID, INVALID, false };
+			freeNodes.push_back(node);
+		}
+	}
+	for (uint32_t slot = 0; slot < liveCount; slot++) {
+		nodes[newNode[slot]].slot = slot;
+	}
+
+	slotParent.resize(liveCount);
+	for (uint32_t slot = 0; slot < liveCount; slot++) {
+		uint32_t parent = nodes[newNode[slot]].parent;
+		slotParent[slot] = parent == INVALID ? INVALID : nodes[parent].slot;
+	}
+
+	slotNode.swap(newNode);
+	slotInstance.swap(newInstance);
+	locals.swap(newLocals);
+	worlds.swap(newWorlds);
+	dirty.swap(newDirty);
+
+	structureChanged = false;
+}
+
+void TransformSystem::update(JobSystem& jobs, GpuInstance* instances)
+{
+	if (structureChanged) rebuild();
+	if (slotNode.empty()) return;
+
+	for (size_t level = 0; level + 1 < levels.size(); level++) {
+		uint32_t begin = levels[level];
+		uint32_t count = levels[level + 1] - begin;
+		uint32_t jobCount = (count + UPDATE_GRAIN - 1) / UPDATE_GRAIN;
+
+		// the previous level is complete, so parents' dirty flags and worlds are final
+		jobs.parallelFor(jobCount, 1, [&](uint32_t job) {
+			uint32_t first = begin + job * UPDATE_GRAIN;
+			uint32_t end = std::min(begin + count, first + UPDATE_GRAIN);
+
+			uint32_t batch[BATCH_SIZE];
+			uint32_t batchCount = 0;
+
+			auto flush = [&]() {
+				if (level > 0) {
+					multiplyBatch(batch, batchCount, slotParent.data(), locals.data(), worlds.data());
+				}
+				else {
+					for (uint32_t i = 0; i < batchCount; i++) worlds[batch[i]] = locals[batch[i]];
+				}
+
+				if (instances) {
+					for (uint32_t i = 0; i < batchCount; i++) {
+						uint32_t instance = slotInstance[batch[i]];
+						if (instance != INVALID) instances[instance].model = worlds[batch[i]];
+					}
+				}
+				batchCount = 0;
+			};
+
+			for (uint32_t slot = first; slot < end; slot++) {
+				uint32_t parent = slotParent[slot];
+				if (!dirty[slot] && (parent == INVALID || !dirty[parent])) continue;
+
+				// children read this on the next level
+				dirty[slot] = 1;
+				batch[batchCount++] = slot;
+				if (batchCount == BATCH_SIZE) flush();
+			}
+			if (batchCount > 0) flush();
+		});
+	}
+
+	memset(dirty.data(), 0, dirty.size());
+}
+
+uint32_t TransformSystem::getCount() const
+{
+	return (uint32_t)slotNode.size();
+}
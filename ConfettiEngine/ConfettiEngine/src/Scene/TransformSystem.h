@@ -0,0 +1,73 @@
+#ifndef TRANSFORM_SYSTEM_H
+#define TRANSFORM_SYSTEM_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../Culling/GpuCulling.h"
+#include "../Jobs/JobSystem.h"
+
+// local to world propagation for the scene hierarchy.
+// Nodes are addressed through stable handles but stored in flat arrays sorted by depth,
+// so every parent is finished before its children are touched and each depth level is
+// one contiguous range that can be split across the job system.
+// Only dirty nodes and their descendants are recomputed, world matrices are produced in
+// batches with the glm SIMD matrix multiply (two at a time on AVX).
+class TransformSystem {
+public:
+	static const uint32_t INVALID = 0xFFFFFFFF;
+
+	uint32_t create(uint32_t parent = INVALID);
+	// also destroys every descendant
+	void destroy(uint32_t node);
+	bool isAlive(uint32_t node) const;
+
+	void setParent(uint32_t node, uint32_t parent);
+	uint32_t getParent(uint32_t node) const;
+
+	void setLocal(uint32_t node, const glm::mat4& local);
+	void setLocal(uint32_t node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	const glm::mat4& getLocal(uint32_t node) const;
+	// valid after update
+	const glm::mat4& getWorld(uint32_t node) const;
+
+	// world matrix is written to instances[instance].model every time it changes
+	void bindInstance(uint32_t node, uint32_t instance);
+
+	// instances may be null when nothing is bound. The instance buffer is persistently
+	// mapped so results land in it without an extra copy
+	void update(JobSystem& jobs, GpuInstance* instances);
+
+	uint32_t getCount() const;
+
+private:
+	struct Node {
+		uint32_t parent;
+		uint32_t slot;
+		bool alive;
+	};
+
+	uint32_t slotOf(uint32_t node) const;
+	// re-sorts the slot arrays by depth after nodes were created, destroyed or reparented
+	void rebuild();
+	void markDirty(uint32_t node);
+
+	// per handle
+	std::vector<Node> nodes;
+	std::vector<uint32_t> freeNodes;
+	bool structureChanged = false;
+
+	// per slot, depth sorted
+	std::vector<uint32_t> slotNode;
+	std::vector<uint32_t> slotParent;
+	std::vector<uint32_t> slotInstance;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> dirty;
+	// slots of depth d are [levels[d], levels[d + 1])
+	std::vector<uint32_t> levels;
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "WorldPartition.h"
+#include "SceneComponents.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+WorldPartition::WorldPartition(AssetStreamer& s, const VirtualFileSystem& v, World& w, const std::string& path, MeshResolver resolve, const Settings& settings)
+	: streamer(s), world(w), resolveMesh(resolve), settings(settings), file(v.open(path))
+{
+	if (file.getSize() < sizeof(WorldFileHeader)) {
+		throw std::runtime_error("ERROR: " + path + " is not a cooked world!");
+	}
+
+	const WorldFileHeader* header = (const WorldFileHeader*)file.getData();
+	if (header->magic != WORLD_MAGIC) {
+		throw std::runtime_error("ERROR: " + path + " is not a cooked world!");
+	}
+	if (header->version != WORLD_VERSION) {
+		throw std::runtime_error("ERROR: " + path + " was cooked with another world version, recook it!");
+	}
+	if (header->proxyMesh != WORLD_NO_PROXY && header->proxyMesh >= header->stringTableSize) {
+		throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+	}
+
+	uint64_t cellBytes = (uint64_t)header->cellCount * sizeof(WorldCell);
+	if (header->fileSize != file.getSize()
+		|| header->cellOffset > file.getSize() || cellBytes > file.getSize() - header->cellOffset
+		|| header->stringOffset > file.getSize() || header->stringTableSize > file.getSize() - header->stringOffset
+		|| header->stringTableSize == 0 || file.getData()[header->stringOffset + header->stringTableSize - 1] != 0) {
+		throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+	}
+
+	// cell scenes are next to the index
+	size_t slash = path.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+	const WorldCell* infos = (const WorldCell*)(file.getData() + header->cellOffset);
+	cells.resize(header->cellCount);
+	for (uint32_t i = 0; i < header->cellCount; i++) {
+		if (infos[i].path >= header->stringTableSize) {
+			throw std::runtime_error("ERROR: " + path + " is truncated or corrupt!");
+		}
+		cells[i].info = &infos[i];
+		cells[i].path = directory + (const char*)(file.getData() + header->stringOffset + infos[i].path);
+	}
+
+	if (header->proxyMesh != WORLD_NO_PROXY) {
+		proxyMesh = resolveMesh(directory + (const char*)(file.getData() + header->stringOffset + header->proxyMesh));
+	}
+
+	std::cout << "World Partition created (" << header->cellCount << " cells of " << header->cellSize << " units)\n";
+}
+
+WorldPartition::~WorldPartition()
+{
+	for (Cell& cell : cells) {
+		if (cell.load.isValid()) streamer.release(cell.load);
+	}
+}
+
+// distance from point to the box, 0 inside
+static float boxDistance(const WorldCell& cell, const glm::vec3& point)
+{
+	glm::vec3 min(cell.aabbMin[0], cell.aabbMin[1], cell.aabbMin[2]);
+	glm::vec3 max(cell.aabbMax[0], cell.aabbMax[1], cell.aabbMax[2]);
+	return glm::length(glm::max(glm::max(min - point, point - max), glm::vec3(0.0f)));
+}
+
+void WorldPartition::update(const glm::vec3& camera, const glm::vec3& velocity)
+{
+	glm::vec3 predicted = camera + velocity * settings.lookAhead;
+
+	// what should be resident: everything in range, nearest first until the budget is used up.
+	// Cells already in keep their place up to unloadDistance
+	order.resize(cells.size());
+	for (uint32_t i = 0; i < cells.size(); i++) {
+		Cell& cell = cells[i];
+		cell.distance = std::min(boxDistance(*cell.info, camera), boxDistance(*cell.info, predicted));
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return cells[a].distance < cells[b].distance; });
+
+	uint64_t planned = 0;
+	for (uint32_t i : order) {
+		Cell& cell = cells[i];
+		bool resident = cell.state != WORLD_CELL_UNLOADED && cell.state != WORLD_CELL_FAILED;
+		float range = resident ? settings.unloadDistance : settings.loadDistance;
+		cell.wanted = cell.state != WORLD_CELL_FAILED && cell.distance < range && planned + cell.info->memorySize <= settings.memoryBudget;
+		if (cell.wanted) planned += cell.info->memorySize;
+	}
+
+	// let go of the rest, reads are cancelled, live cells start demoting
+	uint64_t resident = 0;
+	uint32_t loading = 0;
+	for (Cell& cell : cells) {
+		if (cell.state == WORLD_CELL_LOADING) {
+			StreamState state = streamer.getState(cell.load);
+			if (state == STREAM_READY) {
+				cell.state = WORLD_CELL_LOADED;
+			}
+			else if (state == STREAM_FAILED) {
+				// the streamer reported why
+				release(cell);
+				cell.state = WORLD_CELL_FAILED;
+				continue;
+			}
+		}
+
+		if (!cell.wanted) {
+			if (cell.state == WORLD_CELL_LOADING || cell.state == WORLD_CELL_LOADED) {
+				release(cell);
+			}
+			else if (cell.state == WORLD_CELL_PROMOTING || cell.state == WORLD_CELL_LIVE) {
+				cell.state = WORLD_CELL_DEMOTING;
+				cell.destroyed = 0;
+			}
+		}
+		// still wanted but far enough for the proxy, demote() keeps the bytes
+		else if (settings.hlodDistance > 0.0f && cell.distance > settings.hlodDistance + settings.hlodMargin
+			&& (cell.state == WORLD_CELL_PROMOTING || cell.state == WORLD_CELL_LIVE)) {
+			cell.state = WORLD_CELL_DEMOTING;
+			cell.destroyed = 0;
+		}
+
+		if (cell.state != WORLD_CELL_UNLOADED && cell.state != WORLD_CELL_FAILED) resident += cell.info->memorySize;
+		if (cell.state == WORLD_CELL_LOADING) loading++;
+	}
+
+	// new reads nearest first. Cells the camera is already near go ahead of the ones its
+	// velocity only points at
+	for (uint32_t i : order) {
+		Cell& cell = cells[i];
+		if (!cell.wanted) continue;
+
+		StreamPriority priority = boxDistance(*cell.info, camera) < settings.loadDistance ? STREAM_PRIORITY_HIGH : STREAM_PRIORITY_LOW;
+		if (cell.state == WORLD_CELL_LOADING && cell.priority != priority) {
+			streamer.setPriority(cell.load, priority);
+			cell.priority = priority;
+		}
+		if (cell.state != WORLD_CELL_UNLOADED || loading >= settings.maxLoads) continue;
+		// demoting cells still hold their memory, wait for them
+		if (resident + cell.info->memorySize > settings.memoryBudget) continue;
+
+		std::string path = cell.path;
+		cell.load = streamer.load(path, priority, [path](std::vector<uint8_t>& bytes, StreamedAsset& asset) {
+			// validated on the worker, promotion only copies
+			asset.object = std::make_shared<SceneAsset>(std::move(bytes), path);
+			return true;
+		});
+		cell.priority = priority;
+		cell.state = WORLD_CELL_LOADING;
+		resident += cell.info->memorySize;
+		loading++;
+	}
+
+	// main thread work within the row budget, freeing memory first, then the nearest cells
+	uint32_t budget = settings.rowsPerFrame;
+	for (Cell& cell : cells) {
+		if (budget == 0) break;
+		if (cell.state == WORLD_CELL_DEMOTING) budget = demote(cell, budget);
+	}
+	for (uint32_t i : order) {
+		if (budget == 0) break;
+		Cell& cell = cells[i];
+		if (!cell.wanted) continue;
+		// promotions already going finish within the margin
+		bool near = settings.hlodDistance <= 0.0f || cell.distance < settings.hlodDistance;
+		if ((cell.state == WORLD_CELL_LOADED && near) || cell.state == WORLD_CELL_PROMOTING) budget = promote(cell, budget);
+	}
+
+	for (Cell& cell : cells) updateProxy(cell);
+}
+
+void WorldPartition::release(Cell& cell)
+{
+	if (cell.load.isValid()) streamer.release(cell.load);
+	cell.load = StreamHandle();
+	cell.progress = SceneInstantiation();
+	cell.state = WORLD_CELL_UNLOADED;
+}
+
+uint32_t WorldPartition::demote(Cell& cell, uint32_t budget)
+{
+	// rows a promotion didn't get to are still INVALID_ENTITY, destroy skips them
+	std::vector<Entity>& entities = cell.progress.entities;
+	while (budget > 0 && cell.destroyed < entities.size()) {
+		world.destroy(entities[cell.destroyed++]);
+		budget--;
+	}
+
+	if (cell.destroyed == entities.size()) {
+		if (cell.wanted) {
+			cell.progress = SceneInstantiation();
+			cell.state = WORLD_CELL_LOADED;
+		}
+		else {
+			release(cell);
+		}
+	}
+	return budget;
+}
+
+uint32_t WorldPartition::promote(Cell& cell, uint32_t budget)
+{
+	const SceneAsset* scene = streamer.get<SceneAsset>(cell.load);
+
+	if (cell.state == WORLD_CELL_LOADED) {
+		std::vector<uint32_t> meshes(scene->getMeshCount());
+		for (uint32_t i = 0; i < meshes.size(); i++) {
+			meshes[i] = resolveMesh(scene->getMeshPath(i));
+		}
+		scene->begin(cell.progress, meshes);
+		cell.state = WORLD_CELL_PROMOTING;
+	}
+
+	budget -= scene->step(world, cell.progress, budget);
+	if (cell.progress.done) cell.state = WORLD_CELL_LIVE;
+	return budget;
+}
+
+void WorldPartition::updateProxy(Cell& cell)
+{
+	// promoting and demoting cells keep theirs, half a cell would leave holes
+	bool shown = proxyMesh != WORLD_NO_PROXY && cell.info->proxySubmesh != WORLD_NO_PROXY && cell.state != WORLD_CELL_LIVE;
+	if (shown && cell.proxy == INVALID_ENTITY) {
+		// proxies are cooked in world space
+		LocalTransform transform{ glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) };
+		cell.proxy = world.create(transform, MeshInstance{ proxyMesh, cell.info->proxySubmesh });
+	}
+	else if (!shown && cell.proxy != INVALID_ENTITY) {
+		world.destroy(cell.proxy);
+		cell.proxy = INVALID_ENTITY;
+	}
+}
+
+void WorldPartition::unloadAll()
+{
+	for (Cell& cell : cells) {
+		cell.wanted = false;
+		if (cell.state == WORLD_CELL_PROMOTING || cell.state == WORLD_CELL_LIVE) {
+			cell.state = WORLD_CELL_DEMOTING;
+			cell.destroyed = 0;
+		}
+		if (cell.state == WORLD_CELL_DEMOTING) demote(cell, 0xFFFFFFFF);
+		if (cell.state == WORLD_CELL_LOADING || cell.state == WORLD_CELL_LOADED) release(cell);
+		if (cell.proxy != INVALID_ENTITY) {
+			world.destroy(cell.proxy);
+			cell.proxy = INVALID_ENTITY;
+		}
+	}
+}
+
+uint32_t WorldPartition::getCellCount() const
+{
+	return (uint32_t)cells.size();
+}
+
+const WorldCell& WorldPartition::getCell(uint32_t cell) const
+{
+	return *cells[cell].info;
+}
+
+WorldCellState WorldPartition::getState(uint32_t cell) const
+{
+	return cells[cell].state;
+}
+
+const std::vector<Entity>& WorldPartition::getEntities(uint32_t cell) const
+{
+	return cells[cell].progress.entities;
+}
+
+WorldPartition::Stats WorldPartition::getStats() const
+{
+	Stats stats;
+	stats.cells = (uint32_t)cells.size();
+	for (const Cell& cell : cells) {
+		switch (cell.state) {
+		case WORLD_CELL_LOADING:
+			stats.loading++;
+			break;
+		case WORLD_CELL_LOADED:
+		case WORLD_CELL_PROMOTING:
+		case WORLD_CELL_DEMOTING:
+			stats.pending++;
+			break;
+		case WORLD_CELL_LIVE:
+			stats.live++;
+			stats.entities += (uint32_t)cell.progress.entities.size();
+			break;
+		default:
+			break;
+		}
+		if (cell.proxy != INVALID_ENTITY) stats.proxies++;
+		if (cell.state != WORLD_CELL_UNLOADED && cell.state != WORLD_CELL_FAILED) stats.residentBytes += cell.info->memorySize;
+	}
+	return stats;
+}
@@ -0,0 +1,143 @@
+#ifndef WORLD_PARTITION_H
+#define WORLD_PARTITION_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../Assets/AssetStreamer.h"
+#include "../Assets/SceneAsset.h"
+#include "../Assets/VirtualFileSystem.h"
+#include "../Assets/WorldFormat.h"
+#include "../Ecs/World.h"
+
+enum WorldCellState {
+	WORLD_CELL_UNLOADED = 0,
+	// the AssetStreamer reads and validates the cell's scene
+	WORLD_CELL_LOADING,
+	// in memory, waiting for its turn to be promoted
+	WORLD_CELL_LOADED,
+	// entities being created, a few chunks per update
+	WORLD_CELL_PROMOTING,
+	// the cell's entities are in the world, its HLOD proxy isn't
+	WORLD_CELL_LIVE,
+	// entities being destroyed, the memory is freed once they are gone, or kept when the
+	// cell only went past hlodDistance
+	WORLD_CELL_DEMOTING,
+	// the scene couldn't be read, never retried
+	WORLD_CELL_FAILED
+};
+
+// streams the cells of a partitioned world (WorldCooker) in and out of a World around the
+// camera. Cells whose bounds come within loadDistance of the camera, or of where its velocity
+// takes it lookAhead seconds from now, are read and validated in the background by the
+// AssetStreamer, nearest first and within a memory budget. Loaded cells are promoted into the
+// World a bounded number of entities per update, cells past unloadDistance (or pushed out of
+// the budget by nearer ones) are demoted the same way and released. Cells are independent
+// scenes, nothing references entities of another cell.
+// Past hlodDistance a cell is drawn by its HLOD proxy instead, a single entity placing the
+// cell's merged submesh of the world's proxy mesh. Proxies exist for every cell that isn't
+// live, so the whole world is always on screen at some detail. Cells in range but past
+// hlodDistance stay loaded without being promoted, live ones going past it are demoted back to
+// loaded and come back without another read.
+//
+//    WorldPartition partition(streamer, vfs, world, "cooked/island.world", resolveMesh, settings);
+//    every frame: partition.update(cameraPosition, cameraVelocity);
+class WorldPartition {
+public:
+	// id MeshInstance::mesh should hold for a mesh path, called on the main thread when a cell
+	// is promoted and once for the proxy mesh on construction
+	typedef std::function<uint32_t(const std::string& path)> MeshResolver;
+
+	struct Settings {
+		// cells whose bounds come closer than this are loaded
+		float loadDistance = 256.0f;
+		// and stay until they are further than this, so cells on the edge don't thrash
+		float unloadDistance = 320.0f;
+		// loaded cells further than this show their HLOD proxy instead of being promoted, 0
+		// promotes everything loaded
+		float hlodDistance = 192.0f;
+		// live cells switch back to the proxy only past hlodDistance + hlodMargin
+		float hlodMargin = 32.0f;
+		// seconds of camera velocity to look ahead
+		float lookAhead = 2.0f;
+		// WorldCell::memorySize of every cell not unloaded has to fit, nearer cells win
+		uint64_t memoryBudget = 256ull << 20;
+		// cell reads in flight
+		uint32_t maxLoads = 4;
+		// entities created or destroyed per update, bounds the main thread's share
+		uint32_t rowsPerFrame = 4096;
+	};
+
+	struct Stats {
+		uint32_t cells = 0;
+		uint32_t loading = 0;
+		// loaded, promoting or demoting
+		uint32_t pending = 0;
+		uint32_t live = 0;
+		uint32_t proxies = 0;
+		// of live cells, proxies not counted
+		uint32_t entities = 0;
+		// memory size of every cell that isn't unloaded
+		uint64_t residentBytes = 0;
+	};
+
+	// reads the world index right away, throws if it is missing or corrupt
+	WorldPartition(AssetStreamer& s, const VirtualFileSystem& v, World& w, const std::string& path, MeshResolver resolve, const Settings& settings);
+	// releases the loads, entities and proxies already in the world stay there
+	~WorldPartition();
+
+	WorldPartition(const WorldPartition&) = delete;
+	WorldPartition& operator=(const WorldPartition&) = delete;
+
+	// main thread, once per frame
+	void update(const glm::vec3& camera, const glm::vec3& velocity);
+	// destroys every entity and proxy the partition created and releases every cell, all at once
+	void unloadAll();
+
+	uint32_t getCellCount() const;
+	const WorldCell& getCell(uint32_t cell) const;
+	WorldCellState getState(uint32_t cell) const;
+	// scene index order, complete once the cell is live
+	const std::vector<Entity>& getEntities(uint32_t cell) const;
+	Stats getStats() const;
+
+private:
+	struct Cell {
+		const WorldCell* info;
+		std::string path;
+		WorldCellState state = WORLD_CELL_UNLOADED;
+		StreamHandle load;
+		StreamPriority priority = STREAM_PRIORITY_LOW;
+		SceneInstantiation progress;
+		// entities destroyed so far while demoting
+		uint32_t destroyed = 0;
+		Entity proxy = INVALID_ENTITY;
+		// to the camera or its predicted position, whichever is nearer
+		float distance = 0.0f;
+		bool wanted = false;
+	};
+
+	void release(Cell& cell);
+	// spends up to budget rows, returns what is left
+	uint32_t demote(Cell& cell, uint32_t budget);
+	uint32_t promote(Cell& cell, uint32_t budget);
+	// creates or destroys the cell's proxy to match its state
+	void updateProxy(Cell& cell);
+
+	AssetStreamer& streamer;
+	World& world;
+	MeshResolver resolveMesh;
+	Settings settings;
+	// resolved proxy mesh, WORLD_NO_PROXY if the world has none
+	uint32_t proxyMesh = WORLD_NO_PROXY;
+
+	VfsFile file;
+	std::vector<Cell> cells;
+	// nearest first, rebuilt every update
+	std::vector<uint32_t> order;
+};
+
+#endif
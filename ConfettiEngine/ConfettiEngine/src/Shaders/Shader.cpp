@@ -1,7 +1,16 @@
 #include "Shader.h"
+#include "../Assets/VirtualFileSystem.h"
+#include <filesystem>
+
+static const VirtualFileSystem* shaderFileSystem = nullptr;
 
 std::vector<char> Shader::read(const std::string& filename)
 {
+    if (shaderFileSystem) {
+        VfsFile file = shaderFileSystem->open(filename);
+        return std::vector<char>((const char*)file.getData(), (const char*)file.getData() + file.getSize());
+    }
+
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
     if (!file.is_open()) {
@@ -17,4 +26,17 @@ std::vector<char> Shader::read(const std::string& filename)
     file.close();
 
     return buffer;
-}
\ No newline at end of file
+}
+
+bool Shader::exists(const std::string& filename)
+{
+    if (shaderFileSystem) return shaderFileSystem->exists(filename);
+
+    std::error_code error;
+    return std::filesystem::is_regular_file(filename, error);
+}
+
+void Shader::setFileSystem(const VirtualFileSystem* fileSystem)
+{
+    shaderFileSystem = fileSystem;
+}
@@ -4,8 +4,17 @@
 #include <vector>
 #include <fstream>
 
+class VirtualFileSystem;
+
 namespace Shader {
+	// SPIR-V is looked up through fileSystem once one is set, before that it is read from disk
 	std::vector<char> read(const std::string& filename);
+	// looked up the same way as read, for pipelines that are optional when their SPIR-V
+	// hasn't been compiled
+	bool exists(const std::string& filename);
+
+	// must outlive every pipeline created while it is set
+	void setFileSystem(const VirtualFileSystem* fileSystem);
 
 };
 
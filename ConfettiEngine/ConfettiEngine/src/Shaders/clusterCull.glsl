@@ -0,0 +1,114 @@
+// cluster culling, shared by clusterCull.comp and clusterOcclusionCull.comp which defines
+// CLUSTER_OCCLUSION. One workgroup per instance, its threads walk the instance's meshlets and
+// append every visible one, either as an indexed indirect draw of the meshlet's index range or,
+// for mesh shaders, to the cluster list meshlet.mesh draws one workgroup per entry of.
+// Meshlets are tested against the frustum, their normal cone and with CLUSTER_OCCLUSION the
+// depth pyramid
+
+#include "gpuScene.glsl"
+#ifdef CLUSTER_OCCLUSION
+#include "occlusion.glsl"
+#endif
+
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) readonly buffer Instances {
+	Instance instances[];
+};
+
+layout(std430, binding = 1) readonly buffer Meshes {
+	Mesh meshes[];
+};
+
+layout(std430, binding = 2) readonly buffer Meshlets {
+	Meshlet meshlets[];
+};
+
+layout(std430, binding = 3) writeonly buffer DrawCommands {
+	DrawCommand draws[];
+};
+
+// instance id, meshlet index
+layout(std430, binding = 4) writeonly buffer Clusters {
+	uvec2 clusters[];
+};
+
+// indexed draw count, or the taskCount of a VkDrawMeshTasksIndirectCommandNV
+layout(std430, binding = 5) buffer DrawCount {
+	uint drawCount;
+};
+
+layout(binding = 6) uniform Cull {
+	CullUniforms cull;
+};
+
+#ifdef CLUSTER_OCCLUSION
+// max depth pyramid, texels hold the furthest depth of the area they cover
+layout(binding = 7) uniform sampler2D depthPyramid;
+#endif
+
+layout(push_constant) uniform ClusterConstants {
+	uint instanceCount;
+	uint maxClusters;
+	uint meshShader;
+	uint pad;
+} constants;
+
+void main() {
+	// dispatched in two dimensions, there can be more instances than one allows workgroups
+	uint id = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+	if (id >= constants.instanceCount) return;
+
+	Instance inst = instances[id];
+	Mesh mesh = meshes[inst.meshIndex];
+	if (mesh.meshletCount == 0) return;
+
+	// the whole workgroup leaves together if the instance is off screen
+	if (!sphereInFrustum(cull.planes, worldCenter(inst), worldRadius(inst))) return;
+
+	// rigid view matrix, the camera sits at -R^T * t
+	vec3 cameraPosition = -(transpose(mat3(cull.view)) * cull.view[3].xyz);
+	float scale = max(max(length(inst.model[0].xyz), length(inst.model[1].xyz)), length(inst.model[2].xyz));
+
+	for (uint i = gl_LocalInvocationID.x; i < mesh.meshletCount; i += gl_WorkGroupSize.x) {
+		uint index = mesh.firstMeshlet + i;
+		Meshlet meshlet = meshlets[index];
+
+		vec3 center = (inst.model * vec4(meshlet.sphere.xyz, 1.0)).xyz;
+		float radius = meshlet.sphere.w * scale;
+
+		if (!sphereInFrustum(cull.planes, center, radius)) continue;
+
+		// cones assume uniform scale, mirrored instances flip the winding and can't use them
+		if (meshlet.cone.w < 1.0) {
+			vec3 axis = normalize(mat3(inst.model) * meshlet.cone.xyz);
+			if (coneCulled(cameraPosition, center, radius, axis, meshlet.cone.w)) continue;
+		}
+
+#ifdef CLUSTER_OCCLUSION
+		if (occluded(depthPyramid, cull, center, radius)) continue;
+#endif
+
+		uint slot = atomicAdd(drawCount, 1);
+		// full, hand the slot back. The count never drops below maxClusters again, so it ends up
+		// as exactly the number of written slots and can be drawn as it is
+		if (slot >= constants.maxClusters) {
+			atomicAdd(drawCount, 0xFFFFFFFFu);
+			continue;
+		}
+
+		if (constants.meshShader != 0) {
+			clusters[slot] = uvec2(id, index);
+		}
+		else {
+			DrawCommand draw;
+			draw.indexCount = ((meshlet.counts >> 8) & 0xFF) * 3;
+			draw.instanceCount = 1;
+			draw.firstIndex = meshlet.firstIndex;
+			draw.vertexOffset = mesh.vertexOffset;
+			// same instance id convention as the instance passes, gpuDriven.vert works unchanged
+			draw.firstInstance = id;
+			draws[slot] = draw;
+		}
+	}
+}
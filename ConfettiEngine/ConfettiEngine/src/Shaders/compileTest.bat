@@ -6,5 +6,7 @@
 for %%i in (*.vert) do C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe %%i -o %%i.spv
 for %%i in (*.geom) do C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe %%i -o %%i.spv
 for %%i in (*.frag) do C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe %%i -o %%i.spv
+for %%i in (*.comp) do C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe %%i -o %%i.spv
+for %%i in (*.mesh) do C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe %%i -o %%i.spv
 
 pause
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+// vertex shader for draws produced by frustumCull.comp and occlusionCull.comp
+// gl_InstanceIndex includes firstInstance, which the cull pass sets to the instance id
+
+#include "gpuScene.glsl"
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+	Instance instances[];
+};
+
+layout(push_constant) uniform Camera {
+	mat4 viewProj;
+} camera;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+
+layout(location = 0) out vec3 color;
+
+void main() {
+	mat4 model = instances[gl_InstanceIndex].model;
+	gl_Position = camera.viewProj * model * vec4(position, 1.0);
+	color = normalize(mat3(model) * normal) * 0.5 + 0.5;
+}
@@ -0,0 +1,36 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+// gpuDriven.vert for meshes cooked with MESH_VERTEX_PACKED, same draws and instance data
+// plus the mesh table for the position dequantization
+
+#include "gpuScene.glsl"
+#include "vertexDecode.glsl"
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+	Instance instances[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Meshes {
+	Mesh meshes[];
+};
+
+layout(push_constant) uniform Camera {
+	mat4 viewProj;
+} camera;
+
+layout(location = 0) in vec4 packedPosition;
+layout(location = 1) in vec4 normalTangent;
+layout(location = 2) in vec2 uv;
+
+layout(location = 0) out vec3 color;
+
+void main() {
+	Instance inst = instances[gl_InstanceIndex];
+	Mesh mesh = meshes[inst.meshIndex];
+
+	vec3 position = decodePosition(packedPosition, mesh.positionOffset, mesh.positionScale);
+	vec3 normal = octDecode(normalTangent.xy);
+
+	gl_Position = camera.viewProj * inst.model * vec4(position, 1.0);
+	color = normalize(mat3(inst.model) * normal) * 0.5 + 0.5;
+}
@@ -0,0 +1,84 @@
+// shared GPU scene layouts, must match the structs in Culling/GpuCulling.h and Assets/MeshFormat.h
+// include with #extension GL_GOOGLE_include_directive : require
+
+struct Instance {
+	mat4 model;
+	vec4 boundingSphere;
+	uint meshIndex;
+	uint pad0;
+	uint pad1;
+	uint pad2;
+};
+
+struct Mesh {
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	// range in the meshlet table, meshes with meshlets are drawn by the cluster passes
+	uint firstMeshlet;
+	uint meshletCount;
+	uint pad0;
+	uint pad1;
+	uint pad2;
+	// dequantization of packed positions, see vertexDecode.glsl
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+// matches MeshMeshlet
+struct Meshlet {
+	// xyz = center, w = radius, mesh space
+	vec4 sphere;
+	// xyz = axis, w = cutoff
+	vec4 cone;
+	uint vertexOffset;
+	uint triangleOffset;
+	uint firstIndex;
+	// vertex count in the low byte, triangle count in the next
+	uint counts;
+};
+
+// matches VkDrawIndexedIndirectCommand
+struct DrawCommand {
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+struct CullUniforms {
+	mat4 view;
+	vec4 planes[6];
+	// P00, P11, P22, P32 of the projection matrix
+	vec4 projection;
+	// pyramid width, pyramid height, near plane, unused
+	vec4 pyramid;
+};
+
+const uint CULL_EARLY = 0;
+const uint CULL_LATE = 1;
+
+vec3 worldCenter(Instance inst) {
+	return (inst.model * vec4(inst.boundingSphere.xyz, 1.0)).xyz;
+}
+
+// conservative radius under non-uniform scale
+float worldRadius(Instance inst) {
+	float scale = max(max(length(inst.model[0].xyz), length(inst.model[1].xyz)), length(inst.model[2].xyz));
+	return inst.boundingSphere.w * scale;
+}
+
+bool sphereInFrustum(vec4 planes[6], vec3 center, float radius) {
+	bool visible = true;
+	for (int i = 0; i < 6; i++) {
+		visible = visible && dot(planes[i].xyz, center) + planes[i].w > -radius;
+	}
+	return visible;
+}
+
+// every triangle of the cluster faces away from the camera, world space cone
+bool coneCulled(vec3 cameraPosition, vec3 center, float radius, vec3 axis, float cutoff) {
+	vec3 offset = center - cameraPosition;
+	return dot(offset, axis) >= cutoff * length(offset) + radius;
+}
@@ -0,0 +1,56 @@
+// hierarchical z occlusion test shared by the cull passes, include after gpuScene.glsl
+// with #extension GL_GOOGLE_include_directive : require
+
+// screen space bounds of a view space sphere (+z forward), 2D Polyhedral Bounds of a Clipped, Perspective-Projected 3D Sphere
+// Mara & McGuire 2013. Returns false if the sphere crosses the near plane
+bool projectSphere(vec3 c, float r, float znear, float P00, float P11, out vec4 aabb) {
+	if (c.z < r + znear) return false;
+
+	vec2 cx = -c.xz;
+	vec2 vx = vec2(sqrt(dot(cx, cx) - r * r), r);
+	vec2 minx = mat2(vx.x, vx.y, -vx.y, vx.x) * cx;
+	vec2 maxx = mat2(vx.x, -vx.y, vx.y, vx.x) * cx;
+
+	vec2 cy = -c.yz;
+	vec2 vy = vec2(sqrt(dot(cy, cy) - r * r), r);
+	vec2 miny = mat2(vy.x, vy.y, -vy.y, vy.x) * cy;
+	vec2 maxy = mat2(vy.x, -vy.y, vy.y, vy.x) * cy;
+
+	vec4 ndc = vec4(minx.x / minx.y * P00, miny.x / miny.y * P11, maxx.x / maxx.y * P00, maxy.x / maxy.y * P11);
+	// ndc to uv, the sign of P11 decides which way y points so sort afterwards
+	vec4 uv = ndc * 0.5 + 0.5;
+	aabb = vec4(min(uv.xy, uv.zw), max(uv.xy, uv.zw));
+
+	return true;
+}
+
+// tests a world space sphere against a max depth pyramid, false whenever it can't tell
+bool occluded(sampler2D depthPyramid, CullUniforms cull, vec3 center, float radius) {
+	// glm view space looks down -z
+	vec3 c = (cull.view * vec4(center, 1.0)).xyz;
+	c.z = -c.z;
+
+	vec4 aabb;
+	if (!projectSphere(c, radius, cull.pyramid.z, cull.projection.x, cull.projection.y, aabb)) {
+		return false;
+	}
+
+	vec2 pyramidSize = cull.pyramid.xy;
+	vec2 extent = (aabb.zw - aabb.xy) * pyramidSize;
+	// pick the level where the bounds cover at most 2x2 texels
+	float level = max(ceil(log2(max(extent.x, extent.y))), 0.0);
+	int lod = min(int(level), textureQueryLevels(depthPyramid) - 1);
+
+	ivec2 levelSize = textureSize(depthPyramid, lod);
+	ivec2 lo = clamp(ivec2(aabb.xy * vec2(levelSize)), ivec2(0), levelSize - 1);
+	ivec2 hi = clamp(ivec2(aabb.zw * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+	float depth = max(max(texelFetch(depthPyramid, lo, lod).r, texelFetch(depthPyramid, ivec2(hi.x, lo.y), lod).r),
+		max(texelFetch(depthPyramid, ivec2(lo.x, hi.y), lod).r, texelFetch(depthPyramid, hi, lod).r));
+
+	// depth of the sphere's closest point, zero to one clip space
+	float zn = c.z - radius;
+	float sphereDepth = (cull.projection.z * -zn + cull.projection.w) / zn;
+
+	return sphereDepth > depth;
+}
@@ -0,0 +1,21 @@
+// streaming requests from the shaders, read back by Assets/TextureStreamer.cpp (must match it)
+// include with #extension GL_GOOGLE_include_directive : require
+// The feedback buffer holds one uint per streamed texture, reset to 0xFFFFFFFF every frame.
+// A shader sampling texture id reports the finest level it would have used:
+//
+//   layout(set = 0, binding = 1) buffer TextureFeedback { uint textureFeedback[]; };
+//   // a few pixels per tile are plenty and keep the atomics cheap
+//   if (((uint(gl_FragCoord.x) ^ uint(gl_FragCoord.y)) & 7u) == 0u) {
+//       atomicMin(textureFeedback[id], textureFeedbackLevel(textures[id], uv));
+//   }
+//
+// The level is stored relative to the resident image's width (log2 of it subtracted) in fixed
+// point, so it stays meaningful while the image changes resolution under the shader
+
+const float TEXTURE_FEEDBACK_SCALE = 16.0;
+const float TEXTURE_FEEDBACK_BIAS = 32.0;
+
+uint textureFeedbackLevel(sampler2D tex, vec2 uv) {
+	float level = textureQueryLod(tex, uv).y - log2(float(textureSize(tex, 0).x));
+	return uint(clamp((level + TEXTURE_FEEDBACK_BIAS) * TEXTURE_FEEDBACK_SCALE, 0.0, 65535.0));
+}
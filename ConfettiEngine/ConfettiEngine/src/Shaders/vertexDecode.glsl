@@ -0,0 +1,22 @@
+// decoding of MeshPackedVertex (Assets/MeshFormat.h), must match Assets/VertexPacking.cpp
+// include with #extension GL_GOOGLE_include_directive : require
+// The vertex fetch formats already turn the packed bits into floats:
+//   position     R16G16B16A16_UNORM  xyz in [0, 1] across the submesh aabb, w bitangent sign
+//   normalTangent R8G8B8A8_SNORM     octahedral normal in xy, octahedral tangent in zw
+//   uv           R16G16_SFLOAT
+
+vec3 decodePosition(vec4 packedPosition, vec4 offset, vec4 scale) {
+	return offset.xyz + scale.xyz * packedPosition.xyz;
+}
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) {
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+vec4 decodeTangent(vec4 normalTangent, vec4 packedPosition) {
+	return vec4(octDecode(normalTangent.zw), packedPosition.w * 2.0 - 1.0);
+}
@@ -0,0 +1,446 @@
+#include "Bvh.h"
+#include "../Math/Simd.h"
+#include <algorithm>
+#include <limits>
+
+static const uint32_t SAH_BINS = 16;
+// relative cost of visiting a node versus testing one primitive
+static const float TRAVERSAL_COST = 1.0f;
+
+static float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+{
+	glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// levels of median splits below a node of count primitives until every leaf fits
+static uint32_t medianDepth(uint32_t count)
+{
+	uint32_t levels = 0;
+	for (; count > Bvh::MAX_LEAF_SIZE; levels++) count = (count + 1) / 2;
+	return levels;
+}
+
+void Bvh::build(const glm::vec3* mins, const glm::vec3* maxs, uint32_t count)
+{
+	nodes.clear();
+	buildNodes.clear();
+
+	primMin.assign(mins, mins + count);
+	primMax.assign(maxs, maxs + count);
+
+	primIndices.resize(count);
+	centroids.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		primIndices[i] = i;
+		centroids[i] = (mins[i] + maxs[i]) * 0.5f;
+	}
+
+	if (count == 0) return;
+
+	buildNodes.reserve(count * 2);
+	uint32_t root = buildRecursive(0, count, 0);
+	// leaves reference primIndices ranges, so the binary tree maps straight onto wide nodes
+	nodes.reserve(buildNodes.size() / 2 + 1);
+	collapse(root);
+
+	buildNodes.clear();
+	buildNodes.shrink_to_fit();
+	centroids.clear();
+	centroids.shrink_to_fit();
+}
+
+uint32_t Bvh::buildRecursive(uint32_t first, uint32_t count, uint32_t depth)
+{
+	BuildNode node{};
+	node.min = glm::vec3(std::numeric_limits<float>::max());
+	node.max = glm::vec3(-std::numeric_limits<float>::max());
+	glm::vec3 centroidMin = node.min;
+	glm::vec3 centroidMax = node.max;
+
+	for (uint32_t i = first; i < first + count; i++) {
+		uint32_t prim = primIndices[i];
+		node.min = glm::min(node.min, primMin[prim]);
+		node.max = glm::max(node.max, primMax[prim]);
+		centroidMin = glm::min(centroidMin, centroids[prim]);
+		centroidMax = glm::max(centroidMax, centroids[prim]);
+	}
+
+	node.first = first;
+	node.count = count;
+	node.left = node.right = INVALID;
+
+	uint32_t index = (uint32_t)buildNodes.size();
+	buildNodes.push_back(node);
+
+	// the depth limit is never reached through the splits below, this only guards the stack
+	if (count <= MAX_LEAF_SIZE || depth >= MAX_BUILD_DEPTH) return index;
+
+	//************* BINNED SAH *************//
+	int bestAxis = -1;
+	uint32_t bestBin = 0;
+	float bestCost = std::numeric_limits<float>::max();
+	glm::vec3 extent = centroidMax - centroidMin;
+
+	// an SAH split may peel off a single primitive, only take one while the median splits that
+	// follow could still finish by MAX_BUILD_DEPTH
+	if (depth + 1 + medianDepth(count) <= MAX_BUILD_DEPTH) {
+		for (int axis = 0; axis < 3; axis++) {
+			if (extent[axis] <= 0.0f) continue;
+
+			uint32_t binCount[SAH_BINS] = {};
+			glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+			for (uint32_t b = 0; b < SAH_BINS; b++) {
+				binMin[b] = glm::vec3(std::numeric_limits<float>::max());
+				binMax[b] = glm::vec3(-std::numeric_limits<float>::max());
+			}
+
+			float scale = SAH_BINS / extent[axis];
+			for (uint32_t i = first; i < first + count; i++) {
+				uint32_t prim = primIndices[i];
+				uint32_t b = std::min(SAH_BINS - 1, (uint32_t)((centroids[prim][axis] - centroidMin[axis]) * scale));
+				binCount[b]++;
+				binMin[b] = glm::min(binMin[b], primMin[prim]);
+				binMax[b] = glm::max(binMax[b], primMax[prim]);
+			}
+
+			// sweep from the right to get the cost of every right hand side
+			float rightArea[SAH_BINS];
+			uint32_t rightCount[SAH_BINS];
+			glm::vec3 accMin(std::numeric_limits<float>::max()), accMax(-std::numeric_limits<float>::max());
+			uint32_t accCount = 0;
+			for (uint32_t b = SAH_BINS - 1; b > 0; b--) {
+				accMin = glm::min(accMin, binMin[b]);
+				accMax = glm::max(accMax, binMax[b]);
+				accCount += binCount[b];
+				rightArea[b] = accCount > 0 ? surfaceArea(accMin, accMax) : 0.0f;
+				rightCount[b] = accCount;
+			}
+
+			accMin = glm::vec3(std::numeric_limits<float>::max());
+			accMax = glm::vec3(-std::numeric_limits<float>::max());
+			accCount = 0;
+			for (uint32_t b = 0; b < SAH_BINS - 1; b++) {
+				accMin = glm::min(accMin, binMin[b]);
+				accMax = glm::max(accMax, binMax[b]);
+				accCount += binCount[b];
+				if (accCount == 0 || rightCount[b + 1] == 0) continue;
+
+				float cost = surfaceArea(accMin, accMax) * accCount + rightArea[b + 1] * rightCount[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+	}
+
+	uint32_t mid;
+	float leafCost = (float)count;
+	float splitCost = bestAxis >= 0 ? TRAVERSAL_COST + bestCost / surfaceArea(node.min, node.max) : std::numeric_limits<float>::max();
+
+	if (bestAxis >= 0 && splitCost < leafCost) {
+		float scale = SAH_BINS / extent[bestAxis];
+		float origin = centroidMin[bestAxis];
+		auto it = std::partition(primIndices.begin() + first, primIndices.begin() + first + count, [&](uint32_t prim) {
+			return std::min(SAH_BINS - 1, (uint32_t)((centroids[prim][bestAxis] - origin) * scale)) <= bestBin;
+		});
+		mid = (uint32_t)(it - primIndices.begin());
+	}
+	else if (bestAxis >= 0 && count <= MAX_LEAF_SIZE * 4) {
+		// splitting doesn't pay off and the leaf is still small
+		return index;
+	}
+	else {
+		// degenerate centroids or too deep, split on the median of the widest axis
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		mid = first + count / 2;
+		std::nth_element(primIndices.begin() + first, primIndices.begin() + mid, primIndices.begin() + first + count,
+			[&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+	}
+
+	uint32_t left = buildRecursive(first, mid - first, depth + 1);
+	uint32_t right = buildRecursive(mid, first + count - mid, depth + 1);
+
+	// buildNodes may have reallocated
+	buildNodes[index].left = left;
+	buildNodes[index].right = right;
+	buildNodes[index].count = 0;
+
+	return index;
+}
+
+uint32_t Bvh::collapse(uint32_t binary)
+{
+	// gather up to four children by repeatedly opening the largest internal child
+	uint32_t children[WIDTH];
+	uint32_t childCount = 0;
+
+	if (buildNodes[binary].count > 0) {
+		children[childCount++] = binary;
+	}
+	else {
+		children[childCount++] = buildNodes[binary].left;
+		children[childCount++] = buildNodes[binary].right;
+	}
+
+	while (childCount < WIDTH) {
+		int best = -1;
+		float bestArea = -1.0f;
+		for (uint32_t i = 0; i < childCount; i++) {
+			const BuildNode& child = buildNodes[children[i]];
+			if (child.count > 0) continue;
+			float area = surfaceArea(child.min, child.max);
+			if (area > bestArea) {
+				bestArea = area;
+				best = (int)i;
+			}
+		}
+		if (best < 0) break;
+
+		uint32_t opened = children[best];
+		children[best] = buildNodes[opened].left;
+		children[childCount++] = buildNodes[opened].right;
+	}
+
+	uint32_t index = (uint32_t)nodes.size();
+	nodes.emplace_back();
+
+	for (uint32_t slot = 0; slot < WIDTH; slot++) {
+		if (slot >= childCount) {
+			// inverted box so the frustum test rejects it, rays check for INVALID
+			setSlot(nodes[index], slot, glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()), INVALID, 0);
+			continue;
+		}
+
+		const BuildNode& child = buildNodes[children[slot]];
+		if (child.count > 0) {
+			setSlot(nodes[index], slot, child.min, child.max, child.first, child.count);
+		}
+		else {
+			glm::vec3 min = child.min, max = child.max;
+			uint32_t wide = collapse(children[slot]);
+			setSlot(nodes[index], slot, min, max, wide, 0);
+		}
+	}
+
+	return index;
+}
+
+void Bvh::setSlot(Node& node, uint32_t slot, const glm::vec3& min, const glm::vec3& max, uint32_t child, uint32_t count)
+{
+	node.minX[slot] = min.x;
+	node.minY[slot] = min.y;
+	node.minZ[slot] = min.z;
+	node.maxX[slot] = max.x;
+	node.maxY[slot] = max.y;
+	node.maxZ[slot] = max.z;
+	node.child[slot] = child;
+	node.count[slot] = count;
+}
+
+void Bvh::setBounds(uint32_t prim, const glm::vec3& min, const glm::vec3& max)
+{
+	primMin[prim] = min;
+	primMax[prim] = max;
+}
+
+void Bvh::refit()
+{
+	// children always come after their parent, so walking backwards sees them first
+	for (size_t i = nodes.size(); i-- > 0;) {
+		Node& node = nodes[i];
+
+		for (uint32_t slot = 0; slot < WIDTH; slot++) {
+			if (node.child[slot] == INVALID) continue;
+
+			glm::vec3 min(std::numeric_limits<float>::max());
+			glm::vec3 max(-std::numeric_limits<float>::max());
+
+			if (node.count[slot] > 0) {
+				for (uint32_t p = node.child[slot]; p < node.child[slot] + node.count[slot]; p++) {
+					min = glm::min(min, primMin[primIndices[p]]);
+					max = glm::max(max, primMax[primIndices[p]]);
+				}
+			}
+			else {
+				const Node& child = nodes[node.child[slot]];
+				for (uint32_t c = 0; c < WIDTH; c++) {
+					if (child.child[c] == INVALID) continue;
+					min = glm::min(min, glm::vec3(child.minX[c], child.minY[c], child.minZ[c]));
+					max = glm::max(max, glm::vec3(child.maxX[c], child.maxY[c], child.maxZ[c]));
+				}
+			}
+
+			setSlot(node, slot, min, max, node.child[slot], node.count[slot]);
+		}
+	}
+}
+
+void Bvh::cullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	if (nodes.empty()) return;
+
+	// (node index, fully inside) pairs, a fully inside subtree skips the plane tests
+	uint32_t stack[STACK_SIZE];
+	bool inside[STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize] = 0;
+	inside[stackSize++] = false;
+
+	const Simd4::Float zero = Simd4::set1(0.0f);
+
+	auto addRange = [&](uint32_t first, uint32_t count) {
+		for (uint32_t p = first; p < first + count; p++) {
+			visible.push_back(primIndices[p]);
+		}
+	};
+
+	while (stackSize > 0) {
+		--stackSize;
+		const Node& node = nodes[stack[stackSize]];
+		bool parentInside = inside[stackSize];
+
+		int outsideMask = 0;
+		int intersectMask = 0;
+
+		if (!parentInside) {
+			Simd4::Float outside = Simd4::cmplt(zero, zero);
+			Simd4::Float intersecting = outside;
+
+			Simd4::Float minX = Simd4::load(node.minX), minY = Simd4::load(node.minY), minZ = Simd4::load(node.minZ);
+			Simd4::Float maxX = Simd4::load(node.maxX), maxY = Simd4::load(node.maxY), maxZ = Simd4::load(node.maxZ);
+
+			for (const glm::vec4& p : frustum.planes) {
+				Simd4::Float px = Simd4::set1(p.x), py = Simd4::set1(p.y), pz = Simd4::set1(p.z), pw = Simd4::set1(p.w);
+
+				// positive vertex decides outside, negative vertex decides fully inside
+				Simd4::Float positive = Simd4::madd(px, p.x >= 0.0f ? maxX : minX,
+					Simd4::madd(py, p.y >= 0.0f ? maxY : minY, Simd4::madd(pz, p.z >= 0.0f ? maxZ : minZ, pw)));
+				Simd4::Float negative = Simd4::madd(px, p.x >= 0.0f ? minX : maxX,
+					Simd4::madd(py, p.y >= 0.0f ? minY : maxY, Simd4::madd(pz, p.z >= 0.0f ? minZ : maxZ, pw)));
+
+				outside = Simd4::bitOr(outside, Simd4::cmplt(positive, zero));
+				intersecting = Simd4::bitOr(intersecting, Simd4::cmplt(negative, zero));
+			}
+
+			outsideMask = Simd4::moveMask(outside);
+			intersectMask = Simd4::moveMask(intersecting);
+		}
+
+		for (uint32_t slot = 0; slot < WIDTH; slot++) {
+			if (node.child[slot] == INVALID || (outsideMask & (1 << slot))) continue;
+
+			bool childInside = parentInside || !(intersectMask & (1 << slot));
+
+			if (node.count[slot] == 0) {
+				stack[stackSize] = node.child[slot];
+				inside[stackSize++] = childInside;
+			}
+			else if (childInside) {
+				addRange(node.child[slot], node.count[slot]);
+			}
+			else {
+				// straddling leaf, test each primitive on its own
+				for (uint32_t p = node.child[slot]; p < node.child[slot] + node.count[slot]; p++) {
+					uint32_t prim = primIndices[p];
+					if (frustum.aabbVisible(primMin[prim], primMax[prim])) {
+						visible.push_back(prim);
+					}
+				}
+			}
+		}
+	}
+}
+
+int Bvh::intersectNode(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* tEntry) const
+{
+	Simd4::Float ox = Simd4::set1(origin.x), oy = Simd4::set1(origin.y), oz = Simd4::set1(origin.z);
+	Simd4::Float ix = Simd4::set1(invDir.x), iy = Simd4::set1(invDir.y), iz = Simd4::set1(invDir.z);
+
+	Simd4::Float t1x = Simd4::mul(Simd4::sub(Simd4::load(node.minX), ox), ix);
+	Simd4::Float t2x = Simd4::mul(Simd4::sub(Simd4::load(node.maxX), ox), ix);
+	Simd4::Float t1y = Simd4::mul(Simd4::sub(Simd4::load(node.minY), oy), iy);
+	Simd4::Float t2y = Simd4::mul(Simd4::sub(Simd4::load(node.maxY), oy), iy);
+	Simd4::Float t1z = Simd4::mul(Simd4::sub(Simd4::load(node.minZ), oz), iz);
+	Simd4::Float t2z = Simd4::mul(Simd4::sub(Simd4::load(node.maxZ), oz), iz);
+
+	Simd4::Float tNear = Simd4::max(Simd4::max(Simd4::min(t1x, t2x), Simd4::min(t1y, t2y)), Simd4::max(Simd4::min(t1z, t2z), Simd4::set1(0.0f)));
+	Simd4::Float tFar = Simd4::min(Simd4::min(Simd4::max(t1x, t2x), Simd4::max(t1y, t2y)), Simd4::min(Simd4::max(t1z, t2z), Simd4::set1(tMax)));
+
+	Simd4::store(tEntry, tNear);
+	int mask = Simd4::moveMask(Simd4::cmple(tNear, tFar));
+
+	// the slab test is symmetric in min/max, so empty slots have to be masked off
+	for (uint32_t slot = 0; slot < WIDTH; slot++) {
+		if (node.child[slot] == INVALID) mask &= ~(1 << slot);
+	}
+	return mask;
+}
+
+bool Bvh::intersectBox(const glm::vec3& min, const glm::vec3& max, const Ray& ray, float& t) const
+{
+	float tNear = 0.0f;
+	float tFar = ray.tMax;
+	for (int i = 0; i < 3; i++) {
+		// parallel to the slab: 0 * inf would be nan for an origin on its plane, the ray is
+		// either inside it all along or never
+		if (ray.direction[i] == 0.0f) {
+			if (ray.origin[i] < min[i] || ray.origin[i] > max[i]) return false;
+			continue;
+		}
+
+		float invDir = 1.0f / ray.direction[i];
+		float t1 = (min[i] - ray.origin[i]) * invDir;
+		float t2 = (max[i] - ray.origin[i]) * invDir;
+		tNear = std::max(tNear, std::min(t1, t2));
+		tFar = std::min(tFar, std::max(t1, t2));
+	}
+
+	t = tNear;
+	return tNear <= tFar;
+}
+
+bool Bvh::raycast(const Ray& ray, RayHit& hit) const
+{
+	return raycast(ray, hit, [this](uint32_t prim, const Ray& r, float) {
+		float t;
+		return intersectBox(primMin[prim], primMax[prim], r, t) ? t : -1.0f;
+	});
+}
+
+void Bvh::raycastBatch(JobSystem& jobs, const Ray* rays, uint32_t count, RayHit* hits) const
+{
+	jobs.parallelFor(count, 64, [&](uint32_t i) {
+		raycast(rays[i], hits[i]);
+	});
+}
+
+bool Bvh::pick(const glm::mat4& viewProj, const glm::vec2& ndc, RayHit& hit) const
+{
+	// unproject the point on the near and far planes, zero to one depth
+	glm::mat4 inverse = glm::inverse(viewProj);
+	glm::vec4 nearPoint = inverse * glm::vec4(ndc, 0.0f, 1.0f);
+	glm::vec4 farPoint = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+
+	Ray ray;
+	ray.origin = glm::vec3(nearPoint);
+	ray.direction = glm::vec3(farPoint) - glm::vec3(nearPoint);
+	ray.tMax = glm::length(ray.direction);
+	ray.direction /= ray.tMax;
+
+	return raycast(ray, hit);
+}
+
+uint32_t Bvh::getNodeCount() const
+{
+	return (uint32_t)nodes.size();
+}
+
+uint32_t Bvh::getPrimitiveCount() const
+{
+	return (uint32_t)primIndices.size();
+}
@@ -0,0 +1,163 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../Culling/Frustum.h"
+#include "../Jobs/JobSystem.h"
+
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+	float tMax;
+};
+
+struct RayHit {
+	// distance along the ray, only valid if prim != INVALID
+	float t;
+	uint32_t prim;
+};
+
+// four wide bounding volume hierarchy over instance AABBs.
+// Built with binned SAH into a binary tree which is then collapsed so every node holds
+// up to four children. Child boxes are stored SoA so a node is tested with one SIMD op
+// per plane/axis. Nodes are laid out depth first with children after their parent,
+// which lets refit walk the array backwards without recursion.
+class Bvh {
+public:
+	static const uint32_t WIDTH = 4;
+	static const uint32_t MAX_LEAF_SIZE = 4;
+	static const uint32_t INVALID = 0xFFFFFFFF;
+	// deepest binary build level, which bounds the traversal stack. SAH splits stop early enough
+	// that median splits from there still end in leaves by this depth
+	static const uint32_t MAX_BUILD_DEPTH = 48;
+	static const uint32_t STACK_SIZE = MAX_BUILD_DEPTH * (WIDTH - 1) + 2;
+
+	struct alignas(16) Node {
+		float minX[WIDTH];
+		float minY[WIDTH];
+		float minZ[WIDTH];
+		float maxX[WIDTH];
+		float maxY[WIDTH];
+		float maxZ[WIDTH];
+		// count == 0: child is a node index (or INVALID for an empty slot)
+		// count > 0: child is the first entry in the primitive index list
+		uint32_t child[WIDTH];
+		uint32_t count[WIDTH];
+	};
+
+	void build(const glm::vec3* mins, const glm::vec3* maxs, uint32_t count);
+
+	// moving objects: update their boxes then refit, the topology is kept.
+	// Rebuild once the tree quality degrades from large movements
+	void setBounds(uint32_t prim, const glm::vec3& min, const glm::vec3& max);
+	void refit();
+
+	// appends every primitive whose box intersects the frustum
+	void cullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+	// closest primitive box hit along the ray
+	bool raycast(const Ray& ray, RayHit& hit) const;
+	// rays are split across the job system's workers
+	void raycastBatch(JobSystem& jobs, const Ray* rays, uint32_t count, RayHit* hits) const;
+
+	// closest hit where primitiveTest(prim, ray, tMax) returns the exact distance or a negative miss.
+	// Boxes are only used to reject, so meshes can be tested precisely
+	template<typename Fn>
+	bool raycast(const Ray& ray, RayHit& hit, Fn primitiveTest) const;
+
+	// ray through a point in normalized device coordinates
+	bool pick(const glm::mat4& viewProj, const glm::vec2& ndc, RayHit& hit) const;
+
+	uint32_t getNodeCount() const;
+	uint32_t getPrimitiveCount() const;
+
+private:
+	struct BuildNode {
+		glm::vec3 min;
+		glm::vec3 max;
+		uint32_t left;
+		uint32_t right;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	uint32_t buildRecursive(uint32_t first, uint32_t count, uint32_t depth);
+	uint32_t collapse(uint32_t binary);
+	void setSlot(Node& node, uint32_t slot, const glm::vec3& min, const glm::vec3& max, uint32_t child, uint32_t count);
+
+	// slab test of all four children, returns a lane mask and the entry distances
+	int intersectNode(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* tEntry) const;
+	bool intersectBox(const glm::vec3& min, const glm::vec3& max, const Ray& ray, float& t) const;
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> primIndices;
+	std::vector<glm::vec3> primMin;
+	std::vector<glm::vec3> primMax;
+
+	// build scratch
+	std::vector<BuildNode> buildNodes;
+	std::vector<glm::vec3> centroids;
+};
+
+template<typename Fn>
+bool Bvh::raycast(const Ray& ray, RayHit& hit, Fn primitiveTest) const
+{
+	hit.t = ray.tMax;
+	hit.prim = INVALID;
+	if (nodes.empty()) return false;
+
+	// zero components would give inf * 0 = nan in the slab test
+	glm::vec3 dir = ray.direction;
+	for (int i = 0; i < 3; i++) {
+		if (dir[i] == 0.0f) dir[i] = 1e-20f;
+	}
+	glm::vec3 invDir = 1.0f / dir;
+
+	uint32_t stack[STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+
+		float tEntry[WIDTH];
+		int mask = intersectNode(node, ray.origin, invDir, hit.t, tEntry);
+		if (mask == 0) continue;
+
+		// push far children first so the nearest is popped next
+		uint32_t order[WIDTH];
+		uint32_t hits = 0;
+		for (uint32_t i = 0; i < WIDTH; i++) {
+			if (mask & (1 << i)) order[hits++] = i;
+		}
+		for (uint32_t i = 1; i < hits; i++) {
+			for (uint32_t j = i; j > 0 && tEntry[order[j]] > tEntry[order[j - 1]]; j--) {
+				std::swap(order[j], order[j - 1]);
+			}
+		}
+
+		for (uint32_t i = 0; i < hits; i++) {
+			uint32_t slot = order[i];
+			if (node.count[slot] == 0) {
+				stack[stackSize++] = node.child[slot];
+				continue;
+			}
+
+			for (uint32_t p = node.child[slot]; p < node.child[slot] + node.count[slot]; p++) {
+				uint32_t prim = primIndices[p];
+				float t = primitiveTest(prim, ray, hit.t);
+				if (t >= 0.0f && t < hit.t) {
+					hit.t = t;
+					hit.prim = prim;
+				}
+			}
+		}
+	}
+
+	return hit.prim != INVALID;
+}
+
+#endif